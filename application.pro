@@ -13,12 +13,31 @@ HEADERS += \
     sources/model.h \
     sources/pluginhandler.h \
     sources/shortcuthandler.h \
+    sources/diskcache.h \
+    sources/documentregistry.h \
+    sources/filechangedetector.h \
+    sources/imagebufferpool.h \
+    sources/imageexporter.h \
+    sources/linkpreloader.h \
+    sources/cachebudget.h \
+    sources/renderscheduler.h \
+    sources/scheduledjobs.h \
+    sources/renderworkerpool.h \
+    sources/renderstatistics.h \
+    sources/tracing.h \
+    sources/prefetchplanner.h \
+    sources/textlayout.h \
+    sources/lazypage.h \
     sources/rendertask.h \
+    sources/tilecache.h \
     sources/tileitem.h \
+    sources/hittestindex.h \
     sources/pageitem.h \
     sources/thumbnailitem.h \
     sources/presentationview.h \
+    sources/outlinemodel.h \
     sources/searchmodel.h \
+    sources/textindex.h \
     sources/searchtask.h \
     sources/miscellaneous.h \
     sources/documentlayout.h \
@@ -26,6 +45,7 @@ HEADERS += \
     sources/printdialog.h \
     sources/settingsdialog.h \
     sources/fontsdialog.h \
+    sources/statisticsdialog.h \
     sources/helpdialog.h \
     sources/recentlyusedmenu.h \
     sources/recentlyclosedmenu.h \
@@ -39,12 +59,30 @@ SOURCES += \
     sources/settings.cpp \
     sources/pluginhandler.cpp \
     sources/shortcuthandler.cpp \
+    sources/diskcache.cpp \
+    sources/documentregistry.cpp \
+    sources/filechangedetector.cpp \
+    sources/imagebufferpool.cpp \
+    sources/imageexporter.cpp \
+    sources/linkpreloader.cpp \
+    sources/cachebudget.cpp \
+    sources/renderscheduler.cpp \
+    sources/renderworkerpool.cpp \
+    sources/renderstatistics.cpp \
+    sources/tracing.cpp \
+    sources/prefetchplanner.cpp \
+    sources/textlayout.cpp \
+    sources/lazypage.cpp \
     sources/rendertask.cpp \
+    sources/tilecache.cpp \
     sources/tileitem.cpp \
+    sources/hittestindex.cpp \
     sources/pageitem.cpp \
     sources/thumbnailitem.cpp \
     sources/presentationview.cpp \
+    sources/outlinemodel.cpp \
     sources/searchmodel.cpp \
+    sources/textindex.cpp \
     sources/searchtask.cpp \
     sources/miscellaneous.cpp \
     sources/documentlayout.cpp \
@@ -52,6 +90,7 @@ SOURCES += \
     sources/printdialog.cpp \
     sources/settingsdialog.cpp \
     sources/fontsdialog.cpp \
+    sources/statisticsdialog.cpp \
     sources/helpdialog.cpp \
     sources/recentlyusedmenu.cpp \
     sources/recentlyclosedmenu.cpp \
@@ -85,6 +124,11 @@ greaterThan(QT_MAJOR_VERSION, 4): QT += concurrent widgets printsupport
     QT += dbus
 }
 
+!without_opengl {
+    DEFINES += WITH_OPENGL
+    QT += opengl
+}
+
 DEFINES += PLUGIN_INSTALL_PATH=\\\"$${PLUGIN_INSTALL_PATH}\\\"
 
 !without_pdf {
@@ -201,6 +245,9 @@ with_fitz {
 
     INCLUDEPATH += synctex
     SOURCES += synctex/synctex_parser.c synctex/synctex_parser_utils.c
+
+    HEADERS += sources/synctexscanner.h
+    SOURCES += sources/synctexscanner.cpp
 }
 
 lessThan(QT_MAJOR_VERSION, 5) : !without_magic {
@@ -0,0 +1,73 @@
+include(qpdfview.pri)
+
+TARGET = qpdfview_benchmark
+TEMPLATE = app
+CONFIG += console
+
+OBJECTS_DIR = objects-benchmark
+MOC_DIR = moc-benchmark
+
+HEADERS += \
+    sources/global.h \
+    sources/model.h \
+    sources/pluginhandler.h \
+    sources/lazypage.h \
+    sources/renderworkerpool.h \
+    sources/textlayout.h \
+    sources/textindex.h \
+    sources/searchtask.h \
+    sources/renderstatistics.h \
+    sources/tracing.h \
+    sources/benchmark.h
+
+SOURCES += \
+    sources/pluginhandler.cpp \
+    sources/lazypage.cpp \
+    sources/renderworkerpool.cpp \
+    sources/textlayout.cpp \
+    sources/textindex.cpp \
+    sources/searchtask.cpp \
+    sources/renderstatistics.cpp \
+    sources/tracing.cpp \
+    sources/benchmark.cpp
+
+QT += core gui
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += concurrent widgets
+
+DEFINES += PLUGIN_INSTALL_PATH=\\\"$${PLUGIN_INSTALL_PATH}\\\"
+
+# The benchmark only loads the plug-ins dynamically, so it measures the same shared libraries as the application.
+
+!without_pdf {
+    DEFINES += WITH_PDF
+
+    isEmpty(PDF_PLUGIN_NAME):PDF_PLUGIN_NAME = libqpdfview_pdf.so
+    DEFINES += PDF_PLUGIN_NAME=\\\"$${PDF_PLUGIN_NAME}\\\"
+}
+
+!without_ps {
+    DEFINES += WITH_PS
+
+    isEmpty(PS_PLUGIN_NAME):PS_PLUGIN_NAME = libqpdfview_ps.so
+    DEFINES += PS_PLUGIN_NAME=\\\"$${PS_PLUGIN_NAME}\\\"
+}
+
+!without_djvu {
+    DEFINES += WITH_DJVU
+
+    isEmpty(DJVU_PLUGIN_NAME):DJVU_PLUGIN_NAME = libqpdfview_djvu.so
+    DEFINES += DJVU_PLUGIN_NAME=\\\"$${DJVU_PLUGIN_NAME}\\\"
+}
+
+with_fitz {
+    DEFINES += WITH_FITZ
+
+    isEmpty(FITZ_PLUGIN_NAME):FITZ_PLUGIN_NAME = libqpdfview_fitz.so
+    DEFINES += FITZ_PLUGIN_NAME=\\\"$${FITZ_PLUGIN_NAME}\\\"
+}
+
+lessThan(QT_MAJOR_VERSION, 5) : !without_magic {
+    DEFINES += WITH_MAGIC
+    LIBS += -lmagic
+}
@@ -30,6 +30,7 @@ greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
     system(pkg-config --atleast-version=0.22 $${poppler_qt_pkg}):DEFINES += HAS_POPPLER_22
     system(pkg-config --atleast-version=0.24 $${poppler_qt_pkg}):DEFINES += HAS_POPPLER_24
     system(pkg-config --atleast-version=0.26 $${poppler_qt_pkg}):DEFINES += HAS_POPPLER_26
+    greaterThan(QT_MAJOR_VERSION, 4):system(pkg-config --atleast-version=0.63 $${poppler_qt_pkg}):DEFINES += HAS_POPPLER_63
 } else {
     DEFINES += $$PDF_PLUGIN_DEFINES
     INCLUDEPATH += $$PDF_PLUGIN_INCLUDEPATH
@@ -25,6 +25,11 @@ with_fitz {
 
 SUBDIRS += application.pro
 
+with_benchmark {
+    SUBDIRS += benchmark.pro
+    benchmark.pro.depends = application.pro
+}
+
 TRANSLATIONS += \
     translations/qpdfview_ast.ts \
     translations/qpdfview_az.ts \
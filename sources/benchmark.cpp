@@ -0,0 +1,776 @@
+/*
+
+Copyright 2014 Adam Reichold
+
+This file is part of qpdfview.
+
+qpdfview is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+qpdfview is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "benchmark.h"
+
+#include <iostream>
+
+#include <QApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QImage>
+#include <QMutex>
+#include <QRegExp>
+#include <QRunnable>
+#include <QScopedPointer>
+#include <QStringList>
+#include <QThread>
+#include <QThreadPool>
+#include <QtAlgorithms>
+#include <QVector>
+#include <qmath.h>
+
+#if defined(Q_OS_UNIX) && !defined(Q_OS_LINUX)
+
+#include <sys/resource.h>
+
+#endif // Q_OS_UNIX
+
+#include "lazypage.h"
+#include "model.h"
+#include "pluginhandler.h"
+#include "searchtask.h"
+
+namespace
+{
+
+using namespace qpdfview;
+
+enum ExitStatus
+{
+    ExitOk = 0,
+    ExitUnknownArgument = 1,
+    ExitIllegalArgument = 2,
+    ExitDocumentError = 3
+};
+
+int firstPage = 1;
+int lastPage = -1;
+
+qreal resolution = 72.0;
+Rotation rotation = RotateBy0;
+
+int tileSize = 0;
+int threadCount = QThread::idealThreadCount();
+int repeatCount = 1;
+
+// Searching replaces rendering if at least one query is given.
+
+QStringList queries;
+
+bool matchCase = false;
+bool wholeWords = false;
+bool regularExpression = false;
+
+QStringList filePaths;
+
+int parseInteger(const QString& option, const QString& argument, int minimum)
+{
+    bool ok = false;
+    const int value = argument.toInt(&ok);
+
+    if(!ok || value < minimum)
+    {
+        qCritical() << QObject::tr("The argument of '%1' must be an integer of at least %2.").arg(option).arg(minimum);
+        exit(ExitIllegalArgument);
+    }
+
+    return value;
+}
+
+void parseCommandLineArguments()
+{
+    QStringList arguments = QApplication::arguments();
+
+    if(!arguments.isEmpty())
+    {
+        arguments.removeFirst();
+    }
+
+    QRegExp pagesRegExp("(\\d+)-(\\d*)");
+
+    while(!arguments.isEmpty())
+    {
+        const QString argument = arguments.takeFirst();
+
+        if(!argument.startsWith("--"))
+        {
+            filePaths.append(argument);
+
+            continue;
+        }
+
+        if(argument == QLatin1String("--help"))
+        {
+            std::cout << "Usage: qpdfview_benchmark [options] file ..." << std::endl
+                      << std::endl
+                      << "Available options:" << std::endl
+                      << "  --help                 Show this information" << std::endl
+                      << "  --pages first-[last]   Render the given range of pages" << std::endl
+                      << "  --resolution dpi       Render at the given resolution (default: 72)" << std::endl
+                      << "  --rotation degrees     Render rotated by 0, 90, 180 or 270 degrees" << std::endl
+                      << "  --tile-size pixels     Render the pages in square tiles of the given size" << std::endl
+                      << "  --threads count        Render using the given number of threads" << std::endl
+                      << "  --repeat count         Render or search every page the given number of times" << std::endl
+                      << "  --search text          Search for the given text instead of rendering" << std::endl
+                      << "  --queries file         Search for every line of the given file" << std::endl
+                      << "  --match-case           Search case-sensitively" << std::endl
+                      << "  --whole-words          Search for whole words only" << std::endl
+                      << "  --regular-expression   Search for regular expressions" << std::endl
+                      << std::endl
+                      << "The results are written as one JSON object per file." << std::endl;
+
+            exit(ExitOk);
+        }
+
+        if(argument == QLatin1String("--match-case"))
+        {
+            matchCase = true;
+
+            continue;
+        }
+        else if(argument == QLatin1String("--whole-words"))
+        {
+            wholeWords = true;
+
+            continue;
+        }
+        else if(argument == QLatin1String("--regular-expression"))
+        {
+            regularExpression = true;
+
+            continue;
+        }
+
+        if(arguments.isEmpty())
+        {
+            qCritical() << QObject::tr("Using '%1' requires an argument.").arg(argument);
+            exit(ExitIllegalArgument);
+        }
+
+        const QString value = arguments.takeFirst();
+
+        if(argument == QLatin1String("--pages"))
+        {
+            if(!pagesRegExp.exactMatch(value))
+            {
+                qCritical() << QObject::tr("The argument of '--pages' must be a range like '3-7' or '3-'.");
+                exit(ExitIllegalArgument);
+            }
+
+            firstPage = qMax(pagesRegExp.cap(1).toInt(), 1);
+            lastPage = pagesRegExp.cap(2).isEmpty() ? -1 : pagesRegExp.cap(2).toInt();
+        }
+        else if(argument == QLatin1String("--resolution"))
+        {
+            resolution = parseInteger(argument, value, 1);
+        }
+        else if(argument == QLatin1String("--rotation"))
+        {
+            const int degrees = parseInteger(argument, value, 0);
+
+            if(degrees % 90 != 0 || degrees >= 360)
+            {
+                qCritical() << QObject::tr("The argument of '--rotation' must be 0, 90, 180 or 270.");
+                exit(ExitIllegalArgument);
+            }
+
+            rotation = static_cast< Rotation >(degrees / 90);
+        }
+        else if(argument == QLatin1String("--tile-size"))
+        {
+            tileSize = parseInteger(argument, value, 0);
+        }
+        else if(argument == QLatin1String("--threads"))
+        {
+            threadCount = parseInteger(argument, value, 1);
+        }
+        else if(argument == QLatin1String("--repeat"))
+        {
+            repeatCount = parseInteger(argument, value, 1);
+        }
+        else if(argument == QLatin1String("--search"))
+        {
+            queries.append(value);
+        }
+        else if(argument == QLatin1String("--queries"))
+        {
+            QFile file(value);
+
+            if(!file.open(QIODevice::ReadOnly | QIODevice::Text))
+            {
+                qCritical() << QObject::tr("Could not read queries from '%1'.").arg(value);
+                exit(ExitIllegalArgument);
+            }
+
+            foreach(const QString& line, QString::fromUtf8(file.readAll()).split(QLatin1Char('\n'), QString::SkipEmptyParts))
+            {
+                queries.append(line);
+            }
+        }
+        else
+        {
+            qCritical() << QObject::tr("Unknown command-line option '%1'.").arg(argument);
+            exit(ExitUnknownArgument);
+        }
+    }
+
+    if(filePaths.isEmpty())
+    {
+        qCritical() << QObject::tr("At least one file is required.");
+        exit(ExitIllegalArgument);
+    }
+}
+
+QList< QRect > tileRects(const QSizeF& size)
+{
+    qreal width = resolution / 72.0 * size.width();
+    qreal height = resolution / 72.0 * size.height();
+
+    if(rotation == RotateBy90 || rotation == RotateBy270)
+    {
+        qSwap(width, height);
+    }
+
+    const QRect rect(0, 0, qCeil(width), qCeil(height));
+
+    if(tileSize <= 0)
+    {
+        return QList< QRect >() << rect;
+    }
+
+    QList< QRect > rects;
+
+    for(int top = 0; top < rect.height(); top += tileSize)
+    {
+        for(int left = 0; left < rect.width(); left += tileSize)
+        {
+            rects.append(QRect(left, top, qMin(tileSize, rect.width() - left), qMin(tileSize, rect.height() - top)));
+        }
+    }
+
+    return rects;
+}
+
+qint64 elapsedMicroseconds(const QElapsedTimer& timer)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(4,8,0)
+
+    return timer.nsecsElapsed() / 1000;
+
+#else
+
+    return timer.elapsed() * 1000;
+
+#endif // QT_VERSION
+}
+
+struct Results
+{
+    QMutex mutex;
+
+    // per page in microseconds
+    QVector< qint64 > latencies;
+
+    int tileCount;
+    int failureCount;
+
+    Results() : mutex(), latencies(), tileCount(0), failureCount(0) {}
+
+};
+
+class RenderJob : public QRunnable
+{
+public:
+    RenderJob(const Model::Page* page, Results* results) : QRunnable(),
+        m_page(page),
+        m_results(results)
+    {
+        setAutoDelete(true);
+    }
+
+    void run()
+    {
+        const QList< QRect > rects = tileRects(m_page->size());
+
+        int failureCount = 0;
+
+        QElapsedTimer timer;
+        timer.start();
+
+        foreach(const QRect& rect, rects)
+        {
+            if(m_page->render(resolution, resolution, rotation, rect).isNull())
+            {
+                ++failureCount;
+            }
+        }
+
+        const qint64 latency = elapsedMicroseconds(timer);
+
+        QMutexLocker mutexLocker(&m_results->mutex);
+
+        m_results->latencies.append(latency);
+        m_results->tileCount += rects.count();
+        m_results->failureCount += failureCount;
+    }
+
+private:
+    Q_DISABLE_COPY(RenderJob)
+
+    const Model::Page* m_page;
+    Results* m_results;
+
+};
+
+qreal percentile(const QVector< qint64 >& sortedValues, qreal percent)
+{
+    if(sortedValues.isEmpty())
+    {
+        return 0.0;
+    }
+
+    const int index = qBound(0, qCeil(percent / 100.0 * sortedValues.count()) - 1, sortedValues.count() - 1);
+
+    return sortedValues.at(index) / 1000.0;
+}
+
+// peak resident set size in kilobytes or negative if it is not known
+
+qint64 peakMemory()
+{
+#if defined(Q_OS_LINUX)
+
+    QFile file(QLatin1String("/proc/self/status"));
+
+    if(file.open(QIODevice::ReadOnly))
+    {
+        const QByteArray status = file.readAll();
+        const int index = status.indexOf("VmHWM:");
+
+        if(index >= 0)
+        {
+            const int begin = index + 6;
+            const int end = status.indexOf("kB", begin);
+
+            bool ok = false;
+            const qint64 value = status.mid(begin, end - begin).trimmed().toLongLong(&ok);
+
+            if(ok)
+            {
+                return value;
+            }
+        }
+    }
+
+    return -1;
+
+#elif defined(Q_OS_UNIX)
+
+    struct rusage usage;
+
+    if(getrusage(RUSAGE_SELF, &usage) != 0)
+    {
+        return -1;
+    }
+
+#if defined(Q_OS_MAC)
+
+    return usage.ru_maxrss / 1024;
+
+#else
+
+    return usage.ru_maxrss;
+
+#endif // Q_OS_MAC
+
+#else
+
+    return -1;
+
+#endif // Q_OS_LINUX
+}
+
+QString jsonString(const QString& string)
+{
+    QString escaped;
+    escaped.reserve(string.length() + 2);
+
+    escaped.append(QLatin1Char('"'));
+
+    foreach(const QChar& character, string)
+    {
+        if(character == QLatin1Char('"') || character == QLatin1Char('\\'))
+        {
+            escaped.append(QLatin1Char('\\'));
+            escaped.append(character);
+        }
+        else if(character.unicode() < 0x20)
+        {
+            escaped.append(QString::fromLatin1("\\u%1").arg(character.unicode(), 4, 16, QLatin1Char('0')));
+        }
+        else
+        {
+            escaped.append(character);
+        }
+    }
+
+    escaped.append(QLatin1Char('"'));
+
+    return escaped;
+}
+
+bool loadPages(const QString& filePath, const Model::Document* document, int& first, int& last, QVector< Model::Page* >& pages)
+{
+    if(document == 0 || document->isLocked())
+    {
+        qCritical() << QObject::tr("Could not open '%1'.").arg(filePath);
+
+        return false;
+    }
+
+    const int numberOfPages = document->numberOfPages();
+
+    if(numberOfPages < 1)
+    {
+        qCritical() << QObject::tr("'%1' does not contain any pages.").arg(filePath);
+
+        return false;
+    }
+
+    first = qMin(firstPage, numberOfPages);
+    last = lastPage < first ? numberOfPages : qMin(lastPage, numberOfPages);
+
+    for(int index = first - 1; index < last; ++index)
+    {
+        Model::Page* page = document->page(index);
+
+        if(page == 0)
+        {
+            qCritical() << QObject::tr("Could not load page %1 of '%2'.").arg(index + 1).arg(filePath);
+
+            qDeleteAll(pages);
+            pages.clear();
+
+            return false;
+        }
+
+        pages.append(page);
+    }
+
+    return true;
+}
+
+bool benchmarkRendering(const QString& filePath, QThreadPool& threadPool)
+{
+    const QScopedPointer< Model::Document > document(PluginHandler::instance()->loadDocument(filePath));
+
+    int first = 0;
+    int last = 0;
+    QVector< Model::Page* > pages;
+
+    if(!loadPages(filePath, document.data(), first, last, pages))
+    {
+        return false;
+    }
+
+    Results results;
+    results.latencies.reserve(repeatCount * pages.count());
+
+    QElapsedTimer timer;
+    timer.start();
+
+    for(int repeat = 0; repeat < repeatCount; ++repeat)
+    {
+        foreach(const Model::Page* page, pages)
+        {
+            threadPool.start(new RenderJob(page, &results));
+        }
+    }
+
+    threadPool.waitForDone();
+
+    const qint64 duration = qMax(timer.elapsed(), Q_INT64_C(1));
+
+    qDeleteAll(pages);
+
+    qSort(results.latencies);
+
+    std::cout << "{"
+              << "\"file\": " << jsonString(filePath).toUtf8().constData() << ", "
+              << "\"backend\": " << jsonString(PluginHandler::fileTypeName(PluginHandler::fileType(filePath))).toUtf8().constData() << ", "
+              << "\"firstPage\": " << first << ", "
+              << "\"lastPage\": " << last << ", "
+              << "\"resolution\": " << resolution << ", "
+              << "\"rotation\": " << 90 * rotation << ", "
+              << "\"tileSize\": " << tileSize << ", "
+              << "\"threads\": " << threadPool.maxThreadCount() << ", "
+              << "\"repeat\": " << repeatCount << ", "
+              << "\"renderedPages\": " << results.latencies.count() << ", "
+              << "\"renderedTiles\": " << results.tileCount << ", "
+              << "\"failedTiles\": " << results.failureCount << ", "
+              << "\"durationMs\": " << duration << ", "
+              << "\"pagesPerSecond\": " << 1000.0 * results.latencies.count() / duration << ", "
+              << "\"latencyMs\": {"
+              << "\"p50\": " << percentile(results.latencies, 50.0) << ", "
+              << "\"p90\": " << percentile(results.latencies, 90.0) << ", "
+              << "\"p99\": " << percentile(results.latencies, 99.0) << ", "
+              << "\"max\": " << percentile(results.latencies, 100.0)
+              << "}, "
+              << "\"peakMemoryKb\": " << peakMemory()
+              << "}" << std::endl;
+
+    return true;
+}
+
+qreal pagesPerSecond(int pageCount, qint64 microseconds)
+{
+    return 1.0e6 * pageCount / qMax(microseconds, Q_INT64_C(1));
+}
+
+QString searchTaskJson(const SearchListener& listener, int pageCount)
+{
+    return QString::fromLatin1("{\"firstResultMs\": %1, \"durationMs\": %2, \"hits\": %3, \"pagesPerSecond\": %4}")
+            .arg(listener.firstResultTime())
+            .arg(listener.duration())
+            .arg(listener.results().count())
+            .arg(pagesPerSecond(pageCount, 1000 * listener.duration()));
+}
+
+bool benchmarkSearch(const QString& filePath)
+{
+    const QScopedPointer< Model::Document > document(PluginHandler::instance()->loadDocument(filePath));
+
+    int first = 0;
+    int last = 0;
+    QVector< Model::Page* > pages;
+
+    if(!loadPages(filePath, document.data(), first, last, pages))
+    {
+        return false;
+    }
+
+    // The backends extract the text of whole pages directly, i.e. without the text layout used by the application.
+
+    qint64 textCharacters = 0;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    for(int repeat = 0; repeat < repeatCount; ++repeat)
+    {
+        foreach(const Model::Page* page, pages)
+        {
+            textCharacters += page->text(QRectF(QPointF(), page->size())).length();
+        }
+    }
+
+    const qint64 textDuration = elapsedMicroseconds(timer);
+
+    QStringList queryResults;
+
+    foreach(const QString& query, queries)
+    {
+        // Patterns can not be passed to the backends, which only search for literal text.
+
+        QString backendSearch = QLatin1String("null");
+
+        if(!regularExpression)
+        {
+            int hits = 0;
+
+            timer.restart();
+
+            for(int repeat = 0; repeat < repeatCount; ++repeat)
+            {
+                foreach(const Model::Page* page, pages)
+                {
+                    hits += page->search(query, matchCase).count();
+                }
+            }
+
+            const qint64 duration = elapsedMicroseconds(timer);
+
+            backendSearch = QString::fromLatin1("{\"durationMs\": %1, \"hits\": %2, \"pagesPerSecond\": %3}")
+                    .arg(duration / 1000.0)
+                    .arg(hits / repeatCount)
+                    .arg(pagesPerSecond(repeatCount * pages.count(), duration));
+        }
+
+        // The lazy pages are created anew for every query so that its first search has to extract the text layouts like after opening a document.
+
+        QVector< Model::Page* > lazyPages;
+        lazyPages.reserve(pages.count());
+
+        for(int index = first - 1; index < last; ++index)
+        {
+            lazyPages.append(new LazyPage(document.data(), index, document->pageSizeHint(index)));
+        }
+
+        SearchListener listener;
+
+        listener.search(lazyPages, query, matchCase, wholeWords, regularExpression);
+
+        const QString coldSearch = searchTaskJson(listener, lazyPages.count());
+
+        for(int repeat = 0; repeat < repeatCount; ++repeat)
+        {
+            listener.search(lazyPages, query, matchCase, wholeWords, regularExpression);
+        }
+
+        const QString warmSearch = searchTaskJson(listener, lazyPages.count());
+
+        // The search model fetches the surrounding text of every result to display it.
+
+        qint64 surroundingCharacters = 0;
+
+        timer.restart();
+
+        foreach(const SearchListener::Result& result, listener.results())
+        {
+            surroundingCharacters += static_cast< const LazyPage* >(lazyPages.at(result.first))->surroundingText(result.second).length();
+        }
+
+        const qint64 surroundingDuration = elapsedMicroseconds(timer);
+
+        qDeleteAll(lazyPages);
+
+        queryResults.append(QString::fromLatin1("{\"query\": %1, \"backendSearch\": %2, \"searchTask\": {\"cold\": %3, \"warm\": %4}, \"surroundingText\": {\"durationMs\": %5, \"characters\": %6}}")
+                            .arg(jsonString(query), backendSearch, coldSearch, warmSearch,
+                                 QString::number(surroundingDuration / 1000.0), QString::number(surroundingCharacters)));
+    }
+
+    qDeleteAll(pages);
+
+    std::cout << "{"
+              << "\"file\": " << jsonString(filePath).toUtf8().constData() << ", "
+              << "\"backend\": " << jsonString(PluginHandler::fileTypeName(PluginHandler::fileType(filePath))).toUtf8().constData() << ", "
+              << "\"firstPage\": " << first << ", "
+              << "\"lastPage\": " << last << ", "
+              << "\"matchCase\": " << (matchCase ? "true" : "false") << ", "
+              << "\"wholeWords\": " << (wholeWords ? "true" : "false") << ", "
+              << "\"regularExpression\": " << (regularExpression ? "true" : "false") << ", "
+              << "\"repeat\": " << repeatCount << ", "
+              << "\"text\": {"
+              << "\"durationMs\": " << textDuration / 1000.0 << ", "
+              << "\"characters\": " << textCharacters / repeatCount << ", "
+              << "\"pagesPerSecond\": " << pagesPerSecond(repeatCount * pages.count(), textDuration)
+              << "}, "
+              << "\"queries\": [" << queryResults.join(QLatin1String(", ")).toUtf8().constData() << "], "
+              << "\"peakMemoryKb\": " << peakMemory()
+              << "}" << std::endl;
+
+    return true;
+}
+
+} // anonymous
+
+namespace qpdfview
+{
+
+SearchListener::SearchListener(QObject* parent) : QObject(parent),
+    m_searchTask(new SearchTask(this)),
+    m_eventLoop(),
+    m_timer(),
+    m_firstResultTime(-1),
+    m_duration(0),
+    m_results()
+{
+    connect(m_searchTask, SIGNAL(finished()), SLOT(on_searchTask_finished()));
+    connect(m_searchTask, SIGNAL(resultsReady(int,QList<QRectF>)), SLOT(on_searchTask_resultsReady(int,QList<QRectF>)));
+}
+
+void SearchListener::search(const QVector< Model::Page* >& pages, const QString& text, bool matchCase, bool wholeWords, bool regularExpression)
+{
+    m_firstResultTime = -1;
+    m_duration = 0;
+    m_results.clear();
+
+    m_timer.start();
+
+    m_searchTask->start(pages, text, matchCase, wholeWords, regularExpression);
+
+    m_eventLoop.exec();
+}
+
+void SearchListener::on_searchTask_resultsReady(int index, const QList< QRectF >& results)
+{
+    if(m_firstResultTime < 0 && !results.isEmpty())
+    {
+        m_firstResultTime = m_timer.elapsed();
+    }
+
+    foreach(const QRectF& rect, results)
+    {
+        m_results.append(qMakePair(index, rect));
+    }
+}
+
+void SearchListener::on_searchTask_finished()
+{
+    m_duration = m_timer.elapsed();
+
+    m_eventLoop.quit();
+}
+
+} // qpdfview
+
+int main(int argc, char** argv)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+
+    // The benchmark does not show any windows and should run without a display.
+
+    if(qgetenv("QT_QPA_PLATFORM").isEmpty())
+    {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
+#endif // QT_VERSION
+
+    QApplication application(argc, argv);
+
+    // The plug-ins read their settings using the names of the application.
+
+    QApplication::setOrganizationDomain("local.qpdfview");
+    QApplication::setOrganizationName("qpdfview");
+    QApplication::setApplicationName("qpdfview");
+
+    parseCommandLineArguments();
+
+    QThreadPool threadPool;
+    threadPool.setMaxThreadCount(threadCount);
+
+    int exitStatus = ExitOk;
+
+    foreach(const QString& filePath, filePaths)
+    {
+        const bool ok = queries.isEmpty() ? benchmarkRendering(filePath, threadPool) : benchmarkSearch(filePath);
+
+        if(!ok)
+        {
+            exitStatus = ExitDocumentError;
+        }
+    }
+
+    return exitStatus;
+}
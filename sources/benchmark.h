@@ -0,0 +1,83 @@
+/*
+
+Copyright 2014 Adam Reichold
+
+This file is part of qpdfview.
+
+qpdfview is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+qpdfview is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QList>
+#include <QObject>
+#include <QPair>
+#include <QRectF>
+#include <QVector>
+
+namespace qpdfview
+{
+
+namespace Model
+{
+class Page;
+}
+
+class SearchTask;
+
+// Receives the results of a search task in the main thread just like the search model does, so that the time to the first result includes their delivery.
+
+class SearchListener : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SearchListener(QObject* parent = 0);
+
+    void search(const QVector< Model::Page* >& pages, const QString& text, bool matchCase, bool wholeWords, bool regularExpression);
+
+    // in milliseconds or negative if there were no results
+    inline qint64 firstResultTime() const { return m_firstResultTime; }
+    inline qint64 duration() const { return m_duration; }
+
+    typedef QPair< int, QRectF > Result;
+
+    inline const QList< Result >& results() const { return m_results; }
+
+protected slots:
+    void on_searchTask_resultsReady(int index, const QList< QRectF >& results);
+    void on_searchTask_finished();
+
+private:
+    Q_DISABLE_COPY(SearchListener)
+
+    SearchTask* m_searchTask;
+    QEventLoop m_eventLoop;
+
+    QElapsedTimer m_timer;
+    qint64 m_firstResultTime;
+    qint64 m_duration;
+
+    QList< Result > m_results;
+
+};
+
+} // qpdfview
+
+#endif // BENCHMARK_H
@@ -0,0 +1,247 @@
+/*
+
+Copyright 2014 Adam Reichold
+
+This file is part of qpdfview.
+
+qpdfview is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+qpdfview is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "cachebudget.h"
+
+#include <QApplication>
+#include <QDesktopWidget>
+#include <QFile>
+#include <QTimer>
+
+#if defined(Q_OS_WIN)
+
+#include <windows.h>
+
+#endif // Q_OS_WIN
+
+#include "settings.h"
+#include "tileitem.h"
+
+namespace
+{
+
+const int memoryInterval = 10 * 1000;
+
+const int minimumCost = 16 * 1024 * 1024;
+const int maximumCost = 1024 * 1024 * 1024;
+
+// The visible pages of the current tab and the prefetched ones around them take about this many screens.
+const int foregroundScreens = 4;
+
+// Background tabs are hibernated one by one while less than this much physical memory is available.
+const qint64 lowMemory = Q_INT64_C(256) * 1024 * 1024;
+
+#if defined(Q_OS_LINUX)
+
+qint64 readMemoryInfo(const QByteArray& memoryInfo, const char* name)
+{
+    const int index = memoryInfo.indexOf(name);
+
+    if(index == -1)
+    {
+        return -1;
+    }
+
+    const int begin = index + qstrlen(name);
+    const int end = memoryInfo.indexOf("kB", begin);
+
+    bool ok = false;
+    const qint64 value = memoryInfo.mid(begin, end - begin).trimmed().toLongLong(&ok);
+
+    return ok ? value * 1024 : -1;
+}
+
+#endif // Q_OS_LINUX
+
+} // anonymous
+
+namespace qpdfview
+{
+
+Settings* CacheBudget::s_settings = 0;
+
+CacheBudget* CacheBudget::s_instance = 0;
+
+CacheBudget* CacheBudget::instance()
+{
+    if(s_instance == 0)
+    {
+        s_instance = new CacheBudget(qApp);
+    }
+
+    return s_instance;
+}
+
+CacheBudget::~CacheBudget()
+{
+    s_instance = 0;
+}
+
+void CacheBudget::setTabCount(int tabCount)
+{
+    if(m_tabCount != tabCount)
+    {
+        m_tabCount = tabCount;
+
+        update();
+    }
+}
+
+QString CacheBudget::statistics() const
+{
+    const TileCache::Statistics& statistics = TileItem::cacheStatistics();
+
+    return tr("%1 of %2 MB used, %3 hits, %4 misses, %5 evictions (%6 of background tabs)")
+            .arg(TileItem::cacheTotalCost() / 1024 / 1024).arg(m_maxCost / 1024 / 1024)
+            .arg(statistics.hits).arg(statistics.misses)
+            .arg(statistics.evictions).arg(statistics.backgroundEvictions);
+}
+
+qint64 CacheBudget::availablePhysicalMemory()
+{
+#if defined(Q_OS_WIN)
+
+    MEMORYSTATUSEX memoryStatus;
+    memoryStatus.dwLength = sizeof(memoryStatus);
+
+    if(GlobalMemoryStatusEx(&memoryStatus))
+    {
+        return memoryStatus.ullAvailPhys;
+    }
+
+    return -1;
+
+#elif defined(Q_OS_LINUX)
+
+    QFile file("/proc/meminfo");
+
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        return -1;
+    }
+
+    const QByteArray memoryInfo = file.readAll();
+
+    const qint64 available = readMemoryInfo(memoryInfo, "MemAvailable:");
+
+    if(available >= 0)
+    {
+        return available;
+    }
+
+    const qint64 freeMemory = readMemoryInfo(memoryInfo, "MemFree:");
+    const qint64 buffers = readMemoryInfo(memoryInfo, "Buffers:");
+    const qint64 cached = readMemoryInfo(memoryInfo, "Cached:");
+
+    return freeMemory >= 0 ? freeMemory + qMax(buffers, Q_INT64_C(0)) + qMax(cached, Q_INT64_C(0)) : -1;
+
+#else
+
+    return -1;
+
+#endif // Q_OS_WIN Q_OS_LINUX
+}
+
+void CacheBudget::update()
+{
+    const int cacheSize = s_settings->pageItem().cacheSize();
+
+    if(cacheSize >= 0)
+    {
+        m_maxCost = cacheSize;
+        m_backgroundMaxCost = cacheSize;
+    }
+    else
+    {
+        const QRect screenGeometry = QApplication::desktop()->screenGeometry();
+
+        qreal screenCost = 4.0 * screenGeometry.width() * screenGeometry.height();
+
+#if QT_VERSION >= QT_VERSION_CHECK(5,1,0)
+
+        screenCost *= qApp->devicePixelRatio() * qApp->devicePixelRatio();
+
+#endif // QT_VERSION
+
+        const qreal foregroundCost = foregroundScreens * screenCost;
+        const qreal backgroundCost = qMax(m_tabCount - 1, 0) * screenCost;
+
+        qreal maxCost = foregroundCost + backgroundCost;
+
+        // Never claim more than a quarter of the available physical memory so that the budget shrinks under memory pressure.
+
+        if(m_availablePhysicalMemory > 0)
+        {
+            maxCost = qMin(maxCost, m_availablePhysicalMemory / 4.0);
+        }
+
+        maxCost = qBound(static_cast< qreal >(minimumCost), maxCost, static_cast< qreal >(maximumCost));
+
+        m_maxCost = static_cast< int >(maxCost);
+        m_backgroundMaxCost = backgroundCost > 0.0 ? static_cast< int >(maxCost * backgroundCost / (foregroundCost + backgroundCost)) : 0;
+    }
+
+    TileItem::setCacheBudget(m_maxCost, m_backgroundMaxCost);
+}
+
+void CacheBudget::on_memory_timeout()
+{
+    const qint64 availablePhysicalMemory = CacheBudget::availablePhysicalMemory();
+
+    if(m_availablePhysicalMemory != availablePhysicalMemory)
+    {
+        m_availablePhysicalMemory = availablePhysicalMemory;
+
+        if(s_settings->pageItem().cacheSize() < 0)
+        {
+            update();
+        }
+    }
+
+    if(m_availablePhysicalMemory >= 0 && m_availablePhysicalMemory < lowMemory)
+    {
+        emit memoryPressure();
+    }
+}
+
+CacheBudget::CacheBudget(QObject* parent) : QObject(parent),
+    m_memoryTimer(0),
+    m_tabCount(1),
+    m_availablePhysicalMemory(availablePhysicalMemory()),
+    m_maxCost(0),
+    m_backgroundMaxCost(0)
+{
+    if(s_settings == 0)
+    {
+        s_settings = Settings::instance();
+    }
+
+    m_memoryTimer = new QTimer(this);
+    m_memoryTimer->setInterval(memoryInterval);
+
+    connect(m_memoryTimer, SIGNAL(timeout()), SLOT(on_memory_timeout()));
+
+    m_memoryTimer->start();
+
+    update();
+}
+
+} // qpdfview
@@ -0,0 +1,82 @@
+/*
+
+Copyright 2014 Adam Reichold
+
+This file is part of qpdfview.
+
+qpdfview is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+qpdfview is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef CACHEBUDGET_H
+#define CACHEBUDGET_H
+
+#include <QObject>
+
+class QTimer;
+
+namespace qpdfview
+{
+
+class Settings;
+
+// Sizes the tile cache from the screen, the number of open tabs and the available physical memory unless a fixed size is configured.
+
+class CacheBudget : public QObject
+{
+    Q_OBJECT
+
+public:
+    static CacheBudget* instance();
+    ~CacheBudget();
+
+    inline int maxCost() const { return m_maxCost; }
+    inline int backgroundMaxCost() const { return m_backgroundMaxCost; }
+
+    void setTabCount(int tabCount);
+
+    QString statistics() const;
+
+    static qint64 availablePhysicalMemory();
+
+signals:
+    void memoryPressure();
+
+public slots:
+    void update();
+
+protected slots:
+    void on_memory_timeout();
+
+private:
+    Q_DISABLE_COPY(CacheBudget)
+
+    static CacheBudget* s_instance;
+    CacheBudget(QObject* parent = 0);
+
+    static Settings* s_settings;
+
+    QTimer* m_memoryTimer;
+
+    int m_tabCount;
+    qint64 m_availablePhysicalMemory;
+
+    int m_maxCost;
+    int m_backgroundMaxCost;
+
+};
+
+} // qpdfview
+
+#endif // CACHEBUDGET_H
@@ -41,8 +41,11 @@ along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
 
 #ifdef WITH_SQL
 
+#include <QMutex>
 #include <QSqlError>
 #include <QSqlQuery>
+#include <QThread>
+#include <QWaitCondition>
 
 #endif // WITH_SQL
 
@@ -82,6 +85,50 @@ private:
 
 };
 
+struct Statement
+{
+    QString query;
+    QVariantList values;
+
+    Statement(const QString& query = QString(), const QVariantList& values = QVariantList()) :
+        query(query),
+        values(values) {}
+
+};
+
+QString hashFilePath(const QFileInfo& fileInfo)
+{
+    return QCryptographicHash::hash(fileInfo.absoluteFilePath().toUtf8(), QCryptographicHash::Sha1).toBase64();
+}
+
+QList< QVariantList > bookmarkRows(const BookmarkModel* model)
+{
+    QList< QVariantList > rows;
+
+    for(int row = 0, rowCount = model->rowCount(); row < rowCount; ++row)
+    {
+        const QModelIndex index = model->index(row);
+
+        rows.append(QVariantList()
+                    << index.data(BookmarkModel::PageRole)
+                    << index.data(BookmarkModel::LabelRole)
+                    << index.data(BookmarkModel::CommentRole)
+                    << index.data(BookmarkModel::ModifiedRole));
+    }
+
+    return rows;
+}
+
+void appendBookmarks(QList< Statement >& statements, const QString& absoluteFilePath, const QList< QVariantList >& rows)
+{
+    foreach(const QVariantList& row, rows)
+    {
+        statements.append(Statement("INSERT INTO bookmarks_v3 "
+                                    "(filePath,page,label,comment,modified)"
+                                    " VALUES (?,?,?,?,?)", QVariantList() << absoluteFilePath << row));
+    }
+}
+
 } // anonymous
 
 #endif // WITH_SQL
@@ -89,6 +136,171 @@ private:
 namespace qpdfview
 {
 
+#ifdef WITH_SQL
+
+class Database::Writer : public QThread
+{
+public:
+    Writer(const QString& databaseName, QObject* parent = 0) : QThread(parent),
+        m_databaseName(databaseName),
+        m_mutex(),
+        m_queued(),
+        m_drained(),
+        m_stopped(false),
+        m_busy(false),
+        m_queue(),
+        m_queries()
+    {
+    }
+
+    ~Writer()
+    {
+        m_mutex.lock();
+        m_stopped = true;
+        m_queued.wakeAll();
+        m_mutex.unlock();
+
+        wait();
+    }
+
+    void enqueue(const QList< Statement >& statements)
+    {
+        QMutexLocker mutexLocker(&m_mutex);
+
+        m_queue.append(statements);
+
+        m_queued.wakeAll();
+    }
+
+    void flush()
+    {
+        QMutexLocker mutexLocker(&m_mutex);
+
+        while(m_busy || (!m_queue.isEmpty() && isRunning()))
+        {
+            m_drained.wait(&m_mutex);
+        }
+    }
+
+protected:
+    void run()
+    {
+        const QString connectionName = QLatin1String("writer");
+
+        {
+            QSqlDatabase database = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+            database.setDatabaseName(m_databaseName);
+
+            if(database.open())
+            {
+                QSqlQuery query(database);
+                query.exec("PRAGMA synchronous = OFF");
+                query.exec("PRAGMA journal_mode = MEMORY");
+            }
+            else
+            {
+                qDebug() << database.lastError();
+            }
+
+            while(true)
+            {
+                QList< QList< Statement > > saves;
+
+                {
+                    QMutexLocker mutexLocker(&m_mutex);
+
+                    m_busy = false;
+                    m_drained.wakeAll();
+
+                    while(m_queue.isEmpty() && !m_stopped)
+                    {
+                        m_queued.wait(&m_mutex);
+                    }
+
+                    if(m_queue.isEmpty())
+                    {
+                        break;
+                    }
+
+                    // Everything queued since the last pass is written at once, but each save within its own transaction,
+                    // since the callers consider their rows saved and a failing save must not roll back the others.
+
+                    saves = m_queue;
+                    m_queue.clear();
+
+                    m_busy = true;
+                }
+
+                if(database.isOpen())
+                {
+                    foreach(const QList< Statement >& statements, saves)
+                    {
+                        execute(database, statements);
+                    }
+                }
+            }
+
+            m_queries.clear();
+
+            database.close();
+        }
+
+        QSqlDatabase::removeDatabase(connectionName);
+    }
+
+private:
+    Q_DISABLE_COPY(Writer)
+
+    QString m_databaseName;
+
+    QMutex m_mutex;
+    QWaitCondition m_queued;
+    QWaitCondition m_drained;
+
+    bool m_stopped;
+    bool m_busy;
+
+    QList< QList< Statement > > m_queue;
+
+    // Statements are prepared once and then only rebound, the set of distinct statements is small and fixed.
+
+    QHash< QString, QSqlQuery > m_queries;
+
+    void execute(QSqlDatabase& database, const QList< Statement >& statements)
+    {
+        Transaction transaction(database);
+
+        foreach(const Statement& statement, statements)
+        {
+            QHash< QString, QSqlQuery >::iterator query = m_queries.find(statement.query);
+
+            if(query == m_queries.end())
+            {
+                query = m_queries.insert(statement.query, QSqlQuery(database));
+                query.value().prepare(statement.query);
+            }
+
+            for(int index = 0; index < statement.values.count(); ++index)
+            {
+                query.value().bindValue(index, statement.values.at(index));
+            }
+
+            query.value().exec();
+
+            if(!query.value().isActive())
+            {
+                qDebug() << query.value().lastError();
+                return;
+            }
+        }
+
+        transaction.commit();
+    }
+
+};
+
+#endif // WITH_SQL
+
 Database* Database::s_instance = 0;
 
 Database* Database::instance()
@@ -103,6 +315,12 @@ Database* Database::instance()
 
 Database::~Database()
 {
+#ifdef WITH_SQL
+
+    delete m_writer;
+
+#endif // WITH_SQL
+
     s_instance = 0;
 }
 
@@ -114,6 +332,8 @@ QStringList Database::loadInstanceNames()
 
     if(m_database.isOpen())
     {
+        m_writer->flush();
+
         Transaction transaction(m_database);
 
         QSqlQuery query(m_database);
@@ -141,12 +361,52 @@ QStringList Database::loadInstanceNames()
     return instanceNames;
 }
 
+QStringList Database::loadTabFilePaths()
+{
+    QStringList filePaths;
+
+#ifdef WITH_SQL
+
+    if(m_database.isOpen())
+    {
+        m_writer->flush();
+
+        Transaction transaction(m_database);
+
+        QSqlQuery query(m_database);
+        query.prepare("SELECT filePath FROM tabs_v3 WHERE instanceName==?");
+
+        query.bindValue(0, instanceName());
+
+        query.exec();
+
+        while(query.next())
+        {
+            if(!query.isActive())
+            {
+                qDebug() << query.lastError();
+                return QStringList();
+            }
+
+            filePaths.append(query.value(0).toString());
+        }
+
+        transaction.commit();
+    }
+
+#endif // WITH_SQL
+
+    return filePaths;
+}
+
 void Database::restoreTabs()
 {
 #ifdef WITH_SQL
 
     if(m_database.isOpen())
     {
+        m_writer->flush();
+
         Transaction transaction(m_database);
 
         QSqlQuery query(m_database);
@@ -186,51 +446,44 @@ void Database::saveTabs(const QList< DocumentView* >& tabs)
 
     if(m_database.isOpen())
     {
-        Transaction transaction(m_database);
-
-        QSqlQuery query(m_database);
-
-        query.prepare("DELETE FROM tabs_v3 WHERE instanceName==?");
-
-        query.bindValue(0, instanceName());
-
-        query.exec();
+        QList< QVariantList > rows;
 
-        if(!query.isActive())
+        foreach(const DocumentView* tab, tabs)
         {
-            qDebug() << query.lastError();
-            return;
+            rows.append(QVariantList()
+                        << tab->fileInfo().absoluteFilePath()
+                        << instanceName()
+                        << tab->currentPage()
+                        << static_cast< uint >(tab->continuousMode())
+                        << static_cast< uint >(tab->layoutMode())
+                        << static_cast< uint >(tab->rightToLeftMode())
+                        << static_cast< uint >(tab->scaleMode())
+                        << tab->scaleFactor()
+                        << static_cast< uint >(tab->rotation()));
         }
 
-        query.prepare("INSERT INTO tabs_v3 "
-                      "(filePath,instanceName,currentPage,continuousMode,layoutMode,rightToLeftMode,scaleMode,scaleFactor,rotation)"
-                      " VALUES (?,?,?,?,?,?,?,?,?)");
-
-        foreach(const DocumentView* tab, tabs)
+        if(m_tabsSaved && rows == m_savedTabs)
         {
-            query.bindValue(0, tab->fileInfo().absoluteFilePath());
-            query.bindValue(1, instanceName());
-            query.bindValue(2, tab->currentPage());
-
-            query.bindValue(3, static_cast< uint >(tab->continuousMode()));
-            query.bindValue(4, static_cast< uint >(tab->layoutMode()));
-            query.bindValue(5, static_cast< uint >(tab->rightToLeftMode()));
+            return;
+        }
 
-            query.bindValue(6, static_cast< uint >(tab->scaleMode()));
-            query.bindValue(7, tab->scaleFactor());
+        // The tabs of an instance have no key of their own and are few, so they are replaced as a whole once any of them changed.
 
-            query.bindValue(8, static_cast< uint >(tab->rotation()));
+        QList< Statement > statements;
 
-            query.exec();
+        statements.append(Statement("DELETE FROM tabs_v3 WHERE instanceName==?", QVariantList() << instanceName()));
 
-            if(!query.isActive())
-            {
-                qDebug() << query.lastError();
-                return;
-            }
+        foreach(const QVariantList& row, rows)
+        {
+            statements.append(Statement("INSERT INTO tabs_v3 "
+                                        "(filePath,instanceName,currentPage,continuousMode,layoutMode,rightToLeftMode,scaleMode,scaleFactor,rotation)"
+                                        " VALUES (?,?,?,?,?,?,?,?,?)", row));
         }
 
-        transaction.commit();
+        m_writer->enqueue(statements);
+
+        m_tabsSaved = true;
+        m_savedTabs = rows;
     }
 
 #else
@@ -246,18 +499,10 @@ void Database::clearTabs()
 
     if(m_database.isOpen())
     {
-        Transaction transaction(m_database);
-
-        QSqlQuery query(m_database);
-        query.exec("DELETE FROM tabs_v3");
-
-        if(!query.isActive())
-        {
-            qDebug() << query.lastError();
-            return;
-        }
+        m_writer->enqueue(QList< Statement >() << Statement("DELETE FROM tabs_v3"));
 
-        transaction.commit();
+        m_tabsSaved = true;
+        m_savedTabs.clear();
     }
 
 #endif // WITH_SQL
@@ -269,8 +514,12 @@ void Database::restoreBookmarks()
 
     if(m_database.isOpen())
     {
+        m_writer->flush();
+
         Transaction transaction(m_database);
 
+        QHash< QString, QList< QVariantList > > savedBookmarks;
+
         QSqlQuery outerQuery(m_database);
         outerQuery.exec("SELECT DISTINCT(filePath) FROM bookmarks_v3");
 
@@ -308,9 +557,14 @@ void Database::restoreBookmarks()
 
                 model->addBookmark(BookmarkItem(page, label, comment, modified));
             }
+
+            savedBookmarks.insert(absoluteFilePath, bookmarkRows(model));
         }
 
         transaction.commit();
+
+        m_bookmarksSaved = true;
+        m_savedBookmarks = savedBookmarks;
     }
 
 #endif // WITH_SQL
@@ -322,49 +576,69 @@ void Database::saveBookmarks()
 
     if(m_database.isOpen())
     {
-        Transaction transaction(m_database);
+        if(!Settings::instance()->mainWindow().restoreBookmarks())
+        {
+            if(!m_bookmarksSaved || !m_savedBookmarks.isEmpty())
+            {
+                clearBookmarks();
+            }
 
-        QSqlQuery query(m_database);
-        query.exec("DELETE FROM bookmarks_v3");
+            return;
+        }
 
-        if(!query.isActive())
+        QHash< QString, QList< QVariantList > > bookmarks;
+
+        foreach(const QString& absoluteFilePath, BookmarkModel::knownPaths())
         {
-            qDebug() << query.lastError();
-            return;
+            const QList< QVariantList > rows = bookmarkRows(BookmarkModel::fromPath(absoluteFilePath));
+
+            if(!rows.isEmpty())
+            {
+                bookmarks.insert(absoluteFilePath, rows);
+            }
         }
 
-        if(Settings::instance()->mainWindow().restoreBookmarks())
+        QList< Statement > statements;
+
+        if(!m_bookmarksSaved)
         {
-            query.prepare("INSERT INTO bookmarks_v3 "
-                          "(filePath,page,label,comment,modified)"
-                          " VALUES (?,?,?,?,?)");
+            statements.append(Statement("DELETE FROM bookmarks_v3"));
 
-            foreach(const QString& absoluteFilePath, BookmarkModel::knownPaths())
+            for(QHash< QString, QList< QVariantList > >::const_iterator iterator = bookmarks.constBegin(); iterator != bookmarks.constEnd(); ++iterator)
             {
-                const BookmarkModel* model = BookmarkModel::fromPath(absoluteFilePath);
+                appendBookmarks(statements, iterator.key(), iterator.value());
+            }
+        }
+        else
+        {
+            // Only the bookmarks of paths which changed since the last save are rewritten.
 
-                for(int row = 0, rowCount = model->rowCount(); row < rowCount; ++row)
+            for(QHash< QString, QList< QVariantList > >::const_iterator iterator = m_savedBookmarks.constBegin(); iterator != m_savedBookmarks.constEnd(); ++iterator)
+            {
+                if(!bookmarks.contains(iterator.key()))
                 {
-                    const QModelIndex index = model->index(row);
-
-                    query.bindValue(0, absoluteFilePath);
-                    query.bindValue(1, index.data(BookmarkModel::PageRole));
-                    query.bindValue(2, index.data(BookmarkModel::LabelRole));
-                    query.bindValue(3, index.data(BookmarkModel::CommentRole));
-                    query.bindValue(4, index.data(BookmarkModel::ModifiedRole));
+                    statements.append(Statement("DELETE FROM bookmarks_v3 WHERE filePath==?", QVariantList() << iterator.key()));
+                }
+            }
 
-                    query.exec();
+            for(QHash< QString, QList< QVariantList > >::const_iterator iterator = bookmarks.constBegin(); iterator != bookmarks.constEnd(); ++iterator)
+            {
+                if(m_savedBookmarks.value(iterator.key()) != iterator.value())
+                {
+                    statements.append(Statement("DELETE FROM bookmarks_v3 WHERE filePath==?", QVariantList() << iterator.key()));
 
-                    if(!query.isActive())
-                    {
-                        qDebug() << query.lastError();
-                        return;
-                    }
+                    appendBookmarks(statements, iterator.key(), iterator.value());
                 }
             }
         }
 
-        transaction.commit();
+        if(!statements.isEmpty())
+        {
+            m_writer->enqueue(statements);
+        }
+
+        m_bookmarksSaved = true;
+        m_savedBookmarks = bookmarks;
     }
 
 #endif // WITH_SQL
@@ -376,18 +650,10 @@ void Database::clearBookmarks()
 
     if(m_database.isOpen())
     {
-        Transaction transaction(m_database);
-
-        QSqlQuery query(m_database);
-        query.exec("DELETE FROM bookmarks_v3");
+        m_writer->enqueue(QList< Statement >() << Statement("DELETE FROM bookmarks_v3"));
 
-        if(!query.isActive())
-        {
-            qDebug() << query.lastError();
-            return;
-        }
-
-        transaction.commit();
+        m_bookmarksSaved = true;
+        m_savedBookmarks.clear();
     }
 
 #endif // WITH_SQL
@@ -399,12 +665,13 @@ void Database::restorePerFileSettings(DocumentView* tab)
 
     if(Settings::instance()->mainWindow().restorePerFileSettings() && m_database.isOpen() && tab != 0)
     {
+        m_writer->flush();
+
         Transaction transaction(m_database);
 
-        QSqlQuery query(m_database);
-        query.prepare("SELECT currentPage,continuousMode,layoutMode,rightToLeftMode,scaleMode,scaleFactor,rotation,firstPage FROM perfilesettings_v3 WHERE filePath==?");
+        QSqlQuery& query = m_perFileSettingsQuery;
 
-        query.bindValue(0, QCryptographicHash::hash(tab->fileInfo().absoluteFilePath().toUtf8(), QCryptographicHash::Sha1).toBase64());
+        query.bindValue(0, hashFilePath(tab->fileInfo()));
 
         query.exec();
 
@@ -430,6 +697,8 @@ void Database::restorePerFileSettings(DocumentView* tab)
             return;
         }
 
+        query.finish();
+
         transaction.commit();
     }
 
@@ -444,45 +713,160 @@ void Database::savePerFileSettings(const DocumentView* tab)
 {
 #ifdef WITH_SQL
 
-    if(Settings::instance()->mainWindow().restorePerFileSettings() && m_database.isOpen() && tab != 0)
+    if(Settings::instance()->mainWindow().restorePerFileSettings() && m_database.isOpen() && tab != 0 && tab->numberOfPages() > 0)
+    {
+        const QString filePath = hashFilePath(tab->fileInfo());
+
+        const QVariantList values = QVariantList()
+                << tab->currentPage()
+                << static_cast< uint >(tab->continuousMode())
+                << static_cast< uint >(tab->layoutMode())
+                << static_cast< uint >(tab->rightToLeftMode())
+                << static_cast< uint >(tab->scaleMode())
+                << tab->scaleFactor()
+                << static_cast< uint >(tab->rotation())
+                << tab->firstPage();
+
+        if(m_savedPerFileSettings.value(filePath) != values)
+        {
+            m_writer->enqueue(QList< Statement >() << Statement("INSERT OR REPLACE INTO perfilesettings_v3 "
+                                                                "(lastUsed,filePath,currentPage,continuousMode,layoutMode,rightToLeftMode,scaleMode,scaleFactor,rotation,firstPage)"
+                                                                " VALUES (?,?,?,?,?,?,?,?,?,?)", QVariantList()
+                                                                << QDateTime::currentDateTime().toTime_t()
+                                                                << filePath
+                                                                << values));
+
+            m_savedPerFileSettings.insert(filePath, values);
+        }
+
+        savePageGeometry(tab);
+    }
+
+#else
+
+    Q_UNUSED(tab);
+
+#endif // WITH_SQL
+}
+
+QByteArray Database::restorePageGeometry(const QFileInfo& fileInfo)
+{
+    QByteArray pageGeometry;
+
+#ifdef WITH_SQL
+
+    if(Settings::instance()->mainWindow().restorePerFileSettings() && m_database.isOpen())
     {
+        m_writer->flush();
+
         Transaction transaction(m_database);
 
-        QSqlQuery query(m_database);
-        query.prepare("INSERT OR REPLACE INTO perfilesettings_v3 "
-                      "(lastUsed,filePath,currentPage,continuousMode,layoutMode,rightToLeftMode,scaleMode,scaleFactor,rotation,firstPage)"
-                      " VALUES (?,?,?,?,?,?,?,?,?,?)");
+        QSqlQuery& query = m_pageGeometryQuery;
 
-        query.bindValue(0, QDateTime::currentDateTime().toTime_t());
+        query.bindValue(0, hashFilePath(fileInfo));
+        query.bindValue(1, fileInfo.lastModified().toTime_t());
+        query.bindValue(2, fileInfo.size());
 
-        query.bindValue(1, QCryptographicHash::hash(tab->fileInfo().absoluteFilePath().toUtf8(), QCryptographicHash::Sha1).toBase64());
-        query.bindValue(2, tab->currentPage());
+        query.exec();
 
-        query.bindValue(3, static_cast< uint >(tab->continuousMode()));
-        query.bindValue(4, static_cast< uint >(tab->layoutMode()));
-        query.bindValue(5, static_cast< uint >(tab->rightToLeftMode()));
+        if(query.next())
+        {
+            pageGeometry = query.value(0).toByteArray();
+        }
 
-        query.bindValue(6, static_cast< uint >(tab->scaleMode()));
-        query.bindValue(7, tab->scaleFactor());
+        if(!query.isActive())
+        {
+            qDebug() << query.lastError();
+            return QByteArray();
+        }
 
-        query.bindValue(8, static_cast< uint >(tab->rotation()));
+        query.finish();
 
-        query.bindValue(9, tab->firstPage());
+        transaction.commit();
+    }
+
+#else
+
+    Q_UNUSED(fileInfo);
+
+#endif // WITH_SQL
+
+    return pageGeometry;
+}
+
+QByteArray Database::restoreTextIndex(const QFileInfo& fileInfo)
+{
+    QByteArray textIndex;
+
+#ifdef WITH_SQL
+
+    if(Settings::instance()->documentView().indexText() && m_database.isOpen())
+    {
+        m_writer->flush();
+
+        Transaction transaction(m_database);
+
+        const QString filePath = hashFilePath(fileInfo);
+
+        QSqlQuery query(m_database);
+        query.prepare("SELECT textIndex FROM textindex_v1 WHERE filePath==? AND lastModified==? AND fileSize==?");
+
+        query.bindValue(0, filePath);
+        query.bindValue(1, fileInfo.lastModified().toTime_t());
+        query.bindValue(2, fileInfo.size());
 
         query.exec();
 
+        if(query.next())
+        {
+            textIndex = query.value(0).toByteArray();
+        }
+
         if(!query.isActive())
         {
             qDebug() << query.lastError();
-            return;
+            return QByteArray();
         }
 
         transaction.commit();
+
+        if(!textIndex.isEmpty())
+        {
+            // Documents which are opened regularly should not be evicted.
+
+            m_writer->enqueue(QList< Statement >() << Statement("UPDATE textindex_v1 SET lastUsed=? WHERE filePath==?", QVariantList() << QDateTime::currentDateTime().toTime_t() << filePath));
+        }
     }
 
 #else
 
-    Q_UNUSED(tab);
+    Q_UNUSED(fileInfo);
+
+#endif // WITH_SQL
+
+    return textIndex;
+}
+
+void Database::saveTextIndex(const QFileInfo& fileInfo, const QByteArray& textIndex)
+{
+#ifdef WITH_SQL
+
+    if(Settings::instance()->documentView().indexText() && m_database.isOpen() && !textIndex.isEmpty())
+    {
+        m_writer->enqueue(QList< Statement >() << Statement("INSERT OR REPLACE INTO textindex_v1 "
+                                                            "(lastUsed,filePath,lastModified,fileSize,textIndex)"
+                                                            " VALUES (?,?,?,?,?)", QVariantList()
+                                                            << QDateTime::currentDateTime().toTime_t()
+                                                            << hashFilePath(fileInfo)
+                                                            << fileInfo.lastModified().toTime_t()
+                                                            << fileInfo.size()
+                                                            << textIndex));
+    }
+
+#else
+
+    Q_UNUSED(fileInfo);
+    Q_UNUSED(textIndex);
 
 #endif // WITH_SQL
 }
@@ -491,6 +875,11 @@ Database::Database(QObject* parent) : QObject(parent)
 {
 #ifdef WITH_SQL
 
+    m_writer = 0;
+
+    m_tabsSaved = false;
+    m_bookmarksSaved = false;
+
 #if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
 
     const QString path = QStandardPaths::writableLocation(QStandardPaths::DataLocation);
@@ -568,7 +957,37 @@ Database::Database(QObject* parent) : QObject(parent)
             }
         }
 
+        // page geometry
+
+        if(!tables.contains("pagegeometry_v1"))
+        {
+            preparePageGeometry_v1();
+        }
+
+        // text index
+
+        if(!tables.contains("textindex_v1"))
+        {
+            prepareTextIndex_v1();
+        }
+
+        // indexes
+
+        prepareIndexes_v1();
+
         limitPerFileSettings();
+        limitTextIndex();
+
+        // The lookups done whenever a tab is opened are only prepared once.
+
+        m_perFileSettingsQuery = QSqlQuery(m_database);
+        m_perFileSettingsQuery.prepare("SELECT currentPage,continuousMode,layoutMode,rightToLeftMode,scaleMode,scaleFactor,rotation,firstPage FROM perfilesettings_v3 WHERE filePath==?");
+
+        m_pageGeometryQuery = QSqlQuery(m_database);
+        m_pageGeometryQuery.prepare("SELECT geometry FROM pagegeometry_v1 WHERE filePath==? AND lastModified==? AND fileSize==?");
+
+        m_writer = new Writer(m_database.databaseName(), this);
+        m_writer->start();
     }
     else
     {
@@ -661,6 +1080,80 @@ bool Database::preparePerFileSettings_v3()
     return true;
 }
 
+bool Database::preparePageGeometry_v1()
+{
+    Transaction transaction(m_database);
+
+    QSqlQuery query(m_database);
+
+    query.exec("CREATE TABLE pagegeometry_v1 "
+               "(lastUsed INTEGER"
+               ",filePath TEXT PRIMARY KEY"
+               ",lastModified INTEGER"
+               ",fileSize INTEGER"
+               ",geometry BLOB)");
+
+    if(!query.isActive())
+    {
+        qDebug() << query.lastError();
+        return false;
+    }
+
+    transaction.commit();
+    return true;
+}
+
+bool Database::prepareTextIndex_v1()
+{
+    Transaction transaction(m_database);
+
+    QSqlQuery query(m_database);
+
+    query.exec("CREATE TABLE textindex_v1 "
+               "(lastUsed INTEGER"
+               ",filePath TEXT PRIMARY KEY"
+               ",lastModified INTEGER"
+               ",fileSize INTEGER"
+               ",textIndex BLOB)");
+
+    if(!query.isActive())
+    {
+        qDebug() << query.lastError();
+        return false;
+    }
+
+    transaction.commit();
+    return true;
+}
+
+bool Database::prepareIndexes_v1()
+{
+    Transaction transaction(m_database);
+
+    QSqlQuery query(m_database);
+
+    const QStringList statements = QStringList()
+            << "CREATE INDEX IF NOT EXISTS tabs_v3_instanceName ON tabs_v3 (instanceName)"
+            << "CREATE INDEX IF NOT EXISTS bookmarks_v3_filePath ON bookmarks_v3 (filePath)"
+            << "CREATE INDEX IF NOT EXISTS perfilesettings_v3_lastUsed ON perfilesettings_v3 (lastUsed)"
+            << "CREATE INDEX IF NOT EXISTS pagegeometry_v1_lastUsed ON pagegeometry_v1 (lastUsed)"
+            << "CREATE INDEX IF NOT EXISTS textindex_v1_lastUsed ON textindex_v1 (lastUsed)";
+
+    foreach(const QString& statement, statements)
+    {
+        query.exec(statement);
+
+        if(!query.isActive())
+        {
+            qDebug() << query.lastError();
+            return false;
+        }
+    }
+
+    transaction.commit();
+    return true;
+}
+
 void Database::migrateTabs_v2_v3()
 {
     Transaction transaction(m_database);
@@ -827,6 +1320,34 @@ void Database::migratePerFileSettings_v1_v3()
     transaction.commit();
 }
 
+void Database::savePageGeometry(const DocumentView* tab)
+{
+    const QByteArray pageGeometry = tab->savePageGeometry();
+
+    if(pageGeometry.isEmpty())
+    {
+        return;
+    }
+
+    const QString filePath = hashFilePath(tab->fileInfo());
+
+    if(m_savedPageGeometry.value(filePath) == pageGeometry)
+    {
+        return;
+    }
+
+    m_writer->enqueue(QList< Statement >() << Statement("INSERT OR REPLACE INTO pagegeometry_v1 "
+                                                        "(lastUsed,filePath,lastModified,fileSize,geometry)"
+                                                        " VALUES (?,?,?,?,?)", QVariantList()
+                                                        << QDateTime::currentDateTime().toTime_t()
+                                                        << filePath
+                                                        << tab->fileInfo().lastModified().toTime_t()
+                                                        << tab->fileInfo().size()
+                                                        << pageGeometry));
+
+    m_savedPageGeometry.insert(filePath, pageGeometry);
+}
+
 void Database::limitPerFileSettings()
 {
     Transaction transaction(m_database);
@@ -835,11 +1356,47 @@ void Database::limitPerFileSettings()
 
     if(Settings::instance()->mainWindow().restorePerFileSettings())
     {
-        query.exec("DELETE FROM perfilesettings_v3 WHERE filePath NOT IN (SELECT filePath FROM perfilesettings_v3 ORDER BY lastUsed DESC LIMIT 1000)");
+        // Comparing against the last entry to keep lets the deletion walk the index on lastUsed instead of the whole table.
+
+        query.exec("DELETE FROM perfilesettings_v3 WHERE lastUsed < (SELECT lastUsed FROM perfilesettings_v3 ORDER BY lastUsed DESC LIMIT 1 OFFSET 999)");
+
+        if(query.isActive())
+        {
+            query.exec("DELETE FROM pagegeometry_v1 WHERE filePath NOT IN (SELECT filePath FROM perfilesettings_v3)");
+        }
     }
     else
     {
         query.exec("DELETE FROM perfilesettings_v3");
+
+        if(query.isActive())
+        {
+            query.exec("DELETE FROM pagegeometry_v1");
+        }
+    }
+
+    if(!query.isActive())
+    {
+        qDebug() << query.lastError();
+        return;
+    }
+
+    transaction.commit();
+}
+
+void Database::limitTextIndex()
+{
+    Transaction transaction(m_database);
+
+    QSqlQuery query(m_database);
+
+    if(Settings::instance()->documentView().indexText())
+    {
+        query.exec("DELETE FROM textindex_v1 WHERE lastUsed < (SELECT lastUsed FROM textindex_v1 ORDER BY lastUsed DESC LIMIT 1 OFFSET 99)");
+    }
+    else
+    {
+        query.exec("DELETE FROM textindex_v1");
     }
 
     if(!query.isActive())
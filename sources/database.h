@@ -27,11 +27,15 @@ along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
 
 #ifdef WITH_SQL
 
+#include <QHash>
 #include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QVariant>
 
 #endif // WITH_SQL
 
 class QDateTime;
+class QFileInfo;
 
 #include "global.h"
 
@@ -50,6 +54,8 @@ public:
 
     QStringList loadInstanceNames();
 
+    QStringList loadTabFilePaths();
+
     void restoreTabs();
     void saveTabs(const QList< DocumentView* >& tabs);
     void clearTabs();
@@ -61,6 +67,11 @@ public:
     void restorePerFileSettings(DocumentView* tab);
     void savePerFileSettings(const DocumentView* tab);
 
+    QByteArray restorePageGeometry(const QFileInfo& fileInfo);
+
+    QByteArray restoreTextIndex(const QFileInfo& fileInfo);
+    void saveTextIndex(const QFileInfo& fileInfo, const QByteArray& textIndex);
+
 signals:
     void tabRestored(const QString& absoluteFilePath, bool continuousMode, LayoutMode layoutMode, bool rightToLeftMode, ScaleMode scaleMode, qreal scaleFactor, Rotation rotation, int currentPage);
 
@@ -77,6 +88,9 @@ private:
     bool prepareTabs_v3();
     bool prepareBookmarks_v3();
     bool preparePerFileSettings_v3();
+    bool preparePageGeometry_v1();
+    bool prepareTextIndex_v1();
+    bool prepareIndexes_v1();
 
     void migrateTabs_v2_v3();
     void migrateTabs_v1_v3();
@@ -85,10 +99,32 @@ private:
     void migratePerFileSettings_v2_v3();
     void migratePerFileSettings_v1_v3();
 
+    void savePageGeometry(const DocumentView* tab);
+
     void limitPerFileSettings();
+    void limitTextIndex();
 
     QSqlDatabase m_database;
 
+    QSqlQuery m_perFileSettingsQuery;
+    QSqlQuery m_pageGeometryQuery;
+
+    // Changes are written by a background thread using its own connection and reads wait until it has caught up.
+
+    class Writer;
+    Writer* m_writer;
+
+    // The rows last handed to the writer are kept so that only those which changed have to be written again.
+
+    bool m_tabsSaved;
+    QList< QVariantList > m_savedTabs;
+
+    bool m_bookmarksSaved;
+    QHash< QString, QList< QVariantList > > m_savedBookmarks;
+
+    QHash< QString, QVariantList > m_savedPerFileSettings;
+    QHash< QString, QByteArray > m_savedPageGeometry;
+
 #endif // WITH_SQL
 
 };
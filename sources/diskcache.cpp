@@ -0,0 +1,406 @@
+/*
+
+Copyright 2014 Adam Reichold
+
+This file is part of qpdfview.
+
+qpdfview is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+qpdfview is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "diskcache.h"
+
+#include <cstring>
+
+#include <QApplication>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QRectF>
+#include <QTemporaryFile>
+
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+
+#include <QStandardPaths>
+
+#else
+
+#include <QDesktopServices>
+
+#endif // QT_VERSION
+
+namespace
+{
+
+const quint32 tileMagic = 0x71706474; // "qpdt"
+const quint32 tileVersion = 1;
+
+// The header is followed by the raw scan lines so that a hit can be read straight out of a file mapping.
+
+struct TileHeader
+{
+    quint32 magic;
+    quint32 version;
+
+    qint32 format;
+    qint32 width;
+    qint32 height;
+    qint32 bytesPerLine;
+
+    double cropLeft;
+    double cropTop;
+    double cropWidth;
+    double cropHeight;
+
+};
+
+} // anonymous
+
+namespace qpdfview
+{
+
+DiskCache* DiskCache::s_instance = 0;
+
+DiskCache* DiskCache::instance()
+{
+    if(s_instance == 0)
+    {
+        s_instance = new DiskCache("tiles", qApp);
+    }
+
+    return s_instance;
+}
+
+DiskCache* DiskCache::s_thumbnailInstance = 0;
+
+DiskCache* DiskCache::thumbnailInstance()
+{
+    if(s_thumbnailInstance == 0)
+    {
+        s_thumbnailInstance = new DiskCache("thumbnails", qApp);
+    }
+
+    return s_thumbnailInstance;
+}
+
+DiskCache::~DiskCache()
+{
+    if(s_instance == this)
+    {
+        s_instance = 0;
+    }
+    else if(s_thumbnailInstance == this)
+    {
+        s_thumbnailInstance = 0;
+    }
+}
+
+QByteArray DiskCache::documentKey(const QFileInfo& fileInfo)
+{
+    QByteArray key;
+
+    QDataStream(&key, QIODevice::WriteOnly)
+            << fileInfo.absoluteFilePath()
+            << fileInfo.lastModified()
+            << fileInfo.size();
+
+    return key;
+}
+
+bool DiskCache::isEnabled() const
+{
+    QMutexLocker mutexLocker(&m_mutex);
+
+    return m_maxSize > 0;
+}
+
+qint64 DiskCache::maxSize() const
+{
+    QMutexLocker mutexLocker(&m_mutex);
+
+    return m_maxSize;
+}
+
+void DiskCache::setMaxSize(qint64 maxSize)
+{
+    QMutexLocker mutexLocker(&m_mutex);
+
+    m_maxSize = qMax(maxSize, Q_INT64_C(0));
+
+    // The directory is only scanned once the cache is enabled, whereas a disabled cache removes the tiles of earlier sessions without looking at them.
+
+    if(m_maxSize == 0)
+    {
+        if(!m_scanned || m_size > 0)
+        {
+            purge();
+        }
+    }
+    else
+    {
+        if(!m_scanned)
+        {
+            scan();
+        }
+
+        evict();
+    }
+}
+
+bool DiskCache::load(const QByteArray& key, QImage& image, QRectF& cropRect)
+{
+    const QString name = fileName(key);
+
+    {
+        QMutexLocker mutexLocker(&m_mutex);
+
+        QHash< QString, Entry >::iterator entry = m_entries.find(name);
+
+        if(entry == m_entries.end())
+        {
+            return false;
+        }
+
+        touch(entry.value());
+    }
+
+    QFile file(QDir(m_path).filePath(name));
+
+    if(!file.open(QIODevice::ReadOnly) || file.size() < static_cast< qint64 >(sizeof(TileHeader)))
+    {
+        return false;
+    }
+
+    const uchar* data = file.map(0, file.size());
+
+    if(data == 0)
+    {
+        return false;
+    }
+
+    TileHeader header;
+    memcpy(&header, data, sizeof(TileHeader));
+
+    const qint64 expectedSize = static_cast< qint64 >(sizeof(TileHeader)) + static_cast< qint64 >(header.bytesPerLine) * header.height;
+
+    if(header.magic != tileMagic || header.version != tileVersion || header.width <= 0 || header.height <= 0 || expectedSize != file.size())
+    {
+        file.unmap(const_cast< uchar* >(data));
+        file.close();
+
+        QMutexLocker mutexLocker(&m_mutex);
+
+        remove(name);
+
+        return false;
+    }
+
+    image = QImage(data + sizeof(TileHeader), header.width, header.height, header.bytesPerLine, static_cast< QImage::Format >(header.format)).copy();
+    cropRect = QRectF(header.cropLeft, header.cropTop, header.cropWidth, header.cropHeight);
+
+    file.unmap(const_cast< uchar* >(data));
+
+    return !image.isNull();
+}
+
+void DiskCache::store(const QByteArray& key, const QImage& image, const QRectF& cropRect)
+{
+    if(image.isNull())
+    {
+        return;
+    }
+
+    const qint64 size = static_cast< qint64 >(sizeof(TileHeader)) + static_cast< qint64 >(image.bytesPerLine()) * image.height();
+
+    if(size > maxSize())
+    {
+        return;
+    }
+
+    TileHeader header;
+
+    header.magic = tileMagic;
+    header.version = tileVersion;
+
+    header.format = image.format();
+    header.width = image.width();
+    header.height = image.height();
+    header.bytesPerLine = image.bytesPerLine();
+
+    header.cropLeft = cropRect.left();
+    header.cropTop = cropRect.top();
+    header.cropWidth = cropRect.width();
+    header.cropHeight = cropRect.height();
+
+    QTemporaryFile temporaryFile(QDir(m_path).filePath("XXXXXX.tmp"));
+    temporaryFile.setAutoRemove(false);
+
+    if(!temporaryFile.open())
+    {
+        return;
+    }
+
+    bool ok = temporaryFile.write(reinterpret_cast< const char* >(&header), sizeof(TileHeader)) == sizeof(TileHeader);
+
+    for(int y = 0; ok && y < image.height(); ++y)
+    {
+        ok = temporaryFile.write(reinterpret_cast< const char* >(image.constScanLine(y)), image.bytesPerLine()) == image.bytesPerLine();
+    }
+
+    temporaryFile.close();
+
+    if(!ok)
+    {
+        temporaryFile.remove();
+
+        return;
+    }
+
+    const QString name = fileName(key);
+
+    QMutexLocker mutexLocker(&m_mutex);
+
+    remove(name);
+
+    if(!temporaryFile.rename(QDir(m_path).filePath(name)))
+    {
+        temporaryFile.remove();
+
+        return;
+    }
+
+    Entry entry;
+    entry.size = size;
+    entry.position = m_order.insert(m_order.end(), name);
+
+    m_entries.insert(name, entry);
+    m_size += size;
+
+    evict();
+}
+
+void DiskCache::clear()
+{
+    QMutexLocker mutexLocker(&m_mutex);
+
+    purge();
+}
+
+DiskCache::DiskCache(const QString& name, QObject* parent) : QObject(parent),
+    m_mutex(),
+    m_path(),
+    m_scanned(false),
+    m_maxSize(0),
+    m_size(0),
+    m_order(),
+    m_entries()
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+
+    const QString path = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+
+#else
+
+    const QString path = QDesktopServices::storageLocation(QDesktopServices::CacheLocation);
+
+#endif // QT_VERSION
+
+    m_path = QDir(path).filePath(name);
+
+    QDir().mkpath(m_path);
+}
+
+void DiskCache::scan()
+{
+    const QDir dir(m_path);
+
+    foreach(const QFileInfo& fileInfo, dir.entryInfoList(QStringList() << "*.tmp", QDir::Files))
+    {
+        QFile::remove(fileInfo.absoluteFilePath());
+    }
+
+    // Files are ordered by modification time, so the least recently stored tiles are evicted first after a restart.
+
+    foreach(const QFileInfo& fileInfo, dir.entryInfoList(QDir::Files, QDir::Time | QDir::Reversed))
+    {
+        Entry entry;
+        entry.size = fileInfo.size();
+        entry.position = m_order.insert(m_order.end(), fileInfo.fileName());
+
+        m_entries.insert(fileInfo.fileName(), entry);
+        m_size += entry.size;
+    }
+
+    m_scanned = true;
+}
+
+void DiskCache::evict()
+{
+    while(m_size > m_maxSize && !m_order.isEmpty())
+    {
+        const QString name = m_order.first();
+
+        remove(name);
+    }
+}
+
+void DiskCache::purge()
+{
+    const QDir dir(m_path);
+
+    foreach(const QString& fileName, dir.entryList(QDir::Files))
+    {
+        QFile::remove(dir.filePath(fileName));
+    }
+
+    m_order.clear();
+    m_entries.clear();
+    m_size = 0;
+
+    m_scanned = true;
+}
+
+void DiskCache::touch(Entry& entry)
+{
+    const QString name = *entry.position;
+
+    m_order.erase(entry.position);
+    entry.position = m_order.insert(m_order.end(), name);
+}
+
+void DiskCache::remove(const QString& fileName)
+{
+    QHash< QString, Entry >::iterator entry = m_entries.find(fileName);
+
+    if(entry != m_entries.end())
+    {
+        m_size -= entry.value().size;
+        m_order.erase(entry.value().position);
+
+        m_entries.erase(entry);
+    }
+
+    QFile::remove(QDir(m_path).filePath(fileName));
+}
+
+QString DiskCache::fileName(const QByteArray& key)
+{
+    return QString::fromLatin1(QCryptographicHash::hash(key, QCryptographicHash::Sha1).toHex());
+}
+
+} // qpdfview
@@ -0,0 +1,98 @@
+/*
+
+Copyright 2014 Adam Reichold
+
+This file is part of qpdfview.
+
+qpdfview is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+qpdfview is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef DISKCACHE_H
+#define DISKCACHE_H
+
+#include <QHash>
+#include <QLinkedList>
+#include <QMutex>
+#include <QObject>
+
+class QFileInfo;
+class QImage;
+class QRectF;
+
+namespace qpdfview
+{
+
+class DiskCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    static DiskCache* instance();
+    static DiskCache* thumbnailInstance();
+    ~DiskCache();
+
+    static QByteArray documentKey(const QFileInfo& fileInfo);
+
+    bool isEnabled() const;
+
+    qint64 maxSize() const;
+    void setMaxSize(qint64 maxSize);
+
+    bool load(const QByteArray& key, QImage& image, QRectF& cropRect);
+    void store(const QByteArray& key, const QImage& image, const QRectF& cropRect);
+
+    void clear();
+
+private:
+    Q_DISABLE_COPY(DiskCache)
+
+    static DiskCache* s_instance;
+    static DiskCache* s_thumbnailInstance;
+    DiskCache(const QString& name, QObject* parent = 0);
+
+    mutable QMutex m_mutex;
+
+    QString m_path;
+    bool m_scanned;
+
+    qint64 m_maxSize;
+    qint64 m_size;
+
+    typedef QLinkedList< QString > Order;
+
+    struct Entry
+    {
+        qint64 size;
+        Order::iterator position;
+
+    };
+
+    Order m_order;
+    QHash< QString, Entry > m_entries;
+
+    void scan();
+    void evict();
+    void purge();
+
+    void touch(Entry& entry);
+    void remove(const QString& fileName);
+
+    static QString fileName(const QByteArray& key);
+
+};
+
+} // qpdfview
+
+#endif // DISKCACHE_H
@@ -33,7 +33,6 @@ along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
 #include <libdjvu/ddjvuapi.h>
 #include <libdjvu/miniexp.h>
 
-#define LOCK_PAGE QMutexLocker mutexLocker(&m_parent->m_mutex);
 #define LOCK_DOCUMENT QMutexLocker mutexLocker(&m_mutex);
 
 #if DDJVUAPI_VERSION < 23
@@ -53,6 +52,11 @@ namespace
 
 using namespace qpdfview::Model;
 
+const int decodeAheadCount = 2;
+
+// Embedded thumbnails are scaled to fit a square of this many pixels.
+const int maximumThumbnailSize = 256;
+
 inline miniexp_t miniexp_cadddr(miniexp_t exp)
 {
     return miniexp_cadr(miniexp_cddr(exp));
@@ -73,26 +77,6 @@ inline miniexp_t skip(miniexp_t exp, int offset)
     return exp;
 }
 
-void clearMessageQueue(ddjvu_context_t* context, bool wait)
-{
-    if(wait)
-    {
-        ddjvu_message_wait(context);
-    }
-
-    while(true)
-    {
-        if(ddjvu_message_peek(context) != 0)
-        {
-            ddjvu_message_pop(context);
-        }
-        else
-        {
-            break;
-        }
-    }
-}
-
 void waitForMessageTag(ddjvu_context_t* context, ddjvu_message_tag_t tag)
 {
     ddjvu_message_wait(context);
@@ -254,111 +238,36 @@ QList< Link* > loadLinks(miniexp_t linkExp, const QSizeF& size, int index, const
     return links;
 }
 
-QString loadText(miniexp_t textExp, const QSizeF& size, const QRectF& rect)
+void loadWords(miniexp_t textExp, const QSizeF& size, const QTransform& transform, QVector< QString >& words, QVector< QRectF >& wordBoxes)
 {
-    if(miniexp_length(textExp) < 6 && !miniexp_symbolp(miniexp_car(textExp)))
+    if(miniexp_length(textExp) < 6 || !miniexp_symbolp(miniexp_car(textExp)))
     {
-        return QString();
+        return;
     }
 
-    const int xmin = miniexp_to_int(miniexp_cadr(textExp));
-    const int ymin = miniexp_to_int(miniexp_caddr(textExp));
-    const int xmax = miniexp_to_int(miniexp_cadddr(textExp));
-    const int ymax = miniexp_to_int(miniexp_caddddr(textExp));
+    const QString type = QString::fromUtf8(miniexp_to_name(miniexp_car(textExp)));
 
-    if(rect.intersects(QRect(xmin, size.height() - ymax, xmax - xmin, ymax - ymin)))
+    if(type == QLatin1String("word"))
     {
-        const QString type = QString::fromUtf8(miniexp_to_name(miniexp_car(textExp)));
+        const int xmin = miniexp_to_int(miniexp_cadr(textExp));
+        const int ymin = miniexp_to_int(miniexp_caddr(textExp));
+        const int xmax = miniexp_to_int(miniexp_cadddr(textExp));
+        const int ymax = miniexp_to_int(miniexp_caddddr(textExp));
 
-        if(type == QLatin1String("word"))
-        {
-            return QString::fromUtf8(miniexp_to_str(miniexp_nth(5, textExp)));
-        }
-        else
-        {
-            QStringList text;
-
-            textExp = skip(textExp, 5);
-
-            for(miniexp_t textItem = miniexp_nil; miniexp_consp(textExp); textExp = miniexp_cdr(textExp))
-            {
-                textItem = miniexp_car(textExp);
-
-                text.append(loadText(textItem, size, rect));
-            }
-
-            return type == QLatin1String("line") ? text.join(" ") : text.join("\n");
-        }
+        words.append(QString::fromUtf8(miniexp_to_str(miniexp_nth(5, textExp))));
+        wordBoxes.append(transform.mapRect(QRectF(xmin, size.height() - ymax, xmax - xmin, ymax - ymin)));
     }
-
-    return QString();
-}
-
-QList< QRectF > findText(miniexp_t pageTextExp, const QSizeF& size, const QTransform& transform, const QString& text, bool matchCase)
-{
-    QList< miniexp_t > words;
-    QList< QRectF > results;
-
-    int index = 0;
-    QRectF rect;
-
-    words.append(pageTextExp);
-
-    while(!words.isEmpty())
+    else
     {
-        miniexp_t textExp = words.takeFirst();
-
-        if(miniexp_length(textExp) < 6 || !miniexp_symbolp(miniexp_car(textExp)))
-        {
-            continue;
-        }
-
-        const QString type = QString::fromUtf8(miniexp_to_name(miniexp_car(textExp)));
+        textExp = skip(textExp, 5);
 
-        if(type == QLatin1String("word"))
-        {
-            const QString word = QString::fromUtf8(miniexp_to_str(miniexp_nth(5, textExp)));
-
-            index = word.indexOf(text, index, matchCase ? Qt::CaseSensitive : Qt::CaseInsensitive);
-
-            if(index != -1)
-            {
-                const int xmin = miniexp_to_int(miniexp_cadr(textExp));
-                const int ymin = miniexp_to_int(miniexp_caddr(textExp));
-                const int xmax = miniexp_to_int(miniexp_cadddr(textExp));
-                const int ymax = miniexp_to_int(miniexp_caddddr(textExp));
-
-                index += text.length();
-                rect = rect.united(QRectF(xmin, size.height() - ymax, xmax - xmin, ymax - ymin));
-
-                if(index == word.length() || !word.at(index).isLetter())
-                {
-                    results.append(transform.mapRect(rect));
-
-                    index = 0;
-                    rect = QRectF();
-                }
-            }
-            else
-            {
-                index = 0;
-                rect = QRectF();
-            }
-        }
-        else
+        for(miniexp_t textItem = miniexp_nil; miniexp_consp(textExp); textExp = miniexp_cdr(textExp))
         {
-            textExp = skip(textExp, 5);
-
-            for(miniexp_t textItem = miniexp_nil; miniexp_consp(textExp); textExp = miniexp_cdr(textExp))
-            {
-                textItem = miniexp_car(textExp);
+            textItem = miniexp_car(textExp);
 
-                words.append(textItem);
-            }
+            loadWords(textItem, size, transform, words, wordBoxes);
         }
     }
-
-    return results;
 }
 
 void loadOutline(miniexp_t outlineExp, QStandardItem* parent, const QHash< QString, int >& indexByName)
@@ -457,11 +366,99 @@ namespace qpdfview
 namespace Model
 {
 
+DjVuMessageLoop::DjVuMessageLoop(ddjvu_context_t* context) : QThread(),
+    m_context(context),
+    m_mutex(),
+    m_messagePosted(),
+    m_messagesDrained(),
+    m_hasPostedMessages(false),
+    m_stopped(false),
+    m_generation(0)
+{
+    ddjvu_message_set_callback(m_context, DjVuMessageLoop::callback, this);
+
+    start();
+}
+
+DjVuMessageLoop::~DjVuMessageLoop()
+{
+    {
+        QMutexLocker mutexLocker(&m_mutex);
+
+        m_stopped = true;
+        m_messagePosted.wakeOne();
+    }
+
+    wait();
+
+    ddjvu_message_set_callback(m_context, 0, 0);
+}
+
+int DjVuMessageLoop::generation() const
+{
+    QMutexLocker mutexLocker(&m_mutex);
+
+    return m_generation;
+}
+
+void DjVuMessageLoop::waitForMessages(int generation) const
+{
+    QMutexLocker mutexLocker(&m_mutex);
+
+    while(m_generation == generation && !m_stopped)
+    {
+        m_messagesDrained.wait(&m_mutex);
+    }
+}
+
+void DjVuMessageLoop::run()
+{
+    QMutexLocker mutexLocker(&m_mutex);
+
+    while(!m_stopped)
+    {
+        m_hasPostedMessages = false;
+
+        mutexLocker.unlock();
+
+        while(ddjvu_message_peek(m_context) != 0)
+        {
+            ddjvu_message_pop(m_context);
+        }
+
+        mutexLocker.relock();
+
+        ++m_generation;
+        m_messagesDrained.wakeAll();
+
+        if(!m_hasPostedMessages && !m_stopped)
+        {
+            m_messagePosted.wait(&m_mutex);
+        }
+    }
+
+    m_messagesDrained.wakeAll();
+}
+
+void DjVuMessageLoop::callback(ddjvu_context_t*, void* closure)
+{
+    DjVuMessageLoop* messageLoop = static_cast< DjVuMessageLoop* >(closure);
+
+    QMutexLocker mutexLocker(&messageLoop->m_mutex);
+
+    messageLoop->m_hasPostedMessages = true;
+    messageLoop->m_messagePosted.wakeOne();
+}
+
 DjVuPage::DjVuPage(const DjVuDocument* parent, int index, const ddjvu_pageinfo_t& pageinfo) :
     m_parent(parent),
     m_index(index),
     m_size(pageinfo.width, pageinfo.height),
-    m_resolution(pageinfo.dpi)
+    m_resolution(pageinfo.dpi),
+    m_wordsMutex(),
+    m_wordsLoaded(false),
+    m_words(),
+    m_wordBoxes()
 {
 }
 
@@ -474,11 +471,9 @@ QSizeF DjVuPage::size() const
     return 72.0 / m_resolution * m_size;
 }
 
-QImage DjVuPage::render(qreal horizontalResolution, qreal verticalResolution, Rotation rotation, const QRect& boundingRect) const
+QImage DjVuPage::render(qreal horizontalResolution, qreal verticalResolution, Rotation rotation, const QRect& boundingRect, const CancellationToken* cancellation, ImageAllocator* allocator) const
 {
-    LOCK_PAGE
-
-    ddjvu_page_t* page = ddjvu_page_create_by_pageno(m_parent->m_document, m_index);
+    ddjvu_page_t* page = m_parent->createPage(m_index);
 
     if(page == 0)
     {
@@ -489,11 +484,13 @@ QImage DjVuPage::render(qreal horizontalResolution, qreal verticalResolution, Ro
 
     while(true)
     {
+        const int generation = m_parent->m_messageLoop->generation();
+
         status = ddjvu_page_decoding_status(page);
 
-        if(status < DDJVU_JOB_OK)
+        if(status < DDJVU_JOB_OK && (cancellation == 0 || !cancellation->wasCanceled()))
         {
-            clearMessageQueue(m_parent->m_context, true);
+            m_parent->m_messageLoop->waitForMessages(generation);
         }
         else
         {
@@ -501,8 +498,12 @@ QImage DjVuPage::render(qreal horizontalResolution, qreal verticalResolution, Ro
         }
     }
 
-    if(status >= DDJVU_JOB_FAILED)
+    // The decoder cannot be interrupted while rendering, but a canceled render need not wait for the page to be decoded.
+
+    if(status < DDJVU_JOB_OK || status >= DDJVU_JOB_FAILED)
     {
+        QMutexLocker mutexLocker(&m_parent->m_mutex);
+
         ddjvu_page_release(page);
 
         return QImage();
@@ -562,24 +563,53 @@ QImage DjVuPage::render(qreal horizontalResolution, qreal verticalResolution, Ro
         renderrect.h = boundingRect.height();
     }
 
-    QImage image(renderrect.w, renderrect.h, QImage::Format_RGB32);
+    QImage image = allocator != 0 ? allocator->allocate(renderrect.w, renderrect.h) : QImage(renderrect.w, renderrect.h, QImage::Format_RGB32);
 
     if(!ddjvu_page_render(page, DDJVU_RENDER_COLOR, &pagerect, &renderrect, m_parent->m_format, image.bytesPerLine(), reinterpret_cast< char* >(image.bits())))
     {
         image = QImage();
     }
 
-    clearMessageQueue(m_parent->m_context, false);
+    {
+        QMutexLocker mutexLocker(&m_parent->m_mutex);
+
+        ddjvu_page_release(page);
+    }
+
+    return image;
+}
+
+QImage DjVuPage::thumbnail() const
+{
+    LOCK_PAGE_GLOBAL
+
+    // Thumbnails which are not embedded are not computed as that would mean decoding the page.
+
+    if(ddjvu_thumbnail_status(m_parent->m_document, m_index, 0) != DDJVU_JOB_OK)
+    {
+        return QImage();
+    }
+
+    int width = maximumThumbnailSize;
+    int height = maximumThumbnailSize;
+
+    if(!ddjvu_thumbnail_render(m_parent->m_document, m_index, &width, &height, m_parent->m_format, 0, 0) || width <= 0 || height <= 0)
+    {
+        return QImage();
+    }
+
+    QImage image(width, height, QImage::Format_RGB32);
 
-    ddjvu_page_release(page);
+    if(!ddjvu_thumbnail_render(m_parent->m_document, m_index, &width, &height, m_parent->m_format, image.bytesPerLine(), reinterpret_cast< char* >(image.bits())))
+    {
+        return QImage();
+    }
 
     return image;
 }
 
 QList< Link* > DjVuPage::links() const
 {
-    LOCK_PAGE
-
     miniexp_t pageAnnoExp = miniexp_nil;
 
     {
@@ -587,11 +617,13 @@ QList< Link* > DjVuPage::links() const
 
         while(true)
         {
+            const int generation = m_parent->m_messageLoop->generation();
+
             pageAnnoExp = ddjvu_document_get_pageanno(m_parent->m_document, m_index);
 
             if(pageAnnoExp == miniexp_dummy)
             {
-                clearMessageQueue(m_parent->m_context, true);
+                m_parent->m_messageLoop->waitForMessages(generation);
             }
             else
             {
@@ -613,44 +645,88 @@ QList< Link* > DjVuPage::links() const
 
 QString DjVuPage::text(const QRectF& rect) const
 {
-    LOCK_PAGE
+    QMutexLocker mutexLocker(&m_wordsMutex);
 
-    miniexp_t pageTextExp = miniexp_nil;
+    prepareWords();
 
+    QStringList text;
+
+    for(int index = 0; index < m_words.count(); ++index)
     {
-        LOCK_PAGE_GLOBAL
+        if(rect.intersects(m_wordBoxes.at(index)))
+        {
+            text.append(m_words.at(index));
+        }
+    }
 
-        while(true)
+    return text.join(" ").simplified();
+}
+
+QList< QRectF > DjVuPage::search(const QString& text, bool matchCase) const
+{
+    QMutexLocker mutexLocker(&m_wordsMutex);
+
+    prepareWords();
+
+    QList< QRectF > results;
+
+    const Qt::CaseSensitivity caseSensitivity = matchCase ? Qt::CaseSensitive : Qt::CaseInsensitive;
+
+    int position = 0;
+    QRectF rect;
+
+    for(int index = 0; index < m_words.count(); ++index)
+    {
+        const QString& word = m_words.at(index);
+
+        position = word.indexOf(text, position, caseSensitivity);
+
+        if(position != -1)
         {
-            pageTextExp = ddjvu_document_get_pagetext(m_parent->m_document, m_index, "word");
+            position += text.length();
+            rect = rect.united(m_wordBoxes.at(index));
 
-            if(pageTextExp == miniexp_dummy)
+            if(position == word.length() || !word.at(position).isLetter())
             {
-                clearMessageQueue(m_parent->m_context, true);
-            }
-            else
-            {
-                break;
+                results.append(rect);
+
+                position = 0;
+                rect = QRectF();
             }
         }
+        else
+        {
+            position = 0;
+            rect = QRectF();
+        }
     }
 
-    const QTransform transform = QTransform::fromScale(m_resolution / 72.0, m_resolution / 72.0);
+    return results;
+}
+
+QList< TextBox > DjVuPage::textBoxes() const
+{
+    QMutexLocker mutexLocker(&m_wordsMutex);
 
-    const QString text = loadText(pageTextExp, m_size, transform.mapRect(rect)).simplified();
+    prepareWords();
 
-    {
-        LOCK_PAGE_GLOBAL
+    QList< TextBox > textBoxes;
+    textBoxes.reserve(m_words.count());
 
-        ddjvu_miniexp_release(m_parent->m_document, pageTextExp);
+    for(int index = 0; index < m_words.count(); ++index)
+    {
+        textBoxes.append(TextBox(m_words.at(index), m_wordBoxes.at(index)));
     }
 
-    return text;
+    return textBoxes;
 }
 
-QList< QRectF > DjVuPage::search(const QString& text, bool matchCase) const
+void DjVuPage::prepareWords() const
 {
-    LOCK_PAGE
+    if(m_wordsLoaded)
+    {
+        return;
+    }
 
     miniexp_t pageTextExp = miniexp_nil;
 
@@ -659,11 +735,13 @@ QList< QRectF > DjVuPage::search(const QString& text, bool matchCase) const
 
         while(true)
         {
+            const int generation = m_parent->m_messageLoop->generation();
+
             pageTextExp = ddjvu_document_get_pagetext(m_parent->m_document, m_index, "word");
 
             if(pageTextExp == miniexp_dummy)
             {
-                clearMessageQueue(m_parent->m_context, true);
+                m_parent->m_messageLoop->waitForMessages(generation);
             }
             else
             {
@@ -674,7 +752,10 @@ QList< QRectF > DjVuPage::search(const QString& text, bool matchCase) const
 
     const QTransform transform = QTransform::fromScale(72.0 / m_resolution, 72.0 / m_resolution);
 
-    const QList< QRectF > results = findText(pageTextExp, m_size, transform, text, matchCase);
+    loadWords(pageTextExp, m_size, transform, m_words, m_wordBoxes);
+
+    m_words.squeeze();
+    m_wordBoxes.squeeze();
 
     {
         LOCK_PAGE_GLOBAL
@@ -682,7 +763,7 @@ QList< QRectF > DjVuPage::search(const QString& text, bool matchCase) const
         ddjvu_miniexp_release(m_parent->m_document, pageTextExp);
     }
 
-    return results;
+    m_wordsLoaded = true;
 }
 
 DjVuDocument::DjVuDocument(QMutex* globalMutex, ddjvu_context_t* context, ddjvu_document_t* document) :
@@ -691,7 +772,9 @@ DjVuDocument::DjVuDocument(QMutex* globalMutex, ddjvu_context_t* context, ddjvu_
     m_context(context),
     m_document(document),
     m_format(0),
-    m_indexByName()
+    m_indexByName(),
+    m_messageLoop(0),
+    m_decodingAhead()
 {
     unsigned int mask[] = {0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000};
 
@@ -699,11 +782,20 @@ DjVuDocument::DjVuDocument(QMutex* globalMutex, ddjvu_context_t* context, ddjvu_
     ddjvu_format_set_row_order(m_format, 1);
     ddjvu_format_set_y_direction(m_format, 1);
 
+    m_messageLoop = new DjVuMessageLoop(m_context);
+
     prepareIndexByName();
 }
 
 DjVuDocument::~DjVuDocument()
 {
+    foreach(ddjvu_page_t* page, m_decodingAhead)
+    {
+        ddjvu_page_release(page);
+    }
+
+    delete m_messageLoop;
+
     ddjvu_document_release(m_document);
     ddjvu_context_release(m_context);
     ddjvu_format_release(m_format);
@@ -718,18 +810,18 @@ int DjVuDocument::numberOfPages() const
 
 Page* DjVuDocument::page(int index) const
 {
-    LOCK_DOCUMENT
-
     ddjvu_status_t status;
     ddjvu_pageinfo_t pageinfo;
 
     while(true)
     {
+        const int generation = m_messageLoop->generation();
+
         status = ddjvu_document_get_pageinfo(m_document, index, &pageinfo);
 
         if(status < DDJVU_JOB_OK)
         {
-            clearMessageQueue(m_context, true);
+            m_messageLoop->waitForMessages(generation);
         }
         else
         {
@@ -745,6 +837,11 @@ Page* DjVuDocument::page(int index) const
     return new DjVuPage(this, index, pageinfo);
 }
 
+bool DjVuDocument::hasPageLabels() const
+{
+    return false;
+}
+
 QStringList DjVuDocument::saveFilter() const
 {
     return QStringList() << QLatin1String("DjVu (*.djvu *.djv)");
@@ -778,9 +875,18 @@ bool DjVuDocument::save(const QString& filePath, bool withChanges) const
 
     ddjvu_job_t* job = ddjvu_document_save(m_document, file, 0, 0);
 
-    while(!ddjvu_job_done(job))
+    while(true)
     {
-        clearMessageQueue(m_context, true);
+        const int generation = m_messageLoop->generation();
+
+        if(!ddjvu_job_done(job))
+        {
+            m_messageLoop->waitForMessages(generation);
+        }
+        else
+        {
+            break;
+        }
     }
 
     fclose(file);
@@ -801,11 +907,13 @@ void DjVuDocument::loadOutline(QStandardItemModel* outlineModel) const
 
         while(true)
         {
+            const int generation = m_messageLoop->generation();
+
             outlineExp = ddjvu_document_get_outline(m_document);
 
             if(outlineExp == miniexp_dummy)
             {
-                clearMessageQueue(m_context, true);
+                m_messageLoop->waitForMessages(generation);
             }
             else
             {
@@ -841,11 +949,13 @@ void DjVuDocument::loadProperties(QStandardItemModel* propertiesModel) const
 
         while(true)
         {
+            const int generation = m_messageLoop->generation();
+
             annoExp = ddjvu_document_get_anno(m_document, TRUE);
 
             if(annoExp == miniexp_dummy)
             {
-                clearMessageQueue(m_context, true);
+                m_messageLoop->waitForMessages(generation);
             }
             else
             {
@@ -863,6 +973,46 @@ void DjVuDocument::loadProperties(QStandardItemModel* propertiesModel) const
     }
 }
 
+ddjvu_page_t* DjVuDocument::createPage(int index) const
+{
+    LOCK_DOCUMENT
+
+    ddjvu_page_t* page = ddjvu_page_create_by_pageno(m_document, index);
+
+    // Keep the following pages referenced so that they are decoded in the background until they are rendered.
+
+    const int count = ddjvu_document_get_pagenum(m_document);
+
+    for(int aheadIndex = index + 1; aheadIndex <= index + decodeAheadCount && aheadIndex < count; ++aheadIndex)
+    {
+        if(!m_decodingAhead.contains(aheadIndex))
+        {
+            ddjvu_page_t* aheadPage = ddjvu_page_create_by_pageno(m_document, aheadIndex);
+
+            if(aheadPage != 0)
+            {
+                m_decodingAhead.insert(aheadIndex, aheadPage);
+            }
+        }
+    }
+
+    for(QMap< int, ddjvu_page_t* >::iterator iterator = m_decodingAhead.begin(); iterator != m_decodingAhead.end();)
+    {
+        if(iterator.key() <= index || iterator.key() > index + decodeAheadCount)
+        {
+            ddjvu_page_release(iterator.value());
+
+            iterator = m_decodingAhead.erase(iterator);
+        }
+        else
+        {
+            ++iterator;
+        }
+    }
+
+    return page;
+}
+
 void DjVuDocument::prepareIndexByName()
 {
     for(int index = 0, count = ddjvu_document_get_filenum(m_document); index < count; ++index)
@@ -26,11 +26,16 @@ along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
 #define DJVUMODEL_H
 
 #include <QHash>
+#include <QMap>
 #include <QMutex>
+#include <QThread>
+#include <QVector>
+#include <QWaitCondition>
 
 typedef struct ddjvu_context_s ddjvu_context_t;
 typedef struct ddjvu_format_s ddjvu_format_t;
 typedef struct ddjvu_document_s ddjvu_document_t;
+typedef struct ddjvu_page_s ddjvu_page_t;
 typedef struct ddjvu_pageinfo_s ddjvu_pageinfo_t;
 
 #include "model.h"
@@ -42,6 +47,37 @@ class DjVuPlugin;
 
 namespace Model
 {
+    // Drains the message queue of a context so that callers only need to wait until their own job has progressed.
+
+    class DjVuMessageLoop : public QThread
+    {
+    public:
+        DjVuMessageLoop(ddjvu_context_t* context);
+        ~DjVuMessageLoop();
+
+        int generation() const;
+        void waitForMessages(int generation) const;
+
+    protected:
+        void run();
+
+    private:
+        Q_DISABLE_COPY(DjVuMessageLoop)
+
+        ddjvu_context_t* m_context;
+
+        mutable QMutex m_mutex;
+        QWaitCondition m_messagePosted;
+        mutable QWaitCondition m_messagesDrained;
+
+        bool m_hasPostedMessages;
+        bool m_stopped;
+        int m_generation;
+
+        static void callback(ddjvu_context_t* context, void* closure);
+
+    };
+
     class DjVuPage : public Page
     {
         friend class DjVuDocument;
@@ -51,13 +87,16 @@ namespace Model
 
         QSizeF size() const;
 
-        QImage render(qreal horizontalResolution, qreal verticalResolution, Rotation rotation, const QRect& boundingRect) const;
+        QImage render(qreal horizontalResolution, qreal verticalResolution, Rotation rotation, const QRect& boundingRect, const CancellationToken* cancellation, ImageAllocator* allocator) const;
+        QImage thumbnail() const;
 
         QList< Link* > links() const;
 
         QString text(const QRectF& rect) const;
         QList< QRectF > search(const QString& text, bool matchCase) const;
 
+        QList< TextBox > textBoxes() const;
+
     private:
         Q_DISABLE_COPY(DjVuPage)
 
@@ -69,6 +108,15 @@ namespace Model
         QSizeF m_size;
         int m_resolution;
 
+        // The hidden text is flattened into its words and their boxes in points once and then shared by text extraction and search.
+
+        mutable QMutex m_wordsMutex;
+        mutable bool m_wordsLoaded;
+        mutable QVector< QString > m_words;
+        mutable QVector< QRectF > m_wordBoxes;
+
+        void prepareWords() const;
+
     };
 
     class DjVuDocument : public Document
@@ -83,6 +131,8 @@ namespace Model
 
         Page* page(int index) const;
 
+        bool hasPageLabels() const;
+
         QStringList saveFilter() const;
 
         bool canSave() const;
@@ -107,6 +157,12 @@ namespace Model
 
         void prepareIndexByName();
 
+        DjVuMessageLoop* m_messageLoop;
+
+        mutable QMap< int, ddjvu_page_t* > m_decodingAhead;
+
+        ddjvu_page_t* createPage(int index) const;
+
     };
 }
 
@@ -117,7 +173,7 @@ class DjVuPlugin : public QObject, Plugin
 
 #if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
 
-    Q_PLUGIN_METADATA(IID "local.qpdfview.Plugin")
+    Q_PLUGIN_METADATA(IID "local.qpdfview.Plugin/2")
 
 #endif // QT_VERSION
 
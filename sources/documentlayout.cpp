@@ -22,8 +22,9 @@ along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "documentlayout.h"
 
+#include <QRectF>
+
 #include "settings.h"
-#include "pageitem.h"
 
 namespace
 {
@@ -39,7 +40,11 @@ namespace qpdfview
 
 Settings* DocumentLayout::s_settings = 0;
 
-DocumentLayout::DocumentLayout()
+DocumentLayout::DocumentLayout() :
+    m_count(0),
+    m_rowIndices(),
+    m_rowTops(),
+    m_rowBottoms()
 {
     if(s_settings == 0)
     {
@@ -84,6 +89,38 @@ qreal DocumentLayout::visibleHeight(int viewportHeight) const
     return viewportHeight - 2.0f * pageSpacing;
 }
 
+QPair< int, int > DocumentLayout::pagesBetween(qreal top, qreal bottom) const
+{
+    const int firstRow = qLowerBound(m_rowBottoms.constBegin(), m_rowBottoms.constEnd(), top) - m_rowBottoms.constBegin();
+    const int lastRow = qUpperBound(m_rowTops.constBegin(), m_rowTops.constEnd(), bottom) - m_rowTops.constBegin() - 1;
+
+    if(firstRow > lastRow)
+    {
+        return qMakePair(0, -1);
+    }
+
+    const int firstIndex = m_rowIndices.at(firstRow);
+    const int lastIndex = lastRow + 1 < m_rowIndices.count() ? m_rowIndices.at(lastRow + 1) - 1 : m_count - 1;
+
+    return qMakePair(firstIndex, lastIndex);
+}
+
+void DocumentLayout::clearRows(int count)
+{
+    m_count = count;
+
+    m_rowIndices.clear();
+    m_rowTops.clear();
+    m_rowBottoms.clear();
+}
+
+void DocumentLayout::appendRow(int index, qreal top, qreal bottom)
+{
+    m_rowIndices.append(index);
+    m_rowTops.append(top);
+    m_rowBottoms.append(bottom);
+}
+
 
 int SinglePageLayout::currentPage(int page) const
 {
@@ -127,21 +164,25 @@ qreal SinglePageLayout::visibleWidth(int viewportWidth) const
     return viewportWidth - viewportPadding - 2.0f * pageSpacing;
 }
 
-void SinglePageLayout::prepareLayout(const QVector< PageItem* >& pageItems, bool /* rightToLeft */,
+void SinglePageLayout::prepareLayout(const QVector< QRectF >& boundingRects, QVector< QPointF >& positions, bool /* rightToLeft */,
                                      qreal& left, qreal& right, qreal& height)
 {
     const qreal pageSpacing = s_settings->documentView().pageSpacing();
     qreal pageHeight = 0.0f;
 
-    for(int index = 0; index < pageItems.count(); ++index)
+    clearRows(boundingRects.count());
+    positions.resize(boundingRects.count());
+
+    for(int index = 0; index < boundingRects.count(); ++index)
     {
-        PageItem* page = pageItems.at(index);
-        const QRectF boundingRect = page->boundingRect();
+        const QRectF& boundingRect = boundingRects.at(index);
 
-        page->setPos(-boundingRect.left() - 0.5f * boundingRect.width(), height - boundingRect.top());
+        positions[index] = QPointF(-boundingRect.left() - 0.5f * boundingRect.width(), height - boundingRect.top());
 
         pageHeight = boundingRect.height();
 
+        appendRow(index, height, height + pageHeight);
+
         left = qMin(left, -0.5f * boundingRect.width() - pageSpacing);
         right = qMax(right, 0.5f * boundingRect.width() + pageSpacing);
         height += pageHeight + pageSpacing;
@@ -189,23 +230,25 @@ qreal TwoPagesLayout::visibleWidth(int viewportWidth) const
     return (viewportWidth - viewportPadding - 3.0f * pageSpacing) / 2.0f;
 }
 
-void TwoPagesLayout::prepareLayout(const QVector< PageItem* >& pageItems, bool rightToLeft,
+void TwoPagesLayout::prepareLayout(const QVector< QRectF >& boundingRects, QVector< QPointF >& positions, bool rightToLeft,
                                    qreal& left, qreal& right, qreal& height)
 {
     const qreal pageSpacing = s_settings->documentView().pageSpacing();
     qreal pageHeight = 0.0f;
 
-    for(int index = 0; index < pageItems.count(); ++index)
+    clearRows(boundingRects.count());
+    positions.resize(boundingRects.count());
+
+    for(int index = 0; index < boundingRects.count(); ++index)
     {
-        PageItem* page = pageItems.at(index);
-        const QRectF boundingRect = page->boundingRect();
+        const QRectF& boundingRect = boundingRects.at(index);
 
         const qreal leftPos = -boundingRect.left() - boundingRect.width() - 0.5f * pageSpacing;
         const qreal rightPos = -boundingRect.left() + 0.5f * pageSpacing;
 
         if(index == leftIndex(index))
         {
-            page->setPos(rightToLeft ? rightPos : leftPos, height - boundingRect.top());
+            positions[index] = QPointF(rightToLeft ? rightPos : leftPos, height - boundingRect.top());
 
             pageHeight = boundingRect.height();
 
@@ -218,18 +261,22 @@ void TwoPagesLayout::prepareLayout(const QVector< PageItem* >& pageItems, bool r
                 left = qMin(left, -boundingRect.width() - 1.5f * pageSpacing);
             }
 
-            if(index == rightIndex(index, pageItems.count()))
+            if(index == rightIndex(index, boundingRects.count()))
             {
+                appendRow(index, height, height + pageHeight);
+
                 right = qMax(right, 0.5f * pageSpacing);
                 height += pageHeight + pageSpacing;
             }
         }
         else
         {
-            page->setPos(rightToLeft ? leftPos : rightPos, height - boundingRect.top());
+            positions[index] = QPointF(rightToLeft ? leftPos : rightPos, height - boundingRect.top());
 
             pageHeight = qMax(pageHeight, boundingRect.height());
 
+            appendRow(leftIndex(index), height, height + pageHeight);
+
             if(rightToLeft)
             {
                 left = qMin(left, -boundingRect.width() - 1.5f * pageSpacing);
@@ -313,21 +360,23 @@ qreal MultiplePagesLayout::visibleWidth(int viewportWidth) const
     return (viewportWidth - viewportPadding - (pagesPerRow + 1) * pageSpacing) / pagesPerRow;
 }
 
-void MultiplePagesLayout::prepareLayout(const QVector< PageItem* >& pageItems, bool rightToLeft,
+void MultiplePagesLayout::prepareLayout(const QVector< QRectF >& boundingRects, QVector< QPointF >& positions, bool rightToLeft,
                                         qreal& left, qreal& right, qreal& height)
 {
     const qreal pageSpacing = s_settings->documentView().pageSpacing();
     qreal pageHeight = 0.0;
 
-    for(int index = 0; index < pageItems.count(); ++index)
+    clearRows(boundingRects.count());
+    positions.resize(boundingRects.count());
+
+    for(int index = 0; index < boundingRects.count(); ++index)
     {
-        PageItem* page = pageItems.at(index);
-        const QRectF boundingRect = page->boundingRect();
+        const QRectF& boundingRect = boundingRects.at(index);
 
         const qreal leftPos = left - boundingRect.left() + pageSpacing;
         const qreal rightPos = right - boundingRect.left() - boundingRect.width() - pageSpacing;
 
-        page->setPos(rightToLeft ? rightPos : leftPos, height - boundingRect.top());
+        positions[index] = QPointF(rightToLeft ? rightPos : leftPos, height - boundingRect.top());
 
         pageHeight = qMax(pageHeight, boundingRect.height());
 
@@ -340,8 +389,10 @@ void MultiplePagesLayout::prepareLayout(const QVector< PageItem* >& pageItems, b
             left += boundingRect.width() + pageSpacing;
         }
 
-        if(index == rightIndex(index, pageItems.count()))
+        if(index == rightIndex(index, boundingRects.count()))
         {
+            appendRow(leftIndex(index), height, height + pageHeight);
+
             height += pageHeight + pageSpacing;
             pageHeight = 0.0f;
 
@@ -25,16 +25,17 @@ along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <QMap>
 #include <QPair>
+#include <QVector>
 
 #include "global.h"
 
+class QPointF;
 class QRectF;
 
 namespace qpdfview
 {
 
 class Settings;
-class PageItem;
 
 struct DocumentLayout
 {
@@ -59,12 +60,25 @@ struct DocumentLayout
     virtual qreal visibleWidth(int viewportWidth) const = 0;
     qreal visibleHeight(int viewportHeight) const;
 
-    virtual void prepareLayout(const QVector< PageItem* >& pageItems, bool rightToLeft,
+    virtual void prepareLayout(const QVector< QRectF >& boundingRects, QVector< QPointF >& positions, bool rightToLeft,
                                qreal& left, qreal& right, qreal& height) = 0;
 
+    // Returns the first and last index of the pages in the rows which overlap the given vertical range as of the last call to prepareLayout.
+    QPair< int, int > pagesBetween(qreal top, qreal bottom) const;
+
 protected:
     static Settings* s_settings;
 
+    void clearRows(int count);
+    void appendRow(int index, qreal top, qreal bottom);
+
+private:
+    // Since rows are laid out from top to bottom, both their tops and their bottoms are sorted.
+    int m_count;
+    QVector< int > m_rowIndices;
+    QVector< qreal > m_rowTops;
+    QVector< qreal > m_rowBottoms;
+
 };
 
 struct SinglePageLayout : public DocumentLayout
@@ -82,7 +96,7 @@ struct SinglePageLayout : public DocumentLayout
 
     qreal visibleWidth(int viewportWidth) const;
 
-    void prepareLayout(const QVector< PageItem* >& pageItems, bool rightToLeft,
+    void prepareLayout(const QVector< QRectF >& boundingRects, QVector< QPointF >& positions, bool rightToLeft,
                        qreal& left, qreal& right, qreal& height);
 
 };
@@ -102,7 +116,7 @@ struct TwoPagesLayout : public DocumentLayout
 
     qreal visibleWidth(int viewportWidth) const;
 
-    void prepareLayout(const QVector< PageItem* >& pageItems, bool rightToLeft,
+    void prepareLayout(const QVector< QRectF >& boundingRects, QVector< QPointF >& positions, bool rightToLeft,
                        qreal& left, qreal& right, qreal& height);
 
 };
@@ -133,7 +147,7 @@ struct MultiplePagesLayout : public DocumentLayout
 
     qreal visibleWidth(int viewportWidth) const;
 
-    void prepareLayout(const QVector< PageItem* >& pageItems, bool rightToLeft,
+    void prepareLayout(const QVector< QRectF >& boundingRects, QVector< QPointF >& positions, bool rightToLeft,
                        qreal& left, qreal& right, qreal& height);
 
 };
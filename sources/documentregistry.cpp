@@ -0,0 +1,150 @@
+/*
+
+Copyright 2014 Adam Reichold
+
+This file is part of qpdfview.
+
+qpdfview is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+qpdfview is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "documentregistry.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QFileInfo>
+
+#include "model.h"
+
+namespace qpdfview
+{
+
+DocumentRegistry* DocumentRegistry::s_instance = 0;
+
+DocumentRegistry* DocumentRegistry::instance()
+{
+    if(s_instance == 0)
+    {
+        s_instance = new DocumentRegistry();
+    }
+
+    return s_instance;
+}
+
+DocumentRegistry::~DocumentRegistry()
+{
+    s_instance = 0;
+}
+
+bool DocumentRegistry::contains(const QString& filePath) const
+{
+    return m_documents.contains(fileKey(filePath));
+}
+
+bool DocumentRegistry::acquire(const QString& filePath, Model::Document*& document, QVector< Model::Page* >& pages)
+{
+    Model::Document* sharedDocument = m_documents.value(fileKey(filePath), 0);
+
+    if(sharedDocument == 0)
+    {
+        return false;
+    }
+
+    Entry& entry = m_entries[sharedDocument];
+
+    ++entry.references;
+
+    document = sharedDocument;
+    pages = entry.pages;
+
+    return true;
+}
+
+void DocumentRegistry::insert(const QString& filePath, Model::Document* document, const QVector< Model::Page* >& pages)
+{
+    Entry entry;
+    entry.key = fileKey(filePath);
+    entry.pages = pages;
+    entry.references = 1;
+
+    // If another view loaded the same file concurrently, its document stays the one which is shared.
+
+    if(m_documents.contains(entry.key))
+    {
+        entry.key = QByteArray();
+    }
+    else
+    {
+        m_documents.insert(entry.key, document);
+    }
+
+    m_entries.insert(document, entry);
+}
+
+void DocumentRegistry::detach(Model::Document* document)
+{
+    QHash< Model::Document*, Entry >::iterator entry = m_entries.find(document);
+
+    if(entry != m_entries.end() && !entry.value().key.isNull())
+    {
+        m_documents.remove(entry.value().key);
+
+        entry.value().key = QByteArray();
+    }
+}
+
+void DocumentRegistry::release(Model::Document* document, const QVector< Model::Page* >& pages)
+{
+    QHash< Model::Document*, Entry >::iterator entry = m_entries.find(document);
+
+    if(entry != m_entries.end())
+    {
+        if(--entry.value().references > 0)
+        {
+            return;
+        }
+
+        if(!entry.value().key.isNull())
+        {
+            m_documents.remove(entry.value().key);
+        }
+
+        m_entries.erase(entry);
+    }
+
+    qDeleteAll(pages);
+    delete document;
+}
+
+DocumentRegistry::DocumentRegistry() :
+    m_entries(),
+    m_documents()
+{
+}
+
+QByteArray DocumentRegistry::fileKey(const QString& filePath)
+{
+    const QFileInfo fileInfo(filePath);
+
+    QByteArray key;
+
+    QDataStream(&key, QIODevice::WriteOnly)
+            << fileInfo.canonicalFilePath()
+            << fileInfo.lastModified()
+            << fileInfo.size();
+
+    return key;
+}
+
+} // qpdfview
@@ -0,0 +1,79 @@
+/*
+
+Copyright 2014 Adam Reichold
+
+This file is part of qpdfview.
+
+qpdfview is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+qpdfview is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef DOCUMENTREGISTRY_H
+#define DOCUMENTREGISTRY_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QVector>
+
+namespace qpdfview
+{
+
+namespace Model
+{
+class Document;
+class Page;
+}
+
+// Views of the same unchanged file share one document together with its pages, which are deleted when the last of these views releases them.
+
+class DocumentRegistry
+{
+public:
+    static DocumentRegistry* instance();
+    ~DocumentRegistry();
+
+    bool contains(const QString& filePath) const;
+
+    bool acquire(const QString& filePath, Model::Document*& document, QVector< Model::Page* >& pages);
+    void insert(const QString& filePath, Model::Document* document, const QVector< Model::Page* >& pages);
+
+    // Documents which were modified by one of their views are not handed out to further views.
+
+    void detach(Model::Document* document);
+    void release(Model::Document* document, const QVector< Model::Page* >& pages);
+
+private:
+    Q_DISABLE_COPY(DocumentRegistry)
+
+    static DocumentRegistry* s_instance;
+    DocumentRegistry();
+
+    struct Entry
+    {
+        QByteArray key;
+        QVector< Model::Page* > pages;
+        int references;
+
+    };
+
+    QHash< Model::Document*, Entry > m_entries;
+    QHash< QByteArray, Model::Document* > m_documents;
+
+    static QByteArray fileKey(const QString& filePath);
+
+};
+
+} // qpdfview
+
+#endif // DOCUMENTREGISTRY_H
@@ -25,13 +25,16 @@ along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
 #include "documentview.h"
 
 #include <QApplication>
+#include <QCryptographicHash>
+#include <QDataStream>
 #include <QInputDialog>
 #include <QDebug>
 #include <QDesktopWidget>
 #include <QDesktopServices>
 #include <QDir>
-#include <QFileSystemWatcher>
+#include <QGraphicsSimpleTextItem>
 #include <QKeyEvent>
+#include <QLabel>
 #include <qmath.h>
 #include <QMenu>
 #include <QMessageBox>
@@ -41,8 +44,15 @@ along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
 #include <QScrollBar>
 #include <QTemporaryFile>
 #include <QTimer>
+#include <QtConcurrentRun>
 #include <QUrl>
 
+#ifdef WITH_OPENGL
+
+#include <QGLWidget>
+
+#endif // WITH_OPENGL
+
 #ifdef WITH_CUPS
 
 #include <cups/cups.h>
@@ -50,30 +60,79 @@ along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
 
 #endif // WITH_CUPS
 
-#ifdef WITH_SYNCTEX
-
-#include <synctex_parser.h>
-
-#endif // WITH_SYNCTEX
-
 #include "settings.h"
 #include "model.h"
 #include "pluginhandler.h"
 #include "shortcuthandler.h"
+#include "database.h"
+#include "diskcache.h"
+#include "documentregistry.h"
+#include "filechangedetector.h"
+#include "lazypage.h"
+#include "linkpreloader.h"
+#include "outlinemodel.h"
 #include "pageitem.h"
+#include "prefetchplanner.h"
+#include "renderscheduler.h"
+#include "renderstatistics.h"
+#include "scheduledjobs.h"
 #include "thumbnailitem.h"
+#include "tileitem.h"
 #include "presentationview.h"
 #include "searchmodel.h"
 #include "searchtask.h"
+#include "textlayout.h"
+#include "tracing.h"
 #include "miscellaneous.h"
 #include "documentlayout.h"
 #include "mainwindow.h"
 
+#ifdef WITH_SYNCTEX
+
+#include "synctexscanner.h"
+
+#endif // WITH_SYNCTEX
+
 namespace
 {
 
 using namespace qpdfview;
 
+// A pause longer than this starts a new scroll gesture.
+const qint64 scrollIdleInterval = 250;
+
+// Tiles are prefetched along the path the viewport is predicted to travel within this many milliseconds.
+const qreal scrollPredictionInterval = 500.0;
+
+// Below this velocity in pixels per millisecond, prefetching is left to the prefetch timer.
+const qreal minimumScrollVelocity = 0.5;
+
+// Pages are compared at this resolution when the document is refreshed.
+const qreal fingerprintResolution = 36.0;
+
+// Search results are inserted into the search model at most this often in milliseconds.
+const int searchResultsInterval = 100;
+
+// The statistics overlay is updated this often in milliseconds.
+const int statisticsInterval = 1000;
+
+// Pages are rasterized for printing in horizontal bands of at most this many bytes.
+const qint64 maximumPrintBandSize = Q_INT64_C(16) * 1024 * 1024;
+
+// Fonts are scanned in steps of this many pages.
+const int fontsPageCount = 16;
+
+// The progress of saving is updated this often in milliseconds.
+const int saveProgressInterval = 100;
+
+// Rows describing the memory used by a tab are appended to the properties and marked with this role.
+const int memoryPropertyRole = Qt::UserRole + 1;
+
+QString formatMemory(qint64 bytes)
+{
+    return DocumentView::tr("%1 MB").arg(static_cast< qreal >(bytes) / (1024.0 * 1024.0), 0, 'f', 1);
+}
+
 // taken from http://rosettacode.org/wiki/Roman_numerals/Decode#C.2B.2B
 int romanToInt(const QString& text)
 {
@@ -210,6 +269,243 @@ int addCMYKorRGBColorModel(cups_dest_t* dest, int num_options, cups_option_t** o
 
 #endif // WITH_CUPS
 
+// Crop rects are relative to the rotated page and are stored for the unrotated page.
+QRectF rotateCropRect(const QRectF& cropRect, qreal angle)
+{
+    if(cropRect.isNull())
+    {
+        return cropRect;
+    }
+
+    QTransform transform;
+    transform.translate(0.5, 0.5);
+    transform.rotate(angle);
+    transform.translate(-0.5, -0.5);
+
+    return transform.mapRect(cropRect);
+}
+
+Model::Document* loadDocument(const Plugin* plugin, const QString& filePath, QSharedPointer< QAtomicInt > cancellation)
+{
+    const TraceSpan span("document", "loadDocument");
+
+    // Without a plugin, the document is shared with another view once the job has finished.
+
+    if(plugin == 0)
+    {
+        return 0;
+    }
+
+    Model::Document* document = PluginHandler::loadDocument(plugin, filePath);
+
+    // The view which requested the document might be gone already.
+
+    if(cancellation->fetchAndAddOrdered(0) != 0)
+    {
+        delete document;
+
+        return 0;
+    }
+
+    return document;
+}
+
+#ifdef WITH_SYNCTEX
+
+QSharedPointer< SyncTeXScanner > loadSyncTeXScanner(const QString& filePath)
+{
+    return QSharedPointer< SyncTeXScanner >(SyncTeXScanner::load(filePath));
+}
+
+#endif // WITH_SYNCTEX
+
+class PrintCancellation : public Model::CancellationToken
+{
+public:
+    explicit PrintCancellation(const QSharedPointer< QAtomicInt >& wasCanceled) :
+        m_wasCanceled(wasCanceled)
+    {
+    }
+
+    bool wasCanceled() const
+    {
+        return m_wasCanceled->fetchAndAddOrdered(0) != 0;
+    }
+
+private:
+    Q_DISABLE_COPY(PrintCancellation)
+
+    QSharedPointer< QAtomicInt > m_wasCanceled;
+
+};
+
+QSize printSize(const Model::Page* page, int resolutionX, int resolutionY)
+{
+    return QSize(qMax(qCeil(resolutionX / 72.0 * page->size().width()), 1),
+                 qMax(qCeil(resolutionY / 72.0 * page->size().height()), 1));
+}
+
+QRect printBand(const QSize& size, int top)
+{
+    const int bandHeight = qMax(static_cast< int >(maximumPrintBandSize / (4 * size.width())), 1);
+
+    return QRect(0, top, size.width(), qMin(bandHeight, size.height() - top));
+}
+
+QImage renderForPrinting(const Model::Page* page, int resolutionX, int resolutionY, const QRect& band, QSharedPointer< QAtomicInt > cancellation)
+{
+    const PrintCancellation printCancellation(cancellation);
+
+    if(printCancellation.wasCanceled())
+    {
+        return QImage();
+    }
+
+    return page->render(resolutionX, resolutionY, RotateBy0, band, &printCancellation);
+}
+
+struct PrintBand
+{
+    const Model::Page* page;
+    int resolutionX;
+    int resolutionY;
+    QSharedPointer< QAtomicInt > cancellation;
+
+    PrintBand(const Model::Page* page, int resolutionX, int resolutionY, QSharedPointer< QAtomicInt > cancellation) : page(page), resolutionX(resolutionX), resolutionY(resolutionY), cancellation(cancellation) {}
+
+    QImage operator()(const QRect& band) const
+    {
+        return renderForPrinting(page, resolutionX, resolutionY, band, cancellation);
+    }
+
+};
+
+enum SaveMode
+{
+    SaveWithoutChanges,
+    SaveWithChanges,
+    SaveChangesInPlace
+};
+
+bool saveDocument(const Model::Document* document, const QString& filePath, const QString& temporaryFilePath, SaveMode mode, QSharedPointer< QAtomicInt > copyProgress)
+{
+    const TraceSpan span("save", "save");
+
+    // Changes saved into the original file are appended in place which avoids writing the whole document.
+
+    if(mode == SaveChangesInPlace && document->saveChanges(filePath))
+    {
+        return true;
+    }
+
+    if(!document->save(temporaryFilePath, mode != SaveWithoutChanges))
+    {
+        return false;
+    }
+
+    QFile temporaryFile(temporaryFilePath);
+    QFile file(filePath);
+
+    if(!temporaryFile.open(QIODevice::ReadOnly) || !file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        return false;
+    }
+
+    const qint64 maxSize = 1024 * 1024;
+    const qreal totalSize = qMax(temporaryFile.size(), Q_INT64_C(1));
+
+    while(!temporaryFile.atEnd())
+    {
+        const QByteArray data = temporaryFile.read(maxSize);
+
+        if(data.isEmpty() || file.write(data) != data.size())
+        {
+            return false;
+        }
+
+        copyProgress->fetchAndStoreOrdered(qRound(100.0 * temporaryFile.pos() / totalSize));
+    }
+
+    return true;
+}
+
+QPair< QStandardItemModel*, QStandardItemModel* > loadModels(const Model::Document* document)
+{
+    QStandardItemModel* outlineModel = new QStandardItemModel();
+    QStandardItemModel* propertiesModel = new QStandardItemModel();
+
+    document->loadOutline(outlineModel);
+    document->loadProperties(propertiesModel);
+
+    outlineModel->moveToThread(qApp->thread());
+    propertiesModel->moveToThread(qApp->thread());
+
+    return qMakePair(outlineModel, propertiesModel);
+}
+
+struct FontsLoader
+{
+    typedef QSharedPointer< QStandardItemModel > result_type;
+
+    const Model::Document* document;
+    int numberOfPages;
+
+    FontsLoader(const Model::Document* document, int numberOfPages) : document(document), numberOfPages(numberOfPages) {}
+
+    QSharedPointer< QStandardItemModel > operator()(int beginIndex) const
+    {
+        QSharedPointer< QStandardItemModel > fontsModel(new QStandardItemModel());
+
+        document->loadFonts(fontsModel.data(), beginIndex, qMin(beginIndex + fontsPageCount, numberOfPages));
+
+        fontsModel->moveToThread(qApp->thread());
+
+        return fontsModel;
+    }
+
+};
+
+void takeModel(QStandardItemModel* model, QStandardItemModel* source)
+{
+    model->clear();
+    model->setColumnCount(source->columnCount());
+
+    for(int column = 0; column < source->columnCount(); ++column)
+    {
+        QStandardItem* item = source->takeHorizontalHeaderItem(column);
+
+        if(item != 0)
+        {
+            model->setHorizontalHeaderItem(column, item);
+        }
+    }
+
+    while(source->rowCount() > 0)
+    {
+        model->appendRow(source->takeRow(0));
+    }
+}
+
+// A page is considered unchanged by a refresh if its size and a coarse rendering are unchanged.
+QByteArray pageFingerprint(Model::Page* page)
+{
+    const QImage image = page->render(fingerprintResolution, fingerprintResolution);
+
+    QCryptographicHash hash(QCryptographicHash::Md5);
+
+    QByteArray size;
+    QDataStream(&size, QIODevice::WriteOnly) << page->size();
+
+    hash.addData(size);
+
+    for(int y = 0; y < image.height(); ++y)
+    {
+        hash.addData(reinterpret_cast< const char* >(image.constScanLine(y)), image.bytesPerLine());
+    }
+
+    return hash.result();
+}
+
 bool modifiersUseMouseButton(Settings* settings, Qt::MouseButton mouseButton)
 {
     return ((settings->documentView().zoomModifiers() | settings->documentView().rotateModifiers() | settings->documentView().scrollModifiers()) & mouseButton) != 0;
@@ -235,13 +531,20 @@ ShortcutHandler* DocumentView::s_shortcutHandler = 0;
 SearchModel* DocumentView::s_searchModel = 0;
 
 DocumentView::DocumentView(QWidget* parent) : QGraphicsView(parent),
-    m_autoRefreshWatcher(0),
-    m_autoRefreshTimer(0),
+    m_autoRefreshDetector(0),
     m_prefetchTimer(0),
+    m_zoomGestureTimer(0),
+    m_zoomGestureScaleFactor(1.0),
+    m_scrollTimer(),
+    m_scrollValue(0),
+    m_scrollVelocity(0.0),
+    m_scrollDirection(0),
     m_document(0),
     m_pages(),
+    m_visiblePages(0, -1),
     m_fileInfo(),
     m_wasModified(false),
+    m_isSaving(false),
     m_currentPage(-1),
     m_firstPage(-1),
     m_past(),
@@ -256,14 +559,55 @@ DocumentView::DocumentView(QWidget* parent) : QGraphicsView(parent),
     m_highlightAll(false),
     m_rubberBandMode(ModifiersMode),
     m_pageItems(),
+    m_pageBoundingRects(),
+    m_pagePositions(),
+    m_pageCropRects(),
+    m_pageScaleFactors(),
+    m_materializedPages(),
+    m_retainedPages(),
+    m_documentKey(),
     m_thumbnailItems(),
+    m_thumbnailRects(),
+    m_thumbnailCropRects(),
+    m_thumbnailsVisibleRect(),
     m_highlight(0),
     m_thumbnailsOrientation(Qt::Vertical),
     m_thumbnailsScene(0),
     m_outlineModel(0),
     m_propertiesModel(0),
+    m_openWatcher(0),
+    m_openCancellation(),
+    m_openPlaceholder(0),
+    m_openDeferred(false),
+    m_deferredPage(-1),
+    m_modelsWatcher(0),
+    m_fingerprintsWatcher(0),
+    m_fingerprintsOrder(),
+    m_fingerprints(),
+    m_previousFingerprints(),
+    m_textIndexWatcher(0),
+    m_textIndex(),
+    m_fontsModel(0),
+    m_fontsWatcher(0),
+    m_fontsPrepared(false),
+    m_fontKeys(),
+#ifdef WITH_SYNCTEX
+    m_syncTeXScannerJob(),
+    m_syncTeXScanner(),
+#endif // WITH_SYNCTEX
     m_currentResult(),
-    m_searchTask(0)
+    m_searchTask(0),
+    m_searchText(),
+    m_searchMatchCase(false),
+    m_searchWholeWords(false),
+    m_searchRegularExpression(false),
+    m_unsearchedPages(),
+    m_searchPending(false),
+    m_pendingSearchIndices(),
+    m_searchResultsTimer(0),
+    m_searchResultsBatch(),
+    m_statisticsOverlay(0),
+    m_statisticsTimer(0)
 {
     if(s_settings == 0)
     {
@@ -280,6 +624,27 @@ DocumentView::DocumentView(QWidget* parent) : QGraphicsView(parent),
         s_searchModel = SearchModel::instance();
     }
 
+#ifdef WITH_OPENGL
+
+    if(s_settings->documentView().useOpenGL() && QGLFormat::hasOpenGL())
+    {
+        // Pixmaps are kept as textures by the paint engine, so scrolling and rescaling obsolete tiles are composited by the GPU.
+
+        QGLWidget* glWidget = new QGLWidget(QGLFormat(QGL::SampleBuffers));
+
+        if(glWidget->isValid())
+        {
+            setViewport(glWidget);
+            setViewportUpdateMode(QGraphicsView::FullViewportUpdate);
+        }
+        else
+        {
+            delete glWidget;
+        }
+    }
+
+#endif // WITH_OPENGL
+
     setScene(new QGraphicsScene(this));
 
     setAcceptDrops(false);
@@ -289,9 +654,35 @@ DocumentView::DocumentView(QWidget* parent) : QGraphicsView(parent),
 
     m_thumbnailsScene = new QGraphicsScene(this);
 
-    m_outlineModel = new QStandardItemModel(this);
+    m_outlineModel = new OutlineModel(this);
     m_propertiesModel = new QStandardItemModel(this);
 
+    // asynchronous open
+
+    m_openWatcher = new QFutureWatcher< Model::Document* >(this);
+    connect(m_openWatcher, SIGNAL(finished()), SLOT(on_openJob_finished()));
+
+    m_modelsWatcher = new QFutureWatcher< Models >(this);
+    connect(m_modelsWatcher, SIGNAL(finished()), SLOT(on_modelsJob_finished()));
+
+    // incremental refresh
+
+    m_fingerprintsWatcher = new QFutureWatcher< QByteArray >(this);
+    connect(m_fingerprintsWatcher, SIGNAL(resultReadyAt(int)), SLOT(on_fingerprintsJob_resultReadyAt(int)));
+    connect(m_fingerprintsWatcher, SIGNAL(finished()), SLOT(on_fingerprintsJob_finished()));
+
+    // text index
+
+    m_textIndexWatcher = new QFutureWatcher< QString >(this);
+    connect(m_textIndexWatcher, SIGNAL(finished()), SLOT(on_textIndexJob_finished()));
+
+    // fonts
+
+    m_fontsModel = new QStandardItemModel(this);
+
+    m_fontsWatcher = new QFutureWatcher< QSharedPointer< QStandardItemModel > >(this);
+    connect(m_fontsWatcher, SIGNAL(resultReadyAt(int)), SLOT(on_fontsJob_resultReadyAt(int)));
+
     // highlight
 
     m_highlight = new QGraphicsRectItem();
@@ -304,22 +695,23 @@ DocumentView::DocumentView(QWidget* parent) : QGraphicsView(parent),
 
     m_searchTask = new SearchTask(this);
 
-    connect(m_searchTask, SIGNAL(finished()), SIGNAL(searchFinished()));
+    connect(m_searchTask, SIGNAL(finished()), SLOT(on_searchTask_finished()));
 
     connect(m_searchTask, SIGNAL(progressChanged(int)), SLOT(on_searchTask_progressChanged(int)));
     connect(m_searchTask, SIGNAL(resultsReady(int,QList<QRectF>)), SLOT(on_searchTask_resultsReady(int,QList<QRectF>)));
 
-    // auto-refresh
+    m_searchResultsTimer = new QTimer(this);
+    m_searchResultsTimer->setInterval(searchResultsInterval);
+    m_searchResultsTimer->setSingleShot(true);
 
-    m_autoRefreshWatcher = new QFileSystemWatcher(this);
+    connect(m_searchResultsTimer, SIGNAL(timeout()), SLOT(on_searchResults_timeout()));
 
-    m_autoRefreshTimer = new QTimer(this);
-    m_autoRefreshTimer->setInterval(s_settings->documentView().autoRefreshTimeout());
-    m_autoRefreshTimer->setSingleShot(true);
+    // auto-refresh
 
-    connect(m_autoRefreshWatcher, SIGNAL(fileChanged(QString)), m_autoRefreshTimer, SLOT(start()));
+    m_autoRefreshDetector = new FileChangeDetector(this);
+    m_autoRefreshDetector->setInterval(s_settings->documentView().autoRefreshTimeout());
 
-    connect(m_autoRefreshTimer, SIGNAL(timeout()), this, SLOT(on_autoRefresh_timeout()));
+    connect(m_autoRefreshDetector, SIGNAL(fileChanged()), SLOT(on_autoRefresh_fileChanged()));
 
     // prefetch
 
@@ -336,6 +728,15 @@ DocumentView::DocumentView(QWidget* parent) : QGraphicsView(parent),
 
     connect(m_prefetchTimer, SIGNAL(timeout()), SLOT(on_prefetch_timeout()));
 
+    // zoom gesture
+
+    m_zoomGestureTimer = new QTimer(this);
+    m_zoomGestureTimer->setSingleShot(true);
+
+    connect(m_zoomGestureTimer, SIGNAL(timeout()), SLOT(on_zoomGesture_timeout()));
+
+    setTransformationAnchor(QGraphicsView::AnchorUnderMouse);
+
     // settings
 
     m_continuousMode = s_settings->documentView().continuousMode();
@@ -353,16 +754,25 @@ DocumentView::DocumentView(QWidget* parent) : QGraphicsView(parent),
 
 DocumentView::~DocumentView()
 {
+    cancelOpen();
+    waitForModels();
+    cancelFingerprints();
+    cancelTextIndex();
+    cancelFonts();
+
     m_searchTask->cancel();
     m_searchTask->wait();
 
     s_searchModel->clearResults(this);
 
-    qDeleteAll(m_pageItems);
+    releasePageItems();
     qDeleteAll(m_thumbnailItems);
 
-    qDeleteAll(m_pages);
-    delete m_document;
+    DocumentRegistry::instance()->release(m_document, m_pages);
+
+    RenderStatistics::removeGroup(this);
+    RenderStatistics::removeGroup(scene());
+    RenderStatistics::removeGroup(m_thumbnailsScene);
 }
 
 void DocumentView::setFirstPage(int firstPage)
@@ -373,7 +783,10 @@ void DocumentView::setFirstPage(int firstPage)
 
         for(int index = 0; index < m_thumbnailItems.count(); ++index)
         {
-            m_thumbnailItems.at(index)->setText(pageLabelFromNumber(index + 1));
+            if(m_thumbnailItems.at(index) != 0)
+            {
+                m_thumbnailItems.at(index)->setText(pageLabelFromNumber(index + 1));
+            }
         }
 
         prepareThumbnailsScene();
@@ -523,12 +936,12 @@ QStringList DocumentView::openFilter()
 
 QStringList DocumentView::saveFilter() const
 {
-    return m_document->saveFilter();
+    return m_document != 0 ? m_document->saveFilter() : QStringList();
 }
 
 bool DocumentView::canSave() const
 {
-    return m_document->canSave();
+    return m_document != 0 && m_document->canSave();
 }
 
 void DocumentView::setContinuousMode(bool continuousMode)
@@ -658,12 +1071,18 @@ void DocumentView::setInvertColors(bool invertColors)
 
         foreach(PageItem* page, m_pageItems)
         {
-            page->setInvertColors(m_invertColors);
+            if(page != 0)
+            {
+                page->setInvertColors(m_invertColors);
+            }
         }
 
         foreach(ThumbnailItem* page, m_thumbnailItems)
         {
-            page->setInvertColors(m_invertColors);
+            if(page != 0)
+            {
+                page->setInvertColors(m_invertColors);
+            }
         }
 
         prepareBackground();
@@ -682,12 +1101,18 @@ void DocumentView::setConvertToGrayscale(bool convertToGrayscale)
 
         foreach(PageItem* page, m_pageItems)
         {
-            page->setConvertToGrayscale(m_convertToGrayscale);
+            if(page != 0)
+            {
+                page->setConvertToGrayscale(m_convertToGrayscale);
+            }
         }
 
         foreach(ThumbnailItem* page, m_thumbnailItems)
         {
-            page->setConvertToGrayscale(m_convertToGrayscale);
+            if(page != 0)
+            {
+                page->setConvertToGrayscale(m_convertToGrayscale);
+            }
         }
 
         emit convertToGrayscaleChanged(m_convertToGrayscale);
@@ -708,16 +1133,30 @@ void DocumentView::setHighlightAll(bool highlightAll)
             {
                 const QList< QRectF >& results = s_searchModel->resultsOnPage(this, index + 1);
 
-                m_pageItems.at(index)->setHighlights(results);
-                m_thumbnailItems.at(index)->setHighlights(results);
+                if(m_pageItems.at(index) != 0)
+                {
+                    m_pageItems.at(index)->setHighlights(results);
+                }
+
+                if(m_thumbnailItems.at(index) != 0)
+                {
+                    m_thumbnailItems.at(index)->setHighlights(results);
+                }
             }
         }
         else
         {
             for(int index = 0; index < m_pages.count(); ++index)
             {
-                m_pageItems.at(index)->setHighlights(QList< QRectF >());
-                m_thumbnailItems.at(index)->setHighlights(QList< QRectF >());
+                if(m_pageItems.at(index) != 0)
+                {
+                    m_pageItems.at(index)->setHighlights(QList< QRectF >());
+                }
+
+                if(m_thumbnailItems.at(index) != 0)
+                {
+                    m_thumbnailItems.at(index)->setHighlights(QList< QRectF >());
+                }
             }
         }
 
@@ -735,7 +1174,10 @@ void DocumentView::setRubberBandMode(RubberBandMode rubberBandMode)
 
         foreach(PageItem* page, m_pageItems)
         {
-            page->setRubberBandMode(m_rubberBandMode);
+            if(page != 0)
+            {
+                page->setRubberBandMode(m_rubberBandMode);
+            }
         }
 
         emit rubberBandModeChanged(m_rubberBandMode);
@@ -762,40 +1204,54 @@ void DocumentView::setThumbnailsOrientation(Qt::Orientation thumbnailsOrientatio
     }
 }
 
-QStandardItemModel* DocumentView::fontsModel() const
+QStandardItemModel* DocumentView::outlineModel() const
 {
-    QStandardItemModel* fontsModel = new QStandardItemModel();
+    return m_outlineModel;
+}
 
-    m_document->loadFonts(fontsModel);
+QStandardItemModel* DocumentView::fontsModel()
+{
+    if(!m_fontsPrepared)
+    {
+        prepareFonts();
+    }
 
-    return fontsModel;
+    return m_fontsModel;
 }
 
 QString DocumentView::searchText() const
 {
-    return m_searchTask->text();
+    return m_searchText;
 }
 
 bool DocumentView::searchMatchCase() const
 {
-    return m_searchTask->matchCase();
+    return m_searchMatchCase;
+}
+
+bool DocumentView::searchWholeWords() const
+{
+    return m_searchWholeWords;
+}
+
+bool DocumentView::searchRegularExpression() const
+{
+    return m_searchRegularExpression;
+}
+
+QRegExp DocumentView::searchPattern() const
+{
+    return TextLayout::pattern(m_searchText, m_searchMatchCase, m_searchWholeWords, m_searchRegularExpression);
 }
 
 QString DocumentView::surroundingText(int page, const QRectF& rect) const
 {
-    if(page < 1 || page > m_pages.size() || rect.isEmpty())
+    if(page < 1 || page > m_pages.size())
     {
         return QString();
     }
 
-    // Fetch at most half of a line as centered on the given rectangle as possible.
-    const qreal pageWidth = m_pages.at(page - 1)->size().width();
-    const qreal width = qMax(rect.width(), pageWidth / qreal(2));
-    const qreal x = qBound(qreal(0), rect.x() + rect.width() / qreal(2) - width / qreal(2), pageWidth - width);
-
-    const QRectF surroundingRect(x, rect.top(), width, rect.height());
-
-    return m_pages.at(page - 1)->text(surroundingRect).simplified();
+    return static_cast< const LazyPage* >(m_pages.at(page - 1))->surroundingText(rect);
 }
 
 void DocumentView::show()
@@ -807,1397 +1263,3116 @@ void DocumentView::show()
 
 bool DocumentView::open(const QString& filePath)
 {
-    Model::Document* document = PluginHandler::instance()->loadDocument(filePath);
+    const TraceSpan span("document", "open");
 
-    if(document != 0)
+    if(m_isSaving)
     {
-        QVector< Model::Page* > pages;
-
-        if(!checkDocument(filePath, document, pages))
-        {
-            delete document;
-            qDeleteAll(pages);
+        return false;
+    }
 
-            return false;
-        }
+    cancelOpen();
 
-        m_fileInfo.setFile(filePath);
-        m_wasModified = false;
+    Model::Document* document = DocumentRegistry::instance()->contains(filePath) ? 0 : PluginHandler::instance()->loadDocument(filePath);
 
-        m_currentPage = 1;
+    return openDocument(filePath, document, false);
+}
 
-        m_past.clear();
-        m_future.clear();
+bool DocumentView::openInBackground(const QString& filePath)
+{
+    if(m_isSaving)
+    {
+        return false;
+    }
 
-        prepareDocument(document, pages);
+    cancelOpen();
 
-        loadDocumentDefaults();
+    const bool shared = DocumentRegistry::instance()->contains(filePath);
+    const Plugin* plugin = shared ? 0 : PluginHandler::instance()->pluginForFile(filePath);
 
-        adjustScrollBarPolicy();
+    if(plugin == 0 && !shared)
+    {
+        return false;
+    }
 
-        prepareScene();
-        prepareView();
+    m_openCancellation = QSharedPointer< QAtomicInt >(new QAtomicInt(0));
 
-        prepareThumbnailsScene();
+    m_openWatcher->setFuture(QtConcurrent::run(loadDocument, plugin, filePath, m_openCancellation));
 
-        emit documentChanged();
+    if(m_pages.isEmpty())
+    {
+        m_fileInfo.setFile(filePath);
 
-        emit numberOfPagesChanged(m_pages.count());
-        emit currentPageChanged(m_currentPage);
+        m_openPlaceholder = new QGraphicsSimpleTextItem(tr("Loading '%1'...").arg(m_fileInfo.fileName()));
+        m_openPlaceholder->setBrush(palette().text());
 
-        emit canJumpChanged(false, false);
+        scene()->addItem(m_openPlaceholder);
+        scene()->setSceneRect(m_openPlaceholder->boundingRect());
+    }
 
-        emit continuousModeChanged(m_continuousMode);
-        emit layoutModeChanged(m_layout->layoutMode());
-        emit rightToLeftModeChanged(m_rightToLeftMode);
-    }
-
-    return document != 0;
+    return true;
 }
 
-bool DocumentView::refresh()
+void DocumentView::deferOpen(const QString& filePath, int currentPage)
 {
-    Model::Document* document = PluginHandler::instance()->loadDocument(m_fileInfo.filePath());
-
-    if(document != 0)
-    {
-        QVector< Model::Page* > pages;
-
-        if(!checkDocument(m_fileInfo.filePath(), document, pages))
-        {
-            delete document;
-            qDeleteAll(pages);
-
-            return false;
-        }
+    m_fileInfo.setFile(filePath);
 
-        MainWindow::instance()->m_outlineView->saveExpansionState(m_outlineModel->invisibleRootItem()->index());
+    m_openDeferred = true;
+    m_deferredPage = currentPage;
+}
 
-        qreal left = 0.0, top = 0.0;
-        saveLeftAndTop(left, top);
+bool DocumentView::hibernate()
+{
+    if(m_document == 0 || m_openDeferred || isOpening() || m_wasModified || m_isSaving)
+    {
+        return false;
+    }
 
-        m_wasModified = false;
+    const int currentPage = m_currentPage;
 
-        m_currentPage = qMin(m_currentPage, document->numberOfPages());
+    m_prefetchTimer->blockSignals(true);
+    m_prefetchTimer->stop();
 
-        prepareDocument(document, pages);
+    cancelSearch();
+    clearResults();
 
-        prepareScene();
-        prepareView(left, top);
+    waitForModels();
+    cancelFingerprints();
+    cancelTextIndex();
+    cancelFonts();
 
-        prepareThumbnailsScene();
+#ifdef WITH_SYNCTEX
 
-        emit documentChanged();
+    releaseSyncTeX();
 
-        emit numberOfPagesChanged(m_pages.count());
-        emit currentPageChanged(m_currentPage);
-        MainWindow::instance()->m_outlineView->loadExpansionState(m_outlineModel->invisibleRootItem()->index());
-        MainWindow::instance()->m_outlineView->restoreExpansion(m_outlineModel->invisibleRootItem()->index());
-    }
+#endif // WITH_SYNCTEX
 
-    return document != 0;
-}
+    releasePageItems();
+    qDeleteAll(m_thumbnailItems);
 
-bool DocumentView::save(const QString& filePath, bool withChanges)
-{
-    QTemporaryFile temporaryFile;
-    QFile file(filePath);
+    DocumentRegistry::instance()->release(m_document, m_pages);
 
-    if(temporaryFile.open())
-    {
-        temporaryFile.close();
+    m_document = 0;
+    m_pages.clear();
 
-        if(m_document->save(temporaryFile.fileName(), withChanges))
-        {
-            if(temporaryFile.open())
-            {
-                if(file.open(QIODevice::WriteOnly | QIODevice::Truncate))
-                {
-                    const qint64 maxSize = 4096;
-                    qint64 size = -1;
+    m_autoRefreshDetector->unwatch();
 
-                    char* data = new char[maxSize];
+    m_outlineModel->clear();
+    m_propertiesModel->clear();
 
-                    while(!temporaryFile.atEnd())
-                    {
-                        size = temporaryFile.read(data, maxSize);
+    m_visiblePages = qMakePair(0, -1);
 
-                        if(size == -1 || file.write(data, size) == -1)
-                        {
-                            delete[] data;
-                            return false;
-                        }
-                    }
+    m_past.clear();
+    m_future.clear();
 
-                    if(withChanges)
-                    {
-                        m_wasModified = false;
-                    }
+    preparePages();
+    prepareThumbnails();
 
-                    delete[] data;
-                    return true;
-                }
-            }
-        }
-    }
+    prepareScene();
+    prepareView();
 
-    return false;
-}
+    prepareThumbnailsScene();
 
-bool DocumentView::print(QPrinter* printer, const PrintOptions& printOptions)
-{
-    const int fromPage = printer->fromPage() != 0 ? printer->fromPage() : 1;
-    const int toPage = printer->toPage() != 0 ? printer->toPage() : m_pages.count();
+    deferOpen(m_fileInfo.filePath(), currentPage);
 
-#ifdef WITH_CUPS
+    emit documentChanged();
 
-    if(m_document->canBePrintedUsingCUPS())
-    {
-        return printUsingCUPS(printer, printOptions, fromPage, toPage);
-    }
+    emit numberOfPagesChanged(0);
 
-#endif // WITH_CUPS
+    emit canJumpChanged(false, false);
 
-    return printUsingQt(printer, printOptions, fromPage, toPage);
+    return true;
 }
 
-void DocumentView::previousPage()
+DocumentView::MemoryUsage& DocumentView::MemoryUsage::operator+=(const MemoryUsage& other)
 {
-    jumpToPage(m_layout->previousPage(m_currentPage));
-}
+    tileCache += other.tileCache;
+    document += other.document;
+    searchResults += other.searchResults;
+    textLayouts += other.textLayouts;
+    surroundingTexts += other.surroundingTexts;
 
-void DocumentView::nextPage()
-{
-    jumpToPage(m_layout->nextPage(m_currentPage, m_pages.count()));
-}
+    pageItems += other.pageItems;
+    thumbnailItems += other.thumbnailItems;
+    numberOfSearchResults += other.numberOfSearchResults;
 
-void DocumentView::firstPage()
-{
-    jumpToPage(1);
+    return *this;
 }
 
-void DocumentView::lastPage()
+DocumentView::MemoryUsage DocumentView::memoryUsage() const
 {
-    jumpToPage(m_pages.count());
-}
+    MemoryUsage usage;
 
-void DocumentView::jumpToPage(int page, bool trackChange, qreal changeLeft, qreal changeTop)
-{
-    if(page >= 1 && page <= m_pages.count())
+    for(int index = 0; index < m_pageItems.count(); ++index)
     {
-        qreal left = 0.0, top = 0.0;
-        saveLeftAndTop(left, top);
+        if(m_pageItems.at(index) != 0)
+        {
+            usage.tileCache += TileItem::cacheCost(m_pageItems.at(index));
 
-        if(m_currentPage != m_layout->currentPage(page) || qAbs(left - changeLeft) > 0.01 || qAbs(top - changeTop) > 0.01)
+            ++usage.pageItems;
+        }
+        else if(m_retainedPages.contains(index))
         {
-            if(trackChange)
-            {
-                m_past.append(Position(m_currentPage, left, top));
-                m_future.clear();
+            usage.tileCache += PageItem::cachedPixmapsCost(m_documentKey, index);
+        }
+    }
 
-                emit canJumpChanged(true, false);
-            }
+    foreach(const ThumbnailItem* thumbnailItem, m_thumbnailItems)
+    {
+        if(thumbnailItem != 0)
+        {
+            usage.tileCache += TileItem::cacheCost(thumbnailItem);
 
-            m_currentPage = m_layout->currentPage(page);
+            ++usage.thumbnailItems;
+        }
+    }
 
-            prepareView(changeLeft, changeTop, page);
+    usage.document = m_document != 0 ? m_document->memoryEstimate() : 0;
 
-            emit currentPageChanged(m_currentPage, trackChange);
-        }
+    SearchModel* searchModel = SearchModel::instance();
+    DocumentView* view = const_cast< DocumentView* >(this);
+
+    usage.numberOfSearchResults = searchModel->numberOfResults(view);
+    usage.searchResults = searchModel->resultsCost(view);
+    usage.surroundingTexts = searchModel->surroundingTextCost(view);
+
+    foreach(const Model::Page* page, m_pages)
+    {
+        usage.textLayouts += static_cast< const LazyPage* >(page)->textLayoutCost();
     }
-}
 
-bool DocumentView::canJumpBackward() const
-{
-    return !m_past.isEmpty();
+    return usage;
 }
 
-void DocumentView::jumpBackward()
+void DocumentView::enforceMemoryLimit()
 {
-    if(!m_past.isEmpty())
+    const qint64 memoryLimit = static_cast< qint64 >(s_settings->documentView().memoryLimit()) * 1024 * 1024;
+
+    if(memoryLimit <= 0 || memoryUsage().evictable() <= memoryLimit)
     {
-        qreal left = 0.0, top = 0.0;
-        saveLeftAndTop(left, top);
+        return;
+    }
 
-        m_future.prepend(Position(m_currentPage, left, top));
+    // Tiles of pages near the viewport are kept since they would be rendered again right away.
 
-        const Position pos = m_past.takeLast();
-        jumpToPage(pos.page, false, pos.left, pos.top);
+    for(int index = 0; index < m_pageItems.count(); ++index)
+    {
+        if(m_materializedPages.contains(index))
+        {
+            continue;
+        }
 
-        emit canJumpChanged(!m_past.isEmpty(), !m_future.isEmpty());
+        if(m_pageItems.at(index) != 0)
+        {
+            TileItem::dropCachedPixmaps(m_pageItems.at(index));
+        }
+        else if(m_retainedPages.contains(index))
+        {
+            PageItem::dropCachedPixmaps(m_documentKey, index);
+        }
     }
-}
-
-bool DocumentView::canJumpForward() const
-{
-    return !m_future.isEmpty();
-}
 
-void DocumentView::jumpForward()
-{
-    if(!m_future.isEmpty())
+    foreach(ThumbnailItem* thumbnailItem, m_thumbnailItems)
     {
-        qreal left = 0.0, top = 0.0;
-        saveLeftAndTop(left, top);
+        if(thumbnailItem != 0 && !thumbnailItem->sceneBoundingRect().intersects(m_thumbnailsVisibleRect))
+        {
+            TileItem::dropCachedPixmaps(thumbnailItem);
+        }
+    }
 
-        m_past.append(Position(m_currentPage, left, top));
+    if(memoryUsage().evictable() <= memoryLimit)
+    {
+        return;
+    }
 
-        const Position pos = m_future.takeFirst();
-        jumpToPage(pos.page, false, pos.left, pos.top);
+    foreach(const Model::Page* page, m_pages)
+    {
+        static_cast< const LazyPage* >(page)->releaseTextLayout();
+    }
 
-        emit canJumpChanged(!m_past.isEmpty(), !m_future.isEmpty());
+    if(memoryUsage().evictable() <= memoryLimit)
+    {
+        return;
     }
-}
 
-void DocumentView::temporaryHighlight(int page, const QRectF& highlight)
-{
-    if(page >= 1 && page <= m_pages.count() && !highlight.isNull())
+    SearchModel::instance()->releaseSurroundingText(this);
+
+    if(memoryUsage().evictable() <= memoryLimit)
     {
-        prepareHighlight(page - 1, highlight);
+        return;
+    }
 
-        QTimer::singleShot(s_settings->documentView().highlightDuration(), this, SLOT(on_temporaryHighlight_timeout()));
+    // Thumbnails are cheap to render again and are usually kept on disk, so even the visible ones are dropped last.
+
+    foreach(ThumbnailItem* thumbnailItem, m_thumbnailItems)
+    {
+        if(thumbnailItem != 0)
+        {
+            TileItem::dropCachedPixmaps(thumbnailItem);
+        }
     }
 }
 
-void DocumentView::startSearch(const QString& text, bool matchCase)
+void DocumentView::updateMemoryProperties(const MemoryUsage& totalUsage)
 {
-    cancelSearch();
-    clearResults();
+    QList< int > rows;
 
-    m_searchTask->start(m_pages, text, matchCase, m_currentPage);
-}
+    for(int row = 0; row < m_propertiesModel->rowCount(); ++row)
+    {
+        const QStandardItem* item = m_propertiesModel->item(row, 0);
 
-void DocumentView::cancelSearch()
-{
-    m_searchTask->cancel();
-    m_searchTask->wait();
-}
+        if(item != 0 && item->data(memoryPropertyRole).toBool())
+        {
+            rows.append(row);
+        }
+    }
 
-void DocumentView::clearResults()
-{
-    s_searchModel->clearResults(this);
+    QList< QPair< QString, QString > > properties;
 
-    m_currentResult = QModelIndex();
+    if(m_document != 0)
+    {
+        const MemoryUsage usage = memoryUsage();
+
+        properties.append(qMakePair(tr("Tile cache"), formatMemory(usage.tileCache)));
+        properties.append(qMakePair(tr("Page and thumbnail items"), tr("%1 and %2").arg(usage.pageItems).arg(usage.thumbnailItems)));
+        properties.append(qMakePair(tr("Document (estimated)"), formatMemory(usage.document)));
+        properties.append(qMakePair(tr("Search results"), tr("%1 using %2").arg(usage.numberOfSearchResults).arg(formatMemory(usage.searchResults))));
+        properties.append(qMakePair(tr("Text layouts"), formatMemory(usage.textLayouts)));
+        properties.append(qMakePair(tr("Surrounding texts"), formatMemory(usage.surroundingTexts)));
+        properties.append(qMakePair(tr("Memory of this tab"), formatMemory(usage.total())));
+        properties.append(qMakePair(tr("Memory of all tabs"), formatMemory(totalUsage.total())));
+    }
 
-    m_highlight->setVisible(false);
+    // The values are updated in place so that the selection and the scroll position of the properties are kept.
 
-    foreach(PageItem* page, m_pageItems)
+    if(rows.count() == properties.count())
     {
-        page->setHighlights(QList< QRectF >());
+        for(int index = 0; index < rows.count(); ++index)
+        {
+            QStandardItem* valueItem = m_propertiesModel->item(rows.at(index), 1);
+
+            if(valueItem != 0 && valueItem->text() != properties.at(index).second)
+            {
+                valueItem->setText(properties.at(index).second);
+            }
+        }
+
+        return;
     }
 
-    foreach(ThumbnailItem* page, m_thumbnailItems)
+    for(int index = rows.count() - 1; index >= 0; --index)
     {
-        page->setHighlights(QList< QRectF >());
+        m_propertiesModel->removeRow(rows.at(index));
     }
 
-    if(s_settings->documentView().limitThumbnailsToResults())
+    if(properties.isEmpty())
     {
-        prepareThumbnailsScene();
+        return;
     }
-}
 
-void DocumentView::findPrevious()
-{
-    checkResult();
+    m_propertiesModel->setColumnCount(2);
 
-    m_currentResult = s_searchModel->findResult(this, m_currentResult, m_currentPage, SearchModel::FindPrevious);
+    for(int index = 0; index < properties.count(); ++index)
+    {
+        QStandardItem* keyItem = new QStandardItem(properties.at(index).first);
+        keyItem->setData(true, memoryPropertyRole);
 
-    applyResult();
+        m_propertiesModel->appendRow(QList< QStandardItem* >() << keyItem << new QStandardItem(properties.at(index).second));
+    }
 }
 
-void DocumentView::findNext()
+bool DocumentView::openDeferred()
 {
-    checkResult();
-
-    m_currentResult = s_searchModel->findResult(this, m_currentResult, m_currentPage, SearchModel::FindNext);
-
-    applyResult();
+    return m_openDeferred && openInBackground(m_fileInfo.filePath());
 }
 
-void DocumentView::findResult(const QModelIndex& index)
+void DocumentView::cancelOpen()
 {
-    const int page = pageOfResult(index);
-    const QRectF rect = rectOfResult(index);
-
-    if(page >= 1 && page <= m_pages.count() && !rect.isEmpty())
+    if(!m_openCancellation.isNull())
     {
-        m_currentResult = index;
+        // The job deletes the document itself if it is canceled before it finishes.
 
-        applyResult();
+        m_openCancellation->fetchAndStoreOrdered(1);
+        m_openCancellation.clear();
+
+        m_openWatcher->setFuture(QFuture< Model::Document* >());
     }
+
+    delete m_openPlaceholder;
+    m_openPlaceholder = 0;
 }
 
-void DocumentView::zoomIn()
+bool DocumentView::openDocument(const QString& filePath, Model::Document* document, bool loadModelsInBackground)
 {
-    if(scaleMode() != ScaleFactorMode)
-    {
-        setScaleFactor(qMin(m_pageItems.at(m_currentPage - 1)->scaleFactor() * s_settings->documentView().zoomFactor(),
-                            s_settings->documentView().maximumScaleFactor()));
+    const TraceSpan span("document", "openDocument");
 
-        setScaleMode(ScaleFactorMode);
-    }
-    else
+    QVector< Model::Page* > pages;
+
+    if(!acquireDocument(filePath, document, pages))
     {
-        setScaleFactor(qMin(m_scaleFactor * s_settings->documentView().zoomFactor(),
-                            s_settings->documentView().maximumScaleFactor()));
+        return false;
     }
-}
 
-void DocumentView::zoomOut()
-{
-    if(scaleMode() != ScaleFactorMode)
-    {
-        setScaleFactor(qMax(m_pageItems.at(m_currentPage - 1)->scaleFactor() / s_settings->documentView().zoomFactor(),
-                            s_settings->documentView().minimumScaleFactor()));
+    m_fileInfo.setFile(filePath);
+    m_wasModified = false;
 
-        setScaleMode(ScaleFactorMode);
-    }
-    else
-    {
-        setScaleFactor(qMax(m_scaleFactor / s_settings->documentView().zoomFactor(),
-                            s_settings->documentView().minimumScaleFactor()));
-    }
-}
+    m_openDeferred = false;
+    m_deferredPage = -1;
 
-void DocumentView::originalSize()
-{
-    setScaleFactor(1.0);
-    setScaleMode(ScaleFactorMode);
-}
+    m_currentPage = 1;
 
-void DocumentView::rotateLeft()
-{
-    switch(m_rotation)
-    {
-    default:
-    case RotateBy0:
-        setRotation(RotateBy270);
-        break;
-    case RotateBy90:
-        setRotation(RotateBy0);
-        break;
-    case RotateBy180:
-        setRotation(RotateBy90);
-        break;
-    case RotateBy270:
-        setRotation(RotateBy180);
-        break;
-    }
-}
+    m_past.clear();
+    m_future.clear();
 
-void DocumentView::rotateRight()
-{
-    switch(m_rotation)
-    {
-    default:
-    case RotateBy0:
-        setRotation(RotateBy90);
-        break;
-    case RotateBy90:
-        setRotation(RotateBy180);
-        break;
-    case RotateBy180:
-        setRotation(RotateBy270);
-        break;
-    case RotateBy270:
-        setRotation(RotateBy0);
-        break;
-    }
-}
+    prepareDocument(document, pages, loadModelsInBackground);
 
-void DocumentView::startPresentation()
-{
-    const int screen = s_settings->presentationView().screen();
+    loadDocumentDefaults();
 
-    PresentationView* presentationView = new PresentationView(m_pages);
+    adjustScrollBarPolicy();
 
-    presentationView->setGeometry(QApplication::desktop()->screenGeometry(screen));
+    prepareScene();
+    prepareView();
 
-    presentationView->show();
-    presentationView->setAttribute(Qt::WA_DeleteOnClose);
+    prepareThumbnailsScene();
 
-    connect(this, SIGNAL(destroyed()), presentationView, SLOT(close()));
-    connect(this, SIGNAL(documentChanged()), presentationView, SLOT(close()));
+    emit documentChanged();
 
-    presentationView->setRotation(rotation());
-    presentationView->setInvertColors(invertColors());
+    emit numberOfPagesChanged(m_pages.count());
+    emit currentPageChanged(m_currentPage);
 
-    presentationView->jumpToPage(currentPage(), false);
+    emit canJumpChanged(false, false);
 
-    if(s_settings->presentationView().synchronize())
-    {
-        connect(this, SIGNAL(currentPageChanged(int,bool)), presentationView, SLOT(jumpToPage(int,bool)));
-        connect(presentationView, SIGNAL(currentPageChanged(int,bool)), this, SLOT(jumpToPage(int,bool)));
-    }
+    emit continuousModeChanged(m_continuousMode);
+    emit layoutModeChanged(m_layout->layoutMode());
+    emit rightToLeftModeChanged(m_rightToLeftMode);
+
+    return true;
 }
 
-void DocumentView::on_verticalScrollBar_valueChanged()
+bool DocumentView::refresh()
 {
-    if(!m_continuousMode)
+    if(m_isSaving)
     {
-        return;
+        return false;
     }
 
-    int currentPage = -1;
-    const QRectF visibleRect = mapToScene(viewport()->rect()).boundingRect();
+    cancelOpen();
 
-    foreach(PageItem* page, m_pageItems)
-    {
-        const int pageNumber = page->index() + 1;
-        const QRectF pageRect = page->boundingRect().translated(page->pos());
+    m_fileInfo.refresh();
 
-        if(!pageRect.intersects(visibleRect))
-        {
-            page->cancelRender();
-        }
-        else if(currentPage == -1 &&
-                 m_layout->currentPage(pageNumber) == pageNumber &&
-                 m_layout->isCurrentPage(visibleRect, pageRect))
-        {
-            currentPage = pageNumber;
-        }
-    }
+    // The current document is discarded even if the file did not change, so it must not be handed out again.
 
-    if(currentPage != -1 && m_currentPage != currentPage)
-    {
-        m_currentPage = currentPage;
+    DocumentRegistry::instance()->detach(m_document);
 
-        emit currentPageChanged(m_currentPage);
+    Model::Document* document = DocumentRegistry::instance()->contains(m_fileInfo.filePath()) ? 0 : PluginHandler::instance()->loadDocument(m_fileInfo.filePath());
 
-        if(s_settings->documentView().highlightCurrentThumbnail())
-        {
-            for(int index = 0; index < m_thumbnailItems.count(); ++index)
-            {
-                m_thumbnailItems.at(index)->setHighlighted(index == m_currentPage - 1);
-            }
-        }
-    }
-}
+    QVector< Model::Page* > pages;
 
-void DocumentView::on_autoRefresh_timeout()
-{
-    if(m_fileInfo.exists())
-    {
-        refresh();
-    }
-    else
+    if(acquireDocument(m_fileInfo.filePath(), document, pages))
     {
-        m_wasModified = true;
+        MainWindow::instance()->m_outlineView->saveExpansionState(m_outlineModel->invisibleRootItem()->index());
 
-        emit documentModified();
-    }
-}
+        qreal left = 0.0, top = 0.0;
+        saveLeftAndTop(left, top);
 
-void DocumentView::on_prefetch_timeout()
-{
-    const QPair< int, int > prefetchRange = m_layout->prefetchRange(m_currentPage, m_pages.count());
+        m_wasModified = false;
 
-    const int maxCost = prefetchRange.second - prefetchRange.first + 1;
-    int cost = 0;
+        m_currentPage = qMin(m_currentPage, document->numberOfPages());
 
-    for(int index = m_currentPage - 1; index <= prefetchRange.second - 1; ++index)
-    {
-        cost += m_pageItems.at(index)->startRender(true);
+        // Without the fingerprints of the current pages, everything has to be assumed to have changed.
 
-        if(cost >= maxCost)
+        if(m_fingerprints.count() == m_pages.count() && pages.count() == m_pages.count())
         {
-            return;
+            replaceDocument(document, pages);
         }
-    }
-
-    for(int index = m_currentPage - 1; index >= prefetchRange.first - 1; --index)
-    {
-        cost += m_pageItems.at(index)->startRender(true);
-
-        if(cost >= maxCost)
+        else
         {
-            return;
+            prepareDocument(document, pages);
         }
-    }
-}
 
-void DocumentView::on_temporaryHighlight_timeout()
-{
-    m_highlight->setVisible(false);
-}
+        prepareScene();
+        prepareView(left, top);
 
-void DocumentView::on_searchTask_progressChanged(int progress)
-{
-    s_searchModel->updateProgress(this);
+        prepareThumbnailsScene();
 
-    emit searchProgressChanged(progress);
+        emit documentChanged();
+
+        emit numberOfPagesChanged(m_pages.count());
+        emit currentPageChanged(m_currentPage);
+        MainWindow::instance()->m_outlineView->loadExpansionState(m_outlineModel->invisibleRootItem()->index());
+        MainWindow::instance()->m_outlineView->restoreExpansion(m_outlineModel->invisibleRootItem()->index());
+    }
+
+    return document != 0;
 }
 
-void DocumentView::on_searchTask_resultsReady(int index, const QList< QRectF >& results)
+bool DocumentView::acquireDocument(const QString& filePath, Model::Document*& document, QVector< Model::Page* >& pages)
 {
-    if(m_searchTask->wasCanceled())
+    Model::Document* sharedDocument = 0;
+
+    if(DocumentRegistry::instance()->acquire(filePath, sharedDocument, pages))
     {
-        return;
-    }
+        // Another view might have finished loading the same file while this one was still loading it.
 
-    s_searchModel->insertResults(this, index + 1, results);
+        delete document;
+        document = sharedDocument;
 
-    if(m_highlightAll)
-    {
-        m_pageItems.at(index)->setHighlights(results);
-        m_thumbnailItems.at(index)->setHighlights(results);
+        connectPages(pages);
+
+        return true;
     }
 
-    if(s_settings->documentView().limitThumbnailsToResults())
+    if(document == 0)
     {
-        prepareThumbnailsScene();
+        return false;
     }
 
-    if(!results.isEmpty() && !m_currentResult.isValid())
+    if(!checkDocument(filePath, document, pages))
     {
-        setFocus();
+        delete document;
+        document = 0;
 
-        findNext();
+        qDeleteAll(pages);
+        pages.clear();
+
+        return false;
     }
-}
 
-void DocumentView::on_pages_cropRectChanged()
-{
-    qreal left = 0.0, top = 0.0;
-    saveLeftAndTop(left, top);
+    DocumentRegistry::instance()->insert(filePath, document, pages);
 
-    prepareScene();
-    prepareView(left, top);
-}
+    connectPages(pages);
 
-void DocumentView::on_thumbnails_cropRectChanged()
-{
-    prepareThumbnailsScene();
+    return true;
 }
 
-void DocumentView::on_pages_linkClicked(bool newTab, int page, qreal left, qreal top)
+void DocumentView::connectPages(const QVector< Model::Page* >& pages)
 {
-    page = qMax(page, 1);
-    page = qMin(page, m_pages.count());
-
-    left = left >= 0.0 ? left : 0.0;
-    left = left <= 1.0 ? left : 1.0;
-
-    top = top >= 0.0 ? top : 0.0;
-    top = top <= 1.0 ? top : 1.0;
+    // Pages shared with other views report corrected sizes to each of them.
 
-    if(newTab)
-    {
-        emit linkClicked(page);
-    }
-    else
+    foreach(Model::Page* page, pages)
     {
-        jumpToPage(page, true, left, top);
+        connect(static_cast< LazyPage* >(page), SIGNAL(sizeCorrected(int)), SLOT(on_pages_sizeCorrected(int)), Qt::UniqueConnection);
     }
 }
 
-void DocumentView::on_pages_linkClicked(bool newTab, const QString& fileName, int page)
-{
-    const QString filePath = QFileInfo(fileName).isAbsolute() ? fileName : m_fileInfo.dir().filePath(fileName);
-
-    emit linkClicked(newTab, filePath, page);
-}
-
-void DocumentView::on_pages_linkClicked(const QString& url)
+bool DocumentView::save(const QString& filePath, bool withChanges)
 {
-    if(s_settings->documentView().openUrl())
+    if(m_document == 0)
     {
-        QUrl resolvedUrl(url);
+        return false;
+    }
 
-        if(resolvedUrl.isRelative() && QFileInfo(url).isRelative())
-        {
-            resolvedUrl.setPath(m_fileInfo.dir().filePath(url));
-        }
+    QTemporaryFile temporaryFile;
 
-        QDesktopServices::openUrl(resolvedUrl);
-    }
-    else
+    if(!temporaryFile.open())
     {
-        QMessageBox::information(this, tr("Information"), tr("Opening URL is disabled in the settings."));
+        return false;
     }
-}
 
-void DocumentView::on_pages_rubberBandFinished()
-{
-    setRubberBandMode(ModifiersMode);
-}
+    temporaryFile.close();
 
-void DocumentView::on_pages_editSourceRequested(int page, const QPointF& pos)
-{
-#ifdef WITH_SYNCTEX
+    QScopedPointer< QProgressDialog > progressDialog(new QProgressDialog(this));
+    progressDialog->setLabelText(tr("Saving '%1'...").arg(m_fileInfo.completeBaseName()));
+    progressDialog->setCancelButton(0);
+    progressDialog->setRange(0, 0);
+    progressDialog->setMinimumDuration(0);
+    progressDialog->setWindowModality(Qt::WindowModal);
 
-    if(s_settings->documentView().sourceEditor().isEmpty())
+    // The dialog is shown right away since events are processed while saving and the tab must not be closed or refreshed meanwhile.
+
+    progressDialog->show();
+
+    // Saving runs in the background so that the progress is shown and the other tabs are still painted meanwhile.
+
+    SaveMode mode = SaveWithoutChanges;
+
+    if(withChanges)
     {
-        return;
+        mode = QFileInfo(filePath) == m_fileInfo ? SaveChangesInPlace : SaveWithChanges;
     }
 
-    synctex_scanner_t scanner = synctex_scanner_new_with_output_file(m_fileInfo.absoluteFilePath().toLocal8Bit(), 0, 1);
+    QSharedPointer< QAtomicInt > copyProgress(new QAtomicInt(0));
+
+    QFutureWatcher< bool > watcher;
+    watcher.setFuture(QtConcurrent::run(saveDocument, m_document, filePath, temporaryFile.fileName(), mode, copyProgress));
+
+    QTimer progressTimer;
+    progressTimer.start(saveProgressInterval);
 
-    if(scanner != 0)
+    const qreal originalSize = qMax(m_fileInfo.size(), Q_INT64_C(1));
+
+    m_isSaving = true;
+
+    while(!watcher.isFinished())
     {
-        if(synctex_edit_query(scanner, page, pos.x(), pos.y()) > 0)
-        {
-            for(synctex_node_t node = synctex_next_result(scanner); node != 0; node = synctex_next_result(scanner))
-            {
-                QString sourceName = QString::fromLocal8Bit(synctex_scanner_get_name(scanner, synctex_node_tag(node)));
-                int sourceLine = synctex_node_line(node);
-                int sourceColumn = synctex_node_column(node);
+        QApplication::processEvents(QEventLoop::AllEvents | QEventLoop::WaitForMoreEvents);
 
-                sourceLine = sourceLine >= 0 ? sourceLine : 0;
-                sourceColumn = sourceColumn >= 0 ? sourceColumn : 0;
+        // The document is written into the temporary file first, which is then copied into place.
 
-                QProcess::startDetached(s_settings->documentView().sourceEditor().arg(m_fileInfo.dir().absoluteFilePath(sourceName), QString::number(sourceLine), QString::number(sourceColumn)));
+        const int writeProgress = qMin(qRound(50.0 * QFileInfo(temporaryFile.fileName()).size() / originalSize), 50);
+        const int progress = writeProgress + copyProgress->fetchAndAddOrdered(0) / 2;
 
-                break;
-            }
+        if(progress > 0)
+        {
+            progressDialog->setRange(0, 100);
+            progressDialog->setValue(progress);
         }
-
-        synctex_scanner_free(scanner);
     }
-    else
+
+    m_isSaving = false;
+
+    if(!watcher.result())
     {
-        QMessageBox::warning(this, tr("Warning"), tr("SyncTeX data for '%1' could not be found.").arg(m_fileInfo.absoluteFilePath()));
+        return false;
     }
 
-#else
-
-    Q_UNUSED(page);
-    Q_UNUSED(pos);
+    if(withChanges)
+    {
+        m_wasModified = false;
+    }
 
-#endif // WITH_SYNCTEX
+    return true;
 }
 
-void DocumentView::on_pages_zoomToSelectionRequested(int page, const QRectF& rect)
+bool DocumentView::print(QPrinter* printer, const PrintOptions& printOptions)
 {
-    if(rect.isEmpty())
+    if(m_document == 0)
     {
-        return;
+        return false;
     }
 
-    const qreal visibleWidth = m_layout->visibleWidth(viewport()->width());
-    const qreal visibleHeight = m_layout->visibleHeight(viewport()->height());
+    const int fromPage = printer->fromPage() != 0 ? printer->fromPage() : 1;
+    const int toPage = printer->toPage() != 0 ? printer->toPage() : m_pages.count();
 
-    const qreal displayedWidth = m_pageItems.at(page - 1)->displayedWidth();
-    const qreal displayedHeight = m_pageItems.at(page - 1)->displayedHeight();
+#ifdef WITH_CUPS
 
-    setScaleFactor(qMin(qMin(visibleWidth / displayedWidth / rect.width(),
-                             visibleHeight / displayedHeight / rect.height()),
-                        Defaults::DocumentView::maximumScaleFactor()));
+    if(m_document->canBePrintedUsingCUPS())
+    {
+        return printUsingCUPS(printer, printOptions, fromPage, toPage);
+    }
 
-    setScaleMode(ScaleFactorMode);
+#endif // WITH_CUPS
 
-    jumpToPage(page, false, rect.left(), rect.top());
+    return printUsingQt(printer, printOptions, fromPage, toPage);
 }
 
-void DocumentView::on_pages_wasModified()
+void DocumentView::previousPage()
 {
-    m_wasModified = true;
-
-    emit documentModified();
+    jumpToPage(m_layout->previousPage(m_currentPage));
 }
 
-void DocumentView::resizeEvent(QResizeEvent* event)
+void DocumentView::nextPage()
 {
-    QGraphicsView::resizeEvent(event);
-
-    if(m_scaleMode != ScaleFactorMode)
-    {
-        qreal left = 0.0, top = 0.0;
-        saveLeftAndTop(left, top);
-
-        prepareScene();
-        prepareView(left, top);
-    }
+    jumpToPage(m_layout->nextPage(m_currentPage, m_pages.count()));
 }
 
-void DocumentView::keyPressEvent(QKeyEvent* event)
+void DocumentView::firstPage()
 {
-    foreach(const PageItem* page, m_pageItems)
-    {
-        if(page->showsAnnotationOverlay() || page->showsFormFieldOverlay())
-        {
-            QGraphicsView::keyPressEvent(event);
-            return;
-        }
-    }
-
-    const QKeySequence keySequence(event->modifiers() + event->key());
+    jumpToPage(1);
+}
 
-    int maskedKey = -1;
+void DocumentView::lastPage()
+{
+    jumpToPage(m_pages.count());
+}
 
-    if(s_shortcutHandler->matchesSkipBackward(keySequence))
-    {
-        maskedKey = Qt::Key_PageUp;
-    }
-    else if(s_shortcutHandler->matchesSkipForward(keySequence))
-    {
-        maskedKey = Qt::Key_PageDown;
-    }
-    else if(s_shortcutHandler->matchesMoveUp(keySequence))
-    {
-        maskedKey = Qt::Key_Up;
-    }
-    else if(s_shortcutHandler->matchesMoveDown(keySequence))
-    {
-        maskedKey = Qt::Key_Down;
-    }
-    else if(s_shortcutHandler->matchesMoveLeft(keySequence))
-    {
-        maskedKey = Qt::Key_Left;
-    }
-    else if(s_shortcutHandler->matchesMoveRight(keySequence))
-    {
-        maskedKey = Qt::Key_Right;
-    }
-    else if(event->key() == Qt::Key_PageUp || event->key() == Qt::Key_PageDown ||
-            event->key() == Qt::Key_Up || event->key() == Qt::Key_Down ||
-            event->key() == Qt::Key_Left || event->key() == Qt::Key_Right)
+void DocumentView::jumpToPage(int page, bool trackChange, qreal changeLeft, qreal changeTop)
+{
+    if(page >= 1 && page <= m_pages.count())
     {
-        event->ignore();
-        return;
-    }
+        qreal left = 0.0, top = 0.0;
+        saveLeftAndTop(left, top);
 
-    if(maskedKey == -1)
-    {
-        QGraphicsView::keyPressEvent(event);
-    }
-    else
-    {
-        if(!m_continuousMode)
+        if(m_currentPage != m_layout->currentPage(page) || qAbs(left - changeLeft) > 0.01 || qAbs(top - changeTop) > 0.01)
         {
-            if(maskedKey == Qt::Key_PageUp && verticalScrollBar()->value() == verticalScrollBar()->minimum() && m_currentPage != 1)
+            if(trackChange)
             {
-                previousPage();
-
-                verticalScrollBar()->setValue(verticalScrollBar()->maximum());
+                m_past.append(Position(m_currentPage, left, top));
+                m_future.clear();
 
-                event->accept();
-                return;
+                emit canJumpChanged(true, false);
             }
-            else if(maskedKey == Qt::Key_PageDown && verticalScrollBar()->value() == verticalScrollBar()->maximum() && m_currentPage != m_layout->currentPage(m_pages.count()))
-            {
-                nextPage();
 
-                verticalScrollBar()->setValue(verticalScrollBar()->minimum());
+            m_currentPage = m_layout->currentPage(page);
 
-                event->accept();
-                return;
-            }
+            prepareView(changeLeft, changeTop, page);
+
+            emit currentPageChanged(m_currentPage, trackChange);
         }
+    }
+}
 
-        if((maskedKey == Qt::Key_Up && verticalScrollBar()->minimum() == verticalScrollBar()->maximum()) ||
-           (maskedKey == Qt::Key_Left && !horizontalScrollBar()->isVisible()))
-        {
-            previousPage();
+bool DocumentView::canJumpBackward() const
+{
+    return !m_past.isEmpty();
+}
 
-            event->accept();
-            return;
-        }
-        else if((maskedKey == Qt::Key_Down && verticalScrollBar()->minimum() == verticalScrollBar()->maximum()) ||
-                (maskedKey == Qt::Key_Right && !horizontalScrollBar()->isVisible()))
-        {
-            nextPage();
+void DocumentView::jumpBackward()
+{
+    if(!m_past.isEmpty())
+    {
+        qreal left = 0.0, top = 0.0;
+        saveLeftAndTop(left, top);
 
-            event->accept();
-            return;
-        }
+        m_future.prepend(Position(m_currentPage, left, top));
 
-        QKeyEvent keyEvent(event->type(), maskedKey, Qt::NoModifier, event->text(), event->isAutoRepeat(), event->count());
-        QGraphicsView::keyPressEvent(&keyEvent);
+        const Position pos = m_past.takeLast();
+        jumpToPage(pos.page, false, pos.left, pos.top);
+
+        emit canJumpChanged(!m_past.isEmpty(), !m_future.isEmpty());
     }
 }
 
-void DocumentView::mousePressEvent(QMouseEvent* event)
+bool DocumentView::canJumpForward() const
 {
-    if(event->button() == Qt::XButton1)
+    return !m_future.isEmpty();
+}
+
+void DocumentView::jumpForward()
+{
+    if(!m_future.isEmpty())
     {
-        event->accept();
+        qreal left = 0.0, top = 0.0;
+        saveLeftAndTop(left, top);
 
-        jumpBackward();
+        m_past.append(Position(m_currentPage, left, top));
+
+        const Position pos = m_future.takeFirst();
+        jumpToPage(pos.page, false, pos.left, pos.top);
+
+        emit canJumpChanged(!m_past.isEmpty(), !m_future.isEmpty());
     }
-    else if(event->button() == Qt::XButton2)
+}
+
+void DocumentView::temporaryHighlight(int page, const QRectF& highlight)
+{
+    if(page >= 1 && page <= m_pages.count() && !highlight.isNull())
     {
-        event->accept();
+        prepareHighlight(page - 1, highlight);
 
-        jumpForward();
+        QTimer::singleShot(s_settings->documentView().highlightDuration(), this, SLOT(on_temporaryHighlight_timeout()));
     }
-
-    QGraphicsView::mousePressEvent(event);
 }
 
-void DocumentView::wheelEvent(QWheelEvent* event)
+void DocumentView::startSearch(const QString& text, bool matchCase, bool wholeWords, bool regularExpression)
 {
-    const Qt::KeyboardModifiers zoomModifiers = s_settings->documentView().zoomModifiers();
-    const Qt::KeyboardModifiers rotateModifiers = s_settings->documentView().rotateModifiers();
-    const Qt::KeyboardModifiers scrollModifiers = s_settings->documentView().scrollModifiers();
+    const QVector< int > indices = searchIndices(text, matchCase, wholeWords, regularExpression);
 
-    if(event->modifiers() == zoomModifiers || event->buttons() == zoomModifiers)
-    {
-        if(event->delta() > 0)
-        {
-            zoomIn();
-        }
-        else
-        {
-            zoomOut();
-        }
+    m_searchTask->cancel();
+    clearResults();
 
-        event->accept();
-        return;
+    m_searchText = text;
+    m_searchMatchCase = matchCase;
+    m_searchWholeWords = wholeWords;
+    m_searchRegularExpression = regularExpression;
+
+    foreach(int index, indices)
+    {
+        m_unsearchedPages.insert(index);
     }
-    else if(event->modifiers() == rotateModifiers || event->buttons() == rotateModifiers)
+
+    m_searchPending = false;
+    m_pendingSearchIndices.clear();
+
+    if(indices.isEmpty())
     {
-        if(event->delta() > 0)
+        if(!m_searchTask->isRunning())
         {
-            rotateLeft();
-        }
-        else
-        {
-            rotateRight();
+            emit searchFinished();
         }
 
-        event->accept();
         return;
     }
-    else if(event->modifiers() == scrollModifiers || event->buttons() == scrollModifiers)
+
+    if(m_searchTask->isRunning())
     {
-        QWheelEvent wheelEvent(event->pos(), event->delta(), event->buttons(), Qt::AltModifier, Qt::Horizontal);
-        QGraphicsView::wheelEvent(&wheelEvent);
+        m_searchPending = true;
+        m_pendingSearchIndices = indices;
 
-        event->accept();
         return;
     }
-    else if(event->modifiers() == Qt::NoModifier)
-    {
-        if(!m_continuousMode)
-        {
-            if(event->delta() > 0 && verticalScrollBar()->value() == verticalScrollBar()->minimum() && m_currentPage != 1)
-            {
-                previousPage();
-
-                verticalScrollBar()->setValue(verticalScrollBar()->maximum());
-
-                event->accept();
-                return;
-            }
-            else if(event->delta() < 0 && verticalScrollBar()->value() == verticalScrollBar()->maximum() && m_currentPage != m_layout->currentPage(m_pages.count()))
-            {
-                nextPage();
 
-                verticalScrollBar()->setValue(verticalScrollBar()->minimum());
+    m_searchTask->start(m_pages, text, matchCase, wholeWords, regularExpression, m_currentPage, m_textIndex, indices);
+}
 
-                event->accept();
-                return;
-            }
-        }
-    }
+void DocumentView::cancelSearch()
+{
+    m_searchPending = false;
+    m_pendingSearchIndices.clear();
 
-    QGraphicsView::wheelEvent(event);
+    m_searchTask->cancel();
+    m_searchTask->wait();
 }
 
-void DocumentView::contextMenuEvent(QContextMenuEvent* event)
+void DocumentView::clearResults()
 {
-    if(event->reason() == QContextMenuEvent::Mouse && modifiersUseMouseButton(s_settings, Qt::RightButton))
-    {
-        event->accept();
-        return;
-    }
+    m_searchResultsTimer->stop();
+    m_searchResultsBatch.clear();
 
-    event->setAccepted(false);
+    s_searchModel->clearResults(this);
 
-    QGraphicsView::contextMenuEvent(event);
+    m_searchText = QString();
+    m_searchMatchCase = false;
+    m_searchWholeWords = false;
+    m_searchRegularExpression = false;
+    m_unsearchedPages.clear();
 
-    if(!event->isAccepted())
-    {
-        event->setAccepted(true);
+    m_currentResult = QModelIndex();
 
-        emit customContextMenuRequested(event->pos());
-    }
-}
+    m_highlight->setVisible(false);
+
+    foreach(PageItem* page, m_pageItems)
+    {
+        if(page != 0)
+        {
+            page->setHighlights(QList< QRectF >());
+        }
+    }
+
+    foreach(ThumbnailItem* page, m_thumbnailItems)
+    {
+        if(page != 0)
+        {
+            page->setHighlights(QList< QRectF >());
+        }
+    }
+
+    if(s_settings->documentView().limitThumbnailsToResults())
+    {
+        prepareThumbnailsScene();
+    }
+}
+
+void DocumentView::findPrevious()
+{
+    checkResult();
+
+    m_currentResult = s_searchModel->findResult(this, m_currentResult, m_currentPage, SearchModel::FindPrevious);
+
+    applyResult();
+}
+
+void DocumentView::findNext()
+{
+    checkResult();
+
+    m_currentResult = s_searchModel->findResult(this, m_currentResult, m_currentPage, SearchModel::FindNext);
+
+    applyResult();
+}
+
+void DocumentView::findResult(const QModelIndex& index)
+{
+    const int page = pageOfResult(index);
+    const QRectF rect = rectOfResult(index);
+
+    if(page >= 1 && page <= m_pages.count() && !rect.isEmpty())
+    {
+        m_currentResult = index;
+
+        applyResult();
+    }
+}
+
+void DocumentView::zoomIn()
+{
+    if(zoomGesture(s_settings->documentView().zoomFactor()))
+    {
+        return;
+    }
+
+    if(scaleMode() != ScaleFactorMode)
+    {
+        setScaleFactor(qMin(m_pageScaleFactors.at(m_currentPage - 1) * s_settings->documentView().zoomFactor(),
+                            s_settings->documentView().maximumScaleFactor()));
+
+        setScaleMode(ScaleFactorMode);
+    }
+    else
+    {
+        setScaleFactor(qMin(m_scaleFactor * s_settings->documentView().zoomFactor(),
+                            s_settings->documentView().maximumScaleFactor()));
+    }
+}
+
+void DocumentView::zoomOut()
+{
+    if(zoomGesture(1.0 / s_settings->documentView().zoomFactor()))
+    {
+        return;
+    }
+
+    if(scaleMode() != ScaleFactorMode)
+    {
+        setScaleFactor(qMax(m_pageScaleFactors.at(m_currentPage - 1) / s_settings->documentView().zoomFactor(),
+                            s_settings->documentView().minimumScaleFactor()));
+
+        setScaleMode(ScaleFactorMode);
+    }
+    else
+    {
+        setScaleFactor(qMax(m_scaleFactor / s_settings->documentView().zoomFactor(),
+                            s_settings->documentView().minimumScaleFactor()));
+    }
+}
+
+bool DocumentView::zoomGesture(qreal zoomFactor)
+{
+    const int zoomGestureTimeout = s_settings->documentView().zoomGestureTimeout();
+
+    if(zoomGestureTimeout <= 0 || m_currentPage < 1 || m_currentPage > m_pageScaleFactors.count())
+    {
+        return false;
+    }
+
+    // The scene is only transformed until the gesture settles, so that no render tasks are started for the intermediate scale factors.
+
+    if(!m_zoomGestureTimer->isActive())
+    {
+        m_zoomGestureScaleFactor = m_pageScaleFactors.at(m_currentPage - 1);
+    }
+
+    const qreal scaleFactor = qBound(s_settings->documentView().minimumScaleFactor(),
+                                     (m_scaleMode == ScaleFactorMode ? m_scaleFactor : m_zoomGestureScaleFactor) * zoomFactor,
+                                     s_settings->documentView().maximumScaleFactor());
+
+    if(m_scaleMode != ScaleFactorMode)
+    {
+        m_scaleMode = ScaleFactorMode;
+
+        adjustScrollBarPolicy();
+
+        emit scaleModeChanged(m_scaleMode);
+
+        s_settings->documentView().setScaleMode(m_scaleMode);
+    }
+
+    if(!qFuzzyCompare(m_scaleFactor, scaleFactor))
+    {
+        m_scaleFactor = scaleFactor;
+
+        emit scaleFactorChanged(m_scaleFactor);
+
+        s_settings->documentView().setScaleFactor(m_scaleFactor);
+    }
+
+    const qreal scale = m_scaleFactor / m_zoomGestureScaleFactor;
+
+    setTransform(QTransform::fromScale(scale, scale));
+
+    m_zoomGestureTimer->start(zoomGestureTimeout);
+
+    return true;
+}
+
+void DocumentView::originalSize()
+{
+    setScaleFactor(1.0);
+    setScaleMode(ScaleFactorMode);
+}
+
+void DocumentView::rotateLeft()
+{
+    switch(m_rotation)
+    {
+    default:
+    case RotateBy0:
+        setRotation(RotateBy270);
+        break;
+    case RotateBy90:
+        setRotation(RotateBy0);
+        break;
+    case RotateBy180:
+        setRotation(RotateBy90);
+        break;
+    case RotateBy270:
+        setRotation(RotateBy180);
+        break;
+    }
+}
+
+void DocumentView::rotateRight()
+{
+    switch(m_rotation)
+    {
+    default:
+    case RotateBy0:
+        setRotation(RotateBy90);
+        break;
+    case RotateBy90:
+        setRotation(RotateBy180);
+        break;
+    case RotateBy180:
+        setRotation(RotateBy270);
+        break;
+    case RotateBy270:
+        setRotation(RotateBy0);
+        break;
+    }
+}
+
+void DocumentView::startPresentation()
+{
+    const int screen = s_settings->presentationView().screen();
+
+    PresentationView* presentationView = new PresentationView(m_pages, m_wasModified ? QByteArray() : DiskCache::documentKey(m_fileInfo));
+
+    presentationView->setGeometry(QApplication::desktop()->screenGeometry(screen));
+
+    presentationView->show();
+    presentationView->setAttribute(Qt::WA_DeleteOnClose);
+
+    connect(this, SIGNAL(destroyed()), presentationView, SLOT(close()));
+    connect(this, SIGNAL(documentChanged()), presentationView, SLOT(close()));
+
+    presentationView->setRotation(rotation());
+    presentationView->setInvertColors(invertColors());
+
+    presentationView->jumpToPage(currentPage(), false);
+
+    if(s_settings->presentationView().synchronize())
+    {
+        connect(this, SIGNAL(currentPageChanged(int,bool)), presentationView, SLOT(jumpToPage(int,bool)));
+        connect(presentationView, SIGNAL(currentPageChanged(int,bool)), this, SLOT(jumpToPage(int,bool)));
+    }
+}
+
+void DocumentView::on_verticalScrollBar_valueChanged()
+{
+    if(!m_continuousMode)
+    {
+        return;
+    }
+
+    preparePageItems();
+
+    int currentPage = -1;
+    const QRectF visibleRect = mapToScene(viewport()->rect()).boundingRect();
+
+    // Only the pages which were visible before or are visible now need to be considered.
+
+    QPair< int, int > visiblePages = m_layout->pagesBetween(visibleRect.top(), visibleRect.bottom());
+    visiblePages.second = qMin(visiblePages.second, m_pageItems.count() - 1);
+
+    for(int index = m_visiblePages.first; index <= m_visiblePages.second && index < m_pageItems.count(); ++index)
+    {
+        if((index < visiblePages.first || index > visiblePages.second) && m_pageItems.at(index) != 0)
+        {
+            m_pageItems.at(index)->cancelRender();
+        }
+    }
+
+    m_visiblePages = visiblePages;
+
+    for(int index = visiblePages.first; index <= visiblePages.second; ++index)
+    {
+        PageItem* page = m_pageItems.at(index);
+
+        const int pageNumber = index + 1;
+        const QRectF pageRect = this->pageRect(index);
+
+        if(!pageRect.intersects(visibleRect))
+        {
+            if(page != 0)
+            {
+                page->cancelRender();
+            }
+        }
+        else if(currentPage == -1 &&
+                 m_layout->currentPage(pageNumber) == pageNumber &&
+                 m_layout->isCurrentPage(visibleRect, pageRect))
+        {
+            currentPage = pageNumber;
+        }
+    }
+
+    if(s_settings->documentView().prefetch())
+    {
+        updateScrollVelocity(visibleRect);
+    }
+
+    if(currentPage != -1 && m_currentPage != currentPage)
+    {
+        m_currentPage = currentPage;
+
+        emit currentPageChanged(m_currentPage);
+
+        if(s_settings->documentView().highlightCurrentThumbnail())
+        {
+            for(int index = 0; index < m_thumbnailItems.count(); ++index)
+            {
+                if(m_thumbnailItems.at(index) != 0)
+                {
+                    m_thumbnailItems.at(index)->setHighlighted(index == m_currentPage - 1);
+                }
+            }
+        }
+    }
+}
+
+void DocumentView::on_autoRefresh_fileChanged()
+{
+    // The document must not be replaced while it is being saved in the background.
+
+    if(m_isSaving)
+    {
+        m_autoRefreshDetector->postpone();
+
+        return;
+    }
+
+    if(m_fileInfo.exists())
+    {
+        refresh();
+    }
+    else
+    {
+        m_wasModified = true;
+
+        emit documentModified();
+    }
+}
+
+void DocumentView::on_prefetch_timeout()
+{
+    // Prefetching is postponed until a zoom gesture settles since the page items still have the previous scale factor.
+
+    if(m_zoomGestureTimer->isActive())
+    {
+        return;
+    }
+
+    const QPair< int, int > prefetchRange = m_layout->prefetchRange(m_currentPage, m_pages.count());
+
+    const int nearVisibleFrom = m_layout->previousPage(m_currentPage);
+    const int nearVisibleTo = m_layout->rightIndex(m_layout->nextPage(m_currentPage, m_pages.count()) - 1, m_pages.count()) + 1;
+
+    PrefetchPlanner planner(viewport());
+
+    // The pages in the direction of the last scroll gesture are prefetched first.
+
+    for(int pass = 0; pass < 2; ++pass)
+    {
+        if((pass == 0) == (m_scrollDirection >= 0))
+        {
+            for(int index = m_currentPage - 1; index <= prefetchRange.second - 1; ++index)
+            {
+                if(!planner.prefetch(pageItem(index), index <= nearVisibleTo - 1))
+                {
+                    break;
+                }
+            }
+        }
+        else
+        {
+            for(int index = m_currentPage - 1; index >= prefetchRange.first - 1; --index)
+            {
+                if(!planner.prefetch(pageItem(index), index >= nearVisibleFrom - 1))
+                {
+                    break;
+                }
+            }
+        }
+    }
+}
+
+void DocumentView::on_zoomGesture_timeout()
+{
+    qreal left = 0.0, top = 0.0;
+    saveLeftAndTop(left, top);
+
+    prepareScene();
+    prepareView(left, top);
+
+    if(s_settings->documentView().prefetch())
+    {
+        m_prefetchTimer->start();
+    }
+}
+
+void DocumentView::on_temporaryHighlight_timeout()
+{
+    m_highlight->setVisible(false);
+}
+
+void DocumentView::on_searchTask_finished()
+{
+    if(!m_searchPending)
+    {
+        flushSearchResults();
+
+        emit searchFinished();
+
+        return;
+    }
+
+    m_searchPending = false;
+
+    // The task has signalled that it finished but possibly not yet returned from its thread.
+
+    m_searchTask->wait();
+
+    m_searchTask->start(m_pages, m_searchText, m_searchMatchCase, m_searchWholeWords, m_searchRegularExpression, m_currentPage, m_textIndex, m_pendingSearchIndices);
+
+    m_pendingSearchIndices.clear();
+}
+
+void DocumentView::on_searchTask_progressChanged(int progress)
+{
+    s_searchModel->updateProgress(this);
+
+    emit searchProgressChanged(progress);
+}
+
+void DocumentView::on_searchTask_resultsReady(int index, const QList< QRectF >& results)
+{
+    const TraceSpan span("search", "resultsReady", "page", index + 1);
+
+    if(m_searchTask->wasCanceled() || m_searchPending)
+    {
+        return;
+    }
+
+    m_unsearchedPages.remove(index);
+
+    if(results.isEmpty())
+    {
+        return;
+    }
+
+    m_searchResultsBatch.insert(index + 1, results);
+
+    // The first result is shown immediately.
+
+    if(!m_currentResult.isValid())
+    {
+        flushSearchResults();
+    }
+    else if(!m_searchResultsTimer->isActive())
+    {
+        m_searchResultsTimer->start();
+    }
+}
+
+void DocumentView::on_searchResults_timeout()
+{
+    flushSearchResults();
+}
+
+void DocumentView::setShowStatistics(bool showStatistics)
+{
+    if(showStatistics && m_statisticsOverlay == 0)
+    {
+        m_statisticsOverlay = new QLabel(viewport());
+        m_statisticsOverlay->setAttribute(Qt::WA_TransparentForMouseEvents);
+        m_statisticsOverlay->setAutoFillBackground(true);
+        m_statisticsOverlay->setMargin(5);
+        m_statisticsOverlay->move(0, 0);
+
+        QPalette palette = m_statisticsOverlay->palette();
+        palette.setColor(QPalette::Window, QColor(0, 0, 0, 192));
+        palette.setColor(QPalette::WindowText, Qt::white);
+        m_statisticsOverlay->setPalette(palette);
+
+        m_statisticsTimer = new QTimer(this);
+        m_statisticsTimer->setInterval(statisticsInterval);
+
+        connect(m_statisticsTimer, SIGNAL(timeout()), SLOT(on_statistics_timeout()));
+
+        m_statisticsTimer->start();
+
+        on_statistics_timeout();
+
+        m_statisticsOverlay->show();
+    }
+    else if(!showStatistics && m_statisticsOverlay != 0)
+    {
+        delete m_statisticsOverlay;
+        m_statisticsOverlay = 0;
+
+        delete m_statisticsTimer;
+        m_statisticsTimer = 0;
+    }
+}
+
+void DocumentView::on_statistics_timeout()
+{
+    // Long queue waits point to the scheduler, long renders to the backend and many misses to the tile cache.
+
+    const RenderStatistics::Counters renderCounters = RenderStatistics::counters(scene());
+    const RenderStatistics::Counters searchCounters = RenderStatistics::counters(this);
+
+    const TileCache::Statistics& cacheStatistics = TileItem::cacheStatistics();
+    const RenderScheduler* renderScheduler = RenderScheduler::instance();
+
+    QStringList lines;
+
+    lines.append(tr("Renders: %1, canceled: %2, from disk cache: %3")
+                 .arg(renderCounters.renderCount).arg(renderCounters.cancelCount).arg(renderCounters.diskCacheHits));
+    lines.append(tr("Average queue wait: %1 ms, render: %2 ms, post-processing: %3 ms")
+                 .arg(renderCounters.averageQueueTime(), 0, 'f', 1)
+                 .arg(renderCounters.averageRenderTime(), 0, 'f', 1)
+                 .arg(renderCounters.averagePostProcessTime(), 0, 'f', 1));
+
+    qreal costPerCall = 0.0;
+    qreal costPerMegapixel = 0.0;
+
+    if(renderCounters.fitRenderCost(costPerCall, costPerMegapixel))
+    {
+        lines.append(tr("Render cost: %1 ms per call, %2 ms per megapixel, tile size: %3")
+                     .arg(costPerCall, 0, 'f', 1).arg(costPerMegapixel, 0, 'f', 1).arg(RenderStatistics::tileSize(scene())));
+    }
+    lines.append(tr("Scheduler: %1 queued, %2 of %3 threads active")
+                 .arg(renderScheduler->queuedCount()).arg(renderScheduler->activeCount()).arg(renderScheduler->maxThreadCount()));
+    lines.append(tr("Tile cache: %1 hits, %2 misses, %3 evictions, %4 of %5 MB")
+                 .arg(cacheStatistics.hits).arg(cacheStatistics.misses).arg(cacheStatistics.evictions)
+                 .arg(TileItem::cacheTotalCost() / 1024 / 1024).arg(TileItem::cacheMaxCost() / 1024 / 1024));
+    lines.append(tr("Search: %1 pages at %2 pages per second")
+                 .arg(searchCounters.searchedPages).arg(searchCounters.searchedPagesPerSecond(), 0, 'f', 1));
+
+    m_statisticsOverlay->setText(lines.join(QLatin1String("\n")));
+    m_statisticsOverlay->adjustSize();
+}
+
+void DocumentView::on_pages_cropRectChanged()
+{
+    const PageItem* page = qobject_cast< PageItem* >(sender());
+
+    if(page != 0 && !page->cropRect().isNull())
+    {
+        m_pageCropRects[page->index()] = rotateCropRect(page->cropRect(), -90.0 * page->rotation());
+    }
+
+    qreal left = 0.0, top = 0.0;
+    saveLeftAndTop(left, top);
+
+    prepareScene();
+    prepareView(left, top);
+}
+
+void DocumentView::on_thumbnails_cropRectChanged()
+{
+    prepareThumbnailsScene();
+}
+
+void DocumentView::on_pages_sizeCorrected(int index)
+{
+    if(index < 0 || index >= m_pageItems.count())
+    {
+        return;
+    }
+
+    const QSizeF size = m_pages.at(index)->size();
+
+    if(m_pageItems.at(index) != 0)
+    {
+        m_pageItems.at(index)->setSize(size);
+    }
+
+    if(m_thumbnailItems.at(index) != 0)
+    {
+        m_thumbnailItems.at(index)->setSize(size);
+    }
+
+    qreal left = 0.0, top = 0.0;
+    saveLeftAndTop(left, top);
+
+    prepareScene();
+    prepareView(left, top);
+
+    prepareThumbnailsScene();
+}
+
+void DocumentView::on_openJob_finished()
+{
+    if(m_openCancellation.isNull())
+    {
+        return;
+    }
+
+    Model::Document* document = m_openWatcher->result();
+
+    m_openCancellation.clear();
+    m_openWatcher->setFuture(QFuture< Model::Document* >());
+
+    delete m_openPlaceholder;
+    m_openPlaceholder = 0;
+
+    emit openFinished(openDocument(m_fileInfo.filePath(), document, true));
+}
+
+void DocumentView::on_modelsJob_finished()
+{
+    if(m_modelsWatcher->future().resultCount() == 0)
+    {
+        return;
+    }
+
+    const Models models = m_modelsWatcher->result();
+
+    m_modelsWatcher->setFuture(QFuture< Models >());
+
+    m_outlineModel->takeOutline(models.first);
+    takeModel(m_propertiesModel, models.second);
+
+    delete models.first;
+    delete models.second;
+
+    if(m_outlineModel->rowCount() == 0)
+    {
+        loadFallbackOutline();
+    }
+
+    emit documentChanged();
+}
+
+void DocumentView::on_fingerprintsJob_resultReadyAt(int resultIndex)
+{
+    if(m_previousFingerprints.isEmpty() || resultIndex >= m_fingerprintsOrder.count())
+    {
+        return;
+    }
+
+    const int index = m_fingerprintsOrder.at(resultIndex);
+
+    if(m_fingerprintsWatcher->resultAt(resultIndex) == m_previousFingerprints.at(index))
+    {
+        return;
+    }
+
+    if(m_pageItems.at(index) != 0)
+    {
+        m_pageItems.at(index)->refresh(true, true);
+    }
+
+    if(m_thumbnailItems.at(index) != 0)
+    {
+        m_thumbnailItems.at(index)->refresh(true, true);
+    }
+}
+
+void DocumentView::on_fingerprintsJob_finished()
+{
+    if(m_fingerprintsWatcher->isCanceled() || m_fingerprintsWatcher->future().resultCount() != m_pages.count())
+    {
+        return;
+    }
+
+    const QList< QByteArray > results = m_fingerprintsWatcher->future().results();
+
+    m_fingerprints.resize(m_pages.count());
+
+    for(int resultIndex = 0; resultIndex < results.count(); ++resultIndex)
+    {
+        m_fingerprints[m_fingerprintsOrder.at(resultIndex)] = results.at(resultIndex);
+    }
+
+    m_fingerprintsOrder.clear();
+    m_previousFingerprints.clear();
+
+    m_fingerprintsWatcher->setFuture(QFuture< QByteArray >());
+}
+
+void DocumentView::on_textIndexJob_finished()
+{
+    if(m_textIndexWatcher->isCanceled() || m_textIndexWatcher->future().resultCount() != m_pages.count())
+    {
+        return;
+    }
+
+    m_textIndex = TextIndex(m_textIndexWatcher->future().results().toVector());
+
+    m_textIndexWatcher->setFuture(QFuture< QString >());
+
+    Database::instance()->saveTextIndex(m_fileInfo, m_textIndex.save());
+}
+
+void DocumentView::on_fontsJob_resultReadyAt(int index)
+{
+    const QSharedPointer< QStandardItemModel > fontsModel = m_fontsWatcher->resultAt(index);
+
+    if(m_fontsModel->columnCount() == 0)
+    {
+        m_fontsModel->setColumnCount(fontsModel->columnCount());
+
+        for(int column = 0; column < fontsModel->columnCount(); ++column)
+        {
+            QStandardItem* item = fontsModel->takeHorizontalHeaderItem(column);
+
+            if(item != 0)
+            {
+                m_fontsModel->setHorizontalHeaderItem(column, item);
+            }
+        }
+    }
+
+    // Fonts used on pages of different steps are reported by each of them.
+
+    while(fontsModel->rowCount() > 0)
+    {
+        QList< QStandardItem* > items = fontsModel->takeRow(0);
+
+        QStringList texts;
+
+        foreach(const QStandardItem* item, items)
+        {
+            texts.append(item != 0 ? item->text() : QString());
+        }
+
+        const QString key = texts.join(QLatin1String("\n"));
+
+        if(m_fontKeys.contains(key))
+        {
+            qDeleteAll(items);
+
+            continue;
+        }
+
+        m_fontKeys.insert(key);
+        m_fontsModel->appendRow(items);
+    }
+}
+
+void DocumentView::on_pages_linkClicked(bool newTab, int page, qreal left, qreal top)
+{
+    page = qMax(page, 1);
+    page = qMin(page, m_pages.count());
+
+    left = left >= 0.0 ? left : 0.0;
+    left = left <= 1.0 ? left : 1.0;
+
+    top = top >= 0.0 ? top : 0.0;
+    top = top <= 1.0 ? top : 1.0;
+
+    if(newTab)
+    {
+        emit linkClicked(page);
+    }
+    else
+    {
+        jumpToPage(page, true, left, top);
+    }
+}
+
+void DocumentView::on_pages_linkClicked(bool newTab, const QString& fileName, int page)
+{
+    const QString filePath = QFileInfo(fileName).isAbsolute() ? fileName : m_fileInfo.dir().filePath(fileName);
+
+    emit linkClicked(newTab, filePath, page);
+}
+
+void DocumentView::on_pages_linkPreloadRequested(const QString& fileName, int page, bool hovered)
+{
+    const QString filePath = QFileInfo(fileName).isAbsolute() ? fileName : m_fileInfo.dir().filePath(fileName);
+
+    LinkPreloader::instance()->preload(filePath, page, hovered);
+}
+
+void DocumentView::on_pages_linkClicked(const QString& url)
+{
+    if(s_settings->documentView().openUrl())
+    {
+        QUrl resolvedUrl(url);
+
+        if(resolvedUrl.isRelative() && QFileInfo(url).isRelative())
+        {
+            resolvedUrl.setPath(m_fileInfo.dir().filePath(url));
+        }
+
+        QDesktopServices::openUrl(resolvedUrl);
+    }
+    else
+    {
+        QMessageBox::information(this, tr("Information"), tr("Opening URL is disabled in the settings."));
+    }
+}
+
+void DocumentView::on_pages_rubberBandFinished()
+{
+    setRubberBandMode(ModifiersMode);
+}
+
+void DocumentView::on_pages_editSourceRequested(int page, const QPointF& pos)
+{
+#ifdef WITH_SYNCTEX
+
+    if(s_settings->documentView().sourceEditor().isEmpty())
+    {
+        return;
+    }
+
+    const QSharedPointer< SyncTeXScanner > scanner = syncTeXScanner();
+
+    if(!scanner.isNull())
+    {
+        QString sourceName;
+        int sourceLine = 0;
+        int sourceColumn = 0;
+
+        if(scanner->findSource(page, pos, sourceName, sourceLine, sourceColumn))
+        {
+            QProcess::startDetached(s_settings->documentView().sourceEditor().arg(m_fileInfo.dir().absoluteFilePath(sourceName), QString::number(sourceLine), QString::number(sourceColumn)));
+        }
+    }
+    else
+    {
+        QMessageBox::warning(this, tr("Warning"), tr("SyncTeX data for '%1' could not be found.").arg(m_fileInfo.absoluteFilePath()));
+    }
+
+#else
+
+    Q_UNUSED(page);
+    Q_UNUSED(pos);
+
+#endif // WITH_SYNCTEX
+}
+
+void DocumentView::on_pages_zoomToSelectionRequested(int page, const QRectF& rect)
+{
+    if(rect.isEmpty())
+    {
+        return;
+    }
+
+    const qreal visibleWidth = m_layout->visibleWidth(viewport()->width());
+    const qreal visibleHeight = m_layout->visibleHeight(viewport()->height());
+
+    const qreal displayedWidth = pageItem(page - 1)->displayedWidth();
+    const qreal displayedHeight = pageItem(page - 1)->displayedHeight();
+
+    setScaleFactor(qMin(qMin(visibleWidth / displayedWidth / rect.width(),
+                             visibleHeight / displayedHeight / rect.height()),
+                        Defaults::DocumentView::maximumScaleFactor()));
+
+    setScaleMode(ScaleFactorMode);
+
+    jumpToPage(page, false, rect.left(), rect.top());
+}
+
+void DocumentView::on_pages_wasModified()
+{
+    m_wasModified = true;
+
+    DocumentRegistry::instance()->detach(m_document);
+
+    // Worker processes load the file itself and would not render the changes.
+
+    foreach(Model::Page* page, m_pages)
+    {
+        static_cast< LazyPage* >(page)->setFilePath(QString());
+    }
+
+    foreach(int index, m_retainedPages)
+    {
+        PageItem::releaseCachedPixmaps(m_documentKey, index);
+    }
+
+    m_retainedPages.clear();
+    m_documentKey = QByteArray();
+
+    foreach(PageItem* page, m_pageItems)
+    {
+        if(page != 0)
+        {
+            page->setDocumentKey(QByteArray());
+        }
+    }
+
+    foreach(ThumbnailItem* page, m_thumbnailItems)
+    {
+        if(page != 0)
+        {
+            page->setDocumentKey(QByteArray());
+        }
+    }
+
+    emit documentModified();
+}
+
+void DocumentView::showEvent(QShowEvent* event)
+{
+    QGraphicsView::showEvent(event);
+
+    prepareForeground();
+
+    m_searchTask->setForeground(true);
+}
+
+void DocumentView::hideEvent(QHideEvent* event)
+{
+    QGraphicsView::hideEvent(event);
+
+    m_searchTask->setForeground(false);
+}
+
+void DocumentView::resizeEvent(QResizeEvent* event)
+{
+    QGraphicsView::resizeEvent(event);
+
+    if(m_scaleMode != ScaleFactorMode)
+    {
+        qreal left = 0.0, top = 0.0;
+        saveLeftAndTop(left, top);
+
+        prepareScene();
+        prepareView(left, top);
+    }
+    else
+    {
+        preparePageItems();
+    }
+}
+
+void DocumentView::keyPressEvent(QKeyEvent* event)
+{
+    foreach(const PageItem* page, m_pageItems)
+    {
+        if(page != 0 && (page->showsAnnotationOverlay() || page->showsFormFieldOverlay()))
+        {
+            QGraphicsView::keyPressEvent(event);
+            return;
+        }
+    }
+
+    const QKeySequence keySequence(event->modifiers() + event->key());
+
+    int maskedKey = -1;
+
+    if(s_shortcutHandler->matchesSkipBackward(keySequence))
+    {
+        maskedKey = Qt::Key_PageUp;
+    }
+    else if(s_shortcutHandler->matchesSkipForward(keySequence))
+    {
+        maskedKey = Qt::Key_PageDown;
+    }
+    else if(s_shortcutHandler->matchesMoveUp(keySequence))
+    {
+        maskedKey = Qt::Key_Up;
+    }
+    else if(s_shortcutHandler->matchesMoveDown(keySequence))
+    {
+        maskedKey = Qt::Key_Down;
+    }
+    else if(s_shortcutHandler->matchesMoveLeft(keySequence))
+    {
+        maskedKey = Qt::Key_Left;
+    }
+    else if(s_shortcutHandler->matchesMoveRight(keySequence))
+    {
+        maskedKey = Qt::Key_Right;
+    }
+    else if(event->key() == Qt::Key_PageUp || event->key() == Qt::Key_PageDown ||
+            event->key() == Qt::Key_Up || event->key() == Qt::Key_Down ||
+            event->key() == Qt::Key_Left || event->key() == Qt::Key_Right)
+    {
+        event->ignore();
+        return;
+    }
+
+    if(maskedKey == -1)
+    {
+        QGraphicsView::keyPressEvent(event);
+    }
+    else
+    {
+        if(!m_continuousMode)
+        {
+            if(maskedKey == Qt::Key_PageUp && verticalScrollBar()->value() == verticalScrollBar()->minimum() && m_currentPage != 1)
+            {
+                previousPage();
+
+                verticalScrollBar()->setValue(verticalScrollBar()->maximum());
+
+                event->accept();
+                return;
+            }
+            else if(maskedKey == Qt::Key_PageDown && verticalScrollBar()->value() == verticalScrollBar()->maximum() && m_currentPage != m_layout->currentPage(m_pages.count()))
+            {
+                nextPage();
+
+                verticalScrollBar()->setValue(verticalScrollBar()->minimum());
+
+                event->accept();
+                return;
+            }
+        }
+
+        if((maskedKey == Qt::Key_Up && verticalScrollBar()->minimum() == verticalScrollBar()->maximum()) ||
+           (maskedKey == Qt::Key_Left && !horizontalScrollBar()->isVisible()))
+        {
+            previousPage();
+
+            event->accept();
+            return;
+        }
+        else if((maskedKey == Qt::Key_Down && verticalScrollBar()->minimum() == verticalScrollBar()->maximum()) ||
+                (maskedKey == Qt::Key_Right && !horizontalScrollBar()->isVisible()))
+        {
+            nextPage();
+
+            event->accept();
+            return;
+        }
+
+        QKeyEvent keyEvent(event->type(), maskedKey, Qt::NoModifier, event->text(), event->isAutoRepeat(), event->count());
+        QGraphicsView::keyPressEvent(&keyEvent);
+    }
+}
+
+void DocumentView::mousePressEvent(QMouseEvent* event)
+{
+    if(event->button() == Qt::XButton1)
+    {
+        event->accept();
+
+        jumpBackward();
+    }
+    else if(event->button() == Qt::XButton2)
+    {
+        event->accept();
+
+        jumpForward();
+    }
+
+    QGraphicsView::mousePressEvent(event);
+}
+
+void DocumentView::wheelEvent(QWheelEvent* event)
+{
+    const Qt::KeyboardModifiers zoomModifiers = s_settings->documentView().zoomModifiers();
+    const Qt::KeyboardModifiers rotateModifiers = s_settings->documentView().rotateModifiers();
+    const Qt::KeyboardModifiers scrollModifiers = s_settings->documentView().scrollModifiers();
+
+    if(event->modifiers() == zoomModifiers || event->buttons() == zoomModifiers)
+    {
+        if(event->delta() > 0)
+        {
+            zoomIn();
+        }
+        else
+        {
+            zoomOut();
+        }
+
+        event->accept();
+        return;
+    }
+    else if(event->modifiers() == rotateModifiers || event->buttons() == rotateModifiers)
+    {
+        if(event->delta() > 0)
+        {
+            rotateLeft();
+        }
+        else
+        {
+            rotateRight();
+        }
+
+        event->accept();
+        return;
+    }
+    else if(event->modifiers() == scrollModifiers || event->buttons() == scrollModifiers)
+    {
+        QWheelEvent wheelEvent(event->pos(), event->delta(), event->buttons(), Qt::AltModifier, Qt::Horizontal);
+        QGraphicsView::wheelEvent(&wheelEvent);
+
+        event->accept();
+        return;
+    }
+    else if(event->modifiers() == Qt::NoModifier)
+    {
+        if(!m_continuousMode)
+        {
+            if(event->delta() > 0 && verticalScrollBar()->value() == verticalScrollBar()->minimum() && m_currentPage != 1)
+            {
+                previousPage();
+
+                verticalScrollBar()->setValue(verticalScrollBar()->maximum());
+
+                event->accept();
+                return;
+            }
+            else if(event->delta() < 0 && verticalScrollBar()->value() == verticalScrollBar()->maximum() && m_currentPage != m_layout->currentPage(m_pages.count()))
+            {
+                nextPage();
+
+                verticalScrollBar()->setValue(verticalScrollBar()->minimum());
+
+                event->accept();
+                return;
+            }
+        }
+    }
+
+    QGraphicsView::wheelEvent(event);
+}
+
+void DocumentView::contextMenuEvent(QContextMenuEvent* event)
+{
+    if(event->reason() == QContextMenuEvent::Mouse && modifiersUseMouseButton(s_settings, Qt::RightButton))
+    {
+        event->accept();
+        return;
+    }
+
+    event->setAccepted(false);
+
+    QGraphicsView::contextMenuEvent(event);
+
+    if(!event->isAccepted())
+    {
+        event->setAccepted(true);
+
+        emit customContextMenuRequested(event->pos());
+    }
+}
+
+#ifdef WITH_CUPS
+
+bool DocumentView::printUsingCUPS(QPrinter* printer, const PrintOptions& printOptions, int fromPage, int toPage)
+{
+    int num_dests = 0;
+    cups_dest_t* dests = 0;
+
+    int num_options = 0;
+    cups_option_t* options = 0;
+
+    cups_dest_t* dest = 0;
+    int jobId = 0;
+
+    num_dests = cupsGetDests(&dests);
+
+    dest = cupsGetDest(printer->printerName().toLocal8Bit(), 0, num_dests, dests);
+
+    if(dest != 0)
+    {
+        for(int index = 0; index < dest->num_options; ++index)
+        {
+            num_options = cupsAddOption(dest->options[index].name, dest->options[index].value, num_options, &options);
+        }
+
+        QStringList cupsOptions = printer->printEngine()->property(QPrintEngine::PrintEnginePropertyKey(0xfe00)).toStringList();
+
+        for(int index = 0; index < cupsOptions.count() - 1; index += 2)
+        {
+            num_options = cupsAddOption(cupsOptions.at(index).toLocal8Bit(), cupsOptions.at(index + 1).toLocal8Bit(), num_options, &options);
+        }
+
+#if QT_VERSION >= QT_VERSION_CHECK(4,7,0)
+
+        num_options = cupsAddOption("copies", QString::number(printer->copyCount()).toLocal8Bit(), num_options, &options);
+
+#endif // QT_VERSION
+
+        num_options = cupsAddOption("Collate", printer->collateCopies() ? "true" : "false", num_options, &options);
+
+        switch(printer->pageOrder())
+        {
+        case QPrinter::FirstPageFirst:
+            num_options = cupsAddOption("outputorder", "normal", num_options, &options);
+            break;
+        case QPrinter::LastPageFirst:
+            num_options = cupsAddOption("outputorder", "reverse", num_options, &options);
+            break;
+        }
+
+        num_options = cupsAddOption("fit-to-page", printOptions.fitToPage ? "true" : "false", num_options, &options);
+
+        switch(printer->orientation())
+        {
+        case QPrinter::Portrait:
+            num_options = cupsAddOption("landscape", "false", num_options, &options);
+            break;
+        case QPrinter::Landscape:
+            num_options = cupsAddOption("landscape", "true", num_options, &options);
+            break;
+        }
+
+        switch(printer->colorMode())
+        {
+        case QPrinter::Color:
+            num_options = addCMYKorRGBColorModel(dest, num_options, &options);
+            break;
+        case QPrinter::GrayScale:
+            num_options = cupsAddOption("ColorModel", "Gray", num_options, &options);
+            break;
+        }
+
+        switch(printer->duplex())
+        {
+        case QPrinter::DuplexNone:
+            num_options = cupsAddOption("sides", "one-sided", num_options, &options);
+            break;
+        case QPrinter::DuplexAuto:
+            break;
+        case QPrinter::DuplexLongSide:
+            num_options = cupsAddOption("sides", "two-sided-long-edge", num_options, &options);
+            break;
+        case QPrinter::DuplexShortSide:
+            num_options = cupsAddOption("sides", "two-sided-short-edge", num_options, &options);
+            break;
+        }
+
+        int numberUp = 1;
+
+#if QT_VERSION < QT_VERSION_CHECK(5,2,0)
+
+        switch(printOptions.numberUp)
+        {
+        case PrintOptions::SinglePage:
+            num_options = cupsAddOption("number-up", "1", num_options, &options);
+            numberUp = 1;
+            break;
+        case PrintOptions::TwoPages:
+            num_options = cupsAddOption("number-up", "2", num_options, &options);
+            numberUp = 2;
+            break;
+        case PrintOptions::FourPages:
+            num_options = cupsAddOption("number-up", "4", num_options, &options);
+            numberUp = 4;
+            break;
+        case PrintOptions::SixPages:
+            num_options = cupsAddOption("number-up", "6", num_options, &options);
+            numberUp = 6;
+            break;
+        case PrintOptions::NinePages:
+            num_options = cupsAddOption("number-up", "9", num_options, &options);
+            numberUp = 9;
+            break;
+        case PrintOptions::SixteenPages:
+            num_options = cupsAddOption("number-up", "16", num_options, &options);
+            numberUp = 16;
+            break;
+        }
+
+        switch(printOptions.numberUpLayout)
+        {
+        case PrintOptions::BottomTopLeftRight:
+            num_options = cupsAddOption("number-up-layout", "btlr", num_options, &options);
+            break;
+        case PrintOptions::BottomTopRightLeft:
+            num_options = cupsAddOption("number-up-layout", "btrl", num_options, &options);
+            break;
+        case PrintOptions::LeftRightBottomTop:
+            num_options = cupsAddOption("number-up-layout", "lrbt", num_options, &options);
+            break;
+        case PrintOptions::LeftRightTopBottom:
+            num_options = cupsAddOption("number-up-layout", "lrtb", num_options, &options);
+            break;
+        case PrintOptions::RightLeftBottomTop:
+            num_options = cupsAddOption("number-up-layout", "rlbt", num_options, &options);
+            break;
+        case PrintOptions::RightLeftTopBottom:
+            num_options = cupsAddOption("number-up-layout", "rltb", num_options, &options);
+            break;
+        case PrintOptions::TopBottomLeftRight:
+            num_options = cupsAddOption("number-up-layout", "tblr", num_options, &options);
+            break;
+        case PrintOptions::TopBottomRightLeft:
+            num_options = cupsAddOption("number-up-layout", "tbrl", num_options, &options);
+            break;
+        }
+
+        switch(printOptions.pageSet)
+        {
+        case PrintOptions::AllPages:
+            break;
+        case PrintOptions::EvenPages:
+            num_options = cupsAddOption("page-set", "even", num_options, &options);
+            break;
+        case PrintOptions::OddPages:
+            num_options = cupsAddOption("page-set", "odd", num_options, &options);
+            break;
+        }
+
+#else // QT_VERSION
+
+        {
+            bool ok = false;
+            int value = QString::fromLocal8Bit(cupsGetOption("number-up", num_options, options)).toInt(&ok);
+
+            numberUp = ok ? value : 1;
+        }
+
+#endif // QT_VERSION
+
+        fromPage = (fromPage - 1) / numberUp + 1;
+        toPage = (toPage - 1) / numberUp + 1;
+
+        if(printOptions.pageRanges.isEmpty())
+        {
+            num_options = cupsAddOption("page-ranges", QString("%1-%2").arg(fromPage).arg(toPage).toLocal8Bit(), num_options, &options);
+        }
+        else
+        {
+            num_options = cupsAddOption("page-ranges", printOptions.pageRanges.toLocal8Bit(), num_options, &options);
+        }
+
+        QTemporaryFile temporaryFile;
+
+        if(temporaryFile.open())
+        {
+            temporaryFile.close();
+
+            if(m_document->save(temporaryFile.fileName(), true))
+            {
+                jobId = cupsPrintFile(dest->name, temporaryFile.fileName().toLocal8Bit(), m_fileInfo.completeBaseName().toLocal8Bit(), num_options, options);
+
+                if(jobId < 1)
+                {
+                    qWarning() << cupsLastErrorString();
+                }
+            }
+        }
+    }
+    else
+    {
+        qWarning() << cupsLastErrorString();
+    }
+
+    cupsFreeDests(num_dests, dests);
+    cupsFreeOptions(num_options, options);
+
+    return jobId >= 1;
+}
+
+#endif // WITH_CUPS
+
+bool DocumentView::printUsingQt(QPrinter* printer, const PrintOptions& printOptions, int fromPage, int toPage)
+{
+    QScopedPointer< QProgressDialog > progressDialog(new QProgressDialog(this));
+    progressDialog->setLabelText(tr("Printing '%1'...").arg(m_fileInfo.completeBaseName()));
+    progressDialog->setRange(fromPage - 1, toPage);
+
+    const int resolutionX = printer->physicalDpiX();
+    const int resolutionY = printer->physicalDpiY();
+
+    // Upcoming bands are rasterized by the render scheduler while the painter consumes them in order,
+    // so that peak memory is bounded by the number of render threads independently of page size and resolution.
+
+    const int maximumQueueLength = qMax(RenderScheduler::instance()->maxThreadCount(), 1);
+
+    QSharedPointer< QAtomicInt > cancellation(new QAtomicInt(0));
+
+    QList< QFuture< QImage > > queue;
+
+    int nextIndex = fromPage - 1;
+    int nextTop = 0;
+
+    QFutureWatcher< QImage > watcher;
+
+    QPainter painter(printer);
+
+    bool wasCanceled = false;
+
+    for(int index = fromPage - 1; index <= toPage - 1; ++index)
+    {
+        progressDialog->setValue(index);
+
+        painter.save();
+
+        const Model::Page* page = m_pages.at(index);
+
+        if(printOptions.fitToPage)
+        {
+            const qreal pageWidth = printer->physicalDpiX() / 72.0 * page->size().width();
+            const qreal pageHeight = printer->physicalDpiY() / 72.0 * page->size().width();
+
+            const qreal scaleFactor = qMin(printer->width() / pageWidth, printer->height() / pageHeight);
+
+            painter.setTransform(QTransform::fromScale(scaleFactor, scaleFactor));
+        }
+        else
+        {
+            const qreal scaleFactorX = static_cast< qreal >(printer->logicalDpiX()) / static_cast< qreal >(printer->physicalDpiX());
+            const qreal scaleFactorY = static_cast< qreal >(printer->logicalDpiY()) / static_cast< qreal >(printer->physicalDpiY());
+
+            painter.setTransform(QTransform::fromScale(scaleFactorX, scaleFactorY));
+        }
+
+        const QSize size = printSize(page, resolutionX, resolutionY);
+
+        for(int top = 0; top < size.height(); )
+        {
+            while(nextIndex <= toPage - 1 && queue.count() < maximumQueueLength)
+            {
+                const Model::Page* nextPage = m_pages.at(nextIndex);
+                const QSize nextSize = printSize(nextPage, resolutionX, resolutionY);
+                const QRect nextBand = printBand(nextSize, nextTop);
+
+                queue.append(scheduleRun< QImage >(PrintBand(nextPage, resolutionX, resolutionY, cancellation), nextBand, RenderScheduler::PrintPriority, this));
+
+                nextTop = nextBand.bottom() + 1;
+
+                if(nextTop >= nextSize.height())
+                {
+                    ++nextIndex;
+                    nextTop = 0;
+                }
+            }
+
+            watcher.setFuture(queue.first());
+
+            // The watcher wakes the event loop when the band is ready, so that the progress dialog stays responsive meanwhile.
+
+            while(!watcher.isFinished() && !progressDialog->wasCanceled())
+            {
+                QApplication::processEvents(QEventLoop::AllEvents | QEventLoop::WaitForMoreEvents);
+            }
+
+            if(progressDialog->wasCanceled())
+            {
+                wasCanceled = true;
+
+                break;
+            }
+
+            watcher.setFuture(QFuture< QImage >());
+
+            painter.drawImage(QPointF(0.0, top), queue.takeFirst().result());
+
+            top = printBand(size, top).bottom() + 1;
+        }
+
+        painter.restore();
+
+        if(wasCanceled)
+        {
+            break;
+        }
+
+        if(index < toPage - 1)
+        {
+            printer->newPage();
+        }
+
+        QApplication::processEvents();
+
+        if(progressDialog->wasCanceled())
+        {
+            wasCanceled = true;
+
+            break;
+        }
+    }
+
+    if(wasCanceled)
+    {
+        cancellation->fetchAndStoreOrdered(1);
+
+        printer->abort();
+    }
+
+    // Pending bands still refer to the document, but were canceled above and hence finish quickly.
+
+    foreach(QFuture< QImage > future, queue)
+    {
+        future.waitForFinished();
+    }
+
+    return !wasCanceled;
+}
+
+void DocumentView::saveLeftAndTop(qreal& left, qreal& top) const
+{
+    if(m_currentPage < 1 || m_currentPage > m_pagePositions.count())
+    {
+        return;
+    }
+
+    const QRectF boundingRect = pageRect(m_currentPage - 1);
+    const QPointF topLeft = mapToScene(viewport()->rect().topLeft());
+
+    left = (topLeft.x() - boundingRect.x()) / boundingRect.width();
+    top = (topLeft.y() - boundingRect.y()) / boundingRect.height();
+}
+
+bool DocumentView::checkDocument(const QString& filePath, Model::Document* document, QVector< Model::Page* >& pages)
+{
+    if(document->isLocked())
+    {
+        QString password = QInputDialog::getText(this, tr("Unlock %1").arg(QFileInfo(filePath).completeBaseName()), tr("Password:"), QLineEdit::Password);
+
+        if(document->unlock(password))
+        {
+            return false;
+        }
+    }
+
+    return createPages(filePath, document, pages);
+}
+
+bool DocumentView::createPages(const QString& filePath, Model::Document* document, QVector< Model::Page* >& pages)
+{
+    const int numberOfPages = document->numberOfPages();
+
+    if(numberOfPages == 0)
+    {
+        qWarning() << "No pages were found in document at" << filePath;
+
+        return false;
+    }
+
+    pages.reserve(numberOfPages);
+
+    // Only the first page is created up front, the others are created on demand and their sizes are estimated until then.
+
+    QSizeF sizeHint;
+
+    QByteArray pageGeometry = Database::instance()->restorePageGeometry(QFileInfo(filePath));
+    QDataStream pageGeometryStream(&pageGeometry, QIODevice::ReadOnly);
+
+    int numberOfGeometries = 0;
+    pageGeometryStream >> numberOfGeometries;
+
+    if(numberOfGeometries != numberOfPages)
+    {
+        pageGeometryStream.setStatus(QDataStream::ReadCorruptData);
+    }
+
+    for(int index = 0; index < numberOfPages; ++index)
+    {
+        const QSizeF pageSizeHint = document->pageSizeHint(index);
+
+        LazyPage* page = new LazyPage(document, index, pageSizeHint.isValid() ? pageSizeHint : sizeHint);
+
+        pages.append(page);
+
+        page->setFilePath(filePath);
+
+        QSizeF size;
+        QString label;
+        QRectF cropRect;
+
+        pageGeometryStream >> size >> label >> cropRect;
+
+        if(pageGeometryStream.status() == QDataStream::Ok)
+        {
+            page->setHints(size, label, cropRect);
+        }
+
+        if(index == 0)
+        {
+            if(!page->create())
+            {
+                qWarning() << "No page" << index << "was found in document at" << filePath;
+
+                return false;
+            }
+
+            sizeHint = page->size();
+        }
+    }
+
+    return true;
+}
+
+QByteArray DocumentView::savePageGeometry() const
+{
+    QByteArray pageGeometry;
+
+    if(m_pages.isEmpty())
+    {
+        return pageGeometry;
+    }
+
+    QDataStream pageGeometryStream(&pageGeometry, QIODevice::WriteOnly);
+
+    pageGeometryStream << m_pages.count();
+
+    for(int index = 0; index < m_pages.count(); ++index)
+    {
+        const LazyPage* page = static_cast< const LazyPage* >(m_pages.at(index));
+        const PageItem* pageItem = m_pageItems.at(index);
+
+        QRectF cropRect = pageItem != 0 ? rotateCropRect(pageItem->cropRect(), -90.0 * pageItem->rotation()) : m_pageCropRects.at(index);
+
+        if(cropRect.isNull())
+        {
+            cropRect = page->cropRectHint();
+        }
+
+        pageGeometryStream << page->knownSize() << page->knownLabel() << cropRect;
+    }
+
+    return pageGeometry;
+}
+
+void DocumentView::loadOutline()
+{
+    QStandardItemModel outlineModel;
+
+    m_document->loadOutline(&outlineModel);
+
+    m_outlineModel->takeOutline(&outlineModel);
+}
+
+void DocumentView::loadFallbackOutline()
+{
+    m_outlineModel->clear();
+
+    for(int page = 1; page <= m_pages.count(); ++page)
+    {
+        QStandardItem* item = new QStandardItem(tr("Page %1").arg(pageLabelFromNumber(page)));
+        item->setFlags(Qt::ItemIsEnabled | Qt::ItemIsSelectable);
+
+        item->setData(page, Qt::UserRole + 1);
+
+        QStandardItem* pageItem = item->clone();
+        pageItem->setText(QString::number(page));
+        pageItem->setTextAlignment(Qt::AlignRight);
+
+        m_outlineModel->appendRow(QList< QStandardItem* >() << item << pageItem);
+    }
+
+    m_outlineModel->invisibleRootItem()->setData(true); // Flags this as a fallback outline.
+}
+
+void DocumentView::loadDocumentDefaults()
+{
+    if(m_document->wantsContinuousMode())
+    {
+        m_continuousMode = true;
+    }
 
-#ifdef WITH_CUPS
+    if(m_document->wantsSinglePageMode())
+    {
+        m_layout.reset(new SinglePageLayout);
+    }
+    else if(m_document->wantsTwoPagesMode())
+    {
+        m_layout.reset(new TwoPagesLayout);
+    }
+    else if(m_document->wantsTwoPagesWithCoverPageMode())
+    {
+        m_layout.reset(new TwoPagesWithCoverPageLayout);
+    }
 
-bool DocumentView::printUsingCUPS(QPrinter* printer, const PrintOptions& printOptions, int fromPage, int toPage)
+    if(m_document->wantsRightToLeftMode())
+    {
+        m_rightToLeftMode = true;
+    }
+}
+
+void DocumentView::adjustScrollBarPolicy()
 {
-    int num_dests = 0;
-    cups_dest_t* dests = 0;
+    switch(m_scaleMode)
+    {
+    default:
+    case ScaleFactorMode:
+        setHorizontalScrollBarPolicy(Qt::ScrollBarAsNeeded);
+        setVerticalScrollBarPolicy(Qt::ScrollBarAsNeeded);
+        break;
+    case FitToPageWidthMode:
+        setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+        setVerticalScrollBarPolicy(Qt::ScrollBarAsNeeded);
+        break;
+    case FitToPageSizeMode:
+        setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+        setVerticalScrollBarPolicy(m_continuousMode ? Qt::ScrollBarAsNeeded : Qt::ScrollBarAlwaysOff);
+        break;
+    }
+}
 
-    int num_options = 0;
-    cups_option_t* options = 0;
+void DocumentView::waitForModels()
+{
+    m_modelsWatcher->waitForFinished();
 
-    cups_dest_t* dest = 0;
-    int jobId = 0;
+    if(m_modelsWatcher->future().resultCount() > 0)
+    {
+        const Models models = m_modelsWatcher->result();
 
-    num_dests = cupsGetDests(&dests);
+        delete models.first;
+        delete models.second;
+    }
 
-    dest = cupsGetDest(printer->printerName().toLocal8Bit(), 0, num_dests, dests);
+    m_modelsWatcher->setFuture(QFuture< Models >());
+}
 
-    if(dest != 0)
+void DocumentView::startFingerprints()
+{
+    QVector< Model::Page* > pages;
+    pages.reserve(m_pages.count());
+
+    m_fingerprintsOrder.clear();
+    m_fingerprintsOrder.reserve(m_pages.count());
+
+    const int firstVisible = qMax(m_visiblePages.first, 0);
+    const int lastVisible = qMin(m_visiblePages.second, m_pages.count() - 1);
+
+    for(int index = firstVisible; index <= lastVisible; ++index)
     {
-        for(int index = 0; index < dest->num_options; ++index)
+        m_fingerprintsOrder.append(index);
+    }
+
+    for(int index = 0; index < m_pages.count(); ++index)
+    {
+        if(index < firstVisible || index > lastVisible)
         {
-            num_options = cupsAddOption(dest->options[index].name, dest->options[index].value, num_options, &options);
+            m_fingerprintsOrder.append(index);
         }
+    }
 
-        QStringList cupsOptions = printer->printEngine()->property(QPrintEngine::PrintEnginePropertyKey(0xfe00)).toStringList();
+    foreach(int index, m_fingerprintsOrder)
+    {
+        pages.append(m_pages.at(index));
+    }
 
-        for(int index = 0; index < cupsOptions.count() - 1; index += 2)
-        {
-            num_options = cupsAddOption(cupsOptions.at(index).toLocal8Bit(), cupsOptions.at(index + 1).toLocal8Bit(), num_options, &options);
-        }
+    m_fingerprintsWatcher->setFuture(scheduleMapped< QByteArray >(pages, pageFingerprint, RenderScheduler::BackgroundPriority, this));
+}
 
-#if QT_VERSION >= QT_VERSION_CHECK(4,7,0)
+void DocumentView::cancelFingerprints()
+{
+    m_fingerprintsWatcher->cancel();
+    m_fingerprintsWatcher->waitForFinished();
 
-        num_options = cupsAddOption("copies", QString::number(printer->copyCount()).toLocal8Bit(), num_options, &options);
+    m_fingerprintsWatcher->setFuture(QFuture< QByteArray >());
 
-#endif // QT_VERSION
+    m_fingerprintsOrder.clear();
+    m_fingerprints.clear();
+    m_previousFingerprints.clear();
+}
 
-        num_options = cupsAddOption("Collate", printer->collateCopies() ? "true" : "false", num_options, &options);
+void DocumentView::replaceDocument(Model::Document* document, const QVector< Model::Page* >& pages)
+{
+    m_prefetchTimer->blockSignals(true);
+    m_prefetchTimer->stop();
 
-        switch(printer->pageOrder())
-        {
-        case QPrinter::FirstPageFirst:
-            num_options = cupsAddOption("outputorder", "normal", num_options, &options);
-            break;
-        case QPrinter::LastPageFirst:
-            num_options = cupsAddOption("outputorder", "reverse", num_options, &options);
-            break;
-        }
+    cancelSearch();
+    clearResults();
 
-        num_options = cupsAddOption("fit-to-page", printOptions.fitToPage ? "true" : "false", num_options, &options);
+    waitForModels();
+    cancelTextIndex();
+    cancelFonts();
 
-        switch(printer->orientation())
-        {
-        case QPrinter::Portrait:
-            num_options = cupsAddOption("landscape", "false", num_options, &options);
-            break;
-        case QPrinter::Landscape:
-            num_options = cupsAddOption("landscape", "true", num_options, &options);
-            break;
-        }
+    const QByteArray documentKey = DiskCache::documentKey(m_fileInfo);
 
-        switch(printer->colorMode())
-        {
-        case QPrinter::Color:
-            num_options = addCMYKorRGBColorModel(dest, num_options, &options);
-            break;
-        case QPrinter::GrayScale:
-            num_options = cupsAddOption("ColorModel", "Gray", num_options, &options);
-            break;
-        }
+    // The pixmaps of pages which are not materialized are not carried over.
 
-        switch(printer->duplex())
-        {
-        case QPrinter::DuplexNone:
-            num_options = cupsAddOption("sides", "one-sided", num_options, &options);
-            break;
-        case QPrinter::DuplexAuto:
-            break;
-        case QPrinter::DuplexLongSide:
-            num_options = cupsAddOption("sides", "two-sided-long-edge", num_options, &options);
-            break;
-        case QPrinter::DuplexShortSide:
-            num_options = cupsAddOption("sides", "two-sided-short-edge", num_options, &options);
-            break;
-        }
+    foreach(int index, m_retainedPages)
+    {
+        PageItem::releaseCachedPixmaps(m_documentKey, index);
+    }
 
-        int numberUp = 1;
+    m_retainedPages.clear();
+    m_documentKey = documentKey;
 
-#if QT_VERSION < QT_VERSION_CHECK(5,2,0)
+    // Pages keep their pixmaps unless their size changed until their new fingerprint shows that they changed as well.
 
-        switch(printOptions.numberUp)
+    for(int index = 0; index < pages.count(); ++index)
+    {
+        if(m_pageItems.at(index) == 0 && m_thumbnailItems.at(index) == 0)
         {
-        case PrintOptions::SinglePage:
-            num_options = cupsAddOption("number-up", "1", num_options, &options);
-            numberUp = 1;
-            break;
-        case PrintOptions::TwoPages:
-            num_options = cupsAddOption("number-up", "2", num_options, &options);
-            numberUp = 2;
-            break;
-        case PrintOptions::FourPages:
-            num_options = cupsAddOption("number-up", "4", num_options, &options);
-            numberUp = 4;
-            break;
-        case PrintOptions::SixPages:
-            num_options = cupsAddOption("number-up", "6", num_options, &options);
-            numberUp = 6;
-            break;
-        case PrintOptions::NinePages:
-            num_options = cupsAddOption("number-up", "9", num_options, &options);
-            numberUp = 9;
-            break;
-        case PrintOptions::SixteenPages:
-            num_options = cupsAddOption("number-up", "16", num_options, &options);
-            numberUp = 16;
-            break;
+            continue;
         }
 
-        switch(printOptions.numberUpLayout)
+        const bool changed = pages.at(index)->size() != m_pages.at(index)->size();
+
+        if(m_pageItems.at(index) != 0)
         {
-        case PrintOptions::BottomTopLeftRight:
-            num_options = cupsAddOption("number-up-layout", "btlr", num_options, &options);
-            break;
-        case PrintOptions::BottomTopRightLeft:
-            num_options = cupsAddOption("number-up-layout", "btrl", num_options, &options);
-            break;
-        case PrintOptions::LeftRightBottomTop:
-            num_options = cupsAddOption("number-up-layout", "lrbt", num_options, &options);
-            break;
-        case PrintOptions::LeftRightTopBottom:
-            num_options = cupsAddOption("number-up-layout", "lrtb", num_options, &options);
-            break;
-        case PrintOptions::RightLeftBottomTop:
-            num_options = cupsAddOption("number-up-layout", "rlbt", num_options, &options);
-            break;
-        case PrintOptions::RightLeftTopBottom:
-            num_options = cupsAddOption("number-up-layout", "rltb", num_options, &options);
-            break;
-        case PrintOptions::TopBottomLeftRight:
-            num_options = cupsAddOption("number-up-layout", "tblr", num_options, &options);
-            break;
-        case PrintOptions::TopBottomRightLeft:
-            num_options = cupsAddOption("number-up-layout", "tbrl", num_options, &options);
-            break;
+            m_pageItems.at(index)->setPage(pages.at(index), documentKey, changed);
         }
 
-        switch(printOptions.pageSet)
+        if(m_thumbnailItems.at(index) != 0)
         {
-        case PrintOptions::AllPages:
-            break;
-        case PrintOptions::EvenPages:
-            num_options = cupsAddOption("page-set", "even", num_options, &options);
-            break;
-        case PrintOptions::OddPages:
-            num_options = cupsAddOption("page-set", "odd", num_options, &options);
-            break;
+            m_thumbnailItems.at(index)->setPage(pages.at(index), documentKey, changed);
         }
+    }
+
+    m_previousFingerprints = m_fingerprints;
+    m_fingerprints.clear();
+
+    DocumentRegistry::instance()->release(m_document, m_pages);
+
+    m_pages = pages;
+    m_document = document;
+
+    startFingerprints();
+
+    prepareAutoRefresh();
+
+    preparePaperColor();
+
+    loadOutline();
+    m_document->loadProperties(m_propertiesModel);
+
+    if(m_outlineModel->rowCount() == 0)
+    {
+        loadFallbackOutline();
+    }
+
+    prepareTextIndex();
+
+#ifdef WITH_SYNCTEX
+
+    prepareSyncTeX();
+
+#endif // WITH_SYNCTEX
+
+    if(s_settings->documentView().prefetch())
+    {
+        m_prefetchTimer->blockSignals(false);
+        m_prefetchTimer->start();
+    }
+}
+
+void DocumentView::cancelTextIndex()
+{
+    m_textIndexWatcher->cancel();
+    m_textIndexWatcher->waitForFinished();
+
+    m_textIndexWatcher->setFuture(QFuture< QString >());
+
+    m_textIndex = TextIndex();
+}
+
+void DocumentView::cancelFonts()
+{
+    m_fontsWatcher->cancel();
+    m_fontsWatcher->waitForFinished();
+
+    m_fontsWatcher->setFuture(QFuture< QSharedPointer< QStandardItemModel > >());
+
+    m_fontsModel->clear();
+    m_fontsPrepared = false;
+    m_fontKeys.clear();
+}
+
+void DocumentView::prepareFonts()
+{
+    m_fontsPrepared = true;
+
+    if(m_document == 0)
+    {
+        return;
+    }
+
+    QList< int > beginIndices;
+
+    for(int beginIndex = 0; beginIndex < m_pages.count(); beginIndex += fontsPageCount)
+    {
+        beginIndices.append(beginIndex);
+    }
+
+    m_fontsWatcher->setFuture(scheduleMapped< QSharedPointer< QStandardItemModel > >(beginIndices, FontsLoader(m_document, m_pages.count()), RenderScheduler::BackgroundPriority, this));
+}
+
+void DocumentView::prepareTextIndex()
+{
+    if(!s_settings->documentView().indexText())
+    {
+        return;
+    }
+
+    m_textIndex = TextIndex::restore(Database::instance()->restoreTextIndex(m_fileInfo), m_pages.count());
+
+    if(m_textIndex.isEmpty())
+    {
+        m_textIndexWatcher->setFuture(scheduleMapped< QString >(m_pages, TextIndex::pageText, RenderScheduler::BackgroundPriority, this));
+    }
+}
 
-#else // QT_VERSION
+#ifdef WITH_SYNCTEX
 
-        {
-            bool ok = false;
-            int value = QString::fromLocal8Bit(cupsGetOption("number-up", num_options, options)).toInt(&ok);
+void DocumentView::prepareSyncTeX()
+{
+    releaseSyncTeX();
 
-            numberUp = ok ? value : 1;
-        }
+    if(SyncTeXScanner::hasData(m_fileInfo.absoluteFilePath()))
+    {
+        m_syncTeXScannerJob = QtConcurrent::run(loadSyncTeXScanner, m_fileInfo.absoluteFilePath());
+    }
+}
 
-#endif // QT_VERSION
+void DocumentView::releaseSyncTeX()
+{
+    // A job which is still running frees its scanner itself once it is done.
 
-        fromPage = (fromPage - 1) / numberUp + 1;
-        toPage = (toPage - 1) / numberUp + 1;
+    m_syncTeXScannerJob = QFuture< QSharedPointer< SyncTeXScanner > >();
+    m_syncTeXScanner.clear();
+}
 
-        if(printOptions.pageRanges.isEmpty())
-        {
-            num_options = cupsAddOption("page-ranges", QString("%1-%2").arg(fromPage).arg(toPage).toLocal8Bit(), num_options, &options);
-        }
-        else
-        {
-            num_options = cupsAddOption("page-ranges", printOptions.pageRanges.toLocal8Bit(), num_options, &options);
-        }
+QSharedPointer< SyncTeXScanner > DocumentView::syncTeXScanner()
+{
+    if(!m_syncTeXScannerJob.isCanceled())
+    {
+        m_syncTeXScanner = m_syncTeXScannerJob.result();
 
-        QTemporaryFile temporaryFile;
+        m_syncTeXScannerJob = QFuture< QSharedPointer< SyncTeXScanner > >();
+    }
 
-        if(temporaryFile.open())
-        {
-            temporaryFile.close();
+    // The data is parsed again if it changed without the document being refreshed or if it appeared only after opening.
 
-            if(m_document->save(temporaryFile.fileName(), true))
-            {
-                jobId = cupsPrintFile(dest->name, temporaryFile.fileName().toLocal8Bit(), m_fileInfo.completeBaseName().toLocal8Bit(), num_options, options);
+    if(m_syncTeXScanner.isNull() || m_syncTeXScanner->isOutdated())
+    {
+        m_syncTeXScanner = loadSyncTeXScanner(m_fileInfo.absoluteFilePath());
+    }
 
-                if(jobId < 1)
-                {
-                    qWarning() << cupsLastErrorString();
-                }
-            }
-        }
+    return m_syncTeXScanner;
+}
+
+#endif // WITH_SYNCTEX
+
+void DocumentView::prepareAutoRefresh()
+{
+    if(s_settings->documentView().autoRefresh())
+    {
+        m_autoRefreshDetector->watch(m_fileInfo.filePath());
     }
     else
     {
-        qWarning() << cupsLastErrorString();
+        m_autoRefreshDetector->unwatch();
     }
+}
 
-    cupsFreeDests(num_dests, dests);
-    cupsFreeOptions(num_options, options);
+void DocumentView::preparePaperColor()
+{
+    const QColor paperColor = s_settings->pageItem().paperColor();
 
-    return jobId >= 1;
-}
+    m_document->setPaperColor(paperColor);
 
-#endif // WITH_CUPS
+    foreach(Model::Page* page, m_pages)
+    {
+        static_cast< LazyPage* >(page)->setPaperColor(paperColor);
+    }
+}
 
-bool DocumentView::printUsingQt(QPrinter* printer, const PrintOptions& printOptions, int fromPage, int toPage)
+void DocumentView::prepareDocument(Model::Document* document, const QVector< Model::Page* >& pages, bool loadModelsInBackground)
 {
-    QScopedPointer< QProgressDialog > progressDialog(new QProgressDialog(this));
-    progressDialog->setLabelText(tr("Printing '%1'...").arg(m_fileInfo.completeBaseName()));
-    progressDialog->setRange(fromPage - 1, toPage);
+    m_prefetchTimer->blockSignals(true);
+    m_prefetchTimer->stop();
 
-    QPainter painter(printer);
+    cancelSearch();
+    clearResults();
 
-    for(int index = fromPage - 1; index <= toPage - 1; ++index)
-    {
-        progressDialog->setValue(index);
+    waitForModels();
+    cancelFingerprints();
+    cancelTextIndex();
+    cancelFonts();
 
-        QApplication::processEvents();
+    releasePageItems();
+    qDeleteAll(m_thumbnailItems);
 
-        painter.save();
+    DocumentRegistry::instance()->release(m_document, m_pages);
 
-        const Model::Page* page = m_pages.at(index);
+    m_document = document;
+    m_pages = pages;
 
-        if(printOptions.fitToPage)
-        {
-            const qreal pageWidth = printer->physicalDpiX() / 72.0 * page->size().width();
-            const qreal pageHeight = printer->physicalDpiY() / 72.0 * page->size().width();
+    prepareAutoRefresh();
 
-            const qreal scaleFactor = qMin(printer->width() / pageWidth, printer->height() / pageHeight);
+    preparePaperColor();
 
-            painter.setTransform(QTransform::fromScale(scaleFactor, scaleFactor));
-        }
-        else
-        {
-            const qreal scaleFactorX = static_cast< qreal >(printer->logicalDpiX()) / static_cast< qreal >(printer->physicalDpiX());
-            const qreal scaleFactorY = static_cast< qreal >(printer->logicalDpiY()) / static_cast< qreal >(printer->physicalDpiY());
+    preparePages();
+    prepareThumbnails();
+    prepareBackground();
 
-            painter.setTransform(QTransform::fromScale(scaleFactorX, scaleFactorY));
-        }
+    if(isVisible())
+    {
+        prepareForeground();
+    }
 
-        painter.drawImage(QPointF(), page->render(printer->physicalDpiX(), printer->physicalDpiY()));
+    if(loadModelsInBackground)
+    {
+        m_outlineModel->clear();
+        m_propertiesModel->clear();
 
-        painter.restore();
+        m_modelsWatcher->setFuture(QtConcurrent::run(loadModels, m_document));
+    }
+    else
+    {
+        loadOutline();
+        m_document->loadProperties(m_propertiesModel);
 
-        if(index < toPage - 1)
+        if(m_outlineModel->rowCount() == 0)
         {
-            printer->newPage();
+            loadFallbackOutline();
         }
+    }
 
-        QApplication::processEvents();
-
-        if(progressDialog->wasCanceled())
-        {
-            printer->abort();
+    // Fingerprints are only needed to find the pages which changed when the document is refreshed automatically.
 
-            return false;
-        }
+    if(s_settings->documentView().autoRefresh())
+    {
+        startFingerprints();
     }
 
-    return true;
+    prepareTextIndex();
+
+#ifdef WITH_SYNCTEX
+
+    prepareSyncTeX();
+
+#endif // WITH_SYNCTEX
+
+    if(s_settings->documentView().prefetch())
+    {
+        m_prefetchTimer->blockSignals(false);
+        m_prefetchTimer->start();
+    }
 }
 
-void DocumentView::saveLeftAndTop(qreal& left, qreal& top) const
+void DocumentView::preparePages()
 {
-    const PageItem* page = m_pageItems.at(m_currentPage - 1);
+    // Page items are created on demand by preparePageItems.
 
-    const QRectF boundingRect = page->boundingRect().translated(page->pos());
-    const QPointF topLeft = mapToScene(viewport()->rect().topLeft());
+    m_pageItems.fill(0, m_pages.count());
+    m_pageBoundingRects.fill(QRectF(), m_pages.count());
+    m_pagePositions.fill(QPointF(), m_pages.count());
+    m_pageCropRects.fill(QRectF(), m_pages.count());
+    m_pageScaleFactors.fill(1.0, m_pages.count());
 
-    left = (topLeft.x() - boundingRect.x()) / boundingRect.width();
-    top = (topLeft.y() - boundingRect.y()) / boundingRect.height();
+    m_documentKey = DiskCache::documentKey(m_fileInfo);
+
+    if(s_settings->pageItem().trimMargins())
+    {
+        for(int index = 0; index < m_pages.count(); ++index)
+        {
+            m_pageCropRects[index] = static_cast< const LazyPage* >(m_pages.at(index))->cropRectHint();
+        }
+    }
 }
 
-bool DocumentView::checkDocument(const QString& filePath, Model::Document* document, QVector< Model::Page* >& pages)
+PageItem* DocumentView::pageItem(int index)
 {
-    if(document->isLocked())
+    PageItem*& page = m_pageItems[index];
+
+    if(page == 0)
     {
-        QString password = QInputDialog::getText(this, tr("Unlock %1").arg(QFileInfo(filePath).completeBaseName()), tr("Password:"), QLineEdit::Password);
+        page = createPageItem(index);
 
-        if(document->unlock(password))
+        m_materializedPages.insert(index);
+
+        if(m_retainedPages.remove(index))
         {
-            return false;
+            PageItem::releaseCachedPixmaps(m_documentKey, index);
         }
     }
 
-    const int numberOfPages = document->numberOfPages();
+    return page;
+}
 
-    if(numberOfPages == 0)
-    {
-        qWarning() << "No pages were found in document at" << filePath;
+PageItem* DocumentView::createPageItem(int index)
+{
+    PageItem* page = new PageItem(m_pages.at(index), index);
 
-        return false;
+    page->setDocumentKey(m_documentKey);
+    page->setInvertColors(m_invertColors);
+    page->setConvertToGrayscale(m_convertToGrayscale);
+    page->setRubberBandMode(m_rubberBandMode);
+
+    if(m_highlightAll)
+    {
+        page->setHighlights(s_searchModel->resultsOnPage(this, index + 1));
     }
 
-    pages.reserve(numberOfPages);
+#if QT_VERSION >= QT_VERSION_CHECK(5,1,0)
 
-    for(int index = 0; index < numberOfPages; ++index)
-    {
-        Model::Page* page = document->page(index);
+    page->setDevicePixelRatio(devicePixelRatio());
 
-        if(page == 0)
-        {
-            qWarning() << "No page" << index << "was found in document at" << filePath;
+#endif // QT_VERSION
 
-            return false;
-        }
+    page->setResolution(logicalDpiX(), logicalDpiY());
+    page->setRotation(m_rotation);
 
-        pages.append(page);
+    if(s_settings->pageItem().trimMargins())
+    {
+        page->setCropRect(rotateCropRect(m_pageCropRects.at(index), 90.0 * m_rotation));
     }
 
-    return true;
+    page->setScaleFactor(m_pageScaleFactors.at(index));
+
+    page->setPos(m_pagePositions.at(index));
+    page->setVisible(m_continuousMode || m_layout->leftIndex(index) == m_currentPage - 1);
+
+    scene()->addItem(page);
+
+    connect(page, SIGNAL(cropRectChanged()), SLOT(on_pages_cropRectChanged()));
+
+    connect(page, SIGNAL(linkClicked(bool,int,qreal,qreal)), SLOT(on_pages_linkClicked(bool,int,qreal,qreal)));
+    connect(page, SIGNAL(linkClicked(bool,QString,int)), SLOT(on_pages_linkClicked(bool,QString,int)));
+    connect(page, SIGNAL(linkClicked(QString)), SLOT(on_pages_linkClicked(QString)));
+    connect(page, SIGNAL(linkPreloadRequested(QString,int,bool)), SLOT(on_pages_linkPreloadRequested(QString,int,bool)));
+
+    connect(page, SIGNAL(rubberBandFinished()), SLOT(on_pages_rubberBandFinished()));
+
+    connect(page, SIGNAL(editSourceRequested(int,QPointF)), SLOT(on_pages_editSourceRequested(int,QPointF)));
+    connect(page, SIGNAL(zoomToSelectionRequested(int,QRectF)), SLOT(on_pages_zoomToSelectionRequested(int,QRectF)));
+
+    connect(page, SIGNAL(wasModified()), SLOT(on_pages_wasModified()));
+
+    return page;
 }
 
-void DocumentView::loadFallbackOutline()
+void DocumentView::deletePageItem(int index)
 {
-    m_outlineModel->clear();
+    PageItem*& page = m_pageItems[index];
 
-    for(int page = 1; page <= m_pages.count(); ++page)
+    if(!page->cropRect().isNull())
     {
-        QStandardItem* item = new QStandardItem(tr("Page %1").arg(pageLabelFromNumber(page)));
-        item->setFlags(Qt::ItemIsEnabled | Qt::ItemIsSelectable);
+        m_pageCropRects[index] = rotateCropRect(page->cropRect(), -90.0 * page->rotation());
+    }
 
-        item->setData(page, Qt::UserRole + 1);
+    // The cached pixmaps are retained so that scrolling back does not render the page again.
 
-        QStandardItem* pageItem = item->clone();
-        pageItem->setText(QString::number(page));
-        pageItem->setTextAlignment(Qt::AlignRight);
+    if(!m_documentKey.isEmpty() && !m_retainedPages.contains(index))
+    {
+        PageItem::retainCachedPixmaps(m_documentKey, index);
 
-        m_outlineModel->appendRow(QList< QStandardItem* >() << item << pageItem);
+        m_retainedPages.insert(index);
     }
 
-    m_outlineModel->invisibleRootItem()->setData(true); // Flags this as a fallback outline.
+    page->cancelRender(true);
+
+    delete page;
+    page = 0;
+
+    m_materializedPages.remove(index);
 }
 
-void DocumentView::loadDocumentDefaults()
+void DocumentView::releasePageItems()
 {
-    if(m_document->wantsContinuousMode())
+    qDeleteAll(m_pageItems);
+    m_pageItems.clear();
+
+    m_materializedPages.clear();
+
+    foreach(int index, m_retainedPages)
     {
-        m_continuousMode = true;
+        PageItem::releaseCachedPixmaps(m_documentKey, index);
     }
 
-    if(m_document->wantsSinglePageMode())
+    m_retainedPages.clear();
+}
+
+void DocumentView::preparePageItems()
+{
+    if(m_pageItems.isEmpty())
     {
-        m_layout.reset(new SinglePageLayout);
+        return;
     }
-    else if(m_document->wantsTwoPagesMode())
+
+    const QRectF visibleRect = mapToScene(viewport()->rect()).boundingRect();
+    const qreal extent = visibleRect.height();
+
+    // Items are created one viewport ahead but only deleted two viewports behind so that scrolling back and forth does not thrash.
+
+    QPair< int, int > createPages = m_layout->pagesBetween(visibleRect.top() - extent, visibleRect.bottom() + extent);
+    createPages.second = qMin(createPages.second, m_pageItems.count() - 1);
+
+    const QPair< int, int > deletePages = m_layout->pagesBetween(visibleRect.top() - 2.0 * extent, visibleRect.bottom() + 2.0 * extent);
+    const QPair< int, int > prefetchRange = m_layout->prefetchRange(m_currentPage, m_pages.count());
+
+    bool changed = false;
+
+    for(int index = createPages.first; index <= createPages.second; ++index)
     {
-        m_layout.reset(new TwoPagesLayout);
+        if(m_pageItems.at(index) == 0)
+        {
+            pageItem(index);
+
+            changed = true;
+        }
     }
-    else if(m_document->wantsTwoPagesWithCoverPageMode())
+
+    // The current page and the pages kept for prefetching are never deleted.
+
+    QList< int > indices;
+
+    foreach(int index, m_materializedPages)
     {
-        m_layout.reset(new TwoPagesWithCoverPageLayout);
+        if((index < deletePages.first || index > deletePages.second)
+                && (index < prefetchRange.first - 1 || index > prefetchRange.second - 1)
+                && m_layout->currentPage(index + 1) != m_currentPage)
+        {
+            indices.append(index);
+        }
     }
 
-    if(m_document->wantsRightToLeftMode())
+    foreach(int index, indices)
     {
-        m_rightToLeftMode = true;
+        deletePageItem(index);
+
+        changed = true;
+    }
+
+    if(changed && isVisible())
+    {
+        prepareForeground();
     }
 }
 
-void DocumentView::adjustScrollBarPolicy()
+void DocumentView::prepareThumbnails()
 {
-    switch(m_scaleMode)
+    // Thumbnail items are created on demand by prepareThumbnailItems.
+
+    m_thumbnailItems.fill(0, m_pages.count());
+    m_thumbnailRects.fill(QRectF(), m_pages.count());
+    m_thumbnailCropRects.fill(QRectF(), m_pages.count());
+
+    if(s_settings->pageItem().trimMargins())
     {
-    default:
-    case ScaleFactorMode:
-        setHorizontalScrollBarPolicy(Qt::ScrollBarAsNeeded);
-        setVerticalScrollBarPolicy(Qt::ScrollBarAsNeeded);
-        break;
-    case FitToPageWidthMode:
-        setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
-        setVerticalScrollBarPolicy(Qt::ScrollBarAsNeeded);
-        break;
-    case FitToPageSizeMode:
-        setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
-        setVerticalScrollBarPolicy(m_continuousMode ? Qt::ScrollBarAsNeeded : Qt::ScrollBarAlwaysOff);
-        break;
+        for(int index = 0; index < m_pages.count(); ++index)
+        {
+            m_thumbnailCropRects[index] = static_cast< const LazyPage* >(m_pages.at(index))->cropRectHint();
+        }
     }
 }
 
-void DocumentView::prepareDocument(Model::Document* document, const QVector< Model::Page* >& pages)
-{
-    m_prefetchTimer->blockSignals(true);
-    m_prefetchTimer->stop();
+ThumbnailItem* DocumentView::createThumbnailItem(int index)
+{
+    ThumbnailItem* page = new ThumbnailItem(m_pages.at(index), pageLabelFromNumber(index + 1), index);
+
+    page->setDocumentKey(m_documentKey);
+    page->setInvertColors(m_invertColors);
+    page->setConvertToGrayscale(m_convertToGrayscale);
+    page->setCropRect(m_thumbnailCropRects.at(index));
+
+    if(m_highlightAll)
+    {
+        page->setHighlights(s_searchModel->resultsOnPage(this, index + 1));
+    }
+
+    page->setHighlighted(s_settings->documentView().highlightCurrentThumbnail() && index == m_currentPage - 1);
+
+#if QT_VERSION >= QT_VERSION_CHECK(5,1,0)
+
+    page->setDevicePixelRatio(devicePixelRatio());
 
-    cancelSearch();
-    clearResults();
+#endif // QT_VERSION
 
-    qDeleteAll(m_pageItems);
-    qDeleteAll(m_thumbnailItems);
+    page->setResolution(logicalDpiX(), logicalDpiY());
 
-    delete m_document;
-    m_document = document;
+    page->setScaleFactor(qMin(s_settings->documentView().thumbnailSize() / page->displayedWidth(),
+                              s_settings->documentView().thumbnailSize() / page->displayedHeight()));
 
-    qDeleteAll(m_pages);
-    m_pages = pages;
+    m_thumbnailsScene->addItem(page);
+
+    connect(page, SIGNAL(cropRectChanged()), SLOT(on_thumbnails_cropRectChanged()));
+
+    connect(page, SIGNAL(linkClicked(bool,int,qreal,qreal)), SLOT(on_pages_linkClicked(bool,int,qreal,qreal)));
+
+    return page;
+}
+
+void DocumentView::updateScrollVelocity(const QRectF& visibleRect)
+{
+    const int scrollValue = verticalScrollBar()->value();
+    const int delta = scrollValue - m_scrollValue;
 
-    if(!m_autoRefreshWatcher->files().isEmpty())
+    const qint64 elapsed = m_scrollTimer.isValid() ? m_scrollTimer.restart() : scrollIdleInterval + 1;
+
+    if(!m_scrollTimer.isValid())
     {
-        m_autoRefreshWatcher->removePaths(m_autoRefreshWatcher->files());
+        m_scrollTimer.start();
     }
 
-    if(s_settings->documentView().autoRefresh())
+    m_scrollValue = scrollValue;
+
+    if(delta == 0)
     {
-        m_autoRefreshWatcher->addPath(m_fileInfo.filePath());
+        return;
     }
 
-    m_document->setPaperColor(s_settings->pageItem().paperColor());
+    const int scrollDirection = delta > 0 ? 1 : -1;
 
-    preparePages();
-    prepareThumbnails();
-    prepareBackground();
+    if(elapsed > scrollIdleInterval)
+    {
+        m_scrollVelocity = 0.0;
+    }
+    else if(scrollDirection != m_scrollDirection)
+    {
+        // Once the user reverses, the tiles prefetched along the abandoned path are no longer wanted.
 
-    m_document->loadOutline(m_outlineModel);
-    m_document->loadProperties(m_propertiesModel);
+        foreach(int index, m_materializedPages)
+        {
+            const QRectF pageRect = this->pageRect(index);
 
-    if(m_outlineModel->rowCount() == 0)
+            if(scrollDirection > 0 ? pageRect.bottom() < visibleRect.top() : pageRect.top() > visibleRect.bottom())
+            {
+                m_pageItems.at(index)->cancelRender(true);
+            }
+        }
+
+        m_scrollVelocity = 0.0;
+    }
+    else
     {
-        loadFallbackOutline();
+        const qreal velocity = delta / static_cast< qreal >(qMax(elapsed, Q_INT64_C(1)));
+
+        m_scrollVelocity = m_scrollVelocity == 0.0 ? velocity : 0.5 * (m_scrollVelocity + velocity);
     }
 
-    if(s_settings->documentView().prefetch())
+    m_scrollDirection = scrollDirection;
+
+    if(qAbs(m_scrollVelocity) >= minimumScrollVelocity)
     {
-        m_prefetchTimer->blockSignals(false);
-        m_prefetchTimer->start();
+        prefetchAlongScroll(visibleRect);
     }
 }
 
-void DocumentView::preparePages()
+void DocumentView::prefetchAlongScroll(const QRectF& visibleRect)
 {
-    m_pageItems.clear();
-    m_pageItems.reserve(m_pages.count());
+    // Page items further ahead than this would be deleted again before they are reached.
 
-    for(int index = 0; index < m_pages.count(); ++index)
-    {
-        PageItem* page = new PageItem(m_pages.at(index), index);
+    const qreal maximumDistance = 2.0 * visibleRect.height();
+    const qreal distance = qBound(-maximumDistance, m_scrollVelocity * scrollPredictionInterval, maximumDistance);
+
+    QRectF predictedRect = visibleRect;
 
-        page->setInvertColors(m_invertColors);
-        page->setRubberBandMode(m_rubberBandMode);
+    if(distance > 0.0)
+    {
+        predictedRect.setTop(visibleRect.bottom());
+        predictedRect.setBottom(visibleRect.bottom() + distance);
+    }
+    else
+    {
+        predictedRect.setBottom(visibleRect.top());
+        predictedRect.setTop(visibleRect.top() + distance);
+    }
 
-        scene()->addItem(page);
-        m_pageItems.append(page);
+    PrefetchPlanner planner(viewport());
 
-        connect(page, SIGNAL(cropRectChanged()), SLOT(on_pages_cropRectChanged()));
+    QPair< int, int > predictedPages = m_layout->pagesBetween(predictedRect.top(), predictedRect.bottom());
+    predictedPages.second = qMin(predictedPages.second, m_pageItems.count() - 1);
 
-        connect(page, SIGNAL(linkClicked(bool,int,qreal,qreal)), SLOT(on_pages_linkClicked(bool,int,qreal,qreal)));
-        connect(page, SIGNAL(linkClicked(bool,QString,int)), SLOT(on_pages_linkClicked(bool,QString,int)));
-        connect(page, SIGNAL(linkClicked(QString)), SLOT(on_pages_linkClicked(QString)));
+    for(int count = 0; count <= predictedPages.second - predictedPages.first; ++count)
+    {
+        const int index = distance > 0.0 ? predictedPages.first + count : predictedPages.second - count;
 
-        connect(page, SIGNAL(rubberBandFinished()), SLOT(on_pages_rubberBandFinished()));
+        if(!pageRect(index).intersects(predictedRect))
+        {
+            continue;
+        }
 
-        connect(page, SIGNAL(editSourceRequested(int,QPointF)), SLOT(on_pages_editSourceRequested(int,QPointF)));
-        connect(page, SIGNAL(zoomToSelectionRequested(int,QRectF)), SLOT(on_pages_zoomToSelectionRequested(int,QRectF)));
+        PageItem* page = pageItem(index);
 
-        connect(page, SIGNAL(wasModified()), SLOT(on_pages_wasModified()));
+        if(!planner.prefetch(page, false, page->mapRectFromScene(predictedRect)))
+        {
+            return;
+        }
     }
 }
 
-void DocumentView::prepareThumbnails()
+void DocumentView::prepareForeground()
 {
-    m_thumbnailItems.clear();
-    m_thumbnailItems.reserve(m_pages.count());
-
-    for(int index = 0; index < m_pages.count(); ++index)
-    {
-        ThumbnailItem* page = new ThumbnailItem(m_pages.at(index), pageLabelFromNumber(index + 1), index);
+    // The pages of the visible tab are exempt from the share of the tile cache granted to background tabs.
 
-        page->setInvertColors(m_invertColors);
+    QVector< PageItem* > pages;
 
-        m_thumbnailsScene->addItem(page);
-        m_thumbnailItems.append(page);
-
-        connect(page, SIGNAL(cropRectChanged()), SLOT(on_thumbnails_cropRectChanged()));
+    foreach(int index, m_materializedPages)
+    {
+        pages.append(m_pageItems.at(index));
+    }
 
-        connect(page, SIGNAL(linkClicked(bool,int,qreal,qreal)), SLOT(on_pages_linkClicked(bool,int,qreal,qreal)));
+    foreach(ThumbnailItem* page, m_thumbnailItems)
+    {
+        if(page != 0)
+        {
+            pages.append(page);
+        }
     }
+
+    TileItem::setForegroundPages(pages);
 }
 
 void DocumentView::prepareBackground()
@@ -2224,39 +4399,95 @@ void DocumentView::prepareBackground()
 
 void DocumentView::prepareScene()
 {
+    // Preparing the scene for any reason settles a pending zoom gesture.
+
+    if(m_zoomGestureTimer->isActive())
+    {
+        m_zoomGestureTimer->stop();
+    }
+
+    resetTransform();
+
+    const TraceSpan span("document", "prepareScene", "pages", m_pages.count());
+
     // prepare scale factor and rotation
 
     const qreal visibleWidth = m_layout->visibleWidth(viewport()->width());
     const qreal visibleHeight = m_layout->visibleHeight(viewport()->height());
 
-    foreach(PageItem* page, m_pageItems)
+    const bool trimMargins = s_settings->pageItem().trimMargins();
+
+    RenderParam renderParam;
+
+    renderParam.resolution.resolutionX = logicalDpiX();
+    renderParam.resolution.resolutionY = logicalDpiY();
+    renderParam.rotation = m_rotation;
+
+    for(int index = 0; index < m_pageItems.count(); ++index)
     {
+        PageItem* page = m_pageItems.at(index);
+
+        // Crop rectangles detected during this session carry over to the rotated page as its tiles might not be rendered again.
+
+        QRectF knownCropRect = m_pageCropRects.at(index);
+
+        if(knownCropRect.isNull())
+        {
+            knownCropRect = static_cast< const LazyPage* >(m_pages.at(index))->cropRectHint();
+        }
+
+        if(page != 0)
+        {
 #if QT_VERSION >= QT_VERSION_CHECK(5,1,0)
 
-        page->setDevicePixelRatio(devicePixelRatio());
+            page->setDevicePixelRatio(devicePixelRatio());
 
 #endif // QT_VERSION
 
-        page->setResolution(logicalDpiX(), logicalDpiY());
+            page->setResolution(logicalDpiX(), logicalDpiY());
+
+            page->setRotation(m_rotation);
+
+            if(trimMargins)
+            {
+                page->setCropRect(rotateCropRect(knownCropRect, 90.0 * m_rotation));
+            }
+        }
+
+        // estimate geometry without materializing the page
 
-        page->setRotation(m_rotation);
+        const QSizeF size = page != 0 ? page->size() : m_pages.at(index)->size();
+        const QRectF cropRect = page != 0 ? page->cropRect() : (trimMargins ? rotateCropRect(knownCropRect, 90.0 * m_rotation) : QRectF());
 
-        const qreal displayedWidth = page->displayedWidth();
-        const qreal displayedHeight = page->displayedHeight();
+        const qreal displayedWidth = PageItem::displayedWidth(size, cropRect, renderParam);
+        const qreal displayedHeight = PageItem::displayedHeight(size, cropRect, renderParam);
 
         switch(m_scaleMode)
         {
         default:
         case ScaleFactorMode:
-            page->setScaleFactor(m_scaleFactor);
+            renderParam.scaleFactor = m_scaleFactor;
             break;
         case FitToPageWidthMode:
-            page->setScaleFactor(visibleWidth / displayedWidth);
+            renderParam.scaleFactor = visibleWidth / displayedWidth;
             break;
         case FitToPageSizeMode:
-            page->setScaleFactor(qMin(visibleWidth / displayedWidth, visibleHeight / displayedHeight));
+            renderParam.scaleFactor = qMin(visibleWidth / displayedWidth, visibleHeight / displayedHeight);
             break;
         }
+
+        m_pageScaleFactors[index] = renderParam.scaleFactor;
+
+        if(page != 0)
+        {
+            page->setScaleFactor(renderParam.scaleFactor);
+
+            m_pageBoundingRects[index] = page->boundingRect();
+        }
+        else
+        {
+            m_pageBoundingRects[index] = PageItem::boundingRect(size, cropRect, renderParam);
+        }
     }
 
     // prepare layout
@@ -2265,9 +4496,18 @@ void DocumentView::prepareScene()
     qreal right = 0.0;
     qreal height = s_settings->documentView().pageSpacing();
 
-    m_layout->prepareLayout(m_pageItems, m_rightToLeftMode,
+    const qint64 layoutBegin = Tracing::timestamp();
+
+    m_layout->prepareLayout(m_pageBoundingRects, m_pagePositions, m_rightToLeftMode,
                             left, right, height);
 
+    Tracing::recordSpan("document", "prepareLayout", layoutBegin);
+
+    foreach(int index, m_materializedPages)
+    {
+        m_pageItems.at(index)->setPos(m_pagePositions.at(index));
+    }
+
     scene()->setSceneRect(left, 0.0, right - left, height);
 }
 
@@ -2286,47 +4526,59 @@ void DocumentView::prepareView(qreal changeLeft, qreal changeTop, int visiblePag
     const int highlightIsOnPage = m_currentResult.isValid() ? pageOfResult(m_currentResult) : 0;
     const bool highlightCurrentThumbnail = s_settings->documentView().highlightCurrentThumbnail();
 
-    for(int index = 0; index < m_pageItems.count(); ++index)
+    if(!m_continuousMode && m_currentPage >= 1 && m_currentPage <= m_pageItems.count())
+    {
+        const int rightIndex = m_layout->rightIndex(m_currentPage - 1, m_pageItems.count());
+
+        for(int index = m_currentPage - 1; index <= rightIndex; ++index)
+        {
+            const QRectF boundingRect = pageRect(index);
+
+            top = boundingRect.top() - s_settings->documentView().pageSpacing();
+            height = boundingRect.height() + 2.0 * s_settings->documentView().pageSpacing();
+        }
+    }
+
+    foreach(int index, m_materializedPages)
     {
         PageItem* page = m_pageItems.at(index);
-        const QRectF boundingRect = page->boundingRect().translated(page->pos());
 
-        if(m_continuousMode)
+        if(m_continuousMode || m_layout->leftIndex(index) == m_currentPage - 1)
         {
             page->setVisible(true);
         }
         else
         {
-            if(m_layout->leftIndex(index) == m_currentPage - 1)
-            {
-                page->setVisible(true);
-
-                top = boundingRect.top() - s_settings->documentView().pageSpacing();
-                height = boundingRect.height() + 2.0 * s_settings->documentView().pageSpacing();
-            }
-            else
-            {
-                page->setVisible(false);
+            page->setVisible(false);
 
-                page->cancelRender();
-            }
+            page->cancelRender();
         }
+    }
 
-        if(index == visiblePage - 1)
-        {
-            horizontalValue = qFloor(boundingRect.left() + changeLeft * boundingRect.width());
-            verticalValue = qFloor(boundingRect.top() + changeTop * boundingRect.height());
-        }
+    if(visiblePage >= 1 && visiblePage <= m_pageItems.count())
+    {
+        const QRectF boundingRect = pageRect(visiblePage - 1);
 
-        if(index == highlightIsOnPage - 1)
-        {
-            m_highlight->setPos(page->pos());
-            m_highlight->setTransform(page->transform());
+        horizontalValue = qFloor(boundingRect.left() + changeLeft * boundingRect.width());
+        verticalValue = qFloor(boundingRect.top() + changeTop * boundingRect.height());
+    }
 
-            page->stackBefore(m_highlight);
-        }
+    if(highlightIsOnPage >= 1 && highlightIsOnPage <= m_pageItems.count())
+    {
+        PageItem* page = pageItem(highlightIsOnPage - 1);
+
+        m_highlight->setPos(page->pos());
+        m_highlight->setTransform(page->transform());
+
+        page->stackBefore(m_highlight);
+    }
 
-        m_thumbnailItems.at(index)->setHighlighted(highlightCurrentThumbnail && (index == m_currentPage - 1));
+    for(int index = 0; index < m_thumbnailItems.count(); ++index)
+    {
+        if(m_thumbnailItems.at(index) != 0)
+        {
+            m_thumbnailItems.at(index)->setHighlighted(highlightCurrentThumbnail && (index == m_currentPage - 1));
+        }
     }
 
     setSceneRect(left, top, width, height);
@@ -2334,12 +4586,20 @@ void DocumentView::prepareView(qreal changeLeft, qreal changeTop, int visiblePag
     horizontalScrollBar()->setValue(horizontalValue);
     verticalScrollBar()->setValue(verticalValue);
 
+    preparePageItems();
+
     viewport()->update();
 }
 
 void DocumentView::prepareThumbnailsScene()
 {
     const qreal thumbnailSpacing = s_settings->documentView().thumbnailSpacing();
+    const qreal thumbnailSize = s_settings->documentView().thumbnailSize();
+
+    const qreal resolutionX = logicalDpiX();
+    const qreal resolutionY = logicalDpiY();
+
+    const qreal textHeight = 2.0 * QFontMetrics(QFont()).height();
 
     qreal left = 0.0;
     qreal right = m_thumbnailsOrientation == Qt::Vertical ? 0.0 : thumbnailSpacing;
@@ -2352,58 +4612,137 @@ void DocumentView::prepareThumbnailsScene()
     {
         ThumbnailItem* page = m_thumbnailItems.at(index);
 
+        if(page != 0)
+        {
+            m_thumbnailCropRects[index] = page->cropRect();
+        }
+
         if(limitThumbnailsToResults && s_searchModel->hasResults(this) && !s_searchModel->hasResultsOnPage(this, index + 1))
         {
-            page->setVisible(false);
+            m_thumbnailRects[index] = QRectF();
 
-            page->cancelRender();
+            if(page != 0)
+            {
+                page->setVisible(false);
+
+                page->cancelRender();
+            }
 
             continue;
         }
 
-        page->setVisible(true);
-
-        // prepare scale factor
-
-#if QT_VERSION >= QT_VERSION_CHECK(5,1,0)
+        // estimate geometry without materializing the thumbnail
 
-        page->setDevicePixelRatio(devicePixelRatio());
+        const QSizeF size = m_pages.at(index)->size();
+        const QRectF& cropRect = m_thumbnailCropRects.at(index);
 
-#endif // QT_VERSION
+        const qreal cropWidth = cropRect.isNull() ? 1.0 : cropRect.width();
+        const qreal cropHeight = cropRect.isNull() ? 1.0 : cropRect.height();
 
-        page->setResolution(logicalDpiX(), logicalDpiY());
+        const qreal scaleFactor = qMin(thumbnailSize / (resolutionX / 72.0 * cropWidth * size.width()),
+                                       thumbnailSize / (resolutionY / 72.0 * cropHeight * size.height()));
 
-        page->setScaleFactor(qMin(s_settings->documentView().thumbnailSize() / page->displayedWidth(),
-                                  s_settings->documentView().thumbnailSize() / page->displayedHeight()));
+        const qreal width = cropWidth * qRound(resolutionX * scaleFactor / 72.0 * size.width());
+        const qreal height = cropHeight * qRound(resolutionY * scaleFactor / 72.0 * size.height()) + textHeight;
 
         // prepare layout
 
-        const QRectF boundingRect = page->boundingRect();
+        QRectF& rect = m_thumbnailRects[index];
 
         if(m_thumbnailsOrientation == Qt::Vertical)
         {
-            page->setPos(-boundingRect.left() - 0.5 * boundingRect.width(), bottom - boundingRect.top());
+            rect = QRectF(-0.5 * width, bottom, width, height);
 
-            left = qMin(left, -0.5f * boundingRect.width() - thumbnailSpacing);
-            right = qMax(right, 0.5f * boundingRect.width() + thumbnailSpacing);
-            bottom += boundingRect.height() + thumbnailSpacing;
+            left = qMin(left, -0.5f * width - thumbnailSpacing);
+            right = qMax(right, 0.5f * width + thumbnailSpacing);
+            bottom += height + thumbnailSpacing;
         }
         else
         {
-            page->setPos(right - boundingRect.left(), -boundingRect.top() - 0.5 * boundingRect.height());
+            rect = QRectF(right, -0.5 * height, width, height);
+
+            top = qMin(top, -0.5f * height - thumbnailSpacing);
+            bottom = qMax(bottom, 0.5f * height + thumbnailSpacing);
+            right += width + thumbnailSpacing;
+        }
+
+        if(page != 0)
+        {
+            page->setVisible(true);
+
+#if QT_VERSION >= QT_VERSION_CHECK(5,1,0)
+
+            page->setDevicePixelRatio(devicePixelRatio());
+
+#endif // QT_VERSION
 
-            top = qMin(top, -0.5f * boundingRect.height() - thumbnailSpacing);
-            bottom = qMax(bottom, 0.5f * boundingRect.height() + thumbnailSpacing);
-            right += boundingRect.width() + thumbnailSpacing;
+            page->setResolution(resolutionX, resolutionY);
+            page->setScaleFactor(scaleFactor);
+
+            const QRectF boundingRect = page->boundingRect();
+
+            page->setPos(rect.center() - boundingRect.center());
         }
     }
 
     m_thumbnailsScene->setSceneRect(left, top, right - left, bottom - top);
+
+    prepareThumbnailItems();
+}
+
+void DocumentView::setThumbnailsVisibleRect(const QRectF& visibleRect)
+{
+    if(m_thumbnailsVisibleRect != visibleRect)
+    {
+        m_thumbnailsVisibleRect = visibleRect;
+
+        prepareThumbnailItems();
+    }
+}
+
+void DocumentView::prepareThumbnailItems()
+{
+    const qreal extentX = m_thumbnailsVisibleRect.width();
+    const qreal extentY = m_thumbnailsVisibleRect.height();
+
+    // Items are created one viewport ahead but only deleted two viewports behind so that scrolling back and forth does not thrash.
+
+    const QRectF createRect = m_thumbnailsVisibleRect.adjusted(-extentX, -extentY, extentX, extentY);
+    const QRectF deleteRect = m_thumbnailsVisibleRect.adjusted(-2.0 * extentX, -2.0 * extentY, 2.0 * extentX, 2.0 * extentY);
+
+    for(int index = 0; index < m_thumbnailItems.count(); ++index)
+    {
+        ThumbnailItem*& page = m_thumbnailItems[index];
+        const QRectF& rect = m_thumbnailRects.at(index);
+
+        if(page == 0)
+        {
+            if(!rect.isNull() && rect.intersects(createRect))
+            {
+                page = createThumbnailItem(index);
+
+                page->setPos(rect.center() - page->boundingRect().center());
+            }
+        }
+        else if(rect.isNull() || !rect.intersects(deleteRect))
+        {
+            m_thumbnailCropRects[index] = page->cropRect();
+
+            page->cancelRender(true);
+
+            delete page;
+            page = 0;
+        }
+        else if(!rect.intersects(m_thumbnailsVisibleRect))
+        {
+            page->cancelRender();
+        }
+    }
 }
 
 void DocumentView::prepareHighlight(int index, const QRectF& rect)
 {
-    PageItem* page = m_pageItems.at(index);
+    PageItem* page = pageItem(index);
 
     m_highlight->setPos(page->pos());
     m_highlight->setTransform(page->transform());
@@ -2422,6 +4761,95 @@ void DocumentView::prepareHighlight(int index, const QRectF& rect)
     viewport()->update();
 }
 
+void DocumentView::flushSearchResults()
+{
+    m_searchResultsTimer->stop();
+
+    if(m_searchResultsBatch.isEmpty())
+    {
+        return;
+    }
+
+    s_searchModel->insertResults(this, m_searchResultsBatch);
+
+    if(m_highlightAll)
+    {
+        for(QMap< int, QList< QRectF > >::const_iterator iterator = m_searchResultsBatch.constBegin(); iterator != m_searchResultsBatch.constEnd(); ++iterator)
+        {
+            const int index = iterator.key() - 1;
+
+            if(m_pageItems.at(index) != 0)
+            {
+                m_pageItems.at(index)->setHighlights(iterator.value());
+            }
+
+            if(m_thumbnailItems.at(index) != 0)
+            {
+                m_thumbnailItems.at(index)->setHighlights(iterator.value());
+            }
+        }
+    }
+
+    m_searchResultsBatch.clear();
+
+    if(s_settings->documentView().limitThumbnailsToResults())
+    {
+        prepareThumbnailsScene();
+    }
+
+    if(!m_currentResult.isValid())
+    {
+        setFocus();
+
+        findNext();
+    }
+}
+
+QVector< int > DocumentView::searchIndices(const QString& text, bool matchCase, bool wholeWords, bool regularExpression) const
+{
+    QVector< int > indices;
+
+    // Every match of the extended query contains a match of the previous one on the same page,
+    // which does not hold for regular expressions and for a previous query matching whole words.
+
+    if(m_searchText.isEmpty() || matchCase != m_searchMatchCase
+            || regularExpression || m_searchRegularExpression || m_searchWholeWords
+            || !text.contains(m_searchText, matchCase ? Qt::CaseSensitive : Qt::CaseInsensitive))
+    {
+        indices.reserve(m_pages.count());
+
+        for(int index = 0; index < m_pages.count(); ++index)
+        {
+            indices.append(index);
+        }
+
+        return indices;
+    }
+
+    QSet< int > pages = m_unsearchedPages;
+
+    foreach(int page, s_searchModel->pagesWithResults(const_cast< DocumentView* >(this)))
+    {
+        pages.insert(page - 1);
+    }
+
+    // Results which were not yet inserted into the search model are waiting in the batch.
+
+    foreach(int page, m_searchResultsBatch.keys())
+    {
+        pages.insert(page - 1);
+    }
+
+    indices.reserve(pages.count());
+
+    foreach(int index, pages)
+    {
+        indices.append(index);
+    }
+
+    return indices;
+}
+
 void DocumentView::checkResult()
 {
     if(m_currentResult.isValid() && m_layout->currentPage(pageOfResult(m_currentResult)) != m_currentPage)
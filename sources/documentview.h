@@ -24,18 +24,28 @@ along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef DOCUMENTVIEW_H
 #define DOCUMENTVIEW_H
 
+#include <QAtomicInt>
+#include <QElapsedTimer>
 #include <QFileInfo>
+#include <QFutureWatcher>
 #include <QGraphicsView>
 #include <QMap>
+#include <QPair>
 #include <QPersistentModelIndex>
+#include <QSet>
+#include <QSharedPointer>
 
 class QDomNode;
-class QFileSystemWatcher;
+class QGraphicsSimpleTextItem;
+class QLabel;
 class QPrinter;
+class QRegExp;
 class QStandardItemModel;
+class QTimer;
 
 #include "global.h"
 #include "printoptions.h"
+#include "textindex.h"
 
 namespace qpdfview
 {
@@ -48,12 +58,15 @@ class Document;
 }
 
 class Settings;
+class FileChangeDetector;
+class OutlineModel;
 class PageItem;
 class ThumbnailItem;
 class SearchModel;
 class SearchTask;
 class PresentationView;
 class ShortcutHandler;
+class SyncTeXScanner;
 class MainWindow;
 struct DocumentLayout;
 
@@ -68,8 +81,63 @@ public:
     inline const QFileInfo& fileInfo() const { return m_fileInfo; }
     inline bool wasModified() const { return m_wasModified; }
 
+    // The document is used by a background job while it is saved, so it must neither be replaced nor deleted meanwhile.
+
+    inline bool isSaving() const { return m_isSaving; }
+
     inline int numberOfPages() const { return m_pages.count(); }
-    inline int currentPage() const { return m_currentPage; }
+    inline int currentPage() const { return m_openDeferred ? m_deferredPage : m_currentPage; }
+
+    inline bool isOpening() const { return !m_openCancellation.isNull(); }
+
+    // A deferred view only knows its file and current page until its document is opened in the background.
+
+    inline bool isDeferred() const { return m_openDeferred; }
+    void deferOpen(const QString& filePath, int currentPage);
+
+    // Releases the document, its pages and their cached tiles so that the view is deferred again.
+
+    bool hibernate();
+
+    // Documents and pages shared with other tabs are attributed to each of them.
+
+    struct MemoryUsage
+    {
+        qint64 tileCache;
+        qint64 document;
+        qint64 searchResults;
+        qint64 textLayouts;
+        qint64 surroundingTexts;
+
+        int pageItems;
+        int thumbnailItems;
+        int numberOfSearchResults;
+
+        MemoryUsage() : tileCache(0), document(0), searchResults(0), textLayouts(0), surroundingTexts(0), pageItems(0), thumbnailItems(0), numberOfSearchResults(0) {}
+
+        inline qint64 total() const { return tileCache + document + searchResults + textLayouts + surroundingTexts; }
+
+        // The document and the search results cannot be released while the tab stays open.
+
+        inline qint64 evictable() const { return tileCache + textLayouts + surroundingTexts; }
+
+        MemoryUsage& operator+=(const MemoryUsage& other);
+
+    };
+
+    MemoryUsage memoryUsage() const;
+
+    // Drops the cached tiles of pages away from the viewport and then the cached texts until what can be evicted is within the soft limit of the tab.
+
+    void enforceMemoryLimit();
+
+    // The memory used by this tab and by all tabs is shown after the properties of the document.
+
+    void updateMemoryProperties(const MemoryUsage& totalUsage);
+
+    void saveLeftAndTop(qreal& left, qreal& top) const;
+
+    QByteArray savePageGeometry() const;
 
     inline bool hasFrontMatter() const { return m_firstPage > 1; }
 
@@ -83,6 +151,9 @@ public:
     QString title() const;
 
     static QStringList openFilter();
+
+    // Creates the pages of a document which was just loaded, where only the first one is created up front.
+    static bool createPages(const QString& filePath, Model::Document* document, QVector< Model::Page* >& pages);
     QStringList saveFilter() const;
 
     bool canSave() const;
@@ -123,16 +194,29 @@ public:
     inline Qt::Orientation thumbnailsOrientation() const { return m_thumbnailsOrientation; }
     void setThumbnailsOrientation(Qt::Orientation thumbnailsOrientation);
 
-    inline const QVector< ThumbnailItem* >& thumbnailItems() const { return m_thumbnailItems; }
+    // Only the thumbnails near the visible part of the thumbnails view are materialized as items.
+
+    inline QRectF thumbnailRect(int index) const { return m_thumbnailRects.value(index); }
+    void setThumbnailsVisibleRect(const QRectF& visibleRect);
+
     inline QGraphicsScene* thumbnailsScene() const { return m_thumbnailsScene; }
 
-    inline QStandardItemModel* outlineModel() const { return m_outlineModel; }
+    // The overlay shows where the time of rendering and searching this document is spent.
+
+    inline bool showStatistics() const { return m_statisticsOverlay != 0; }
+    void setShowStatistics(bool showStatistics);
+
+    QStandardItemModel* outlineModel() const;
     inline QStandardItemModel* propertiesModel() const { return m_propertiesModel; }
 
-    QStandardItemModel* fontsModel() const;
+    QStandardItemModel* fontsModel();
 
     QString searchText() const;
     bool searchMatchCase() const;
+    bool searchWholeWords() const;
+    bool searchRegularExpression() const;
+
+    QRegExp searchPattern() const;
 
     QString surroundingText(int page, const QRectF& rect) const;
 
@@ -163,11 +247,20 @@ signals:
     void searchFinished();
     void searchProgressChanged(int progress);
 
+    void openFinished(bool ok);
+
 public slots:
     void show();
 
     bool open(const QString& filePath);
     bool refresh();
+
+    // Loads the document on a worker thread and emits openFinished once it is shown, the outline and properties follow afterwards.
+
+    bool openInBackground(const QString& filePath);
+    bool openDeferred();
+    void cancelOpen();
+
     bool save(const QString& filePath, bool withChanges);
     bool print(QPrinter* printer, const PrintOptions& printOptions = PrintOptions());
 
@@ -186,7 +279,7 @@ public slots:
 
     void temporaryHighlight(int page, const QRectF& highlight);
 
-    void startSearch(const QString& text, bool matchCase = true);
+    void startSearch(const QString& text, bool matchCase = true, bool wholeWords = false, bool regularExpression = false);
     void cancelSearch();
 
     void clearResults();
@@ -207,20 +300,38 @@ public slots:
 protected slots:
     void on_verticalScrollBar_valueChanged();
 
-    void on_autoRefresh_timeout();
+    void on_autoRefresh_fileChanged();
     void on_prefetch_timeout();
 
+    void on_zoomGesture_timeout();
+
     void on_temporaryHighlight_timeout();
 
+    void on_searchTask_finished();
     void on_searchTask_progressChanged(int progress);
     void on_searchTask_resultsReady(int index, const QList< QRectF >& results);
+    void on_searchResults_timeout();
+
+    void on_statistics_timeout();
 
     void on_pages_cropRectChanged();
     void on_thumbnails_cropRectChanged();
 
+    void on_pages_sizeCorrected(int index);
+
+    void on_openJob_finished();
+    void on_modelsJob_finished();
+
+    void on_fingerprintsJob_resultReadyAt(int resultIndex);
+    void on_fingerprintsJob_finished();
+    void on_textIndexJob_finished();
+
+    void on_fontsJob_resultReadyAt(int index);
+
     void on_pages_linkClicked(bool newTab, int page, qreal left, qreal top);
     void on_pages_linkClicked(bool newTab, const QString& fileName, int page);
     void on_pages_linkClicked(const QString& url);
+    void on_pages_linkPreloadRequested(const QString& fileName, int page, bool hovered);
 
     void on_pages_rubberBandFinished();
 
@@ -230,6 +341,8 @@ protected slots:
     void on_pages_wasModified();
 
 protected:
+    void showEvent(QShowEvent* event);
+    void hideEvent(QHideEvent* event);
     void resizeEvent(QResizeEvent* event);
 
     void keyPressEvent(QKeyEvent* event);
@@ -244,16 +357,36 @@ private:
     static Settings* s_settings;
     static ShortcutHandler* s_shortcutHandler;
 
-    QFileSystemWatcher* m_autoRefreshWatcher;
-    QTimer* m_autoRefreshTimer;
+    FileChangeDetector* m_autoRefreshDetector;
 
     QTimer* m_prefetchTimer;
 
+    // zoom gesture
+
+    QTimer* m_zoomGestureTimer;
+    qreal m_zoomGestureScaleFactor;
+
+    bool zoomGesture(qreal zoomFactor);
+
+    // scroll prediction
+
+    QElapsedTimer m_scrollTimer;
+    int m_scrollValue;
+    qreal m_scrollVelocity;
+    int m_scrollDirection;
+
+    void updateScrollVelocity(const QRectF& visibleRect);
+    void prefetchAlongScroll(const QRectF& visibleRect);
+
     Model::Document* m_document;
     QVector< Model::Page* > m_pages;
 
+    // first and last index of the pages which were visible after the last scroll
+    QPair< int, int > m_visiblePages;
+
     QFileInfo m_fileInfo;
     bool m_wasModified;
+    bool m_isSaving;
 
     int m_currentPage;
     int m_firstPage;
@@ -279,8 +412,6 @@ private:
     QList< Position > m_past;
     QList< Position > m_future;
 
-    void saveLeftAndTop(qreal& left, qreal& top) const;
-
     QScopedPointer< DocumentLayout > m_layout;
 
     bool m_continuousMode;
@@ -294,33 +425,129 @@ private:
     bool m_highlightAll;
     RubberBandMode m_rubberBandMode;
 
+    // Page items are only materialized near the visible part of the scene whereas the geometry of all pages is kept here.
+
     QVector< PageItem* > m_pageItems;
+    QVector< QRectF > m_pageBoundingRects;
+    QVector< QPointF > m_pagePositions;
+    QVector< QRectF > m_pageCropRects;
+    QVector< qreal > m_pageScaleFactors;
+
+    QSet< int > m_materializedPages;
+    QSet< int > m_retainedPages;
+
+    QByteArray m_documentKey;
+
+    inline QRectF pageRect(int index) const { return m_pageBoundingRects.at(index).translated(m_pagePositions.at(index)); }
+
     QVector< ThumbnailItem* > m_thumbnailItems;
+    QVector< QRectF > m_thumbnailRects;
+    QVector< QRectF > m_thumbnailCropRects;
+    QRectF m_thumbnailsVisibleRect;
 
     QGraphicsRectItem* m_highlight;
 
     Qt::Orientation m_thumbnailsOrientation;
     QGraphicsScene* m_thumbnailsScene;
 
-    QStandardItemModel* m_outlineModel;
+    OutlineModel* m_outlineModel;
     QStandardItemModel* m_propertiesModel;
 
+    // asynchronous open
+
+    QFutureWatcher< Model::Document* >* m_openWatcher;
+    QSharedPointer< QAtomicInt > m_openCancellation;
+
+    QGraphicsSimpleTextItem* m_openPlaceholder;
+
+    bool m_openDeferred;
+    int m_deferredPage;
+
+    typedef QPair< QStandardItemModel*, QStandardItemModel* > Models;
+
+    QFutureWatcher< Models >* m_modelsWatcher;
+
+    bool openDocument(const QString& filePath, Model::Document* document, bool loadModelsInBackground);
+    void waitForModels();
+
+    // incremental refresh
+
+    // Pages are fingerprinted in the background with the visible ones first and are invalidated as soon as their fingerprint is known to differ from before the refresh.
+
+    QFutureWatcher< QByteArray >* m_fingerprintsWatcher;
+    QVector< int > m_fingerprintsOrder;
+    QVector< QByteArray > m_fingerprints;
+    QVector< QByteArray > m_previousFingerprints;
+
+    void startFingerprints();
+    void cancelFingerprints();
+    void replaceDocument(Model::Document* document, const QVector< Model::Page* >& pages);
+
+    // text index
+
+    QFutureWatcher< QString >* m_textIndexWatcher;
+    TextIndex m_textIndex;
+
+    void cancelTextIndex();
+    void prepareTextIndex();
+
+    // fonts
+
+    QStandardItemModel* m_fontsModel;
+
+    QFutureWatcher< QSharedPointer< QStandardItemModel > >* m_fontsWatcher;
+    bool m_fontsPrepared;
+    QSet< QString > m_fontKeys;
+
+    void cancelFonts();
+    void prepareFonts();
+
+#ifdef WITH_SYNCTEX
+
+    // SyncTeX data is parsed in the background after opening so that it is ready when it is first queried.
+
+    QFuture< QSharedPointer< SyncTeXScanner > > m_syncTeXScannerJob;
+    QSharedPointer< SyncTeXScanner > m_syncTeXScanner;
+
+    void prepareSyncTeX();
+    void releaseSyncTeX();
+    QSharedPointer< SyncTeXScanner > syncTeXScanner();
+
+#endif // WITH_SYNCTEX
+
+    bool acquireDocument(const QString& filePath, Model::Document*& document, QVector< Model::Page* >& pages);
     bool checkDocument(const QString& filePath, Model::Document* document, QVector< Model::Page* >& pages);
+    void connectPages(const QVector< Model::Page* >& pages);
 
+    void loadOutline();
     void loadFallbackOutline();
     void loadDocumentDefaults();
 
     void adjustScrollBarPolicy();
 
-    void prepareDocument(Model::Document* document, const QVector< Model::Page* >& pages);
+    void prepareAutoRefresh();
+    void preparePaperColor();
+
+    void prepareDocument(Model::Document* document, const QVector< Model::Page* >& pages, bool loadModelsInBackground = false);
     void preparePages();
     void prepareThumbnails();
+    void prepareForeground();
     void prepareBackground();
 
     void prepareScene();
     void prepareView(qreal changeLeft = 0.0, qreal changeTop = 0.0, int visiblePage = 0);
 
+    void preparePageItems();
+
+    PageItem* pageItem(int index);
+    PageItem* createPageItem(int index);
+    void deletePageItem(int index);
+    void releasePageItems();
+
     void prepareThumbnailsScene();
+    void prepareThumbnailItems();
+
+    ThumbnailItem* createThumbnailItem(int index);
 
     void prepareHighlight(int index, const QRectF& highlight);
 
@@ -332,9 +559,34 @@ private:
 
     SearchTask* m_searchTask;
 
+    // A query which extends the previous one only needs to search the pages which had results or had not been searched yet.
+
+    QString m_searchText;
+    bool m_searchMatchCase;
+    bool m_searchWholeWords;
+    bool m_searchRegularExpression;
+    QSet< int > m_unsearchedPages;
+
+    // A new search is started once the canceled one has finished instead of waiting for it.
+
+    bool m_searchPending;
+    QVector< int > m_pendingSearchIndices;
+
+    // Results are inserted into the search model in batches to keep the search dock responsive.
+
+    QTimer* m_searchResultsTimer;
+    QMap< int, QList< QRectF > > m_searchResultsBatch; // by page
+
+    void flushSearchResults();
+
+    QVector< int > searchIndices(const QString& text, bool matchCase, bool wholeWords, bool regularExpression) const;
+
     void checkResult();
     void applyResult();
 
+    QLabel* m_statisticsOverlay;
+    QTimer* m_statisticsTimer;
+
 };
 
 } // qpdfview
@@ -0,0 +1,357 @@
+/*
+
+Copyright 2014 Adam Reichold
+
+This file is part of qpdfview.
+
+qpdfview is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+qpdfview is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "filechangedetector.h"
+
+#include <QCryptographicHash>
+#include <QFile>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QTimer>
+#include <QtConcurrentRun>
+
+namespace
+{
+
+// maximum number of intervals waited for a file which is missing or incomplete before the change is reported anyway
+const int maxSettleAttempts = 40;
+
+// number of bytes at the end of a PDF file which are searched for its end-of-file marker
+const qint64 trailerSize = 1024;
+
+// number of bytes which are hashed at once
+const qint64 checksumBlockSize = 1024 * 1024;
+
+// A PDF file without the end-of-file marker near its end is still being written, other formats are taken as they are.
+
+bool isComplete(const QString& filePath)
+{
+    QFile file(filePath);
+
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    if(file.read(5) != "%PDF-")
+    {
+        return true;
+    }
+
+    if(file.size() > trailerSize)
+    {
+        file.seek(file.size() - trailerSize);
+    }
+
+    return file.read(trailerSize).contains("%%EOF");
+}
+
+// Hashing is canceled between blocks, so that large files or files on slow mounts never have to be waited for.
+
+QByteArray fileChecksum(const QString& filePath, QSharedPointer< QAtomicInt > cancellation)
+{
+    QFile file(filePath);
+
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        return QByteArray();
+    }
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+
+    while(!file.atEnd())
+    {
+        if(cancellation->fetchAndAddOrdered(0) != 0)
+        {
+            return QByteArray();
+        }
+
+        const QByteArray block = file.read(checksumBlockSize);
+
+        if(block.isEmpty())
+        {
+            return QByteArray();
+        }
+
+        hash.addData(block);
+    }
+
+    return hash.result();
+}
+
+} // anonymous
+
+namespace qpdfview
+{
+
+FileChangeDetector::FileChangeDetector(QObject* parent) : QObject(parent),
+    m_watcher(0),
+    m_timer(0),
+    m_checksumWatcher(0),
+    m_checksumCancellation(),
+    m_filePath(),
+    m_snapshot(),
+    m_attempts(0),
+    m_checksum(),
+    m_checksumSnapshot(),
+    m_isVerifying(false)
+{
+    m_watcher = new QFileSystemWatcher(this);
+
+    connect(m_watcher, SIGNAL(fileChanged(QString)), SLOT(on_watcher_fileChanged(QString)));
+    connect(m_watcher, SIGNAL(directoryChanged(QString)), SLOT(on_watcher_directoryChanged(QString)));
+
+    m_timer = new QTimer(this);
+    m_timer->setSingleShot(true);
+
+    connect(m_timer, SIGNAL(timeout()), SLOT(on_timer_timeout()));
+
+    m_checksumWatcher = new QFutureWatcher< QByteArray >(this);
+
+    connect(m_checksumWatcher, SIGNAL(finished()), SLOT(on_checksum_finished()));
+}
+
+FileChangeDetector::~FileChangeDetector()
+{
+    cancelChecksum();
+}
+
+int FileChangeDetector::interval() const
+{
+    return m_timer->interval();
+}
+
+void FileChangeDetector::setInterval(int interval)
+{
+    m_timer->setInterval(interval);
+}
+
+void FileChangeDetector::watch(const QString& filePath)
+{
+    const Snapshot current = snapshot(filePath);
+
+    // A refresh watches the file it was told about again, whose checksum is known already.
+
+    const bool isUnchanged = filePath == m_filePath && current == m_checksumSnapshot && !m_checksum.isNull() && !m_checksumWatcher->isRunning();
+    const QByteArray checksum = m_checksum;
+
+    unwatch();
+
+    m_filePath = filePath;
+    m_snapshot = current;
+
+    // Files replaced by renaming are only noticed by watching their directory.
+
+    m_watcher->addPath(filePath);
+    m_watcher->addPath(QFileInfo(filePath).absolutePath());
+
+    if(isUnchanged)
+    {
+        m_checksum = checksum;
+        m_checksumSnapshot = current;
+    }
+    else
+    {
+        startChecksum(false);
+    }
+}
+
+void FileChangeDetector::unwatch()
+{
+    m_timer->stop();
+
+    if(!m_watcher->files().isEmpty())
+    {
+        m_watcher->removePaths(m_watcher->files());
+    }
+
+    if(!m_watcher->directories().isEmpty())
+    {
+        m_watcher->removePaths(m_watcher->directories());
+    }
+
+    cancelChecksum();
+
+    m_isVerifying = false;
+
+    m_filePath.clear();
+    m_checksum.clear();
+    m_checksumSnapshot = Snapshot();
+
+    m_attempts = 0;
+}
+
+void FileChangeDetector::postpone()
+{
+    if(!m_filePath.isEmpty())
+    {
+        m_timer->start();
+    }
+}
+
+void FileChangeDetector::on_watcher_fileChanged(const QString& path)
+{
+    if(path != m_filePath)
+    {
+        return;
+    }
+
+    // Replacing the file by renaming removes it from the watcher.
+
+    if(!m_watcher->files().contains(m_filePath) && QFileInfo(m_filePath).exists())
+    {
+        m_watcher->addPath(m_filePath);
+    }
+
+    m_snapshot = snapshot(m_filePath);
+    m_attempts = 0;
+
+    m_timer->start();
+}
+
+void FileChangeDetector::on_watcher_directoryChanged(const QString& path)
+{
+    Q_UNUSED(path);
+
+    if(m_filePath.isEmpty())
+    {
+        return;
+    }
+
+    const Snapshot current = snapshot(m_filePath);
+
+    // Changes to other files in the same directory are ignored.
+
+    if(current == m_snapshot && m_watcher->files().contains(m_filePath))
+    {
+        return;
+    }
+
+    on_watcher_fileChanged(m_filePath);
+}
+
+void FileChangeDetector::on_timer_timeout()
+{
+    const Snapshot current = snapshot(m_filePath);
+
+    // The file is still being written as long as its size or modification time changes from one interval to the next.
+
+    if(current != m_snapshot)
+    {
+        m_snapshot = current;
+
+        m_timer->start();
+        return;
+    }
+
+    if((!current.exists || !isComplete(m_filePath)) && ++m_attempts < maxSettleAttempts)
+    {
+        m_timer->start();
+        return;
+    }
+
+    if(!current.exists)
+    {
+        emit fileChanged();
+        return;
+    }
+
+    if(m_checksumWatcher->isRunning())
+    {
+        m_timer->start();
+        return;
+    }
+
+    startChecksum(true);
+}
+
+void FileChangeDetector::on_checksum_finished()
+{
+    const QByteArray checksum = m_checksumWatcher->result();
+    const bool wasVerifying = m_isVerifying;
+
+    m_isVerifying = false;
+
+    // If the file changed while it was hashed, the checksum does not belong to any settled contents and the pending change is checked again.
+
+    if(snapshot(m_filePath) != m_checksumSnapshot)
+    {
+        if(!wasVerifying)
+        {
+            m_checksum.clear();
+        }
+
+        return;
+    }
+
+    if(wasVerifying && !checksum.isNull() && checksum == m_checksum)
+    {
+        return;
+    }
+
+    m_checksum = checksum;
+
+    if(wasVerifying)
+    {
+        emit fileChanged();
+    }
+}
+
+FileChangeDetector::Snapshot FileChangeDetector::snapshot(const QString& filePath)
+{
+    const QFileInfo fileInfo(filePath);
+
+    Snapshot snapshot;
+
+    if(fileInfo.exists())
+    {
+        snapshot.exists = true;
+        snapshot.size = fileInfo.size();
+        snapshot.lastModified = fileInfo.lastModified();
+    }
+
+    return snapshot;
+}
+
+void FileChangeDetector::startChecksum(bool verify)
+{
+    m_isVerifying = verify;
+    m_checksumSnapshot = snapshot(m_filePath);
+
+    m_checksumCancellation = QSharedPointer< QAtomicInt >(new QAtomicInt(0));
+
+    m_checksumWatcher->setFuture(QtConcurrent::run(fileChecksum, m_filePath, m_checksumCancellation));
+}
+
+void FileChangeDetector::cancelChecksum()
+{
+    // The job only holds on to its own copies, so it is left to finish by itself and its result is discarded.
+
+    if(!m_checksumCancellation.isNull())
+    {
+        m_checksumCancellation->fetchAndStoreOrdered(1);
+        m_checksumCancellation.clear();
+    }
+
+    m_checksumWatcher->setFuture(QFuture< QByteArray >());
+}
+
+} // qpdfview
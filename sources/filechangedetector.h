@@ -0,0 +1,110 @@
+/*
+
+Copyright 2014 Adam Reichold
+
+This file is part of qpdfview.
+
+qpdfview is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+qpdfview is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef FILECHANGEDETECTOR_H
+#define FILECHANGEDETECTOR_H
+
+#include <QAtomicInt>
+#include <QDateTime>
+#include <QFutureWatcher>
+#include <QObject>
+#include <QSharedPointer>
+
+class QFileSystemWatcher;
+class QTimer;
+
+namespace qpdfview
+{
+
+// Reports a change of a file only after writing it has settled and its contents actually differ, so that files written in several steps or replaced by renaming are reloaded once and never while incomplete.
+
+class FileChangeDetector : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FileChangeDetector(QObject* parent = 0);
+    ~FileChangeDetector();
+
+    int interval() const;
+    void setInterval(int interval);
+
+    void watch(const QString& filePath);
+    void unwatch();
+
+public slots:
+    // The change is checked again after another interval, e.g. because the file cannot be reloaded right now.
+
+    void postpone();
+
+signals:
+    void fileChanged();
+
+protected slots:
+    void on_watcher_fileChanged(const QString& path);
+    void on_watcher_directoryChanged(const QString& path);
+
+    void on_timer_timeout();
+
+    void on_checksum_finished();
+
+private:
+    Q_DISABLE_COPY(FileChangeDetector)
+
+    QFileSystemWatcher* m_watcher;
+    QTimer* m_timer;
+
+    QFutureWatcher< QByteArray >* m_checksumWatcher;
+    QSharedPointer< QAtomicInt > m_checksumCancellation;
+
+    QString m_filePath;
+
+    struct Snapshot
+    {
+        bool exists;
+        qint64 size;
+        QDateTime lastModified;
+
+        Snapshot() : exists(false), size(0), lastModified() {}
+
+        bool operator==(const Snapshot& other) const { return exists == other.exists && size == other.size && lastModified == other.lastModified; }
+        bool operator!=(const Snapshot& other) const { return !operator==(other); }
+
+    };
+
+    static Snapshot snapshot(const QString& filePath);
+
+    Snapshot m_snapshot;
+    int m_attempts;
+
+    // of the contents which were loaded, a null checksum matches no contents
+    QByteArray m_checksum;
+    Snapshot m_checksumSnapshot;
+    bool m_isVerifying;
+
+    void startChecksum(bool verify);
+    void cancelChecksum();
+
+};
+
+} // qpdfview
+
+#endif // FILECHANGEDETECTOR_H
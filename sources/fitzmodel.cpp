@@ -23,6 +23,8 @@ along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <QFile>
 #include <qmath.h>
+#include <QThread>
+#include <QtConcurrentMap>
 
 extern "C"
 {
@@ -39,6 +41,67 @@ pdf_document* pdf_specifics(fz_document*);
 namespace
 {
 
+const int maximumDisplayListCount = 8;
+
+const int renderBandHeight = 256;
+
+// Images of at least this many pixels are split into stripes which are rasterized concurrently.
+const int concurrentRenderPixelCount = 2048 * 2048;
+
+struct RenderStripe
+{
+    fz_context* context;
+    fz_display_list* displayList;
+    fz_matrix pageMatrix;
+
+    uchar* bits;
+    int bytesPerLine;
+    int width;
+
+    int top;
+    int height;
+
+    const qpdfview::Model::CancellationToken* cancellation;
+    bool canceled;
+
+};
+
+void renderStripe(RenderStripe& stripe)
+{
+    // The stripe is drawn in horizontal bands, each into its own pixmap, so that a canceled render stops after the current band.
+
+    for(int bandTop = stripe.top; bandTop < stripe.top + stripe.height; bandTop += renderBandHeight)
+    {
+        if(stripe.cancellation != 0 && stripe.cancellation->wasCanceled())
+        {
+            stripe.canceled = true;
+            return;
+        }
+
+        const int bandHeight = qMin(renderBandHeight, stripe.top + stripe.height - bandTop);
+
+        fz_matrix bandTranslation;
+        fz_translate(&bandTranslation, 0.0, -bandTop);
+
+        fz_matrix bandMatrix;
+        fz_concat(&bandMatrix, &stripe.pageMatrix, &bandTranslation);
+
+        fz_rect bandRect;
+        bandRect.x0 = 0.0;
+        bandRect.y0 = 0.0;
+        bandRect.x1 = stripe.width;
+        bandRect.y1 = bandHeight;
+
+        fz_pixmap* pixmap = fz_new_pixmap_with_data(stripe.context, fz_device_bgr(stripe.context), stripe.width, bandHeight, stripe.bits + bandTop * stripe.bytesPerLine);
+
+        fz_device* device = fz_new_draw_device(stripe.context, pixmap);
+        fz_run_display_list(stripe.displayList, device, &bandMatrix, &bandRect, 0);
+        fz_free_device(device);
+
+        fz_drop_pixmap(stripe.context, pixmap);
+    }
+}
+
 void loadOutline(fz_outline* outline, QStandardItem* parent)
 {
     QStandardItem* item = new QStandardItem(QString::fromUtf8(outline->title));
@@ -88,6 +151,10 @@ FitzPage::FitzPage(const FitzDocument* parent, fz_page* page) :
 
 FitzPage::~FitzPage()
 {
+    QMutexLocker mutexLocker(&m_parent->m_mutex);
+
+    m_parent->dropDisplayList(this);
+
     fz_free_page(m_parent->m_document, m_page);
 }
 
@@ -101,7 +168,7 @@ QSizeF FitzPage::size() const
     return QSizeF(rect.x1 - rect.x0, rect.y1 - rect.y0);
 }
 
-QImage FitzPage::render(qreal horizontalResolution, qreal verticalResolution, Rotation rotation, const QRect& boundingRect) const
+QImage FitzPage::render(qreal horizontalResolution, qreal verticalResolution, Rotation rotation, const QRect& boundingRect, const CancellationToken* cancellation, ImageAllocator* allocator) const
 {
     QMutexLocker mutexLocker(&m_parent->m_mutex);
 
@@ -135,11 +202,7 @@ QImage FitzPage::render(qreal horizontalResolution, qreal verticalResolution, Ro
 
 
     fz_context* context = fz_clone_context(m_parent->m_context);
-    fz_display_list* display_list = fz_new_display_list(context);
-
-    fz_device* device = fz_new_list_device(context, display_list);
-    fz_run_page(m_parent->m_document, m_page, device, &matrix, 0);
-    fz_free_device(device);
+    fz_display_list* display_list = m_parent->displayList(this);
 
 
     mutexLocker.unlock();
@@ -163,17 +226,86 @@ QImage FitzPage::render(qreal horizontalResolution, qreal verticalResolution, Ro
         tileHeight = tileRect.y1 = boundingRect.height();
     }
 
+    // The cached display list is untransformed, so scaling and rotation are applied while it is run.
 
-    QImage image(tileWidth, tileHeight, QImage::Format_RGB32);
+    fz_matrix pageMatrix;
+    fz_concat(&pageMatrix, &matrix, &tileMatrix);
+
+
+    QImage image = allocator != 0 ? allocator->allocate(tileWidth, tileHeight) : QImage(tileWidth, tileHeight, QImage::Format_RGB32);
     image.fill(m_parent->m_paperColor);
 
-    fz_pixmap* pixmap = fz_new_pixmap_with_data(context, fz_device_bgr(context), image.width(), image.height(), image.bits());
+    if(cancellation == 0 && static_cast< qint64 >(tileWidth) * tileHeight < concurrentRenderPixelCount)
+    {
+        fz_pixmap* pixmap = fz_new_pixmap_with_data(context, fz_device_bgr(context), image.width(), image.height(), image.bits());
 
-    device = fz_new_draw_device(context, pixmap);
-    fz_run_display_list(display_list, device, &tileMatrix, &tileRect, 0);
-    fz_free_device(device);
+        fz_device* device = fz_new_draw_device(context, pixmap);
+        fz_run_display_list(display_list, device, &pageMatrix, &tileRect, 0);
+        fz_free_device(device);
+
+        fz_drop_pixmap(context, pixmap);
+    }
+    else
+    {
+        // Large images are split into one stripe per core, each of which runs the shared display list on its own clone of the context.
+
+        int stripeCount = 1;
+
+        if(static_cast< qint64 >(tileWidth) * tileHeight >= concurrentRenderPixelCount)
+        {
+            stripeCount = qBound(1, QThread::idealThreadCount(), (tileHeight + renderBandHeight - 1) / renderBandHeight);
+        }
+
+        const int stripeHeight = ((tileHeight + stripeCount - 1) / stripeCount + renderBandHeight - 1) / renderBandHeight * renderBandHeight;
+
+        uchar* bits = image.bits();
+
+        QVector< RenderStripe > stripes;
+
+        for(int stripeTop = 0; stripeTop < tileHeight; stripeTop += stripeHeight)
+        {
+            RenderStripe stripe;
+
+            stripe.context = stripes.isEmpty() ? context : fz_clone_context(context);
+            stripe.displayList = display_list;
+            stripe.pageMatrix = pageMatrix;
+
+            stripe.bits = bits;
+            stripe.bytesPerLine = image.bytesPerLine();
+            stripe.width = tileWidth;
+
+            stripe.top = stripeTop;
+            stripe.height = qMin(stripeHeight, tileHeight - stripeTop);
+
+            stripe.cancellation = cancellation;
+            stripe.canceled = false;
+
+            stripes.append(stripe);
+        }
+
+        if(stripes.count() > 1)
+        {
+            QtConcurrent::blockingMap(stripes, renderStripe);
+        }
+        else
+        {
+            renderStripe(stripes.first());
+        }
+
+        for(int index = 0; index < stripes.count(); ++index)
+        {
+            if(stripes.at(index).canceled)
+            {
+                image = QImage();
+            }
+
+            if(index > 0)
+            {
+                fz_free_context(stripes.at(index).context);
+            }
+        }
+    }
 
-    fz_drop_pixmap(context, pixmap);
     fz_drop_display_list(context, display_list);
     fz_free_context(context);
 
@@ -236,16 +368,23 @@ QList< Link* > FitzPage::links() const
     return links;
 }
 
-FitzDocument::FitzDocument(fz_context* context, fz_document* document) :
+FitzDocument::FitzDocument(fz_context* context, fz_document* document, const QByteArray& data) :
     m_mutex(),
     m_context(context),
     m_document(document),
-    m_paperColor(Qt::white)
+    m_data(data),
+    m_paperColor(Qt::white),
+    m_displayLists()
 {
 }
 
 FitzDocument::~FitzDocument()
 {
+    foreach(const DisplayListEntry& entry, m_displayLists)
+    {
+        fz_drop_display_list(m_context, entry.second);
+    }
+
     fz_close_document(m_document);
     fz_free_context(m_context);
 }
@@ -266,6 +405,11 @@ Page* FitzDocument::page(int index) const
     return page != 0 ? new FitzPage(this, page) : 0;
 }
 
+bool FitzDocument::hasPageLabels() const
+{
+    return false;
+}
+
 bool FitzDocument::canBePrintedUsingCUPS() const
 {
     QMutexLocker mutexLocker(&m_mutex);
@@ -294,6 +438,47 @@ void FitzDocument::loadOutline(QStandardItemModel* outlineModel) const
     }
 }
 
+fz_display_list* FitzDocument::displayList(const FitzPage* page) const
+{
+    for(int index = 0; index < m_displayLists.count(); ++index)
+    {
+        if(m_displayLists.at(index).first == page)
+        {
+            m_displayLists.move(index, 0);
+
+            return fz_keep_display_list(m_context, m_displayLists.first().second);
+        }
+    }
+
+    fz_display_list* display_list = fz_new_display_list(m_context);
+
+    fz_device* device = fz_new_list_device(m_context, display_list);
+    fz_run_page(m_document, page->m_page, device, &fz_identity, 0);
+    fz_free_device(device);
+
+    m_displayLists.prepend(qMakePair(page, display_list));
+
+    while(m_displayLists.count() > maximumDisplayListCount)
+    {
+        fz_drop_display_list(m_context, m_displayLists.takeLast().second);
+    }
+
+    return fz_keep_display_list(m_context, display_list);
+}
+
+void FitzDocument::dropDisplayList(const FitzPage* page) const
+{
+    for(int index = 0; index < m_displayLists.count(); ++index)
+    {
+        if(m_displayLists.at(index).first == page)
+        {
+            fz_drop_display_list(m_context, m_displayLists.takeAt(index).second);
+
+            return;
+        }
+    }
+}
+
 } // Model
 
 FitzPlugin::FitzPlugin(QObject* parent) : QObject(parent)
@@ -343,6 +528,29 @@ Model::Document* FitzPlugin::loadDocument(const QString& filePath) const
     return new Model::FitzDocument(context, document);
 }
 
+Model::Document* FitzPlugin::loadDocumentFromData(const QByteArray& data) const
+{
+    fz_context* context = fz_clone_context(m_context);
+
+    if(context == 0)
+    {
+        return 0;
+    }
+
+    fz_stream* stream = fz_open_memory(context, reinterpret_cast< unsigned char* >(const_cast< char* >(data.constData())), data.size());
+    fz_document* document = fz_open_document_with_stream(context, "application/pdf", stream);
+    fz_close(stream);
+
+    if(document == 0)
+    {
+        fz_free_context(context);
+
+        return 0;
+    }
+
+    return new Model::FitzDocument(context, document, data);
+}
+
 void FitzPlugin::lock(void* user, int lock)
 {
     reinterpret_cast< FitzPlugin* >(user)->m_mutex[lock].lock();
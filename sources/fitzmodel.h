@@ -22,7 +22,9 @@ along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef FITZMODEL_H
 #define FITZMODEL_H
 
+#include <QList>
 #include <QMutex>
+#include <QPair>
 
 extern "C"
 {
@@ -31,6 +33,7 @@ extern "C"
 
 typedef struct fz_page_s fz_page;
 typedef struct fz_document_s fz_document;
+typedef struct fz_display_list_s fz_display_list;
 
 }
 
@@ -52,7 +55,7 @@ namespace Model
 
         QSizeF size() const;
 
-        QImage render(qreal horizontalResolution, qreal verticalResolution, Rotation rotation, const QRect& boundingRect) const;
+        QImage render(qreal horizontalResolution, qreal verticalResolution, Rotation rotation, const QRect& boundingRect, const CancellationToken* cancellation, ImageAllocator* allocator) const;
 
         QList< Link* > links() const;
 
@@ -79,6 +82,8 @@ namespace Model
 
         Page* page(int index) const;
 
+        bool hasPageLabels() const;
+
         bool canBePrintedUsingCUPS() const;
 
         void setPaperColor(const QColor &paperColor);
@@ -88,14 +93,26 @@ namespace Model
     private:
         Q_DISABLE_COPY(FitzDocument)
 
-        FitzDocument(fz_context* context, fz_document* document);
+        FitzDocument(fz_context* context, fz_document* document, const QByteArray& data = QByteArray());
 
         mutable QMutex m_mutex;
         fz_context* m_context;
         fz_document* m_document;
 
+        // The stream of a document loaded from memory reads directly from this data.
+
+        QByteArray m_data;
+
         QColor m_paperColor;
 
+        // Display lists are recorded without any transformation and kept for the most recently rendered pages.
+
+        typedef QPair< const FitzPage*, fz_display_list* > DisplayListEntry;
+        mutable QList< DisplayListEntry > m_displayLists;
+
+        fz_display_list* displayList(const FitzPage* page) const;
+        void dropDisplayList(const FitzPage* page) const;
+
     };
 }
 
@@ -106,7 +123,7 @@ class FitzPlugin : public QObject, Plugin
 
 #if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
 
-    Q_PLUGIN_METADATA(IID "local.qpdfview.Plugin")
+    Q_PLUGIN_METADATA(IID "local.qpdfview.Plugin/2")
 
 #endif // QT_VERSION
 
@@ -115,6 +132,7 @@ public:
     ~FitzPlugin();
 
     Model::Document* loadDocument(const QString& filePath) const;
+    Model::Document* loadDocumentFromData(const QByteArray& data) const;
 
 private:
     QMutex m_mutex[FZ_LOCK_MAX];
@@ -0,0 +1,119 @@
+/*
+
+Copyright 2014 Adam Reichold
+
+This file is part of qpdfview.
+
+qpdfview is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+qpdfview is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "hittestindex.h"
+
+#include <qmath.h>
+
+namespace
+{
+
+// average number of elements per cell
+const int elementsPerCell = 4;
+
+// maximum number of cells per dimension
+const int maxCellsPerDimension = 64;
+
+} // anonymous
+
+namespace qpdfview
+{
+
+HitTestIndex::HitTestIndex() :
+    m_columns(0),
+    m_rows(0),
+    m_boundingRects(),
+    m_cells()
+{
+}
+
+void HitTestIndex::build(const QList< QRectF >& boundingRects)
+{
+    clear();
+
+    if(boundingRects.isEmpty())
+    {
+        return;
+    }
+
+    m_columns = m_rows = qBound(1, qCeil(qSqrt(static_cast< qreal >(boundingRects.count()) / elementsPerCell)), maxCellsPerDimension);
+
+    m_boundingRects = boundingRects.toVector();
+    m_cells.resize(m_columns * m_rows);
+
+    for(int index = 0; index < m_boundingRects.count(); ++index)
+    {
+        const QRectF& boundingRect = m_boundingRects.at(index);
+
+        const int left = column(boundingRect.left());
+        const int right = column(boundingRect.right());
+        const int top = row(boundingRect.top());
+        const int bottom = row(boundingRect.bottom());
+
+        for(int cellRow = top; cellRow <= bottom; ++cellRow)
+        {
+            for(int cellColumn = left; cellColumn <= right; ++cellColumn)
+            {
+                m_cells[cellRow * m_columns + cellColumn].append(index);
+            }
+        }
+    }
+}
+
+void HitTestIndex::clear()
+{
+    m_columns = m_rows = 0;
+
+    m_boundingRects.clear();
+    m_cells.clear();
+}
+
+QVector< int > HitTestIndex::candidates(const QPointF& point) const
+{
+    QVector< int > candidates;
+
+    if(m_cells.isEmpty())
+    {
+        return candidates;
+    }
+
+    foreach(int index, m_cells.at(row(point.y()) * m_columns + column(point.x())))
+    {
+        if(m_boundingRects.at(index).contains(point))
+        {
+            candidates.append(index);
+        }
+    }
+
+    return candidates;
+}
+
+inline int HitTestIndex::column(qreal x) const
+{
+    return qBound(0, qFloor(x * m_columns), m_columns - 1);
+}
+
+inline int HitTestIndex::row(qreal y) const
+{
+    return qBound(0, qFloor(y * m_rows), m_rows - 1);
+}
+
+} // qpdfview
@@ -0,0 +1,62 @@
+/*
+
+Copyright 2014 Adam Reichold
+
+This file is part of qpdfview.
+
+qpdfview is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+qpdfview is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef HITTESTINDEX_H
+#define HITTESTINDEX_H
+
+#include <QList>
+#include <QRectF>
+#include <QVector>
+
+namespace qpdfview
+{
+
+// Buckets the bounding rectangles of the interactive elements of a page into a uniform grid over normalized page coordinates,
+// so that only the elements whose bounding rectangle covers the queried cell have to be tested exactly.
+
+class HitTestIndex
+{
+public:
+    HitTestIndex();
+
+    void build(const QList< QRectF >& boundingRects);
+    void clear();
+
+    inline bool isEmpty() const { return m_cells.isEmpty(); }
+
+    // yields the indices of the elements whose bounding rectangle contains the point in ascending order
+    QVector< int > candidates(const QPointF& point) const;
+
+private:
+    int m_columns;
+    int m_rows;
+
+    QVector< QRectF > m_boundingRects;
+    QVector< QVector< int > > m_cells;
+
+    int column(qreal x) const;
+    int row(qreal y) const;
+
+};
+
+} // qpdfview
+
+#endif // HITTESTINDEX_H
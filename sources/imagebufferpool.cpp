@@ -0,0 +1,124 @@
+/*
+
+Copyright 2014 Adam Reichold
+
+This file is part of qpdfview.
+
+qpdfview is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+qpdfview is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "imagebufferpool.h"
+
+namespace
+{
+
+// maximum number of bytes kept for reuse
+const qint64 maxSize = 32 * 1024 * 1024;
+
+// maximum number of buffers kept per size
+const int maxBuffersPerSize = 16;
+
+} // anonymous
+
+namespace qpdfview
+{
+
+ImageBufferPool* ImageBufferPool::s_instance = 0;
+
+ImageBufferPool* ImageBufferPool::instance()
+{
+    if(s_instance == 0)
+    {
+        s_instance = new ImageBufferPool();
+    }
+
+    return s_instance;
+}
+
+ImageBufferPool::~ImageBufferPool()
+{
+    s_instance = 0;
+}
+
+QImage ImageBufferPool::allocate(int width, int height)
+{
+    {
+        QMutexLocker mutexLocker(&m_mutex);
+
+        QHash< Size, QList< QImage > >::iterator buffers = m_buffers.find(qMakePair(width, height));
+
+        if(buffers != m_buffers.end())
+        {
+            QImage image = buffers.value().takeLast();
+
+            if(buffers.value().isEmpty())
+            {
+                m_buffers.erase(buffers);
+            }
+
+            m_size -= image.byteCount();
+
+            return image;
+        }
+    }
+
+    return QImage(width, height, QImage::Format_RGB32);
+}
+
+void ImageBufferPool::recycle(QImage& image)
+{
+    // Only buffers which are not shared with a pixmap or a pending paint can be handed out again.
+
+    if(image.isNull() || !image.isDetached() || image.format() != QImage::Format_RGB32)
+    {
+        image = QImage();
+
+        return;
+    }
+
+    QMutexLocker mutexLocker(&m_mutex);
+
+    QList< QImage >& buffers = m_buffers[qMakePair(image.width(), image.height())];
+
+    if(m_size + image.byteCount() <= maxSize && buffers.count() < maxBuffersPerSize)
+    {
+        m_size += image.byteCount();
+
+        buffers.append(image);
+    }
+    else if(buffers.isEmpty())
+    {
+        m_buffers.remove(qMakePair(image.width(), image.height()));
+    }
+
+    image = QImage();
+}
+
+void ImageBufferPool::clear()
+{
+    QMutexLocker mutexLocker(&m_mutex);
+
+    m_buffers.clear();
+    m_size = 0;
+}
+
+ImageBufferPool::ImageBufferPool() :
+    m_mutex(),
+    m_buffers(),
+    m_size(0)
+{
+}
+
+} // qpdfview
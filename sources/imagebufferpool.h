@@ -0,0 +1,66 @@
+/*
+
+Copyright 2014 Adam Reichold
+
+This file is part of qpdfview.
+
+qpdfview is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+qpdfview is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef IMAGEBUFFERPOOL_H
+#define IMAGEBUFFERPOOL_H
+
+#include <QHash>
+#include <QImage>
+#include <QList>
+#include <QMutex>
+#include <QPair>
+
+#include "model.h"
+
+namespace qpdfview
+{
+
+// Keeps the buffers of evicted tiles so that the render workers can reuse them for tiles of the same size.
+
+class ImageBufferPool : public Model::ImageAllocator
+{
+public:
+    static ImageBufferPool* instance();
+    ~ImageBufferPool();
+
+    QImage allocate(int width, int height);
+    void recycle(QImage& image);
+
+    void clear();
+
+private:
+    Q_DISABLE_COPY(ImageBufferPool)
+
+    static ImageBufferPool* s_instance;
+    ImageBufferPool();
+
+    QMutex m_mutex;
+
+    typedef QPair< int, int > Size;
+
+    QHash< Size, QList< QImage > > m_buffers;
+    qint64 m_size;
+
+};
+
+} // qpdfview
+
+#endif // IMAGEBUFFERPOOL_H
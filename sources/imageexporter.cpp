@@ -0,0 +1,253 @@
+/*
+
+Copyright 2014 Adam Reichold
+
+This file is part of qpdfview.
+
+qpdfview is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+qpdfview is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "imageexporter.h"
+
+#include <qmath.h>
+#include <QDebug>
+#include <QImageWriter>
+#include <QtConcurrentRun>
+
+#include "imagebufferpool.h"
+#include "model.h"
+#include "renderscheduler.h"
+#include "rendertask.h"
+#include "tracing.h"
+
+namespace
+{
+
+using namespace qpdfview;
+
+bool writeImage(QImage image, const QString& fileName, const QByteArray& format)
+{
+    const TraceSpan span("export", "write");
+
+    QImageWriter writer(fileName, format);
+
+    const bool ok = writer.write(image);
+
+    if(!ok)
+    {
+        qWarning() << QObject::tr("Could not write '%1': %2").arg(fileName, writer.errorString());
+    }
+
+    ImageBufferPool::instance()->recycle(image);
+
+    return ok;
+}
+
+} // anonymous
+
+namespace qpdfview
+{
+
+ImageExporter::ImageExporter(QObject* parent) : QObject(parent),
+    m_resolution(72),
+    m_format(),
+    m_convertToGrayscale(false),
+    m_invertColors(false),
+    m_trimMargins(false),
+    m_paperColor(Qt::white),
+    m_document(0),
+    m_fileNamePattern(),
+    m_fieldWidth(1),
+    m_nextIndex(0),
+    m_lastIndex(-1),
+    m_failedCount(0),
+    m_maxImageCount(1),
+    m_idleTasks(),
+    m_activeJobs(),
+    m_writeWatchers(),
+    m_eventLoop()
+{
+}
+
+int ImageExporter::exportImages(Model::Document* document, int firstPage, int lastPage, const QString& fileNamePattern)
+{
+    const int numberOfPages = document->numberOfPages();
+
+    m_document = document;
+    m_fileNamePattern = fileNamePattern;
+    m_fieldWidth = QString::number(numberOfPages).length();
+
+    m_nextIndex = qMax(firstPage, 1) - 1;
+    m_lastIndex = (lastPage < 0 ? numberOfPages : qMin(lastPage, numberOfPages)) - 1;
+    m_failedCount = 0;
+
+    // Every render thread gets a second image which is encoded while the next one is rendered.
+
+    const int threadCount = RenderScheduler::instance()->maxThreadCount();
+
+    m_maxImageCount = 2 * threadCount;
+
+    while(m_idleTasks.count() < threadCount)
+    {
+        RenderTask* renderTask = new RenderTask(0, this);
+
+        connect(renderTask, SIGNAL(finished()), SLOT(on_renderTask_finished()));
+        connect(renderTask, SIGNAL(imageReady(RenderParam,QRect,bool,QImage,QRectF)), SLOT(on_renderTask_imageReady(RenderParam,QRect,bool,QImage,QRectF)));
+
+        m_idleTasks.append(renderTask);
+    }
+
+    dispatch();
+
+    if(!m_activeJobs.isEmpty())
+    {
+        m_eventLoop.exec();
+    }
+
+    m_document = 0;
+
+    return m_failedCount;
+}
+
+void ImageExporter::on_renderTask_imageReady(const RenderParam& renderParam,
+                                             const QRect& rect, bool prefetch,
+                                             QImage image, QRectF cropRect)
+{
+    Q_UNUSED(renderParam);
+    Q_UNUSED(prefetch);
+
+    RenderTask* renderTask = qobject_cast< RenderTask* >(sender());
+
+    QHash< RenderTask*, Job >::iterator job = m_activeJobs.find(renderTask);
+
+    if(job == m_activeJobs.end() || image.isNull())
+    {
+        return;
+    }
+
+    job.value().imageReady = true;
+
+    if(m_trimMargins && !cropRect.isNull())
+    {
+        const QRect trimmedRect(qRound(cropRect.left() * rect.width()), qRound(cropRect.top() * rect.height()),
+                                qRound(cropRect.width() * rect.width()), qRound(cropRect.height() * rect.height()));
+
+        QImage trimmedImage = image.copy(trimmedRect);
+
+        ImageBufferPool::instance()->recycle(image);
+
+        image = trimmedImage;
+    }
+
+    QFutureWatcher< bool >* writeWatcher = new QFutureWatcher< bool >(this);
+
+    connect(writeWatcher, SIGNAL(finished()), SLOT(on_writeJob_finished()));
+
+    writeWatcher->setFuture(QtConcurrent::run(writeImage, image, fileName(job.value().index), m_format));
+
+    m_writeWatchers.append(writeWatcher);
+}
+
+void ImageExporter::on_renderTask_finished()
+{
+    RenderTask* renderTask = qobject_cast< RenderTask* >(sender());
+
+    if(!m_activeJobs.contains(renderTask))
+    {
+        return;
+    }
+
+    const Job job = m_activeJobs.take(renderTask);
+
+    if(!job.imageReady)
+    {
+        qWarning() << QObject::tr("Could not render page %1.").arg(job.index + 1);
+
+        ++m_failedCount;
+    }
+
+    // The finished signal is emitted right before the task stops running.
+
+    renderTask->wait();
+
+    delete job.page;
+
+    m_idleTasks.append(renderTask);
+
+    dispatch();
+}
+
+void ImageExporter::on_writeJob_finished()
+{
+    QFutureWatcher< bool >* writeWatcher = static_cast< QFutureWatcher< bool >* >(sender());
+
+    if(!writeWatcher->result())
+    {
+        ++m_failedCount;
+    }
+
+    m_writeWatchers.removeAll(writeWatcher);
+    writeWatcher->deleteLater();
+
+    dispatch();
+}
+
+void ImageExporter::dispatch()
+{
+    while(!m_idleTasks.isEmpty() && m_nextIndex <= m_lastIndex && m_activeJobs.count() + m_writeWatchers.count() < m_maxImageCount)
+    {
+        const int index = m_nextIndex++;
+
+        Model::Page* page = m_document->page(index);
+
+        if(page == 0)
+        {
+            qWarning() << QObject::tr("Could not load page %1.").arg(index + 1);
+
+            ++m_failedCount;
+
+            continue;
+        }
+
+        const QSizeF size = page->size() * m_resolution / 72.0;
+        const QRect rect(0, 0, qCeil(size.width()), qCeil(size.height()));
+
+        const RenderParam renderParam(RenderResolution(m_resolution, m_resolution), 1.0, RotateBy0, m_invertColors, m_convertToGrayscale);
+
+        RenderTask* renderTask = m_idleTasks.takeLast();
+
+        Job job;
+        job.index = index;
+        job.page = page;
+        job.imageReady = false;
+
+        m_activeJobs.insert(renderTask, job);
+
+        renderTask->setPage(page);
+        renderTask->start(renderParam, rect, false, m_trimMargins, m_paperColor, RenderScheduler::PrintPriority, this);
+    }
+
+    if(m_activeJobs.isEmpty() && m_writeWatchers.isEmpty() && m_nextIndex > m_lastIndex)
+    {
+        m_eventLoop.quit();
+    }
+}
+
+QString ImageExporter::fileName(int index) const
+{
+    return QString(m_fileNamePattern).replace(QLatin1String("%1"), QString("%1").arg(index + 1, m_fieldWidth, 10, QLatin1Char('0')));
+}
+
+} // qpdfview
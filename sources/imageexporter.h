@@ -0,0 +1,131 @@
+/*
+
+Copyright 2014 Adam Reichold
+
+This file is part of qpdfview.
+
+qpdfview is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+qpdfview is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef IMAGEEXPORTER_H
+#define IMAGEEXPORTER_H
+
+#include <QColor>
+#include <QEventLoop>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QImage>
+#include <QList>
+#include <QObject>
+#include <QRectF>
+
+#include "global.h"
+
+namespace qpdfview
+{
+
+namespace Model
+{
+class Document;
+class Page;
+}
+
+class RenderTask;
+
+// Renders pages through the same tasks as the viewer and streams the encoded images to disk without showing any windows.
+
+class ImageExporter : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ImageExporter(QObject* parent = 0);
+
+    inline int resolution() const { return m_resolution; }
+    inline void setResolution(int resolution) { m_resolution = resolution; }
+
+    // empty if the format is deduced from the suffix of the file name
+    inline const QByteArray& format() const { return m_format; }
+    inline void setFormat(const QByteArray& format) { m_format = format; }
+
+    inline bool convertToGrayscale() const { return m_convertToGrayscale; }
+    inline void setConvertToGrayscale(bool convertToGrayscale) { m_convertToGrayscale = convertToGrayscale; }
+
+    inline bool invertColors() const { return m_invertColors; }
+    inline void setInvertColors(bool invertColors) { m_invertColors = invertColors; }
+
+    inline bool trimMargins() const { return m_trimMargins; }
+    inline void setTrimMargins(bool trimMargins) { m_trimMargins = trimMargins; }
+
+    inline const QColor& paperColor() const { return m_paperColor; }
+    inline void setPaperColor(const QColor& paperColor) { m_paperColor = paperColor; }
+
+    // Every "%1" in the pattern is replaced by the zero-padded page number and a negative last page exports until the end. Returns the number of pages which could not be exported.
+    int exportImages(Model::Document* document, int firstPage, int lastPage, const QString& fileNamePattern);
+
+protected slots:
+    void on_renderTask_imageReady(const RenderParam& renderParam,
+                                  const QRect& rect, bool prefetch,
+                                  QImage image, QRectF cropRect);
+    void on_renderTask_finished();
+
+    void on_writeJob_finished();
+
+private:
+    Q_DISABLE_COPY(ImageExporter)
+
+    int m_resolution;
+    QByteArray m_format;
+
+    bool m_convertToGrayscale;
+    bool m_invertColors;
+    bool m_trimMargins;
+    QColor m_paperColor;
+
+    Model::Document* m_document;
+    QString m_fileNamePattern;
+    int m_fieldWidth;
+
+    int m_nextIndex;
+    int m_lastIndex;
+    int m_failedCount;
+
+    // At most this many images are being rendered or written at once, which bounds the memory held.
+    int m_maxImageCount;
+
+    struct Job
+    {
+        int index;
+        Model::Page* page;
+        bool imageReady;
+
+    };
+
+    QList< RenderTask* > m_idleTasks;
+    QHash< RenderTask*, Job > m_activeJobs;
+
+    QList< QFutureWatcher< bool >* > m_writeWatchers;
+
+    QEventLoop m_eventLoop;
+
+    void dispatch();
+
+    QString fileName(int index) const;
+
+};
+
+} // qpdfview
+
+#endif // IMAGEEXPORTER_H
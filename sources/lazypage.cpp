@@ -0,0 +1,435 @@
+/*
+
+Copyright 2014 Adam Reichold
+
+This file is part of qpdfview.
+
+qpdfview is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+qpdfview is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "lazypage.h"
+
+#include <QCache>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFileInfo>
+#include <QImage>
+#include <QThread>
+
+#include "renderworkerpool.h"
+#include "textlayout.h"
+
+namespace
+{
+
+using namespace qpdfview;
+
+typedef QSharedPointer< const TextLayout > TextLayoutPointer;
+
+const int textLayoutCacheCost = 32 * 1024 * 1024;
+
+QMutex textLayoutMutex;
+QCache< const LazyPage*, TextLayoutPointer > textLayoutCache(textLayoutCacheCost);
+
+} // anonymous
+
+namespace qpdfview
+{
+
+LazyPage::LazyPage(const Model::Document* document, int index, const QSizeF& sizeHint, QObject* parent) : QObject(parent),
+    m_document(document),
+    m_index(index),
+    m_sizeHint(sizeHint),
+    m_sizeHintIsExact(false),
+    m_labelHint(),
+    m_cropRectHint(),
+    m_filePath(),
+    m_lastModified(),
+    m_paperColor(),
+    m_mutex(),
+    m_page(0),
+    m_failed(false)
+{
+}
+
+LazyPage::~LazyPage()
+{
+    {
+        QMutexLocker mutexLocker(&textLayoutMutex);
+
+        textLayoutCache.remove(this);
+    }
+
+    delete m_page;
+}
+
+bool LazyPage::isCreated() const
+{
+    QMutexLocker mutexLocker(&m_mutex);
+
+    return m_page != 0;
+}
+
+bool LazyPage::create() const
+{
+    return page() != 0;
+}
+
+void LazyPage::setHints(const QSizeF& size, const QString& label, const QRectF& cropRect)
+{
+    QMutexLocker mutexLocker(&m_mutex);
+
+    if(m_page == 0)
+    {
+        if(size.isValid())
+        {
+            m_sizeHint = size;
+            m_sizeHintIsExact = true;
+        }
+
+        m_labelHint = label;
+    }
+
+    m_cropRectHint = cropRect;
+}
+
+void LazyPage::setFilePath(const QString& filePath)
+{
+    QMutexLocker mutexLocker(&m_mutex);
+
+    m_filePath = filePath;
+    m_lastModified = filePath.isNull() ? QDateTime() : QFileInfo(filePath).lastModified();
+}
+
+void LazyPage::setPaperColor(const QColor& paperColor)
+{
+    QMutexLocker mutexLocker(&m_mutex);
+
+    m_paperColor = paperColor;
+}
+
+QSizeF LazyPage::knownSize() const
+{
+    QMutexLocker mutexLocker(&m_mutex);
+
+    return m_page != 0 || m_sizeHintIsExact ? m_sizeHint : QSizeF();
+}
+
+QString LazyPage::knownLabel() const
+{
+    if(!m_document->hasPageLabels())
+    {
+        return QLatin1String("");
+    }
+
+    QMutexLocker mutexLocker(&m_mutex);
+
+    return m_labelHint;
+}
+
+QSizeF LazyPage::size() const
+{
+    {
+        QMutexLocker mutexLocker(&m_mutex);
+
+        if(m_page == 0 && m_sizeHint.isValid())
+        {
+            return m_sizeHint;
+        }
+    }
+
+    Model::Page* page = this->page();
+
+    if(page != 0)
+    {
+        return page->size();
+    }
+
+    QMutexLocker mutexLocker(&m_mutex);
+
+    return m_sizeHint;
+}
+
+QImage LazyPage::render(qreal horizontalResolution, qreal verticalResolution, Rotation rotation, const QRect& boundingRect, const Model::CancellationToken* cancellation, Model::ImageAllocator* allocator) const
+{
+    QString filePath;
+    QDateTime lastModified;
+    QColor paperColor;
+
+    {
+        QMutexLocker mutexLocker(&m_mutex);
+
+        filePath = m_filePath;
+        lastModified = m_lastModified;
+        paperColor = m_paperColor;
+    }
+
+    // Waiting for a worker process would block the user interface, so only the render threads hand their pages over.
+
+    if(!filePath.isNull() && QThread::currentThread() != QCoreApplication::instance()->thread())
+    {
+        QImage image;
+
+        if(RenderWorkerPool::instance()->render(filePath, lastModified, paperColor, m_index, size(), horizontalResolution, verticalResolution, rotation, boundingRect, cancellation, allocator, image))
+        {
+            return image;
+        }
+    }
+
+    Model::Page* page = this->page();
+
+    return page != 0 ? page->render(horizontalResolution, verticalResolution, rotation, boundingRect, cancellation, allocator) : QImage();
+}
+
+QImage LazyPage::thumbnail() const
+{
+    // Like the worker processes, the embedded thumbnail only knows the file and not the changes made since it was loaded.
+
+    {
+        QMutexLocker mutexLocker(&m_mutex);
+
+        if(m_filePath.isNull())
+        {
+            return QImage();
+        }
+    }
+
+    Model::Page* page = this->page();
+
+    return page != 0 ? page->thumbnail() : QImage();
+}
+
+QString LazyPage::label() const
+{
+    if(!m_document->hasPageLabels())
+    {
+        return QString();
+    }
+
+    {
+        QMutexLocker mutexLocker(&m_mutex);
+
+        if(!m_labelHint.isNull())
+        {
+            return m_labelHint;
+        }
+    }
+
+    Model::Page* page = this->page();
+
+    return page != 0 ? page->label() : QString();
+}
+
+QList< Model::Link* > LazyPage::links() const
+{
+    Model::Page* page = this->page();
+
+    return page != 0 ? page->links() : QList< Model::Link* >();
+}
+
+QString LazyPage::text(const QRectF& rect) const
+{
+    const TextLayoutPointer textLayout = this->textLayout();
+
+    if(!textLayout->isEmpty())
+    {
+        return textLayout->text(rect);
+    }
+
+    Model::Page* page = this->page();
+
+    return page != 0 ? page->text(rect) : QString();
+}
+
+QString LazyPage::surroundingText(const QRectF& rect) const
+{
+    if(rect.isEmpty())
+    {
+        return QString();
+    }
+
+    // Fetch at most half of a line as centered on the given rectangle as possible.
+    const qreal pageWidth = size().width();
+    const qreal width = qMax(rect.width(), pageWidth / qreal(2));
+    const qreal x = qBound(qreal(0), rect.x() + rect.width() / qreal(2) - width / qreal(2), pageWidth - width);
+
+    const QRectF surroundingRect(x, rect.top(), width, rect.height());
+
+    return text(surroundingRect).simplified();
+}
+
+QList< QRectF > LazyPage::search(const QString& text, bool matchCase) const
+{
+    const TextLayoutPointer textLayout = this->textLayout();
+
+    if(!textLayout->isEmpty())
+    {
+        return textLayout->search(text, matchCase);
+    }
+
+    Model::Page* page = this->page();
+
+    return page != 0 ? page->search(text, matchCase) : QList< QRectF >();
+}
+
+QList< QRectF > LazyPage::search(const QRegExp& pattern) const
+{
+    return textLayout()->search(pattern);
+}
+
+QList< Model::TextBox > LazyPage::textBoxes() const
+{
+    Model::Page* page = this->page();
+
+    return page != 0 ? page->textBoxes() : QList< Model::TextBox >();
+}
+
+TextLayoutPointer LazyPage::textLayout() const
+{
+    {
+        QMutexLocker mutexLocker(&textLayoutMutex);
+
+        if(const TextLayoutPointer* textLayout = textLayoutCache.object(this))
+        {
+            return *textLayout;
+        }
+    }
+
+    // Backends which do not provide text boxes yield an empty layout which is cached as well so that they are not asked again.
+
+    const TextLayoutPointer textLayout(new TextLayout(textBoxes()));
+
+    {
+        QMutexLocker mutexLocker(&textLayoutMutex);
+
+        textLayoutCache.insert(this, new TextLayoutPointer(textLayout), qMax(textLayout->cost(), 1));
+    }
+
+    return textLayout;
+}
+
+int LazyPage::textLayoutCost() const
+{
+    QMutexLocker mutexLocker(&textLayoutMutex);
+
+    const TextLayoutPointer* textLayout = textLayoutCache.object(this);
+
+    return textLayout != 0 ? (*textLayout)->cost() : 0;
+}
+
+void LazyPage::releaseTextLayout() const
+{
+    QMutexLocker mutexLocker(&textLayoutMutex);
+
+    textLayoutCache.remove(this);
+}
+
+QList< Model::Annotation* > LazyPage::annotations() const
+{
+    Model::Page* page = this->page();
+
+    return page != 0 ? page->annotations() : QList< Model::Annotation* >();
+}
+
+bool LazyPage::canAddAndRemoveAnnotations() const
+{
+    Model::Page* page = this->page();
+
+    return page != 0 ? page->canAddAndRemoveAnnotations() : false;
+}
+
+Model::Annotation* LazyPage::addTextAnnotation(const QRectF& boundary, const QColor& color)
+{
+    Model::Page* page = this->page();
+
+    return page != 0 ? page->addTextAnnotation(boundary, color) : 0;
+}
+
+Model::Annotation* LazyPage::addHighlightAnnotation(const QRectF& boundary, const QColor& color)
+{
+    Model::Page* page = this->page();
+
+    return page != 0 ? page->addHighlightAnnotation(boundary, color) : 0;
+}
+
+void LazyPage::removeAnnotation(Model::Annotation* annotation)
+{
+    Model::Page* page = this->page();
+
+    if(page != 0)
+    {
+        page->removeAnnotation(annotation);
+    }
+}
+
+QList< Model::FormField* > LazyPage::formFields() const
+{
+    Model::Page* page = this->page();
+
+    return page != 0 ? page->formFields() : QList< Model::FormField* >();
+}
+
+Model::Page* LazyPage::page() const
+{
+    bool sizeCorrected = false;
+
+    {
+        QMutexLocker mutexLocker(&m_mutex);
+
+        if(m_page != 0 || m_failed)
+        {
+            return m_page;
+        }
+
+        m_page = m_document->page(m_index);
+
+        if(m_page == 0)
+        {
+            qWarning() << "No page" << m_index << "could be created.";
+
+            m_failed = true;
+
+            return 0;
+        }
+
+        const QSizeF size = m_page->size();
+
+        sizeCorrected = m_sizeHint.isValid() && m_sizeHint != size;
+
+        m_sizeHint = size;
+        m_sizeHintIsExact = true;
+
+        if(m_document->hasPageLabels())
+        {
+            m_labelHint = m_page->label();
+
+            if(m_labelHint.isNull())
+            {
+                m_labelHint = QLatin1String("");
+            }
+        }
+    }
+
+    // The signal is emitted without holding the mutex as directly connected slots will usually query the corrected size.
+
+    if(sizeCorrected)
+    {
+        emit const_cast< LazyPage* >(this)->sizeCorrected(m_index);
+    }
+
+    return m_page;
+}
+
+} // qpdfview
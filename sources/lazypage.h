@@ -0,0 +1,143 @@
+/*
+
+Copyright 2014 Adam Reichold
+
+This file is part of qpdfview.
+
+qpdfview is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+qpdfview is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef LAZYPAGE_H
+#define LAZYPAGE_H
+
+#include <QColor>
+#include <QDateTime>
+#include <QMutex>
+#include <QObject>
+#include <QSharedPointer>
+
+#include "model.h"
+
+class QRegExp;
+
+namespace qpdfview
+{
+
+class TextLayout;
+
+// Defers creating the backend page until something other than its size is needed, so that opening a document does not touch every page.
+
+class LazyPage : public QObject, public Model::Page
+{
+    Q_OBJECT
+
+public:
+    LazyPage(const Model::Document* document, int index, const QSizeF& sizeHint, QObject* parent = 0);
+    ~LazyPage();
+
+    inline int index() const { return m_index; }
+
+    bool isCreated() const;
+    bool create() const;
+
+    // Geometry restored from the database is used instead of estimates, it is null where it is unknown.
+
+    void setHints(const QSizeF& size, const QString& label, const QRectF& cropRect);
+
+    QSizeF knownSize() const;
+    QString knownLabel() const;
+
+    inline const QRectF& cropRectHint() const { return m_cropRectHint; }
+
+    // Pages of unmodified files can be rendered by worker processes which load the file themselves and use the thumbnails embedded into it, a null path keeps rendering in this process.
+
+    void setFilePath(const QString& filePath);
+
+    // The worker processes load their own documents, so the render state of the document is repeated here.
+
+    void setPaperColor(const QColor& paperColor);
+
+    QSizeF size() const;
+
+    QImage render(qreal horizontalResolution, qreal verticalResolution, Rotation rotation, const QRect& boundingRect, const Model::CancellationToken* cancellation, Model::ImageAllocator* allocator) const;
+    QImage thumbnail() const;
+
+    QString label() const;
+
+    QList< Model::Link* > links() const;
+
+    QString text(const QRectF& rect) const;
+    QList< QRectF > search(const QString& text, bool matchCase) const;
+
+    // Yields the text of at most half a line centered on the given rectangle to give context to search results.
+
+    QString surroundingText(const QRectF& rect) const;
+
+    // Patterns can only be matched against the text layout, so backends which do not provide text boxes yield no results.
+
+    QList< QRectF > search(const QRegExp& pattern) const;
+
+    QList< Model::TextBox > textBoxes() const;
+
+    // The text layout is extracted once and shared by text extraction and search until it is evicted from a cache common to all pages.
+
+    QSharedPointer< const TextLayout > textLayout() const;
+
+    // The bytes of the cached text layout, which is released to stay within the memory limit of a tab.
+
+    int textLayoutCost() const;
+    void releaseTextLayout() const;
+
+    QList< Model::Annotation* > annotations() const;
+
+    bool canAddAndRemoveAnnotations() const;
+    Model::Annotation* addTextAnnotation(const QRectF& boundary, const QColor& color);
+    Model::Annotation* addHighlightAnnotation(const QRectF& boundary, const QColor& color);
+    void removeAnnotation(Model::Annotation* annotation);
+
+    QList< Model::FormField* > formFields() const;
+
+signals:
+    void sizeCorrected(int index);
+
+private:
+    Q_DISABLE_COPY(LazyPage)
+
+    const Model::Document* m_document;
+    int m_index;
+
+    // The hints are corrected when the page is created and are guarded by the mutex like the page itself.
+
+    mutable QSizeF m_sizeHint;
+    mutable bool m_sizeHintIsExact;
+
+    mutable QString m_labelHint;
+    QRectF m_cropRectHint;
+
+    QString m_filePath;
+    QDateTime m_lastModified;
+    QColor m_paperColor;
+
+    mutable QMutex m_mutex;
+    mutable Model::Page* m_page;
+    mutable bool m_failed;
+
+    Model::Page* page() const;
+
+};
+
+} // qpdfview
+
+#endif // LAZYPAGE_H
@@ -0,0 +1,270 @@
+/*
+
+Copyright 2014 Adam Reichold
+
+This file is part of qpdfview.
+
+qpdfview is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+qpdfview is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "linkpreloader.h"
+
+#include <QApplication>
+#include <QFileInfo>
+#include <QtConcurrentRun>
+
+#include "documentregistry.h"
+#include "documentview.h"
+#include "model.h"
+#include "pluginhandler.h"
+#include "tracing.h"
+
+namespace
+{
+
+using namespace qpdfview;
+
+// maximum number of documents which are kept loaded ahead
+const int maxPreloadedDocuments = 4;
+
+// maximum number of documents which are loaded ahead concurrently
+const int maxPendingDocuments = 2;
+
+// extent in pixels of the render which warms up the back-end for the target page
+const qreal warmUpExtent = 256.0;
+
+Model::Document* preloadDocument(const Plugin* plugin, const QString& filePath, int index)
+{
+    const TraceSpan span("document", "preloadDocument");
+
+    Model::Document* document = PluginHandler::loadDocument(plugin, filePath);
+
+    if(document == 0)
+    {
+        return 0;
+    }
+
+    // Locked documents are left to the view which asks for the password.
+
+    if(document->isLocked() || document->numberOfPages() == 0)
+    {
+        delete document;
+
+        return 0;
+    }
+
+    // The tiles of the future view depend on its layout, but parsing the target page and its resources once makes its first render cheap.
+
+    Model::Page* page = document->page(qBound(0, index, document->numberOfPages() - 1));
+
+    if(page != 0)
+    {
+        const QSizeF size = page->size();
+        const qreal extent = qMax(size.width(), size.height());
+
+        if(extent > 0.0)
+        {
+            const qreal resolution = 72.0 * warmUpExtent / extent;
+
+            page->render(resolution, resolution);
+        }
+
+        delete page;
+    }
+
+    return document;
+}
+
+} // anonymous
+
+namespace qpdfview
+{
+
+LinkPreloader* LinkPreloader::s_instance = 0;
+
+LinkPreloader* LinkPreloader::instance()
+{
+    if(s_instance == 0)
+    {
+        s_instance = new LinkPreloader(qApp);
+    }
+
+    return s_instance;
+}
+
+LinkPreloader::~LinkPreloader()
+{
+    for(QHash< Watcher*, QString >::const_iterator pending = m_pending.constBegin(); pending != m_pending.constEnd(); ++pending)
+    {
+        pending.key()->waitForFinished();
+
+        delete pending.key()->result();
+    }
+
+    m_pending.clear();
+
+    while(!m_loaded.isEmpty())
+    {
+        evict(0);
+    }
+
+    s_instance = 0;
+}
+
+void LinkPreloader::preload(const QString& filePath, int page, bool hovered)
+{
+    const QString absoluteFilePath = QFileInfo(filePath).absoluteFilePath();
+
+    const int index = indexOf(absoluteFilePath);
+
+    if(DocumentRegistry::instance()->contains(absoluteFilePath))
+    {
+        if(index != -1)
+        {
+            m_loaded.move(index, m_loaded.count() - 1);
+        }
+
+        return;
+    }
+
+    // The file was changed since it was loaded ahead, hence the registry does not hand out this document anymore.
+
+    if(index != -1)
+    {
+        evict(index);
+    }
+
+    foreach(const QString& pendingFilePath, m_pending)
+    {
+        if(pendingFilePath == absoluteFilePath)
+        {
+            return;
+        }
+    }
+
+    if(hovered)
+    {
+        if(m_pending.count() >= maxPendingDocuments)
+        {
+            return;
+        }
+    }
+    else
+    {
+        if(m_loaded.count() + m_pending.count() >= maxPreloadedDocuments)
+        {
+            return;
+        }
+    }
+
+    if(!QFileInfo(absoluteFilePath).isFile())
+    {
+        return;
+    }
+
+    const Plugin* plugin = PluginHandler::instance()->pluginForFile(absoluteFilePath);
+
+    if(plugin == 0)
+    {
+        return;
+    }
+
+    Watcher* watcher = new Watcher(this);
+    connect(watcher, SIGNAL(finished()), SLOT(on_preload_finished()));
+
+    m_pending.insert(watcher, absoluteFilePath);
+
+    watcher->setFuture(QtConcurrent::run(preloadDocument, plugin, absoluteFilePath, page - 1));
+}
+
+void LinkPreloader::on_preload_finished()
+{
+    Watcher* watcher = static_cast< Watcher* >(sender());
+
+    if(!m_pending.contains(watcher))
+    {
+        return;
+    }
+
+    const QString filePath = m_pending.take(watcher);
+    Model::Document* document = watcher->result();
+
+    watcher->deleteLater();
+
+    if(document == 0)
+    {
+        return;
+    }
+
+    // A view might have opened the same file while it was being loaded ahead.
+
+    if(DocumentRegistry::instance()->contains(filePath))
+    {
+        delete document;
+
+        return;
+    }
+
+    Entry entry;
+    entry.filePath = filePath;
+    entry.document = document;
+
+    if(!DocumentView::createPages(filePath, document, entry.pages))
+    {
+        qDeleteAll(entry.pages);
+        delete document;
+
+        return;
+    }
+
+    while(m_loaded.count() >= maxPreloadedDocuments)
+    {
+        evict(0);
+    }
+
+    DocumentRegistry::instance()->insert(filePath, entry.document, entry.pages);
+
+    m_loaded.append(entry);
+}
+
+LinkPreloader::LinkPreloader(QObject* parent) : QObject(parent),
+    m_pending(),
+    m_loaded()
+{
+}
+
+int LinkPreloader::indexOf(const QString& filePath) const
+{
+    for(int index = 0; index < m_loaded.count(); ++index)
+    {
+        if(m_loaded.at(index).filePath == filePath)
+        {
+            return index;
+        }
+    }
+
+    return -1;
+}
+
+void LinkPreloader::evict(int index)
+{
+    const Entry entry = m_loaded.takeAt(index);
+
+    // Views which acquired the document meanwhile keep it alive.
+
+    DocumentRegistry::instance()->release(entry.document, entry.pages);
+}
+
+} // qpdfview
@@ -0,0 +1,86 @@
+/*
+
+Copyright 2014 Adam Reichold
+
+This file is part of qpdfview.
+
+qpdfview is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+qpdfview is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef LINKPRELOADER_H
+#define LINKPRELOADER_H
+
+#include <QFutureWatcher>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QVector>
+
+namespace qpdfview
+{
+
+namespace Model
+{
+class Document;
+class Page;
+}
+
+// Documents targeted by links are loaded ahead into the document registry so that following such a link opens them immediately.
+
+class LinkPreloader : public QObject
+{
+    Q_OBJECT
+
+public:
+    static LinkPreloader* instance();
+    ~LinkPreloader();
+
+    // Hovered links may displace older documents, whereas links which merely became visible only use spare capacity.
+
+    void preload(const QString& filePath, int page, bool hovered);
+
+protected slots:
+    void on_preload_finished();
+
+private:
+    Q_DISABLE_COPY(LinkPreloader)
+
+    static LinkPreloader* s_instance;
+    LinkPreloader(QObject* parent = 0);
+
+    typedef QFutureWatcher< Model::Document* > Watcher;
+
+    QHash< Watcher*, QString > m_pending;
+
+    struct Entry
+    {
+        QString filePath;
+        Model::Document* document;
+        QVector< Model::Page* > pages;
+
+    };
+
+    // least recently requested first
+    QList< Entry > m_loaded;
+
+    int indexOf(const QString& filePath) const;
+
+    void evict(int index);
+
+};
+
+} // qpdfview
+
+#endif // LINKPRELOADER_H
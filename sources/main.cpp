@@ -27,10 +27,15 @@ along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
 #include <QApplication>
 #include <QDebug>
 #include <QDir>
+#include <QFileInfo>
+#include <QHash>
+#include <QImageWriter>
 #include <QInputDialog>
 #include <QLibraryInfo>
 #include <QMessageBox>
+#include <QRegExp>
 #include <QScopedPointer>
+#include <QSharedPointer>
 #include <QTranslator>
 
 #ifdef WITH_DBUS
@@ -40,15 +45,15 @@ along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
 
 #endif // WITH_DBUS
 
-#ifdef WITH_SYNCTEX
-
-#include <synctex_parser.h>
-
-#endif // WITH_SYNCTEX
-
 #include "documentview.h"
 #include "database.h"
+#include "imageexporter.h"
 #include "mainwindow.h"
+#include "model.h"
+#include "pluginhandler.h"
+#include "renderworkerpool.h"
+#include "settings.h"
+#include "tracing.h"
 
 #ifdef WITH_SIGNALS
 
@@ -56,6 +61,12 @@ along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
 
 #endif // WITH_SIGNALS
 
+#ifdef WITH_SYNCTEX
+
+#include "synctexscanner.h"
+
+#endif // WITH_SYNCTEX
+
 #ifdef __amigaos4__
 
 #include <proto/dos.h>
@@ -90,14 +101,28 @@ enum ExitStatus
     ExitUnknownArgument = 1,
     ExitIllegalArgument = 2,
     ExitInconsistentArguments = 3,
-    ExitDBusError = 4
+    ExitDBusError = 4,
+    ExitExportError = 5
 };
 
 bool unique = false;
+bool resident = false;
 bool quiet = false;
 
 QString instanceName;
 QString searchText;
+QString traceFilePath;
+
+// Exporting images replaces opening the files if a file name pattern is given.
+
+QString exportPattern;
+int exportFirstPage = 1;
+int exportLastPage = -1;
+int exportResolution = 150;
+QByteArray exportFormat;
+bool exportGrayscale = false;
+bool exportInvertColors = false;
+bool exportTrimMargins = false;
 
 QList< File > files;
 
@@ -125,15 +150,47 @@ void loadTranslators()
 #endif // QT_VERSION
 }
 
+bool isExportRequested(int argc, char** argv)
+{
+    for(int index = 1; index < argc; ++index)
+    {
+        if(qstrcmp(argv[index], "--") == 0)
+        {
+            break;
+        }
+
+        if(qstrcmp(argv[index], "--export-images") == 0)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Worker processes are started with this as their only argument and bypass the usual command line.
+
+bool isRenderWorkerRequested(int argc, char** argv)
+{
+    return argc == 2 && qstrcmp(argv[1], "--render-worker") == 0;
+}
+
 void parseCommandLineArguments()
 {
     bool instanceNameIsNext = false;
     bool searchTextIsNext = false;
+    bool traceFileIsNext = false;
+    bool exportPatternIsNext = false;
+    bool exportPagesIsNext = false;
+    bool exportResolutionIsNext = false;
+    bool exportFormatIsNext = false;
+    bool exportOptionUsed = false;
     bool noMoreOptions = false;
 
     QRegExp fileAndPageRegExp("(.+)#(\\d+)");
     QRegExp fileAndSourceRegExp("(.+)#src:(.+):(\\d+):(\\d+)");
     QRegExp instanceNameRegExp("[A-Za-z_]+[A-Za-z0-9_]*");
+    QRegExp pagesRegExp("(\\d+)-(\\d*)");
 
     QStringList arguments = QApplication::arguments();
 
@@ -166,12 +223,82 @@ void parseCommandLineArguments()
             searchTextIsNext = false;
             searchText = argument;
         }
+        else if(traceFileIsNext)
+        {
+            if(argument.isEmpty())
+            {
+                qCritical() << QObject::tr("An empty trace file is not allowed.");
+                exit(ExitIllegalArgument);
+            }
+
+            traceFileIsNext = false;
+            traceFilePath = argument;
+        }
+        else if(exportPatternIsNext)
+        {
+            if(!argument.contains(QLatin1String("%1")))
+            {
+                qCritical() << QObject::tr("The file name pattern of '--export-images' must contain '%1' for the page number.");
+                exit(ExitIllegalArgument);
+            }
+
+            exportPatternIsNext = false;
+            exportPattern = argument;
+        }
+        else if(exportPagesIsNext)
+        {
+            if(!pagesRegExp.exactMatch(argument))
+            {
+                qCritical() << QObject::tr("The argument of '--pages' must be a range like '3-7' or '3-'.");
+                exit(ExitIllegalArgument);
+            }
+
+            exportPagesIsNext = false;
+            exportFirstPage = qMax(pagesRegExp.cap(1).toInt(), 1);
+            exportLastPage = pagesRegExp.cap(2).isEmpty() ? -1 : pagesRegExp.cap(2).toInt();
+
+            if(exportLastPage != -1 && exportLastPage < exportFirstPage)
+            {
+                qCritical() << QObject::tr("The last page of '--pages' must not be smaller than the first one.");
+                exit(ExitIllegalArgument);
+            }
+        }
+        else if(exportResolutionIsNext)
+        {
+            bool ok = false;
+            const int resolution = argument.toInt(&ok);
+
+            if(!ok || resolution < 1)
+            {
+                qCritical() << QObject::tr("The argument of '--resolution' must be an integer of at least 1.");
+                exit(ExitIllegalArgument);
+            }
+
+            exportResolutionIsNext = false;
+            exportResolution = resolution;
+        }
+        else if(exportFormatIsNext)
+        {
+            if(!QImageWriter::supportedImageFormats().contains(argument.toLatin1().toLower()))
+            {
+                qCritical() << QObject::tr("The image format '%1' is not supported.").arg(argument);
+                exit(ExitIllegalArgument);
+            }
+
+            exportFormatIsNext = false;
+            exportFormat = argument.toLatin1().toLower();
+        }
         else if(!noMoreOptions && argument.startsWith("--"))
         {
             if(argument == QLatin1String("--unique"))
             {
                 unique = true;
             }
+            else if(argument == QLatin1String("--resident"))
+            {
+                unique = true;
+                resident = true;
+            }
             else if(argument == QLatin1String("--quiet"))
             {
                 quiet = true;
@@ -184,6 +311,38 @@ void parseCommandLineArguments()
             {
                 searchTextIsNext = true;
             }
+            else if(argument == QLatin1String("--trace"))
+            {
+                traceFileIsNext = true;
+            }
+            else if(argument == QLatin1String("--export-images"))
+            {
+                exportPatternIsNext = true;
+            }
+            else if(argument == QLatin1String("--pages"))
+            {
+                exportPagesIsNext = exportOptionUsed = true;
+            }
+            else if(argument == QLatin1String("--resolution"))
+            {
+                exportResolutionIsNext = exportOptionUsed = true;
+            }
+            else if(argument == QLatin1String("--format"))
+            {
+                exportFormatIsNext = exportOptionUsed = true;
+            }
+            else if(argument == QLatin1String("--grayscale"))
+            {
+                exportGrayscale = exportOptionUsed = true;
+            }
+            else if(argument == QLatin1String("--invert-colors"))
+            {
+                exportInvertColors = exportOptionUsed = true;
+            }
+            else if(argument == QLatin1String("--trim-margins"))
+            {
+                exportTrimMargins = exportOptionUsed = true;
+            }
             else if(argument == QLatin1String("--choose-instance"))
             {
                 bool ok = false;
@@ -205,6 +364,16 @@ void parseCommandLineArguments()
                           << "  --unique                    Open files as tabs in unique window" << std::endl
                           << "  --unique --instance name    Open files as tabs in named instance" << std::endl
                           << "  --unique --choose-instance  Open files as tabs after choosing an instance name" << std::endl
+                          << "  --resident                  Keep a hidden unique instance running to open files quickly" << std::endl
+                          << "  --trace file                Write a timeline of render and search activity to file" << std::endl
+                          << std::endl
+                          << "  --export-images pattern     Write the pages as images named by replacing %1 with the page number" << std::endl
+                          << "  --pages first-[last]        Export only the given range of pages" << std::endl
+                          << "  --resolution dpi            Export at the given resolution (default: 150)" << std::endl
+                          << "  --format format             Export in the given format instead of deducing it from the pattern" << std::endl
+                          << "  --grayscale                 Export with the colors converted to grayscale" << std::endl
+                          << "  --invert-colors             Export with inverted colors" << std::endl
+                          << "  --trim-margins              Export with the margins trimmed" << std::endl
                           << std::endl
                           << "Please report bugs at \"https://launchpad.net/qpdfview\"." << std::endl;
 
@@ -268,6 +437,36 @@ void parseCommandLineArguments()
         qCritical() << QObject::tr("Using '--search' requires a search text.");
         exit(ExitInconsistentArguments);
     }
+
+    if(traceFileIsNext)
+    {
+        qCritical() << QObject::tr("Using '--trace' requires a trace file.");
+        exit(ExitInconsistentArguments);
+    }
+
+    if(exportPatternIsNext)
+    {
+        qCritical() << QObject::tr("Using '--export-images' requires a file name pattern.");
+        exit(ExitInconsistentArguments);
+    }
+
+    if(exportPagesIsNext || exportResolutionIsNext || exportFormatIsNext)
+    {
+        qCritical() << QObject::tr("Using '--pages', '--resolution' or '--format' requires an argument.");
+        exit(ExitInconsistentArguments);
+    }
+
+    if(exportPattern.isEmpty() && exportOptionUsed)
+    {
+        qCritical() << QObject::tr("Using export options is not allowed without using '--export-images'.");
+        exit(ExitInconsistentArguments);
+    }
+
+    if(!exportPattern.isEmpty() && (unique || !searchText.isEmpty()))
+    {
+        qCritical() << QObject::tr("Using '--export-images' is not allowed together with '--unique' or '--search'.");
+        exit(ExitInconsistentArguments);
+    }
 }
 
 void parseWorkbenchExtendedSelection(int argc, char** argv)
@@ -310,36 +509,33 @@ void resolveSourceReferences()
 {
 #ifdef WITH_SYNCTEX
 
+    // The SyncTeX data of every output file is parsed only once, even if it is referenced multiple times.
+
+    QHash< QString, QSharedPointer< SyncTeXScanner > > scanners;
+
     for(int index = 0; index < files.count(); ++index)
     {
         File& file = files[index];
 
         if(!file.sourceName.isNull())
         {
-            synctex_scanner_t scanner = synctex_scanner_new_with_output_file(file.filePath.toLocal8Bit(), 0, 1);
+            QHash< QString, QSharedPointer< SyncTeXScanner > >::iterator scanner = scanners.find(file.filePath);
+
+            if(scanner == scanners.end())
+            {
+                scanner = scanners.insert(file.filePath, QSharedPointer< SyncTeXScanner >(SyncTeXScanner::load(file.filePath)));
+            }
 
-            if(scanner != 0)
+            if(!scanner.value().isNull())
             {
-                if(synctex_display_query(scanner, file.sourceName.toLocal8Bit(), file.sourceLine, file.sourceColumn) > 0)
+                int page = -1;
+                QRectF enclosingBox;
+
+                if(scanner.value()->findPosition(file.sourceName, file.sourceLine, file.sourceColumn, page, enclosingBox))
                 {
-                    for(synctex_node_t node = synctex_next_result(scanner); node != 0; node = synctex_next_result(scanner))
-                    {
-                        int page = synctex_node_page(node);
-                        QRectF enclosingBox(synctex_node_box_visible_h(node), synctex_node_box_visible_v(node), synctex_node_box_visible_width(node), synctex_node_box_visible_height(node));
-
-                        if(file.page != page)
-                        {
-                            file.page = page;
-                            file.enclosingBox = enclosingBox;
-                        }
-                        else
-                        {
-                            file.enclosingBox = file.enclosingBox.united(enclosingBox);
-                        }
-                    }
+                    file.page = page;
+                    file.enclosingBox = enclosingBox;
                 }
-
-                synctex_scanner_free(scanner);
             }
             else
             {
@@ -351,6 +547,57 @@ void resolveSourceReferences()
 #endif // WITH_SYNCTEX
 }
 
+int exportImages()
+{
+    ImageExporter imageExporter;
+
+    imageExporter.setResolution(exportResolution);
+    imageExporter.setFormat(exportFormat);
+    imageExporter.setConvertToGrayscale(exportGrayscale);
+    imageExporter.setInvertColors(exportInvertColors);
+    imageExporter.setTrimMargins(exportTrimMargins);
+    imageExporter.setPaperColor(Settings::instance()->pageItem().paperColor());
+
+    int exitCode = ExitOk;
+
+    foreach(const File& file, files)
+    {
+        const QScopedPointer< Model::Document > document(PluginHandler::instance()->loadDocument(file.filePath));
+
+        if(document == 0 || document->isLocked())
+        {
+            qCritical() << QObject::tr("Could not open '%1'.").arg(file.filePath);
+
+            exitCode = ExitExportError;
+            continue;
+        }
+
+        // The paper color is applied by the plug-ins as well, so that the images match the viewer.
+
+        document->setPaperColor(Settings::instance()->pageItem().paperColor());
+
+        // Several files are exported side by side if the pattern does not separate them by itself.
+
+        QString pattern = exportPattern;
+
+        if(files.count() > 1 && !pattern.contains(QLatin1String("%2")))
+        {
+            const QFileInfo patternInfo(pattern);
+
+            pattern = patternInfo.dir().filePath(QFileInfo(file.filePath).completeBaseName() + QLatin1Char('-') + patternInfo.fileName());
+        }
+
+        pattern.replace(QLatin1String("%2"), QFileInfo(file.filePath).completeBaseName());
+
+        if(imageExporter.exportImages(document.data(), exportFirstPage, exportLastPage, pattern) > 0)
+        {
+            exitCode = ExitExportError;
+        }
+    }
+
+    return exitCode;
+}
+
 void activateUniqueInstance()
 {
     qApp->setObjectName(instanceName);
@@ -413,6 +660,8 @@ void activateUniqueInstance()
                 delete mainWindow;
                 exit(ExitDBusError);
             }
+
+            mainWindow->setResident(resident);
         }
 
         return;
@@ -439,6 +688,12 @@ void prepareSignalHandler()
 
         QObject::connect(signalHandler, SIGNAL(sigIntReceived()), mainWindow, SLOT(close()));
         QObject::connect(signalHandler, SIGNAL(sigTermReceived()), mainWindow, SLOT(close()));
+
+        if(mainWindow->isResident())
+        {
+            QObject::connect(signalHandler, SIGNAL(sigIntReceived()), qApp, SLOT(quit()));
+            QObject::connect(signalHandler, SIGNAL(sigTermReceived()), qApp, SLOT(quit()));
+        }
     }
     else
     {
@@ -458,6 +713,17 @@ int main(int argc, char** argv)
 
     parseWorkbenchExtendedSelection(argc, argv);
 
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+
+    // Exporting images and render workers do not show any windows and should run without a display.
+
+    if((isExportRequested(argc, argv) || isRenderWorkerRequested(argc, argv)) && qgetenv("QT_QPA_PLATFORM").isEmpty())
+    {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
+#endif // QT_VERSION
+
     QApplication application(argc, argv);
 
     QApplication::setOrganizationDomain("local.qpdfview");
@@ -468,18 +734,51 @@ int main(int argc, char** argv)
 
     QApplication::setWindowIcon(QIcon(":icons/qpdfview.svg"));
 
+    if(isRenderWorkerRequested(argc, argv))
+    {
+        return RenderWorkerPool::serve();
+    }
+
     loadTranslators();
 
     parseCommandLineArguments();
 
+    if(!traceFilePath.isEmpty())
+    {
+        Tracing::start(traceFilePath);
+    }
+
+    if(!exportPattern.isEmpty())
+    {
+        const int exitCode = exportImages();
+
+        if(!Tracing::stop())
+        {
+            qWarning() << QObject::tr("Could not write trace to '%1'.").arg(traceFilePath);
+        }
+
+        return exitCode;
+    }
+
     resolveSourceReferences();
 
     activateUniqueInstance();
 
     prepareSignalHandler();
 
-    mainWindow->show();
-    mainWindow->setAttribute(Qt::WA_DeleteOnClose);
+    // A resident instance starts hidden unless it was asked to open files right away.
+
+    if(!mainWindow->isResident() || !files.isEmpty())
+    {
+        mainWindow->show();
+    }
+
+    if(!mainWindow->isResident())
+    {
+        mainWindow->setAttribute(Qt::WA_DeleteOnClose);
+    }
+
+    const QScopedPointer< MainWindow > residentWindow(mainWindow->isResident() ? mainWindow : 0);
 
     foreach(const File& file, files)
     {
@@ -491,5 +790,12 @@ int main(int argc, char** argv)
         mainWindow->startSearch(searchText);
     }
 
-    return application.exec();
+    const int exitCode = application.exec();
+
+    if(!Tracing::stop())
+    {
+        qWarning() << QObject::tr("Could not write trace to '%1'.").arg(traceFilePath);
+    }
+
+    return exitCode;
 }
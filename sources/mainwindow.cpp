@@ -47,6 +47,7 @@ along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
 #include <QToolButton>
 #include <QUrl>
 #include <QVBoxLayout>
+#include <QVector>
 #include <QWidgetAction>
 
 #if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
@@ -56,6 +57,9 @@ along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
 #endif // QT_VERSION
 
 #include "settings.h"
+#include "cachebudget.h"
+#include "imagebufferpool.h"
+#include "pluginhandler.h"
 #include "shortcuthandler.h"
 #include "thumbnailitem.h"
 #include "searchmodel.h"
@@ -64,6 +68,7 @@ along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
 #include "printdialog.h"
 #include "settingsdialog.h"
 #include "fontsdialog.h"
+#include "statisticsdialog.h"
 #include "helpdialog.h"
 #include "recentlyusedmenu.h"
 #include "recentlyclosedmenu.h"
@@ -77,9 +82,24 @@ namespace
 
 using namespace qpdfview;
 
+// Restored tabs which were not activated are opened one after another with this pause in milliseconds.
+const int restoreTabsInterval = 500;
+
+// Background tabs are checked for hibernation with this interval in milliseconds.
+const int hibernateTabsInterval = 60 * 1000;
+
+// The memory used by each tab is accounted and checked against its limit with this interval in milliseconds.
+const int memoryInterval = 2000;
+
 QModelIndex synchronizeOutlineView(int currentPage, TreeView* outlineView, const QModelIndex& parent)
 {
-    for(int row = 0, rowCount = outlineView->model()->rowCount(parent); row < rowCount; ++row)
+    const int rowCount = outlineView->model()->rowCount(parent);
+
+    // Entries without a destination are treated as pointing to the page of the entry before them.
+
+    QVector< int > pages(rowCount, -1);
+
+    for(int row = 0, lastPage = -1; row < rowCount; ++row)
     {
         const QModelIndex index = outlineView->model()->index(row, 0, parent);
 
@@ -90,11 +110,34 @@ QModelIndex synchronizeOutlineView(int currentPage, TreeView* outlineView, const
         {
             return index;
         }
+
+        pages[row] = lastPage = ok ? page : lastPage;
     }
 
-    for(int row = 0, rowCount = outlineView->model()->rowCount(parent); row < rowCount; ++row)
+    for(int row = 0; row < rowCount; ++row)
     {
+        // The children of an entry are expected between its page and the page of the entry after it,
+        // so that only the entries which can contain the current page are fetched.
+
+        if(pages.at(row) > currentPage)
+        {
+            break;
+        }
+
+        if(row + 1 < rowCount && pages.at(row + 1) != -1 && pages.at(row + 1) < currentPage)
+        {
+            continue;
+        }
+
         const QModelIndex index = outlineView->model()->index(row, 0, parent);
+
+        // Entries whose children were not inserted yet are searched as well.
+
+        if(outlineView->model()->canFetchMore(index))
+        {
+            outlineView->model()->fetchMore(index);
+        }
+
         const QModelIndex match = synchronizeOutlineView(currentPage, outlineView, index);
 
         if(match.isValid())
@@ -124,7 +167,8 @@ namespace qpdfview
 Settings* MainWindow::s_settings = 0;
 Database* MainWindow::s_database = 0;
 
-MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent)
+MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent),
+    m_resident(false)
 {
     s_instance = this;
 
@@ -137,6 +181,8 @@ MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent)
 
     prepareStyle();
 
+    preloadPlugins();
+
     setAcceptDrops(true);
 
     createWidgets();
@@ -152,8 +198,11 @@ MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent)
     restoreState(s_settings->mainWindow().state());
 
     m_matchCaseCheckBox->setChecked(s_settings->documentView().matchCase());
+    m_wholeWordsCheckBox->setChecked(s_settings->documentView().wholeWords());
+    m_regularExpressionCheckBox->setChecked(s_settings->documentView().regularExpression());
 
     prepareDatabase();
+    prepareHibernation();
 
     if(s_settings->mainWindow().restoreTabs())
     {
@@ -239,59 +288,13 @@ bool MainWindow::openInNewTab(const QString& filePath, int page, const QRectF& h
 {
     DocumentView* newTab = new DocumentView(this);
 
-    if(newTab->open(filePath))
+    if(newTab->openInBackground(filePath))
     {
-        s_settings->mainWindow().setOpenPath(newTab->fileInfo().absolutePath());
-        m_recentlyUsedMenu->addOpenAction(newTab->fileInfo());
-
-        const int index = addTab(newTab);
-
-        QAction* tabAction = new QAction(m_tabWidget->tabText(index), newTab);
-        connect(tabAction, SIGNAL(triggered()), SLOT(on_tabAction_triggered()));
-
-        m_tabsMenu->addAction(tabAction);
-
-        on_thumbnails_dockLocationChanged(dockWidgetArea(m_thumbnailsDock));
-
-        connect(newTab, SIGNAL(documentChanged()), SLOT(on_currentTab_documentChanged()));
-
-        connect(newTab, SIGNAL(numberOfPagesChanged(int)), SLOT(on_currentTab_numberOfPagesChaned(int)));
-        connect(newTab, SIGNAL(currentPageChanged(int)), SLOT(on_currentTab_currentPageChanged(int)));
-
-        connect(newTab, SIGNAL(canJumpChanged(bool,bool)), SLOT(on_currentTab_canJumpChanged(bool,bool)));
-
-        connect(newTab, SIGNAL(continuousModeChanged(bool)), SLOT(on_currentTab_continuousModeChanged(bool)));
-        connect(newTab, SIGNAL(layoutModeChanged(LayoutMode)), SLOT(on_currentTab_layoutModeChanged(LayoutMode)));
-        connect(newTab, SIGNAL(rightToLeftModeChanged(bool)), SLOT(on_currentTab_rightToLeftModeChanged(bool)));
-        connect(newTab, SIGNAL(scaleModeChanged(ScaleMode)), SLOT(on_currentTab_scaleModeChanged(ScaleMode)));
-        connect(newTab, SIGNAL(scaleFactorChanged(qreal)), SLOT(on_currentTab_scaleFactorChanged(qreal)));
-        connect(newTab, SIGNAL(rotationChanged(Rotation)), SLOT(on_currentTab_rotationChanged(Rotation)));
-
-        connect(newTab, SIGNAL(linkClicked(int)), SLOT(on_currentTab_linkClicked(int)));
-        connect(newTab, SIGNAL(linkClicked(bool,QString,int)), SLOT(on_currentTab_linkClicked(bool,QString,int)));
-
-        connect(newTab, SIGNAL(invertColorsChanged(bool)), SLOT(on_currentTab_invertColorsChanged(bool)));
-        connect(newTab, SIGNAL(convertToGrayscaleChanged(bool)), SLOT(on_currentTab_convertToGrayscale(bool)));
-        connect(newTab, SIGNAL(highlightAllChanged(bool)), SLOT(on_currentTab_highlightAllChanged(bool)));
-        connect(newTab, SIGNAL(rubberBandModeChanged(RubberBandMode)), SLOT(on_currentTab_rubberBandModeChanged(RubberBandMode)));
+        prepareTab(newTab);
 
-        connect(newTab, SIGNAL(searchFinished()), SLOT(on_currentTab_searchFinished()));
-        connect(newTab, SIGNAL(searchProgressChanged(int)), SLOT(on_currentTab_searchProgressChanged(int)));
+        connect(newTab, SIGNAL(openFinished(bool)), SLOT(on_currentTab_openFinished(bool)));
 
-        connect(newTab, SIGNAL(customContextMenuRequested(QPoint)), SLOT(on_currentTab_customContextMenuRequested(QPoint)));
-
-        newTab->show();
-
-        s_database->restorePerFileSettings(newTab);
-        scheduleSaveTabs();
-
-        newTab->jumpToPage(page, false);
-        newTab->setFocus();
-
-        if(!highlight.isNull())
-        {
-            newTab->temporaryHighlight(page, highlight);
-        }
+        m_pendingOpens.insert(newTab, PendingOpen(page, highlight, quiet));
 
         return true;
     }
@@ -318,6 +321,21 @@ bool MainWindow::jumpToPageOrOpenInNewTab(const QString& filePath, int page, boo
         {
             m_tabWidget->setCurrentIndex(index);
 
+            if(currentTab()->isDeferred() && !currentTab()->isOpening())
+            {
+                if(!openRestoredTab(currentTab()))
+                {
+                    return false;
+                }
+            }
+
+            if(currentTab()->isOpening())
+            {
+                m_pendingOpens.insert(currentTab(), PendingOpen(page, highlight, quiet));
+
+                return true;
+            }
+
             if(refreshBeforeJump)
             {
                 if(!currentTab()->refresh())
@@ -414,12 +432,21 @@ void MainWindow::on_tabWidget_currentChanged(int index)
     m_scaleFactorComboBox->setEnabled(hasCurrent);
     m_searchLineEdit->setEnabled(hasCurrent);
     m_matchCaseCheckBox->setEnabled(hasCurrent);
+    m_wholeWordsCheckBox->setEnabled(hasCurrent);
+    m_regularExpressionCheckBox->setEnabled(hasCurrent);
     m_highlightAllCheckBox->setEnabled(hasCurrent);
 
     m_searchDock->toggleViewAction()->setEnabled(hasCurrent);
 
     if(hasCurrent)
     {
+        m_tabsLastActive.insert(currentTab(), m_hibernateClock.elapsed());
+
+        if(currentTab()->isDeferred() && !currentTab()->isOpening())
+        {
+            m_restoreTabsTimer->start(0);
+        }
+
         m_saveCopyAction->setEnabled(currentTab()->canSave());
         m_saveAsAction->setEnabled(currentTab()->canSave());
 
@@ -431,8 +458,10 @@ void MainWindow::on_tabWidget_currentChanged(int index)
 
         m_outlineView->setModel(currentTab()->outlineModel());
         m_propertiesView->setModel(currentTab()->propertiesModel());
+        updateMemoryProperties();
         m_bookmarksView->setModel(bookmarkModelForCurrentTab());
         m_thumbnailsView->setScene(currentTab()->thumbnailsScene());
+        on_thumbnails_verticalScrollBar_valueChanged(m_thumbnailsView->verticalScrollBar()->value());
 
         on_currentTab_documentChanged();
 
@@ -494,6 +523,8 @@ void MainWindow::on_tabWidget_currentChanged(int index)
 
         m_invertColorsAction->setChecked(false);
     }
+
+    CacheBudget::instance()->setTabCount(m_tabWidget->count());
 }
 
 void MainWindow::on_tabWidget_tabCloseRequested(int index)
@@ -622,7 +653,7 @@ void MainWindow::on_currentTab_currentPageChanged(int currentPage)
             }
         }
 
-        m_thumbnailsView->ensureVisible(currentTab()->thumbnailItems().at(currentPage - 1));
+        m_thumbnailsView->ensureVisible(currentTab()->thumbnailRect(currentPage - 1));
 
         setWindowTitleForCurrentTab();
         setCurrentPageSuffixForCurrentTab();
@@ -809,6 +840,49 @@ void MainWindow::on_currentTab_searchProgressChanged(int progress)
     }
 }
 
+void MainWindow::on_currentTab_openFinished(bool ok)
+{
+    DocumentView* tab = qobject_cast< DocumentView* >(sender());
+
+    if(tab == 0)
+    {
+        return;
+    }
+
+    const PendingOpen pendingOpen = m_pendingOpens.take(tab);
+
+    if(!m_restoredTabs.isEmpty())
+    {
+        m_restoreTabsTimer->start(restoreTabsInterval);
+    }
+
+    if(ok)
+    {
+        finishOpenInNewTab(tab, pendingOpen.page, pendingOpen.highlight);
+
+        if(m_restoredTabs.contains(tab))
+        {
+            finishRestoredTab(tab, m_restoredTabs.take(tab), pendingOpen.page == -1);
+        }
+    }
+    else
+    {
+        m_restoredTabs.remove(tab);
+
+        const QString filePath = tab->fileInfo().filePath();
+
+        // The tab is still emitting the signal which is handled here.
+
+        m_tabWidget->removeTab(m_tabWidget->indexOf(tab));
+        tab->deleteLater();
+
+        if(!pendingOpen.quiet)
+        {
+            QMessageBox::warning(this, tr("Warning"), tr("Could not open '%1'.").arg(filePath));
+        }
+    }
+}
+
 void MainWindow::on_currentTab_customContextMenuRequested(const QPoint& pos)
 {
     if(senderIsCurrentTab())
@@ -1147,6 +1221,8 @@ void MainWindow::on_settings_triggered()
     {
         s_settings->sync();
 
+        CacheBudget::instance()->update();
+
         m_tabWidget->setTabPosition(static_cast< QTabWidget::TabPosition >(s_settings->mainWindow().tabPosition()));
         m_tabWidget->setTabBarPolicy(static_cast< TabWidget::TabBarPolicy >(s_settings->mainWindow().tabVisibility()));
         m_tabWidget->setSpreadTabs(s_settings->mainWindow().spreadTabs());
@@ -1235,12 +1311,26 @@ void MainWindow::on_convertToGrayscale_triggered(bool checked)
 
 void MainWindow::on_fonts_triggered()
 {
-    QScopedPointer< QStandardItemModel > fontsModel(currentTab()->fontsModel());
-    QScopedPointer< FontsDialog > dialog(new FontsDialog(fontsModel.data(), this));
+    QScopedPointer< FontsDialog > dialog(new FontsDialog(currentTab()->fontsModel(), this));
 
     dialog->exec();
 }
 
+void MainWindow::on_statistics_triggered()
+{
+    QScopedPointer< StatisticsDialog > dialog(new StatisticsDialog(tabs(), this));
+
+    dialog->exec();
+}
+
+void MainWindow::on_statisticsOverlay_triggered(bool checked)
+{
+    foreach(DocumentView* tab, tabs())
+    {
+        tab->setShowStatistics(checked);
+    }
+}
+
 void MainWindow::on_fullscreen_triggered(bool checked)
 {
     if(checked)
@@ -1722,12 +1812,12 @@ void MainWindow::on_searchInitiated(const QString& text, bool modified)
         {
             for(int index = 0; index < m_tabWidget->count(); ++index)
             {
-                tab(index)->startSearch(text, m_matchCaseCheckBox->isChecked());
+                tab(index)->startSearch(text, m_matchCaseCheckBox->isChecked(), m_wholeWordsCheckBox->isChecked(), m_regularExpressionCheckBox->isChecked());
             }
         }
         else
         {
-            currentTab()->startSearch(text, m_matchCaseCheckBox->isChecked());
+            currentTab()->startSearch(text, m_matchCaseCheckBox->isChecked(), m_wholeWordsCheckBox->isChecked(), m_regularExpressionCheckBox->isChecked());
         }
     }
 }
@@ -1869,13 +1959,7 @@ void MainWindow::on_thumbnails_verticalScrollBar_valueChanged(int value)
     {
         const QRectF visibleRect = m_thumbnailsView->mapToScene(m_thumbnailsView->viewport()->rect()).boundingRect();
 
-        foreach(ThumbnailItem* page, currentTab()->thumbnailItems())
-        {
-            if(!page->boundingRect().translated(page->pos()).intersects(visibleRect))
-            {
-                page->cancelRender();
-            }
-        }
+        currentTab()->setThumbnailsVisibleRect(visibleRect);
     }
 }
 
@@ -2050,19 +2134,26 @@ void MainWindow::on_search_clicked(const QModelIndex& index)
 
 void MainWindow::on_database_tabRestored(const QString& absoluteFilePath, bool continuousMode, LayoutMode layoutMode, bool rightToLeftMode, ScaleMode scaleMode, qreal scaleFactor, Rotation rotation, int currentPage)
 {
-    if(openInNewTab(absoluteFilePath))
+    if(!QFileInfo(absoluteFilePath).exists())
     {
-        currentTab()->setContinuousMode(continuousMode);
-        currentTab()->setLayoutMode(layoutMode);
-        currentTab()->setRightToLeftMode(rightToLeftMode);
+        return;
+    }
 
-        currentTab()->setScaleMode(scaleMode);
-        currentTab()->setScaleFactor(scaleFactor);
+    // Restored tabs keep their saved state without a document, which is opened once they are activated.
 
-        currentTab()->setRotation(rotation);
+    DocumentView* newTab = new DocumentView(this);
 
-        currentTab()->jumpToPage(currentPage);
-    }
+    newTab->deferOpen(absoluteFilePath, currentPage);
+
+    const RestoredTab restoredTab(continuousMode, layoutMode, rightToLeftMode, scaleMode, scaleFactor, rotation, currentPage);
+
+    finishRestoredTab(newTab, restoredTab, false);
+
+    m_restoredTabs.insert(newTab, restoredTab);
+
+    prepareTab(newTab);
+
+    connect(newTab, SIGNAL(openFinished(bool)), SLOT(on_currentTab_openFinished(bool)));
 }
 
 void MainWindow::on_saveDatabase_timeout()
@@ -2086,8 +2177,134 @@ void MainWindow::on_saveDatabase_timeout()
     }
 }
 
+void MainWindow::on_restoreTabs_timeout()
+{
+    // The current tab is opened right away, the others at most one at a time.
+
+    DocumentView* nextTab = currentTab() != 0 && currentTab()->isDeferred() ? currentTab() : 0;
+
+    if(nextTab == 0)
+    {
+        foreach(DocumentView* tab, tabs())
+        {
+            if(tab->isDeferred() && !m_restoredTabs.value(tab).hibernated)
+            {
+                if(tab->isOpening())
+                {
+                    return;
+                }
+
+                if(nextTab == 0)
+                {
+                    nextTab = tab;
+                }
+            }
+        }
+    }
+
+    if(nextTab != 0 && !nextTab->isOpening() && !openRestoredTab(nextTab) && !m_restoredTabs.isEmpty())
+    {
+        m_restoreTabsTimer->start(restoreTabsInterval);
+    }
+}
+
+void MainWindow::on_hibernateTabs_timeout()
+{
+    const int timeout = s_settings->mainWindow().hibernateTabsTimeout();
+
+    if(timeout <= 0)
+    {
+        return;
+    }
+
+    const qint64 now = m_hibernateClock.elapsed();
+
+    if(currentTab() != 0)
+    {
+        m_tabsLastActive.insert(currentTab(), now);
+    }
+
+    foreach(DocumentView* tab, tabs())
+    {
+        if(now - m_tabsLastActive.value(tab, now) > timeout)
+        {
+            hibernateTab(tab);
+        }
+    }
+}
+
+void MainWindow::on_cacheBudget_memoryPressure()
+{
+    ImageBufferPool::instance()->clear();
+
+    // Only the least recently active tab is hibernated as the available memory is checked again shortly.
+
+    DocumentView* oldestTab = 0;
+    qint64 oldestActive = 0;
+
+    foreach(DocumentView* tab, tabs())
+    {
+        if(tab == currentTab() || tab->isDeferred() || tab->isOpening() || tab->wasModified())
+        {
+            continue;
+        }
+
+        const qint64 lastActive = m_tabsLastActive.value(tab, 0);
+
+        if(oldestTab == 0 || lastActive < oldestActive)
+        {
+            oldestTab = tab;
+            oldestActive = lastActive;
+        }
+    }
+
+    if(oldestTab != 0)
+    {
+        hibernateTab(oldestTab);
+    }
+}
+
+void MainWindow::on_memory_timeout()
+{
+    if(s_settings->documentView().memoryLimit() > 0)
+    {
+        foreach(DocumentView* tab, tabs())
+        {
+            tab->enforceMemoryLimit();
+        }
+    }
+
+    updateMemoryProperties();
+}
+
+void MainWindow::updateMemoryProperties()
+{
+    if(currentTab() == 0 || !m_propertiesDock->isVisible())
+    {
+        return;
+    }
+
+    DocumentView::MemoryUsage totalUsage;
+
+    foreach(const DocumentView* tab, tabs())
+    {
+        totalUsage += tab->memoryUsage();
+    }
+
+    currentTab()->updateMemoryProperties(totalUsage);
+}
+
 void MainWindow::closeEvent(QCloseEvent* event)
 {
+    for(int index = 0; index < m_tabWidget->count(); ++index)
+    {
+        if(tab(index)->isSaving())
+        {
+            event->setAccepted(false);
+            return;
+        }
+    }
+
     m_searchDock->setVisible(false);
 
     for(int index = 0; index < m_tabWidget->count(); ++index)
@@ -2122,10 +2339,32 @@ void MainWindow::closeEvent(QCloseEvent* event)
     s_settings->mainWindow().setRecentlyUsed(s_settings->mainWindow().trackRecentlyUsed() ? m_recentlyUsedMenu->filePaths() : QStringList());
 
     s_settings->documentView().setMatchCase(m_matchCaseCheckBox->isChecked());
+    s_settings->documentView().setWholeWords(m_wholeWordsCheckBox->isChecked());
+    s_settings->documentView().setRegularExpression(m_regularExpressionCheckBox->isChecked());
 
     s_settings->mainWindow().setGeometry(m_fullscreenAction->isChecked() ? m_fullscreenAction->data().toByteArray() : saveGeometry());
     s_settings->mainWindow().setState(saveState());
 
+    if(m_resident)
+    {
+        // The tabs were saved above and are restored when the window is reopened.
+
+        disconnect(m_tabWidget, SIGNAL(currentChanged(int)), this, SLOT(on_tabWidget_currentChanged(int)));
+
+        foreach(DocumentView* tab, tabs())
+        {
+            m_pendingOpens.remove(tab);
+            m_restoredTabs.remove(tab);
+            m_tabsLastActive.remove(tab);
+
+            delete tab;
+        }
+
+        connect(m_tabWidget, SIGNAL(currentChanged(int)), this, SLOT(on_tabWidget_currentChanged(int)));
+
+        on_tabWidget_currentChanged(m_tabWidget->currentIndex());
+    }
+
     QMainWindow::closeEvent(event);
 }
 
@@ -2182,11 +2421,52 @@ void MainWindow::prepareStyle()
     qApp->setStyle(style);
 }
 
+void MainWindow::preloadPlugins()
+{
+    // The plug-ins for restored tabs and recently used files are loaded while the widgets are created.
+
+    QStringList filePaths;
+
+    if(s_settings->mainWindow().restoreTabs())
+    {
+        filePaths += Database::instance()->loadTabFilePaths();
+    }
+
+    if(s_settings->mainWindow().trackRecentlyUsed())
+    {
+        filePaths += s_settings->mainWindow().recentlyUsed();
+    }
+
+    PluginHandler::instance()->preloadPlugins(filePaths);
+}
+
+void MainWindow::reopen()
+{
+    restoreGeometry(s_settings->mainWindow().geometry());
+    restoreState(s_settings->mainWindow().state());
+
+    if(s_settings->mainWindow().restoreTabs() && m_tabWidget->count() == 0)
+    {
+        s_database->restoreTabs();
+    }
+
+    show();
+
+    on_tabWidget_currentChanged(m_tabWidget->currentIndex());
+}
+
 TreeView* MainWindow::outlineView() const
 {
     return m_outlineView;
 }
 
+void MainWindow::setResident(bool resident)
+{
+    m_resident = resident;
+
+    QApplication::setQuitOnLastWindowClosed(!resident);
+}
+
 DocumentView* MainWindow::currentTab() const
 {
     return qobject_cast< DocumentView* >(m_tabWidget->currentWidget());
@@ -2226,9 +2506,156 @@ int MainWindow::addTab(DocumentView* tab)
     return index;
 }
 
+void MainWindow::prepareTab(DocumentView* tab)
+{
+    const int index = addTab(tab);
+
+    QAction* tabAction = new QAction(m_tabWidget->tabText(index), tab);
+    connect(tabAction, SIGNAL(triggered()), SLOT(on_tabAction_triggered()));
+
+    m_tabsMenu->addAction(tabAction);
+
+    on_thumbnails_dockLocationChanged(dockWidgetArea(m_thumbnailsDock));
+
+    tab->setShowStatistics(m_statisticsOverlayAction->isChecked());
+
+    connect(tab, SIGNAL(documentChanged()), SLOT(on_currentTab_documentChanged()));
+
+    connect(tab, SIGNAL(numberOfPagesChanged(int)), SLOT(on_currentTab_numberOfPagesChaned(int)));
+    connect(tab, SIGNAL(currentPageChanged(int)), SLOT(on_currentTab_currentPageChanged(int)));
+
+    connect(tab, SIGNAL(canJumpChanged(bool,bool)), SLOT(on_currentTab_canJumpChanged(bool,bool)));
+
+    connect(tab, SIGNAL(continuousModeChanged(bool)), SLOT(on_currentTab_continuousModeChanged(bool)));
+    connect(tab, SIGNAL(layoutModeChanged(LayoutMode)), SLOT(on_currentTab_layoutModeChanged(LayoutMode)));
+    connect(tab, SIGNAL(rightToLeftModeChanged(bool)), SLOT(on_currentTab_rightToLeftModeChanged(bool)));
+    connect(tab, SIGNAL(scaleModeChanged(ScaleMode)), SLOT(on_currentTab_scaleModeChanged(ScaleMode)));
+    connect(tab, SIGNAL(scaleFactorChanged(qreal)), SLOT(on_currentTab_scaleFactorChanged(qreal)));
+    connect(tab, SIGNAL(rotationChanged(Rotation)), SLOT(on_currentTab_rotationChanged(Rotation)));
+
+    connect(tab, SIGNAL(linkClicked(int)), SLOT(on_currentTab_linkClicked(int)));
+    connect(tab, SIGNAL(linkClicked(bool,QString,int)), SLOT(on_currentTab_linkClicked(bool,QString,int)));
+
+    connect(tab, SIGNAL(invertColorsChanged(bool)), SLOT(on_currentTab_invertColorsChanged(bool)));
+    connect(tab, SIGNAL(convertToGrayscaleChanged(bool)), SLOT(on_currentTab_convertToGrayscale(bool)));
+    connect(tab, SIGNAL(highlightAllChanged(bool)), SLOT(on_currentTab_highlightAllChanged(bool)));
+    connect(tab, SIGNAL(rubberBandModeChanged(RubberBandMode)), SLOT(on_currentTab_rubberBandModeChanged(RubberBandMode)));
+
+    connect(tab, SIGNAL(searchFinished()), SLOT(on_currentTab_searchFinished()));
+    connect(tab, SIGNAL(searchProgressChanged(int)), SLOT(on_currentTab_searchProgressChanged(int)));
+
+    connect(tab, SIGNAL(customContextMenuRequested(QPoint)), SLOT(on_currentTab_customContextMenuRequested(QPoint)));
+
+    tab->show();
+}
+
+void MainWindow::finishOpenInNewTab(DocumentView* tab, int page, const QRectF& highlight)
+{
+    s_settings->mainWindow().setOpenPath(tab->fileInfo().absolutePath());
+    m_recentlyUsedMenu->addOpenAction(tab->fileInfo());
+
+    s_database->restorePerFileSettings(tab);
+    scheduleSaveTabs();
+
+    tab->jumpToPage(page, false);
+
+    if(tab == currentTab())
+    {
+        tab->setFocus();
+    }
+
+    if(!highlight.isNull())
+    {
+        tab->temporaryHighlight(page, highlight);
+    }
+}
+
+bool MainWindow::openRestoredTab(DocumentView* tab)
+{
+    if(!m_pendingOpens.contains(tab))
+    {
+        m_pendingOpens.insert(tab, PendingOpen(-1, QRectF(), true));
+    }
+
+    if(tab->openDeferred())
+    {
+        return true;
+    }
+
+    m_pendingOpens.remove(tab);
+    m_restoredTabs.remove(tab);
+
+    m_tabWidget->removeTab(m_tabWidget->indexOf(tab));
+    tab->deleteLater();
+
+    return false;
+}
+
+void MainWindow::finishRestoredTab(DocumentView* tab, const RestoredTab& restoredTab, bool jumpToPage)
+{
+    tab->setContinuousMode(restoredTab.continuousMode);
+    tab->setLayoutMode(restoredTab.layoutMode);
+    tab->setRightToLeftMode(restoredTab.rightToLeftMode);
+
+    tab->setScaleMode(restoredTab.scaleMode);
+    tab->setScaleFactor(restoredTab.scaleFactor);
+
+    tab->setRotation(restoredTab.rotation);
+
+    if(jumpToPage)
+    {
+        tab->jumpToPage(restoredTab.currentPage, false, restoredTab.left, restoredTab.top);
+    }
+
+    if(!restoredTab.searchText.isEmpty())
+    {
+        tab->startSearch(restoredTab.searchText, restoredTab.matchCase, restoredTab.wholeWords, restoredTab.regularExpression);
+    }
+}
+
+bool MainWindow::hibernateTab(DocumentView* tab)
+{
+    if(tab == currentTab() || tab->isDeferred() || tab->isOpening() || tab->wasModified() || tab->isSaving())
+    {
+        return false;
+    }
+
+    s_database->savePerFileSettings(tab);
+
+    RestoredTab restoredTab(tab->continuousMode(), tab->layoutMode(), tab->rightToLeftMode(),
+                            tab->scaleMode(), tab->scaleFactor(), tab->rotation(), tab->currentPage());
+
+    tab->saveLeftAndTop(restoredTab.left, restoredTab.top);
+
+    restoredTab.searchText = tab->searchText();
+    restoredTab.matchCase = tab->searchMatchCase();
+    restoredTab.wholeWords = tab->searchWholeWords();
+    restoredTab.regularExpression = tab->searchRegularExpression();
+
+    restoredTab.hibernated = true;
+
+    if(!tab->hibernate())
+    {
+        return false;
+    }
+
+    m_restoredTabs.insert(tab, restoredTab);
+
+    return true;
+}
+
 void MainWindow::closeTab(DocumentView* tab)
 {
-    if(s_settings->mainWindow().keepRecentlyClosed())
+    if(tab->isSaving())
+    {
+        return;
+    }
+
+    m_pendingOpens.remove(tab);
+    m_restoredTabs.remove(tab);
+    m_tabsLastActive.remove(tab);
+
+    if(s_settings->mainWindow().keepRecentlyClosed() && !tab->isOpening() && !tab->isDeferred())
     {
         foreach(QAction* tabAction, m_tabsMenu->actions())
         {
@@ -2367,6 +2794,32 @@ void MainWindow::prepareDatabase()
     m_saveDatabaseTimer->setInterval(s_settings->mainWindow().saveDatabaseInterval());
 
     connect(m_saveDatabaseTimer, SIGNAL(timeout()), SLOT(on_saveDatabase_timeout()));
+
+    m_restoreTabsTimer = new QTimer(this);
+    m_restoreTabsTimer->setSingleShot(true);
+
+    connect(m_restoreTabsTimer, SIGNAL(timeout()), SLOT(on_restoreTabs_timeout()));
+}
+
+void MainWindow::prepareHibernation()
+{
+    m_hibernateClock.start();
+
+    m_hibernateTabsTimer = new QTimer(this);
+    m_hibernateTabsTimer->setInterval(hibernateTabsInterval);
+
+    connect(m_hibernateTabsTimer, SIGNAL(timeout()), SLOT(on_hibernateTabs_timeout()));
+
+    m_hibernateTabsTimer->start();
+
+    m_memoryTimer = new QTimer(this);
+    m_memoryTimer->setInterval(memoryInterval);
+
+    connect(m_memoryTimer, SIGNAL(timeout()), SLOT(on_memory_timeout()));
+
+    m_memoryTimer->start();
+
+    connect(CacheBudget::instance(), SIGNAL(memoryPressure()), SLOT(on_cacheBudget_memoryPressure()));
 }
 
 void MainWindow::scheduleSaveDatabase()
@@ -2468,6 +2921,8 @@ void MainWindow::createWidgets()
 
     m_searchLineEdit = new SearchLineEdit(this);
     m_matchCaseCheckBox = new QCheckBox(tr("Match &case"), this);
+    m_wholeWordsCheckBox = new QCheckBox(tr("Whole &words"), this);
+    m_regularExpressionCheckBox = new QCheckBox(tr("Regular e&xpression"), this);
     m_highlightAllCheckBox = new QCheckBox(tr("Highlight &all"), this);
 
     connect(m_searchLineEdit, SIGNAL(searchInitiated(QString,bool)), SLOT(on_searchInitiated(QString,bool)));
@@ -2573,6 +3028,9 @@ void MainWindow::createActions()
 
     m_fontsAction = createAction(tr("Fonts..."), QString(), QIcon(), QKeySequence(), SLOT(on_fonts_triggered()));
 
+    m_statisticsAction = createAction(tr("Statistics..."), QLatin1String("statistics"), QIcon(), QKeySequence(), SLOT(on_statistics_triggered()));
+    m_statisticsOverlayAction = createAction(tr("Statistics overlay"), QLatin1String("statisticsOverlay"), QIcon(), QKeySequence(), SLOT(on_statisticsOverlay_triggered(bool)), true);
+
     m_fullscreenAction = createAction(tr("&Fullscreen"), QLatin1String("fullscreen"), QLatin1String("view-fullscreen"), QKeySequence(Qt::Key_F11), SLOT(on_fullscreen_triggered(bool)), true);
     m_presentationAction = createAction(tr("&Presentation..."), QLatin1String("presentation"), QLatin1String("x-office-presentation"), QKeySequence(Qt::Key_F12), SLOT(on_presentation_triggered()));
 
@@ -2711,7 +3169,7 @@ void MainWindow::createSearchDock()
     cancelSearchButton->setDefaultAction(m_cancelSearchAction);
 
     QGridLayout* searchLayout = new QGridLayout(m_searchWidget);
-    searchLayout->setRowStretch(2, 1);
+    searchLayout->setRowStretch(3, 1);
     searchLayout->setColumnStretch(2, 1);
     searchLayout->addWidget(m_searchLineEdit, 0, 0, 1, 6);
     searchLayout->addWidget(m_matchCaseCheckBox, 1, 0);
@@ -2719,6 +3177,8 @@ void MainWindow::createSearchDock()
     searchLayout->addWidget(findPreviousButton, 1, 3);
     searchLayout->addWidget(findNextButton, 1, 4);
     searchLayout->addWidget(cancelSearchButton, 1, 5);
+    searchLayout->addWidget(m_wholeWordsCheckBox, 2, 0);
+    searchLayout->addWidget(m_regularExpressionCheckBox, 2, 1);
 
     m_searchDock->setWidget(m_searchWidget);
 
@@ -2756,7 +3216,7 @@ void MainWindow::createSearchDock()
         m_searchView->setItemDelegate(new SearchItemDelegate(m_searchView));
         m_searchView->setModel(SearchModel::instance());
 
-        searchLayout->addWidget(m_searchView, 2, 0, 1, 6);
+        searchLayout->addWidget(m_searchView, 3, 0, 1, 6);
     }
     else
     {
@@ -2804,6 +3264,9 @@ void MainWindow::createDocks()
     m_thumbnailsView = new QGraphicsView(this);
 
     connect(m_thumbnailsView->verticalScrollBar(), SIGNAL(valueChanged(int)), SLOT(on_thumbnails_verticalScrollBar_valueChanged(int)));
+    connect(m_thumbnailsView->verticalScrollBar(), SIGNAL(rangeChanged(int,int)), SLOT(on_thumbnails_verticalScrollBar_valueChanged(int)));
+    connect(m_thumbnailsView->horizontalScrollBar(), SIGNAL(valueChanged(int)), SLOT(on_thumbnails_verticalScrollBar_valueChanged(int)));
+    connect(m_thumbnailsView->horizontalScrollBar(), SIGNAL(rangeChanged(int,int)), SLOT(on_thumbnails_verticalScrollBar_valueChanged(int)));
 
     m_thumbnailsDock->setWidget(m_thumbnailsView);
 
@@ -2894,6 +3357,7 @@ void MainWindow::createMenus()
     }
 
     m_viewMenu->addAction(m_fontsAction);
+    m_viewMenu->addActions(QList< QAction* >() << m_statisticsAction << m_statisticsOverlayAction);
     m_viewMenu->addSeparator();
     m_viewMenu->addActions(QList< QAction* >() << m_fullscreenAction << m_presentationAction);
 
@@ -2937,10 +3401,23 @@ MainWindowAdaptor::MainWindowAdaptor(MainWindow* mainWindow) : QDBusAbstractAdap
 
 void MainWindowAdaptor::raiseAndActivate()
 {
+    if(mainWindow()->isResident() && mainWindow()->isHidden())
+    {
+        mainWindow()->reopen();
+    }
+
     mainWindow()->raise();
     mainWindow()->activateWindow();
 }
 
+void MainWindowAdaptor::quit()
+{
+    if(mainWindow()->isHidden() || mainWindow()->close())
+    {
+        qApp->quit();
+    }
+}
+
 bool MainWindowAdaptor::open(const QString& absoluteFilePath, int page, const QRectF& highlight, bool quiet)
 {
     return mainWindow()->open(absoluteFilePath, page, highlight, quiet);
@@ -25,9 +25,12 @@ along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef MAINWINDOW_H
 #define MAINWINDOW_H
 
+#include <QElapsedTimer>
+#include <QHash>
 #include <QMainWindow>
 
 #include <QPointer>
+#include <QRectF>
 
 #ifdef WITH_DBUS
 
@@ -78,6 +81,11 @@ public:
 
     TreeView* outlineView() const;
     static MainWindow* s_instance;
+
+    // A resident window is hidden instead of closed so that the process stays initialized to open files quickly.
+
+    inline bool isResident() const { return m_resident; }
+    void setResident(bool resident);
     TreeView* m_outlineView;
 
 public slots:
@@ -118,6 +126,8 @@ protected slots:
     void on_currentTab_searchFinished();
     void on_currentTab_searchProgressChanged(int progress);
 
+    void on_currentTab_openFinished(bool ok);
+
     void on_currentTab_customContextMenuRequested(const QPoint& pos);
 
     void on_currentPage_editingFinished();
@@ -182,6 +192,9 @@ protected slots:
 
     void on_fonts_triggered();
 
+    void on_statistics_triggered();
+    void on_statisticsOverlay_triggered(bool checked);
+
     void on_fullscreen_triggered(bool checked);
     void on_presentation_triggered();
 
@@ -246,6 +259,13 @@ protected slots:
 
     void on_saveDatabase_timeout();
 
+    void on_restoreTabs_timeout();
+
+    void on_hibernateTabs_timeout();
+    void on_cacheBudget_memoryPressure();
+
+    void on_memory_timeout();
+
 protected:
     void closeEvent(QCloseEvent* event);
 
@@ -260,6 +280,12 @@ private:
 
     void prepareStyle();
 
+    void preloadPlugins();
+
+    bool m_resident;
+
+    void reopen();
+
     TabWidget* m_tabWidget;
 
     DocumentView* currentTab() const;
@@ -271,6 +297,82 @@ private:
     int addTab(DocumentView* tab);
     void closeTab(DocumentView* tab);
 
+    void prepareTab(DocumentView* tab);
+    void finishOpenInNewTab(DocumentView* tab, int page, const QRectF& highlight);
+
+    struct PendingOpen
+    {
+        int page;
+        QRectF highlight;
+        bool quiet;
+
+        PendingOpen(int page = -1, const QRectF& highlight = QRectF(), bool quiet = false) : page(page), highlight(highlight), quiet(quiet) {}
+
+    };
+
+    QHash< DocumentView*, PendingOpen > m_pendingOpens;
+
+    // Restored tabs are opened once they are activated or, one at a time, when the application is idle.
+    // Hibernated tabs are only opened once they are activated.
+
+    struct RestoredTab
+    {
+        bool continuousMode;
+        LayoutMode layoutMode;
+        bool rightToLeftMode;
+        ScaleMode scaleMode;
+        qreal scaleFactor;
+        Rotation rotation;
+        int currentPage;
+
+        qreal left;
+        qreal top;
+
+        QString searchText;
+        bool matchCase;
+        bool wholeWords;
+        bool regularExpression;
+
+        bool hibernated;
+
+        RestoredTab(bool continuousMode = false, LayoutMode layoutMode = SinglePageMode, bool rightToLeftMode = false,
+                    ScaleMode scaleMode = ScaleFactorMode, qreal scaleFactor = 1.0, Rotation rotation = RotateBy0, int currentPage = -1) :
+            continuousMode(continuousMode),
+            layoutMode(layoutMode),
+            rightToLeftMode(rightToLeftMode),
+            scaleMode(scaleMode),
+            scaleFactor(scaleFactor),
+            rotation(rotation),
+            currentPage(currentPage),
+            left(0.0),
+            top(0.0),
+            searchText(),
+            matchCase(false),
+            wholeWords(false),
+            regularExpression(false),
+            hibernated(false) {}
+
+    };
+
+    QHash< DocumentView*, RestoredTab > m_restoredTabs;
+
+    QTimer* m_restoreTabsTimer;
+
+    bool openRestoredTab(DocumentView* tab);
+    void finishRestoredTab(DocumentView* tab, const RestoredTab& restoredTab, bool jumpToPage);
+
+    QElapsedTimer m_hibernateClock;
+    QHash< DocumentView*, qint64 > m_tabsLastActive;
+
+    QTimer* m_hibernateTabsTimer;
+    QTimer* m_memoryTimer;
+
+    void updateMemoryProperties();
+
+    void prepareHibernation();
+
+    bool hibernateTab(DocumentView* tab);
+
     bool saveModifications(DocumentView* tab);
 
     void setWindowTitleForCurrentTab();
@@ -295,6 +397,8 @@ private:
 
     SearchLineEdit* m_searchLineEdit;
     QCheckBox* m_matchCaseCheckBox;
+    QCheckBox* m_wholeWordsCheckBox;
+    QCheckBox* m_regularExpressionCheckBox;
     QCheckBox* m_highlightAllCheckBox;
 
     void createWidgets();
@@ -353,6 +457,9 @@ private:
 
     QAction* m_fontsAction;
 
+    QAction* m_statisticsAction;
+    QAction* m_statisticsOverlayAction;
+
     QAction* m_fullscreenAction;
     QAction* m_presentationAction;
 
@@ -451,6 +558,8 @@ public:
 public slots:
     Q_NOREPLY void raiseAndActivate();
 
+    Q_NOREPLY void quit();
+
     bool open(const QString& absoluteFilePath, int page = -1, const QRectF& highlight = QRectF(), bool quiet = false);
     bool openInNewTab(const QString& absoluteFilePath, int page = -1, const QRectF& highlight = QRectF(), bool quiet = false);
 
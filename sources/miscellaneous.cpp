@@ -31,6 +31,7 @@ along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
 #include <qmath.h>
 #include <QMenu>
 #include <QMouseEvent>
+#include <QRegExp>
 #include <QTextLayout>
 #include <QTimer>
 #include <QVBoxLayout>
@@ -54,7 +55,7 @@ QMetaMethod slotToMethod(const QMetaObject* metaObject, const char* slot)
     return metaObject->method(index);
 }
 
-void emphasizeText(const QString& text, bool matchCase, const QString& surroundingText, QTextLayout& textLayout)
+void emphasizeText(const QRegExp& pattern, const QString& surroundingText, QTextLayout& textLayout)
 {
     QFont font = textLayout.font();
     font.setWeight(QFont::Light);
@@ -63,11 +64,18 @@ void emphasizeText(const QString& text, bool matchCase, const QString& surroundi
 
     QList< QTextLayout::FormatRange > additionalFormats;
 
-    for(int position = 0; (position = surroundingText.indexOf(text, position, matchCase ? Qt::CaseSensitive : Qt::CaseInsensitive)) != -1; position += text.length())
+    QRegExp regExp(pattern);
+
+    for(int position = 0; (position = regExp.indexIn(surroundingText, position)) != -1; position += qMax(regExp.matchedLength(), 1))
     {
+        if(regExp.matchedLength() <= 0)
+        {
+            continue;
+        }
+
         QTextLayout::FormatRange formatRange;
         formatRange.start = position;
-        formatRange.length = text.length();
+        formatRange.length = regExp.matchedLength();
         formatRange.format.setFontWeight(QFont::Bold);
 
         additionalFormats.append(formatRange);
@@ -334,6 +342,11 @@ void TreeView::loadExpansionState(const QModelIndex& index)
 
         if (storedExpansions.indexOf(qv.toString()) != -1) {
             model()->setData(index, true, m_expansionRole);
+
+            // The children of an expanded entry have to be present to restore their expansion as well.
+            if (model()->canFetchMore(index)) {
+                model()->fetchMore(index);
+            }
         }
     }
 
@@ -587,13 +600,12 @@ void SearchItemDelegate::paint(QPainter* painter, const QStyleOptionViewItem& op
         return;
     }
 
-    const QString text = index.data(SearchModel::TextRole).toString();
+    const QRegExp pattern = index.data(SearchModel::PatternRole).toRegExp();
     const QString surroundingText = index.data(SearchModel::SurroundingTextRole).toString();
-    const bool matchCase = index.data(SearchModel::MatchCaseRole).toBool();
 
-    if(!text.isEmpty() && !surroundingText.isEmpty())
+    if(!pattern.isEmpty() && pattern.isValid() && !surroundingText.isEmpty())
     {
-        paintSurroundingText(painter, option, text, surroundingText, matchCase);
+        paintSurroundingText(painter, option, pattern, surroundingText);
         return;
     }
 }
@@ -613,7 +625,7 @@ void SearchItemDelegate::paintProgress(QPainter* painter, const QStyleOptionView
 }
 
 void SearchItemDelegate::paintSurroundingText(QPainter* painter, const QStyleOptionViewItem& option,
-                                              const QString& text, const QString& surroundingText, bool matchCase) const
+                                              const QRegExp& pattern, const QString& surroundingText) const
 {
     const int textMargin = QApplication::style()->pixelMetric(QStyle::PM_FocusFrameHMargin) + 1;
     const QRect textRect = option.rect.adjusted(textMargin, 0, -textMargin, 0);
@@ -629,7 +641,7 @@ void SearchItemDelegate::paintSurroundingText(QPainter* painter, const QStyleOpt
     textLayout.setText(elidedText);
     textLayout.setFont(option.font);
 
-    emphasizeText(text, matchCase, surroundingText, textLayout);
+    emphasizeText(pattern, surroundingText, textLayout);
 
 
     textLayout.beginLayout();
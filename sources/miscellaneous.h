@@ -34,6 +34,7 @@ along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
 #include <QStyledItemDelegate>
 #include <QTreeView>
 
+class QRegExp;
 class QTextLayout;
 
 namespace qpdfview
@@ -317,7 +318,7 @@ private:
     void paintProgress(QPainter* painter, const QStyleOptionViewItem& option,
                        int progress) const;
     void paintSurroundingText(QPainter* painter, const QStyleOptionViewItem& option,
-                              const QString& text, const QString& surroundingText, bool matchCase) const;
+                              const QRegExp& pattern, const QString& surroundingText) const;
 
 };
 
@@ -26,6 +26,7 @@ along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
 #include <QList>
 #include <QtPlugin>
 #include <QRect>
+#include <QSize>
 #include <QStandardItemModel>
 #include <QString>
 #include <QWidget>
@@ -33,7 +34,6 @@ along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
 class QColor;
 class QImage;
 class QPrinter;
-class QSizeF;
 
 #include "global.h"
 
@@ -65,6 +65,16 @@ namespace Model
 
     };
 
+    struct TextBox
+    {
+        QString text;
+        QRectF boundingBox;
+
+        TextBox() : text(), boundingBox() {}
+        TextBox(const QString& text, const QRectF& boundingBox) : text(text), boundingBox(boundingBox) {}
+
+    };
+
     class Annotation : public QObject
     {
         Q_OBJECT
@@ -101,6 +111,29 @@ namespace Model
 
     };
 
+    // Polled by the plugins while rendering so that work which is no longer needed can be abandoned early.
+
+    class CancellationToken
+    {
+    public:
+        virtual ~CancellationToken() {}
+
+        virtual bool wasCanceled() const = 0;
+
+    };
+
+    // Supplies the images which the plugins render into so that their buffers are reused instead of being allocated for every tile.
+
+    class ImageAllocator
+    {
+    public:
+        virtual ~ImageAllocator() {}
+
+        // yields an image using the format "QImage::Format_RGB32" whose pixels are undefined
+        virtual QImage allocate(int width, int height) = 0;
+
+    };
+
     class Page
     {
     public:
@@ -108,7 +141,10 @@ namespace Model
 
         virtual QSizeF size() const = 0;
 
-        virtual QImage render(qreal horizontalResolution = 72.0, qreal verticalResolution = 72.0, Rotation rotation = RotateBy0, const QRect& boundingRect = QRect()) const = 0;
+        virtual QImage render(qreal horizontalResolution = 72.0, qreal verticalResolution = 72.0, Rotation rotation = RotateBy0, const QRect& boundingRect = QRect(), const CancellationToken* cancellation = 0, ImageAllocator* allocator = 0) const = 0;
+
+        // Yields a thumbnail of the unrotated page which is embedded in the document and much cheaper than rendering, or a null image if there is none.
+        virtual QImage thumbnail() const { return QImage(); }
 
         virtual QString label() const { return QString(); }
 
@@ -117,6 +153,8 @@ namespace Model
         virtual QString text(const QRectF& rect) const { Q_UNUSED(rect); return QString(); }
         virtual QList< QRectF > search(const QString& text, bool matchCase) const { Q_UNUSED(text); Q_UNUSED(matchCase); return QList< QRectF >(); }
 
+        virtual QList< TextBox > textBoxes() const { return QList< TextBox >(); }
+
         virtual QList< Annotation* > annotations() const { return QList< Annotation* >(); }
 
         virtual bool canAddAndRemoveAnnotations() const { return false; }
@@ -137,14 +175,25 @@ namespace Model
 
         virtual Page* page(int index) const = 0;
 
+        // Cheap estimates which allow laying out pages before they are created, an invalid size means that none is available.
+
+        virtual QSizeF pageSizeHint(int index) const { Q_UNUSED(index); return QSizeF(); }
+        virtual bool hasPageLabels() const { return true; }
+
         virtual bool isLocked() const { return false; }
         virtual bool unlock(const QString& password) { Q_UNUSED(password); return false; }
 
+        // A rough estimate of the bytes held by the back-end, or zero if it is unknown.
+        virtual qint64 memoryEstimate() const { return 0; }
+
         virtual QStringList saveFilter() const { return QStringList(); }
 
         virtual bool canSave() const { return false; }
         virtual bool save(const QString& filePath, bool withChanges) const { Q_UNUSED(filePath); Q_UNUSED(withChanges); return false; }
 
+        // Appends only the changed objects to the file the document was loaded from and fails if the file does not start with the original document.
+        virtual bool saveChanges(const QString& filePath) const { Q_UNUSED(filePath); return false; }
+
         virtual bool canBePrintedUsingCUPS() const { return false; }
 
         virtual void setPaperColor(const QColor& paperColor) { Q_UNUSED(paperColor); }
@@ -154,6 +203,10 @@ namespace Model
 
         virtual void loadFonts(QStandardItemModel* fontsModel) const { fontsModel->clear(); }
 
+        // Loads the fonts used on the pages from begin up to end so that scanning can be split into steps, where backends which cannot scan single pages load all fonts with the first step.
+
+        virtual void loadFonts(QStandardItemModel* fontsModel, int beginIndex, int endIndex) const { Q_UNUSED(endIndex); if(beginIndex == 0) { loadFonts(fontsModel); } else { fontsModel->clear(); } }
+
         virtual bool wantsContinuousMode() const { return false; }
         virtual bool wantsSinglePageMode() const { return false; }
         virtual bool wantsTwoPagesMode() const { return false; }
@@ -182,12 +235,19 @@ public:
 
     virtual Model::Document* loadDocument(const QString& filePath) const = 0;
 
+    // Loads a document from contents which were already read into memory, where plug-ins which can only open files return null.
+
+    virtual Model::Document* loadDocumentFromData(const QByteArray& data) const { Q_UNUSED(data); return 0; }
+
     virtual SettingsWidget* createSettingsWidget(QWidget* parent = 0) const { Q_UNUSED(parent); return 0; }
 
 };
 
 } // qpdfview
 
-Q_DECLARE_INTERFACE(qpdfview::Plugin, "local.qpdfview.Plugin")
+// The version has to be bumped together with the metadata of the plug-ins whenever the virtual tables of the model change,
+// so that plug-ins built against an older interface are rejected instead of crashing once the new methods are called.
+
+Q_DECLARE_INTERFACE(qpdfview::Plugin, "local.qpdfview.Plugin/2")
 
 #endif // DOCUMENTMODEL_H
@@ -0,0 +1,132 @@
+/*
+
+Copyright 2014 Adam Reichold
+
+This file is part of qpdfview.
+
+qpdfview is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+qpdfview is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "outlinemodel.h"
+
+namespace qpdfview
+{
+
+OutlineModel::OutlineModel(QObject* parent) : QStandardItemModel(parent),
+    m_pendingRows()
+{
+}
+
+OutlineModel::~OutlineModel()
+{
+    deletePendingRows();
+}
+
+void OutlineModel::takeOutline(QStandardItemModel* source)
+{
+    clear();
+
+    setColumnCount(source->columnCount());
+
+    for(int column = 0; column < source->columnCount(); ++column)
+    {
+        QStandardItem* item = source->takeHorizontalHeaderItem(column);
+
+        if(item != 0)
+        {
+            setHorizontalHeaderItem(column, item);
+        }
+    }
+
+    appendRows(invisibleRootItem(), takeRows(source->invisibleRootItem()));
+}
+
+void OutlineModel::clear()
+{
+    QStandardItemModel::clear();
+
+    deletePendingRows();
+}
+
+bool OutlineModel::hasChildren(const QModelIndex& parent) const
+{
+    return QStandardItemModel::hasChildren(parent) || canFetchMore(parent);
+}
+
+bool OutlineModel::canFetchMore(const QModelIndex& parent) const
+{
+    return parent.isValid() && m_pendingRows.contains(itemFromIndex(parent));
+}
+
+void OutlineModel::fetchMore(const QModelIndex& parent)
+{
+    QStandardItem* item = itemFromIndex(parent);
+
+    if(item == 0)
+    {
+        return;
+    }
+
+    const QList< Row > rows = m_pendingRows.take(item);
+
+    if(!rows.isEmpty())
+    {
+        appendRows(item, rows);
+    }
+}
+
+void OutlineModel::appendRows(QStandardItem* parent, const QList< Row >& rows)
+{
+    foreach(const Row& row, rows)
+    {
+        // The children are held back until their parent is expanded.
+
+        const QList< Row > children = takeRows(row.first());
+
+        parent->appendRow(row);
+
+        if(!children.isEmpty())
+        {
+            m_pendingRows.insert(row.first(), children);
+        }
+    }
+}
+
+void OutlineModel::deletePendingRows()
+{
+    foreach(const QList< Row >& rows, m_pendingRows)
+    {
+        foreach(const Row& row, rows)
+        {
+            qDeleteAll(row);
+        }
+    }
+
+    m_pendingRows.clear();
+}
+
+QList< OutlineModel::Row > OutlineModel::takeRows(QStandardItem* item)
+{
+    QList< Row > rows;
+
+    for(int row = item->rowCount() - 1; row >= 0; --row)
+    {
+        rows.prepend(item->takeRow(row));
+    }
+
+    return rows;
+}
+
+} // qpdfview
@@ -0,0 +1,67 @@
+/*
+
+Copyright 2014 Adam Reichold
+
+This file is part of qpdfview.
+
+qpdfview is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+qpdfview is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef OUTLINEMODEL_H
+#define OUTLINEMODEL_H
+
+#include <QHash>
+#include <QStandardItemModel>
+
+namespace qpdfview
+{
+
+// Inserts the children of an outline entry only once it is expanded, so that large outlines do not have to be attached to the view up front.
+
+class OutlineModel : public QStandardItemModel
+{
+    Q_OBJECT
+
+public:
+    explicit OutlineModel(QObject* parent = 0);
+    ~OutlineModel();
+
+    // Takes the header and the entries of the given model which is left empty.
+    void takeOutline(QStandardItemModel* source);
+
+    void clear();
+
+    bool hasChildren(const QModelIndex& parent = QModelIndex()) const;
+
+    bool canFetchMore(const QModelIndex& parent) const;
+    void fetchMore(const QModelIndex& parent);
+
+private:
+    Q_DISABLE_COPY(OutlineModel)
+
+    typedef QList< QStandardItem* > Row;
+
+    QHash< QStandardItem*, QList< Row > > m_pendingRows;
+
+    void appendRows(QStandardItem* parent, const QList< Row >& rows);
+    void deletePendingRows();
+
+    static QList< Row > takeRows(QStandardItem* item);
+
+};
+
+} // qpdfview
+
+#endif // OUTLINEMODEL_H
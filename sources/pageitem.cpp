@@ -23,10 +23,13 @@ along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <QApplication>
 #include <QClipboard>
+#include <QtConcurrentRun>
+#include <QDataStream>
 #include <QFileDialog>
 #include <QGraphicsProxyWidget>
 #include <QGraphicsScene>
 #include <QGraphicsSceneHoverEvent>
+#include <QGraphicsView>
 #include <qmath.h>
 #include <QMenu>
 #include <QMessageBox>
@@ -38,8 +41,10 @@ along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "settings.h"
 #include "model.h"
+#include "renderstatistics.h"
 #include "rendertask.h"
 #include "tileitem.h"
+#include "tracing.h"
 
 namespace
 {
@@ -48,6 +53,43 @@ using namespace qpdfview;
 
 const qreal proxyPadding = 2.0;
 
+const int maximumSlicedTileCount = 16;
+
+// A page rendered at once may take up at most this fraction of the pixmap cache.
+const qreal maximumSlicedCacheShare = 1.0 / 8.0;
+
+// The cost of the pixmap cache is measured in bytes of 32-bit pixels.
+const qreal cacheBytesPerPixel = 4.0;
+
+// edge lengths in pixels from which the tile size is chosen
+const int tileSizes[] = { 256, 384, 512, 768, 1024, 1536, 2048 };
+const int tileSizeCount = sizeof(tileSizes) / sizeof(tileSizes[0]);
+
+// A different tile size is only chosen if it is expected to complete the visible area at least this much faster.
+const qreal tileSizeHysteresis = 0.9;
+
+// Estimates the time until the visible area is complete if its tiles are rendered in rounds on all threads.
+qreal visibleRenderTime(int tileSize, const QSizeF& pageSize, const QSizeF& visibleSize, int threadCount, qreal costPerCall, qreal costPerMegapixel)
+{
+    // A page larger than the view is cut off within tiles at both sides whereas a smaller one is covered exactly.
+
+    const int columnCount = pageSize.width() > visibleSize.width() ? qCeil(visibleSize.width() / tileSize) + 1 : qCeil(pageSize.width() / tileSize);
+    const int rowCount = pageSize.height() > visibleSize.height() ? qCeil(visibleSize.height() / tileSize) + 1 : qCeil(pageSize.height() / tileSize);
+
+    const qreal tileWidth = qMin< qreal >(tileSize, pageSize.width());
+    const qreal tileHeight = qMin< qreal >(tileSize, pageSize.height());
+
+    const int roundCount = (columnCount * rowCount + threadCount - 1) / threadCount;
+
+    return roundCount * (costPerCall + costPerMegapixel * tileWidth * tileHeight / (1024.0 * 1024.0));
+}
+
+// Levels of the tile pyramid are spaced by factors of two, where scale factors just above a level are treated as belonging to it.
+qreal tilePyramidScaleFactor(qreal scaleFactor)
+{
+    return qPow(2.0, qCeil(qLn(scaleFactor) / qLn(2.0) - 0.001));
+}
+
 bool modifiersUseMouseButton(Settings* settings, Qt::MouseButton mouseButton)
 {
     return ((settings->pageItem().copyToClipboardModifiers() | settings->pageItem().addAnnotationModifiers()) & mouseButton) != 0;
@@ -60,16 +102,29 @@ namespace qpdfview
 
 Settings* PageItem::s_settings = 0;
 
+QHash< QByteArray, PageItem::CacheKeyReference > PageItem::s_cacheKeyReferences;
+int PageItem::s_lastCacheId = 0;
+
+qreal PageItem::s_renderRate = 0.0;
+
 PageItem::PageItem(Model::Page* page, int index, DrawMode drawMode, QGraphicsItem* parent) : QGraphicsObject(parent),
     m_page(page),
     m_size(page->size()),
     m_cropRect(),
     m_index(index),
     m_drawMode(drawMode),
+    m_documentKey(),
+    m_cacheKey(),
+    m_cacheId(0),
     m_highlights(),
     m_links(),
     m_annotations(),
     m_formFields(),
+    m_linkIndex(),
+    m_annotationIndex(),
+    m_formFieldIndex(),
+    m_interactiveElementsRequested(false),
+    m_interactiveElementsWatcher(0),
     m_rubberBandMode(ModifiersMode),
     m_rubberBand(),
     m_annotationOverlay(),
@@ -78,13 +133,24 @@ PageItem::PageItem(Model::Page* page, int index, DrawMode drawMode, QGraphicsIte
     m_transform(),
     m_normalizedTransform(),
     m_boundingRect(),
-    m_tileItems()
+    m_tileItems(),
+    m_tileSize(0),
+    m_frameRenderParam(),
+    m_frame(),
+    m_pageRenderTask(0),
+    m_renderRate(0.0)
 {
     if(s_settings == 0)
     {
         s_settings = Settings::instance();
     }
 
+    m_cacheKey = QByteArray::number(reinterpret_cast< quintptr >(this));
+    retainCacheKey();
+
+    m_interactiveElementsWatcher = new QFutureWatcher< InteractiveElements >(this);
+    connect(m_interactiveElementsWatcher, SIGNAL(finished()), SLOT(on_interactiveElements_finished()));
+
     setAcceptHoverEvents(true);
 
     setFlag(QGraphicsItem::ItemUsesExtendedStyleOption, s_settings->pageItem().useTiling() && !thumbnailMode());
@@ -100,8 +166,6 @@ PageItem::PageItem(Model::Page* page, int index, DrawMode drawMode, QGraphicsIte
         m_tileItems.replace(0, tile);
     }
 
-    QTimer::singleShot(0, this, SLOT(loadInteractiveElements()));
-
     prepareGeometry();
 }
 
@@ -110,32 +174,114 @@ PageItem::~PageItem()
     hideAnnotationOverlay(false);
     hideFormFieldOverlay(false);
 
-    TileItem::dropCachedPixmaps(this);
+    if(m_pageRenderTask != 0)
+    {
+        m_pageRenderTask->cancel(true);
+        m_pageRenderTask->wait();
+    }
+
+    releaseCacheKey();
+
+    discardInteractiveElements();
 
     qDeleteAll(m_links);
     qDeleteAll(m_annotations);
     qDeleteAll(m_formFields);
 }
 
-QRectF PageItem::boundingRect() const
+void PageItem::setDocumentKey(const QByteArray& documentKey, bool keepCachedPixmaps)
 {
-    if(m_cropRect.isNull())
+    if(m_documentKey == documentKey)
     {
-        return m_boundingRect;
+        return;
     }
 
-    QRectF boundingRect;
+    const QByteArray cacheKey = !documentKey.isEmpty() ?
+                PageItem::cacheKey(documentKey, m_index) :
+                QByteArray::number(reinterpret_cast< quintptr >(this));
 
-    boundingRect.setLeft(m_boundingRect.left() + m_cropRect.left() * m_boundingRect.width());
-    boundingRect.setTop(m_boundingRect.top() + m_cropRect.top() * m_boundingRect.height());
-    boundingRect.setWidth(m_cropRect.width() * m_boundingRect.width());
-    boundingRect.setHeight(m_cropRect.height() * m_boundingRect.height());
+    // The cached pixmaps are carried over unless another page item already retained the new cache key for different ones.
 
-    return boundingRect;
+    const bool carryOver = keepCachedPixmaps && (!s_cacheKeyReferences.contains(cacheKey) || s_cacheKeyReferences.value(cacheKey).id == m_cacheId);
+
+    releaseCacheKey(!carryOver);
+
+    m_documentKey = documentKey;
+    m_cacheKey = cacheKey;
+
+    if(carryOver)
+    {
+        CacheKeyReference& reference = s_cacheKeyReferences[m_cacheKey];
+
+        if(reference.count++ == 0)
+        {
+            reference.id = m_cacheId;
+        }
+    }
+    else
+    {
+        retainCacheKey();
+    }
+}
+
+void PageItem::setPage(Model::Page* page, const QByteArray& documentKey, bool changed)
+{
+    hideAnnotationOverlay(false);
+    hideFormFieldOverlay(false);
+
+    foreach(TileItem* tile, m_tileItems)
+    {
+        tile->m_renderTask->cancel(true);
+        tile->m_renderTask->wait();
+        tile->m_renderTask->setPage(page);
+    }
+
+    if(m_pageRenderTask != 0)
+    {
+        m_pageRenderTask->cancel(true);
+        m_pageRenderTask->wait();
+        m_pageRenderTask->setPage(page);
+    }
+
+    discardInteractiveElements();
+
+    qDeleteAll(m_links);
+    m_links.clear();
+    m_linkIndex.clear();
+
+    qDeleteAll(m_annotations);
+    m_annotations.clear();
+    m_annotationIndex.clear();
+
+    qDeleteAll(m_formFields);
+    m_formFields.clear();
+    m_formFieldIndex.clear();
+
+    m_interactiveElementsRequested = false;
+
+    m_page = page;
+
+    setDocumentKey(documentKey, !changed);
+
+    if(changed)
+    {
+        refresh(true, true);
+    }
+
+    setSize(m_page->size());
+
+    update();
+}
+
+QRectF PageItem::boundingRect() const
+{
+    return cropBoundingRect(m_boundingRect, m_cropRect);
 }
 
 void PageItem::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget*)
 {
+    requestInteractiveElements();
+
     paintPage(painter, option->exposedRect);
 
     paintLinks(painter);
@@ -147,35 +293,50 @@ void PageItem::paint(QPainter* painter, const QStyleOptionGraphicsItem* option,
 
 qreal PageItem::displayedWidth() const
 {
-    const qreal cropWidth = m_cropRect.isNull() ? 1.0 : m_cropRect.width();
-    const qreal cropHeight = m_cropRect.isNull() ? 1.0 : m_cropRect.height();
+    return displayedWidth(m_size, m_cropRect, m_renderParam);
+}
 
-    switch(m_renderParam.rotation)
+qreal PageItem::displayedHeight() const
+{
+    return displayedHeight(m_size, m_cropRect, m_renderParam);
+}
+
+QRectF PageItem::boundingRect(const QSizeF& size, const QRectF& cropRect, const RenderParam& renderParam)
+{
+    return cropBoundingRect(uncroppedBoundingRect(renderTransform(renderParam), size), cropRect);
+}
+
+qreal PageItem::displayedWidth(const QSizeF& size, const QRectF& cropRect, const RenderParam& renderParam)
+{
+    const qreal cropWidth = cropRect.isNull() ? 1.0 : cropRect.width();
+    const qreal cropHeight = cropRect.isNull() ? 1.0 : cropRect.height();
+
+    switch(renderParam.rotation)
     {
     default:
     case RotateBy0:
     case RotateBy180:
-        return m_renderParam.resolution.resolutionX / 72.0 * cropWidth * m_size.width();
+        return renderParam.resolution.resolutionX / 72.0 * cropWidth * size.width();
     case RotateBy90:
     case RotateBy270:
-        return m_renderParam.resolution.resolutionX / 72.0 * cropHeight * m_size.height();
+        return renderParam.resolution.resolutionX / 72.0 * cropHeight * size.height();
     }
 }
 
-qreal PageItem::displayedHeight() const
+qreal PageItem::displayedHeight(const QSizeF& size, const QRectF& cropRect, const RenderParam& renderParam)
 {
-    const qreal cropHeight = m_cropRect.isNull() ? 1.0 : m_cropRect.height();
-    const qreal cropWidth = m_cropRect.isNull() ? 1.0 : m_cropRect.width();
+    const qreal cropHeight = cropRect.isNull() ? 1.0 : cropRect.height();
+    const qreal cropWidth = cropRect.isNull() ? 1.0 : cropRect.width();
 
-    switch(m_renderParam.rotation)
+    switch(renderParam.rotation)
     {
     default:
     case RotateBy0:
     case RotateBy180:
-        return m_renderParam.resolution.resolutionY / 72.0 * cropHeight * m_size.height();
+        return renderParam.resolution.resolutionY / 72.0 * cropHeight * size.height();
     case RotateBy90:
     case RotateBy270:
-        return m_renderParam.resolution.resolutionY / 72.0 * cropWidth * m_size.width();
+        return renderParam.resolution.resolutionY / 72.0 * cropWidth * size.width();
     }
 }
 
@@ -248,16 +409,45 @@ void PageItem::setScaleFactor(qreal scaleFactor)
     }
 }
 
+void PageItem::setSize(const QSizeF& size)
+{
+    if(m_size != size && !size.isEmpty())
+    {
+        refresh(false);
+
+        m_size = size;
+
+        prepareGeometryChange();
+        prepareGeometry();
+    }
+}
+
+void PageItem::setCropRect(const QRectF& cropRect)
+{
+    if(m_cropRect.isNull() && !cropRect.isNull())
+    {
+        prepareGeometryChange();
+
+        m_cropRect = cropRect;
+    }
+}
+
 void PageItem::setRotation(Rotation rotation)
 {
     if(m_renderParam.rotation != rotation && rotation >= 0 && rotation < NumberOfRotations)
     {
         refresh(false);
 
+        const Rotation oldRotation = m_renderParam.rotation;
+        const QRectF oldBoundingRect = tileBoundingRect();
+        const QSize oldSize(oldBoundingRect.width(), oldBoundingRect.height());
+
         m_renderParam.rotation = rotation;
 
         prepareGeometryChange();
         prepareGeometry();
+
+        TileItem::rotateCachedPixmaps(this, oldRotation, oldSize);
     }
 }
 
@@ -268,6 +458,8 @@ void PageItem::setInvertColors(bool invertColors)
         refresh(false);
 
         m_renderParam.invertColors = invertColors;
+
+        TileItem::recolorCachedPixmaps(this);
     }
 }
 
@@ -278,9 +470,19 @@ void PageItem::setConvertToGrayscale(bool convertToGrayscale)
         refresh(false);
 
         m_renderParam.convertToGrayscale = convertToGrayscale;
+
+        TileItem::recolorCachedPixmaps(this);
     }
 }
 
+void PageItem::setFrame(const RenderParam& renderParam, const QPixmap& frame)
+{
+    m_frameRenderParam = renderParam;
+    m_frame = frame;
+
+    update();
+}
+
 
 void PageItem::refresh(bool keepObsoletePixmaps, bool dropCachedPixmaps)
 {
@@ -294,6 +496,11 @@ void PageItem::refresh(bool keepObsoletePixmaps, bool dropCachedPixmaps)
         {
             tile->refresh(keepObsoletePixmaps);
         }
+
+        if(m_pageRenderTask != 0)
+        {
+            m_pageRenderTask->cancel(true);
+        }
     }
 
     if(!keepObsoletePixmaps)
@@ -309,36 +516,77 @@ void PageItem::refresh(bool keepObsoletePixmaps, bool dropCachedPixmaps)
     update();
 }
 
-int PageItem::startRender(bool prefetch)
+int PageItem::startRender(bool prefetch, bool nearVisible)
 {
+    if(!prefetch || nearVisible)
+    {
+        requestInteractiveElements();
+    }
+
     int cost = 0;
 
     if(!s_settings->pageItem().useTiling() || thumbnailMode())
     {
-        cost += m_tileItems.first()->startRender(prefetch);
+        cost += m_tileItems.first()->startRender(prefetch, nearVisible);
+    }
+    else if(slicesPageRender())
+    {
+        cost += startPageRender(prefetch, nearVisible);
     }
     else
     {
         foreach(TileItem* tile, m_tileItems)
         {
-            cost += tile->startRender(prefetch);
+            cost += tile->startRender(prefetch, nearVisible);
         }
     }
 
     return cost;
 }
 
-void PageItem::cancelRender()
+int PageItem::startRender(const QRectF& rect, bool prefetch, bool nearVisible)
+{
+    if(!s_settings->pageItem().useTiling() || thumbnailMode() || slicesPageRender())
+    {
+        return startRender(prefetch, nearVisible);
+    }
+
+    if(!prefetch || nearVisible)
+    {
+        requestInteractiveElements();
+    }
+
+    int cost = 0;
+
+    const QRectF translatedRect = rect.translated(-m_boundingRect.topLeft());
+
+    foreach(TileItem* tile, m_tileItems)
+    {
+        if(translatedRect.intersects(tile->displayedRect()))
+        {
+            cost += tile->startRender(prefetch, nearVisible);
+        }
+    }
+
+    return cost;
+}
+
+void PageItem::cancelRender(bool force)
 {
     if(!s_settings->pageItem().useTiling() || thumbnailMode())
     {
-        m_tileItems.first()->cancelRender();
+        m_tileItems.first()->cancelRender(force);
     }
     else
     {
         foreach(TileItem* tile, m_tileItems)
         {
-            tile->cancelRender();
+            tile->cancelRender(force);
+        }
+
+        if(m_pageRenderTask != 0)
+        {
+            m_pageRenderTask->cancel(force);
         }
     }
 }
@@ -401,11 +649,17 @@ void PageItem::hoverMoveEvent(QGraphicsSceneHoverEvent* event)
 {
     if(m_rubberBandMode == ModifiersMode && event->modifiers() == Qt::NoModifier)
     {
+        // The position is mapped into normalized page coordinates once instead of mapping every element onto the page.
+
+        const QPointF normalizedPos = m_normalizedTransform.inverted().map(event->pos());
+
         // links
 
-        foreach(const Model::Link* link, m_links)
+        foreach(int index, m_linkIndex.candidates(normalizedPos))
         {
-            if(m_normalizedTransform.map(link->boundary).contains(event->pos()))
+            const Model::Link* link = m_links.at(index);
+
+            if(link->boundary.contains(normalizedPos))
             {
                 if(link->page != -1 && (link->urlOrFileName.isNull() || !presentationMode()))
                 {
@@ -418,6 +672,8 @@ void PageItem::hoverMoveEvent(QGraphicsSceneHoverEvent* event)
                     else
                     {
                         QToolTip::showText(event->screenPos(), tr("Go to page %1 of file '%2'.").arg(link->page).arg(link->urlOrFileName));
+
+                        emit linkPreloadRequested(link->urlOrFileName, link->page, true);
                     }
 
                     return;
@@ -442,9 +698,11 @@ void PageItem::hoverMoveEvent(QGraphicsSceneHoverEvent* event)
 
         // annotations
 
-        foreach(const Model::Annotation* annotation, m_annotations)
+        foreach(int index, m_annotationIndex.candidates(normalizedPos))
         {
-            if(m_normalizedTransform.mapRect(annotation->boundary()).contains(event->pos()))
+            const Model::Annotation* annotation = m_annotations.at(index);
+
+            if(annotation->boundary().contains(normalizedPos))
             {
                 setCursor(Qt::PointingHandCursor);
                 QToolTip::showText(event->screenPos(), annotation->contents());
@@ -455,9 +713,11 @@ void PageItem::hoverMoveEvent(QGraphicsSceneHoverEvent* event)
 
         // form fields
 
-        foreach(const Model::FormField* formField, m_formFields)
+        foreach(int index, m_formFieldIndex.candidates(normalizedPos))
         {
-            if(m_normalizedTransform.mapRect(formField->boundary()).contains(event->pos()))
+            const Model::FormField* formField = m_formFields.at(index);
+
+            if(formField->boundary().contains(normalizedPos))
             {
                 setCursor(Qt::PointingHandCursor);
                 QToolTip::showText(event->screenPos(), tr("Edit form field '%1'.").arg(formField->name()));
@@ -522,11 +782,15 @@ void PageItem::mousePressEvent(QGraphicsSceneMouseEvent* event)
     if(event->modifiers() == Qt::NoModifier
             && (event->button() == Qt::LeftButton || event->button() == Qt::MidButton))
     {
+        const QPointF normalizedPos = m_normalizedTransform.inverted().map(event->pos());
+
         // links
 
-        foreach(const Model::Link* link, m_links)
+        foreach(int index, m_linkIndex.candidates(normalizedPos))
         {
-            if(m_normalizedTransform.map(link->boundary).contains(event->pos()))
+            const Model::Link* link = m_links.at(index);
+
+            if(link->boundary.contains(normalizedPos))
             {
                 unsetCursor();
 
@@ -562,9 +826,11 @@ void PageItem::mousePressEvent(QGraphicsSceneMouseEvent* event)
 
         // annotations
 
-        foreach(Model::Annotation* annotation, m_annotations)
+        foreach(int index, m_annotationIndex.candidates(normalizedPos))
         {
-            if(m_normalizedTransform.mapRect(annotation->boundary()).contains(event->pos()))
+            Model::Annotation* annotation = m_annotations.at(index);
+
+            if(annotation->boundary().contains(normalizedPos))
             {
                 unsetCursor();
 
@@ -579,9 +845,11 @@ void PageItem::mousePressEvent(QGraphicsSceneMouseEvent* event)
 
         // form fields
 
-        foreach(Model::FormField* formField, m_formFields)
+        foreach(int index, m_formFieldIndex.candidates(normalizedPos))
         {
-            if(m_normalizedTransform.mapRect(formField->boundary()).contains(event->pos()))
+            Model::FormField* formField = m_formFields.at(index);
+
+            if(formField->boundary().contains(normalizedPos))
             {
                 unsetCursor();
 
@@ -672,9 +940,13 @@ void PageItem::contextMenuEvent(QGraphicsSceneContextMenuEvent* event)
         return;
     }
 
-    foreach(Model::Link* link, m_links)
+    const QPointF normalizedPos = m_normalizedTransform.inverted().map(event->pos());
+
+    foreach(int index, m_linkIndex.candidates(normalizedPos))
     {
-        if(m_normalizedTransform.map(link->boundary).contains(event->pos()))
+        Model::Link* link = m_links.at(index);
+
+        if(link->boundary.contains(normalizedPos))
         {
             unsetCursor();
 
@@ -685,9 +957,11 @@ void PageItem::contextMenuEvent(QGraphicsSceneContextMenuEvent* event)
         }
     }
 
-    foreach(Model::Annotation* annotation, m_annotations)
+    foreach(int index, m_annotationIndex.candidates(normalizedPos))
     {
-        if(m_normalizedTransform.mapRect(annotation->boundary()).contains(event->pos()))
+        Model::Annotation* annotation = m_annotations.at(index);
+
+        if(annotation->boundary().contains(normalizedPos))
         {
             unsetCursor();
 
@@ -703,23 +977,203 @@ void PageItem::contextMenuEvent(QGraphicsSceneContextMenuEvent* event)
 
 void PageItem::loadInteractiveElements()
 {
-    m_links = m_page->links();
+    if(m_interactiveElementsWatcher->isRunning())
+    {
+        return;
+    }
+
+    m_interactiveElementsWatcher->setFuture(QtConcurrent::run(fetchInteractiveElements, m_page, !presentationMode(), thread()));
+}
+
+void PageItem::on_interactiveElements_finished()
+{
+    const QFuture< InteractiveElements > future = m_interactiveElementsWatcher->future();
+    m_interactiveElementsWatcher->setFuture(QFuture< InteractiveElements >());
+
+    if(future.resultCount() == 0)
+    {
+        return;
+    }
+
+    const InteractiveElements elements = future.result();
+
+    qDeleteAll(m_links);
+    qDeleteAll(m_annotations);
+    qDeleteAll(m_formFields);
+
+    m_links = elements.links;
+    m_annotations = elements.annotations;
+    m_formFields = elements.formFields;
+
+    foreach(const Model::Annotation* annotation, m_annotations)
+    {
+        connect(annotation, SIGNAL(wasModified()), SIGNAL(wasModified()));
+    }
+
+    foreach(const Model::FormField* formField, m_formFields)
+    {
+        connect(formField, SIGNAL(wasModified()), SIGNAL(wasModified()));
+    }
+
+    prepareLinkIndex();
+    prepareAnnotationIndex();
+    prepareFormFieldIndex();
 
     if(!presentationMode())
     {
-        m_annotations = m_page->annotations();
+        foreach(const Model::Link* link, m_links)
+        {
+            if(link->page != -1 && !link->urlOrFileName.isNull())
+            {
+                emit linkPreloadRequested(link->urlOrFileName, link->page, false);
+            }
+        }
+    }
+
+    update();
+}
+
+void PageItem::requestInteractiveElements()
+{
+    // Interactive elements are only loaded once the page is shown or about to be, so that pages which are never shown are never created.
+
+    if(!m_interactiveElementsRequested)
+    {
+        m_interactiveElementsRequested = true;
+
+        QTimer::singleShot(0, this, SLOT(loadInteractiveElements()));
+    }
+}
+
+void PageItem::discardInteractiveElements()
+{
+    QFuture< InteractiveElements > future = m_interactiveElementsWatcher->future();
+    m_interactiveElementsWatcher->setFuture(QFuture< InteractiveElements >());
+
+    future.waitForFinished();
+
+    if(future.resultCount() > 0)
+    {
+        const InteractiveElements elements = future.result();
+
+        qDeleteAll(elements.links);
+        qDeleteAll(elements.annotations);
+        qDeleteAll(elements.formFields);
+    }
+}
+
+PageItem::InteractiveElements PageItem::fetchInteractiveElements(Model::Page* page, bool fetchAnnotationsAndFormFields, QThread* thread)
+{
+    const TraceSpan span("page", "fetchInteractiveElements");
+
+    InteractiveElements elements;
+
+    elements.links = page->links();
+
+    if(fetchAnnotationsAndFormFields)
+    {
+        // The elements are created on a worker thread and have to be moved to the thread of the page item to receive its signals.
 
-        foreach(const Model::Annotation* annotation, m_annotations)
+        elements.annotations = page->annotations();
+
+        foreach(Model::Annotation* annotation, elements.annotations)
         {
-            connect(annotation, SIGNAL(wasModified()), SIGNAL(wasModified()));
+            annotation->moveToThread(thread);
         }
 
-        m_formFields = m_page->formFields();
+        elements.formFields = page->formFields();
 
-        foreach(const Model::FormField* formField, m_formFields)
+        foreach(Model::FormField* formField, elements.formFields)
+        {
+            formField->moveToThread(thread);
+        }
+    }
+
+    return elements;
+}
+
+void PageItem::prepareLinkIndex()
+{
+    QList< QRectF > boundingRects;
+
+    foreach(const Model::Link* link, m_links)
+    {
+        boundingRects.append(link->boundary.boundingRect());
+    }
+
+    m_linkIndex.build(boundingRects);
+}
+
+void PageItem::prepareAnnotationIndex()
+{
+    QList< QRectF > boundingRects;
+
+    foreach(const Model::Annotation* annotation, m_annotations)
+    {
+        boundingRects.append(annotation->boundary());
+    }
+
+    m_annotationIndex.build(boundingRects);
+}
+
+void PageItem::prepareFormFieldIndex()
+{
+    QList< QRectF > boundingRects;
+
+    foreach(const Model::FormField* formField, m_formFields)
+    {
+        boundingRects.append(formField->boundary());
+    }
+
+    m_formFieldIndex.build(boundingRects);
+}
+
+void PageItem::on_pageRenderTask_finished()
+{
+    update();
+}
+
+void PageItem::on_pageRenderTask_imageReady(const RenderParam& renderParam,
+                                            const QRect& rect, bool prefetch,
+                                            QImage image, QRectF cropRect)
+{
+    if(m_renderParam != renderParam || QRect(0, 0, m_boundingRect.width(), m_boundingRect.height()) != rect)
+    {
+        return;
+    }
+
+    if(!image.isNull())
+    {
+        updateRenderRate(m_pageRenderTask->renderDuration(), image.size());
+    }
+
+    const qreal scaleX = image.isNull() ? 1.0 : image.width() / static_cast< qreal >(rect.width());
+    const qreal scaleY = image.isNull() ? 1.0 : image.height() / static_cast< qreal >(rect.height());
+
+    foreach(TileItem* tile, m_tileItems)
+    {
+        const QRect& tileRect = tile->rect();
+
+        QImage tileImage;
+        QRectF tileCropRect;
+
+        if(!image.isNull())
+        {
+            tileImage = image.copy(qRound(scaleX * tileRect.x()), qRound(scaleY * tileRect.y()),
+                                   qRound(scaleX * tileRect.width()), qRound(scaleY * tileRect.height()));
+        }
+
+        if(!cropRect.isNull())
         {
-            connect(formField, SIGNAL(wasModified()), SIGNAL(wasModified()));
+            // The crop rectangle of the page is expressed relative to each tile so that their union yields it again.
+
+            tileCropRect = QRectF((cropRect.left() * rect.width() - tileRect.left()) / tileRect.width(),
+                                  (cropRect.top() * rect.height() - tileRect.top()) / tileRect.height(),
+                                  cropRect.width() * rect.width() / tileRect.width(),
+                                  cropRect.height() * rect.height() / tileRect.height());
         }
+
+        tile->setImage(m_pageRenderTask, prefetch, tileImage, tileCropRect);
     }
 
     update();
@@ -737,7 +1191,7 @@ void PageItem::updateCropRect()
     {
         foreach(TileItem* tile, m_tileItems)
         {
-            const QRect& tileRect = tile->rect();
+            const QRectF tileRect = tile->displayedRect();
             const QRectF& tileCropRect = tile->cropRect();
 
             if(tileCropRect.isNull())
@@ -849,6 +1303,8 @@ void PageItem::addAnnotation(const QPoint& screenPos)
             m_annotations.append(annotation);
             connect(annotation, SIGNAL(wasModified()), SIGNAL(wasModified()));
 
+            prepareAnnotationIndex();
+
             refresh(false, true);
             emit wasModified();
 
@@ -896,6 +1352,8 @@ void PageItem::showAnnotationContextMenu(Model::Annotation* annotation, const QP
             m_annotations.removeAll(annotation);
             m_page->removeAnnotation(annotation);
 
+            prepareAnnotationIndex();
+
             annotation->deleteLater();
 
             refresh(false, true);
@@ -1042,37 +1500,166 @@ void PageItem::setProxyGeometry(Model::FormField* formField, QGraphicsProxyWidge
     proxy->setGeometry(QRectF(x - proxyPadding, y - proxyPadding, width + proxyPadding, height + proxyPadding));
 }
 
-void PageItem::prepareGeometry()
+void PageItem::retainCachedPixmaps(const QByteArray& documentKey, int index)
 {
-    m_transform.reset();
+    if(documentKey.isEmpty())
+    {
+        return;
+    }
 
-    m_transform.scale(m_renderParam.resolution.resolutionX * m_renderParam.scaleFactor / 72.0,
-                      m_renderParam.resolution.resolutionY * m_renderParam.scaleFactor / 72.0);
+    CacheKeyReference& reference = s_cacheKeyReferences[cacheKey(documentKey, index)];
 
-    switch(m_renderParam.rotation)
+    if(reference.count++ == 0)
+    {
+        reference.id = ++s_lastCacheId;
+    }
+}
+
+void PageItem::releaseCachedPixmaps(const QByteArray& documentKey, int index)
+{
+    if(documentKey.isEmpty())
+    {
+        return;
+    }
+
+    QHash< QByteArray, CacheKeyReference >::iterator reference = s_cacheKeyReferences.find(cacheKey(documentKey, index));
+
+    if(reference != s_cacheKeyReferences.end() && --reference.value().count <= 0)
+    {
+        const int id = reference.value().id;
+
+        s_cacheKeyReferences.erase(reference);
+
+        TileItem::dropCachedPixmaps(id);
+    }
+}
+
+int PageItem::cachedPixmapsCost(const QByteArray& documentKey, int index)
+{
+    if(documentKey.isEmpty())
+    {
+        return 0;
+    }
+
+    QHash< QByteArray, CacheKeyReference >::const_iterator reference = s_cacheKeyReferences.constFind(cacheKey(documentKey, index));
+
+    return reference != s_cacheKeyReferences.constEnd() ? TileItem::cacheCost(reference.value().id) : 0;
+}
+
+void PageItem::dropCachedPixmaps(const QByteArray& documentKey, int index)
+{
+    if(documentKey.isEmpty())
+    {
+        return;
+    }
+
+    QHash< QByteArray, CacheKeyReference >::const_iterator reference = s_cacheKeyReferences.constFind(cacheKey(documentKey, index));
+
+    if(reference != s_cacheKeyReferences.constEnd())
+    {
+        TileItem::dropCachedPixmaps(reference.value().id);
+    }
+}
+
+QByteArray PageItem::cacheKey(const QByteArray& documentKey, int index)
+{
+    QByteArray indexKey;
+    QDataStream(&indexKey, QIODevice::WriteOnly) << index;
+
+    return documentKey + indexKey;
+}
+
+void PageItem::retainCacheKey()
+{
+    CacheKeyReference& reference = s_cacheKeyReferences[m_cacheKey];
+
+    if(reference.count++ == 0)
+    {
+        reference.id = ++s_lastCacheId;
+    }
+
+    m_cacheId = reference.id;
+}
+
+void PageItem::releaseCacheKey(bool dropCachedPixmaps)
+{
+    // Cached pixmaps are shared by all page items showing the same page of the same document.
+
+    QHash< QByteArray, CacheKeyReference >::iterator reference = s_cacheKeyReferences.find(m_cacheKey);
+
+    if(reference != s_cacheKeyReferences.end() && --reference.value().count <= 0)
+    {
+        s_cacheKeyReferences.erase(reference);
+
+        if(dropCachedPixmaps)
+        {
+            TileItem::dropCachedPixmaps(this);
+        }
+    }
+}
+
+QTransform PageItem::renderTransform(const RenderParam& renderParam)
+{
+    QTransform transform;
+
+    transform.scale(renderParam.resolution.resolutionX * renderParam.scaleFactor / 72.0,
+                    renderParam.resolution.resolutionY * renderParam.scaleFactor / 72.0);
+
+    switch(renderParam.rotation)
     {
     default:
     case RotateBy0:
         break;
     case RotateBy90:
-        m_transform.rotate(90.0);
+        transform.rotate(90.0);
         break;
     case RotateBy180:
-        m_transform.rotate(180.0);
+        transform.rotate(180.0);
         break;
     case RotateBy270:
-        m_transform.rotate(270.0);
+        transform.rotate(270.0);
         break;
     }
 
+    return transform;
+}
+
+QRectF PageItem::uncroppedBoundingRect(const QTransform& transform, const QSizeF& size)
+{
+    QRectF boundingRect = transform.mapRect(QRectF(QPointF(), size));
+
+    boundingRect.setWidth(qRound(boundingRect.width()));
+    boundingRect.setHeight(qRound(boundingRect.height()));
+
+    return boundingRect;
+}
+
+QRectF PageItem::cropBoundingRect(const QRectF& boundingRect, const QRectF& cropRect)
+{
+    if(cropRect.isNull())
+    {
+        return boundingRect;
+    }
+
+    QRectF croppedBoundingRect;
+
+    croppedBoundingRect.setLeft(boundingRect.left() + cropRect.left() * boundingRect.width());
+    croppedBoundingRect.setTop(boundingRect.top() + cropRect.top() * boundingRect.height());
+    croppedBoundingRect.setWidth(cropRect.width() * boundingRect.width());
+    croppedBoundingRect.setHeight(cropRect.height() * boundingRect.height());
+
+    return croppedBoundingRect;
+}
+
+void PageItem::prepareGeometry()
+{
+    m_transform = renderTransform(m_renderParam);
+
     m_normalizedTransform = m_transform;
     m_normalizedTransform.scale(m_size.width(), m_size.height());
 
 
-    m_boundingRect = m_transform.mapRect(QRectF(QPointF(), m_size));
-
-    m_boundingRect.setWidth(qRound(m_boundingRect.width()));
-    m_boundingRect.setHeight(qRound(m_boundingRect.height()));
+    m_boundingRect = uncroppedBoundingRect(m_transform, m_size);
 
 
     prepareTiling();
@@ -1091,19 +1678,37 @@ void PageItem::prepareTiling()
     }
 
 
-    const qreal pageWidth = m_boundingRect.width();
-    const qreal pageHeight = m_boundingRect.height();
+    const QRectF tileBoundingRect = this->tileBoundingRect();
+
+    const qreal pageWidth = tileBoundingRect.width();
+    const qreal pageHeight = tileBoundingRect.height();
+
+    const int tileSize = m_tileSize = chooseTileSize();
 
-    const int tileSize = s_settings->pageItem().tileSize();
+    int columnCount = 0;
+    int rowCount = 0;
 
-    int tileWidth = pageWidth < pageHeight ? tileSize * pageWidth / pageHeight : tileSize;
-    int tileHeight = pageHeight < pageWidth ? tileSize * pageHeight / pageWidth : tileSize;
+    int tileWidth = tileSize;
+    int tileHeight = tileSize;
 
-    const int columnCount = qCeil(pageWidth / tileWidth);
-    const int rowCount = qCeil(pageHeight / tileHeight);
+    if(usesTilePyramid())
+    {
+        // The tiles of a level have a fixed size and are addressed by their column and row, so that they stay the same while zooming within the level.
 
-    tileWidth = qCeil(pageWidth / columnCount);
-    tileHeight = qCeil(pageHeight / rowCount);
+        columnCount = qCeil(pageWidth / tileSize);
+        rowCount = qCeil(pageHeight / tileSize);
+    }
+    else
+    {
+        tileWidth = pageWidth < pageHeight ? tileSize * pageWidth / pageHeight : tileSize;
+        tileHeight = pageHeight < pageWidth ? tileSize * pageHeight / pageWidth : tileSize;
+
+        columnCount = qCeil(pageWidth / tileWidth);
+        rowCount = qCeil(pageHeight / tileHeight);
+
+        tileWidth = qCeil(pageWidth / columnCount);
+        tileHeight = qCeil(pageHeight / rowCount);
+    }
 
 
     const int newCount = columnCount * rowCount;
@@ -1145,6 +1750,227 @@ void PageItem::prepareTiling()
     }
 }
 
+int PageItem::chooseTileSize() const
+{
+    const int defaultTileSize = s_settings->pageItem().tileSize();
+
+    if(scene() == 0)
+    {
+        return defaultTileSize;
+    }
+
+    const int lastTileSize = RenderStatistics::tileSize(scene());
+    const int threadCount = RenderScheduler::instance()->maxThreadCount();
+
+    int tileSize = lastTileSize > 0 ? lastTileSize : defaultTileSize;
+
+    const RenderStatistics::Counters counters = RenderStatistics::counters(scene());
+
+    qreal costPerCall = 0.0;
+    qreal costPerMegapixel = 0.0;
+
+    if(!counters.fitRenderCost(costPerCall, costPerMegapixel))
+    {
+        // Tiles of a single size do not tell the cost per call from the cost per pixel, so a smaller size is tried once they kept all threads busy.
+
+        if(tileSize == defaultTileSize && counters.renderCount >= 2 * threadCount)
+        {
+            tileSize = qMax(defaultTileSize / 2, tileSizes[0]);
+
+            RenderStatistics::recordTileSize(scene(), tileSize);
+        }
+
+        return tileSize;
+    }
+
+    const QRectF tileBoundingRect = this->tileBoundingRect();
+    const QSizeF pageSize = tileBoundingRect.size();
+
+    QSizeF visibleSize;
+
+    foreach(const QGraphicsView* view, scene()->views())
+    {
+        visibleSize = visibleSize.expandedTo(QSizeF(view->viewport()->size()) / tileScale());
+    }
+
+    if(visibleSize.isEmpty())
+    {
+        visibleSize = pageSize;
+    }
+
+    // Tiles must stay small enough for the pixmap cache to hold the visible area a few times over.
+
+    const qreal maximumPixelCount = TileItem::cacheMaxCost() / 32.0;
+
+    qreal bestTime = tileSize * tileSize <= maximumPixelCount
+            ? tileSizeHysteresis * visibleRenderTime(tileSize, pageSize, visibleSize, threadCount, costPerCall, costPerMegapixel)
+            : -1.0;
+
+    for(int index = 0; index < tileSizeCount; ++index)
+    {
+        const int candidate = tileSizes[index];
+
+        if(candidate * candidate > maximumPixelCount && index > 0)
+        {
+            break;
+        }
+
+        const qreal time = visibleRenderTime(candidate, pageSize, visibleSize, threadCount, costPerCall, costPerMegapixel);
+
+        if(bestTime < 0.0 || time < bestTime)
+        {
+            tileSize = candidate;
+            bestTime = time;
+        }
+    }
+
+    RenderStatistics::recordTileSize(scene(), tileSize);
+
+    return tileSize;
+}
+
+bool PageItem::usesTilePyramid() const
+{
+    return s_settings->pageItem().useTiling() && s_settings->pageItem().useTilePyramid() && !thumbnailMode();
+}
+
+RenderParam PageItem::tileRenderParam() const
+{
+    RenderParam renderParam = m_renderParam;
+
+    if(usesTilePyramid())
+    {
+        renderParam.scaleFactor = tilePyramidScaleFactor(m_renderParam.scaleFactor);
+    }
+
+    return renderParam;
+}
+
+qreal PageItem::tileScale() const
+{
+    return usesTilePyramid() ? m_renderParam.scaleFactor / tilePyramidScaleFactor(m_renderParam.scaleFactor) : 1.0;
+}
+
+QRectF PageItem::tileBoundingRect() const
+{
+    return usesTilePyramid() ? uncroppedBoundingRect(renderTransform(tileRenderParam()), m_size) : m_boundingRect;
+}
+
+void PageItem::estimateRenderCost(const QRectF& rect, qint64& bytes, qreal& duration) const
+{
+    const QRectF translatedRect = rect.translated(-m_boundingRect.topLeft());
+
+    qreal pixelCount = 0.0;
+
+    foreach(const TileItem* tile, m_tileItems)
+    {
+        const QRect& tileRect = tile->rect();
+
+        if(!tile->isCached() && (rect.isNull() || translatedRect.intersects(tile->displayedRect())))
+        {
+            pixelCount += tileRect.width() * tileRect.height();
+        }
+    }
+
+    const qreal devicePixelRatio = m_renderParam.resolution.devicePixelRatio;
+
+    pixelCount *= devicePixelRatio * devicePixelRatio;
+
+    const qreal renderRate = m_renderRate > 0.0 ? m_renderRate : s_renderRate;
+
+    bytes = static_cast< qint64 >(4.0 * pixelCount);
+    duration = renderRate * pixelCount / (1024.0 * 1024.0);
+}
+
+void PageItem::updateRenderRate(int duration, const QSize& size)
+{
+    if(duration < 0 || size.isEmpty())
+    {
+        return;
+    }
+
+    const qreal renderRate = duration * (1024.0 * 1024.0) / (size.width() * size.height());
+
+    m_renderRate = m_renderRate > 0.0 ? 0.5 * (m_renderRate + renderRate) : renderRate;
+    s_renderRate = s_renderRate > 0.0 ? 0.5 * (s_renderRate + renderRate) : renderRate;
+}
+
+bool PageItem::slicesPageRender() const
+{
+    if(!s_settings->pageItem().useTiling() || thumbnailMode() || usesTilePyramid() || m_tileItems.count() < 2)
+    {
+        return false;
+    }
+
+    // Rendering the whole page at once saves setting up the page for every tile but must neither exceed a few tiles nor crowd out the pixmap cache.
+
+    const qreal devicePixelRatio = m_renderParam.resolution.devicePixelRatio;
+    const qreal pixelCount = devicePixelRatio * devicePixelRatio * m_boundingRect.width() * m_boundingRect.height();
+
+    const qreal tileSize = m_tileSize > 0 ? m_tileSize : s_settings->pageItem().tileSize();
+    const qreal maximumPixelCount = qMin(maximumSlicedTileCount * tileSize * tileSize, maximumSlicedCacheShare * TileItem::cacheMaxCost() / cacheBytesPerPixel);
+
+    return pixelCount <= maximumPixelCount;
+}
+
+int PageItem::startPageRender(bool prefetch, bool nearVisible)
+{
+    if(prefetch)
+    {
+        bool isCached = true;
+
+        foreach(const TileItem* tile, m_tileItems)
+        {
+            if(!tile->isCached())
+            {
+                isCached = false;
+                break;
+            }
+        }
+
+        if(isCached)
+        {
+            return 0;
+        }
+    }
+
+    RenderScheduler::Priority priority;
+
+    if(!prefetch)
+    {
+        priority = RenderScheduler::VisiblePriority;
+    }
+    else
+    {
+        priority = nearVisible ? RenderScheduler::NearVisiblePriority : RenderScheduler::PrefetchPriority;
+    }
+
+    if(m_pageRenderTask == 0)
+    {
+        m_pageRenderTask = new RenderTask(m_page, this);
+
+        connect(m_pageRenderTask, SIGNAL(finished()), SLOT(on_pageRenderTask_finished()));
+        connect(m_pageRenderTask, SIGNAL(imageReady(RenderParam,QRect,bool,QImage,QRectF)), SLOT(on_pageRenderTask_imageReady(RenderParam,QRect,bool,QImage,QRectF)));
+    }
+
+    if(m_pageRenderTask->isRunning())
+    {
+        m_pageRenderTask->reprioritize(priority);
+
+        return 0;
+    }
+
+    const QRect rect(0, 0, m_boundingRect.width(), m_boundingRect.height());
+
+    m_pageRenderTask->start(m_renderParam,
+                            rect, prefetch,
+                            s_settings->pageItem().trimMargins() && m_cropRect.isNull(), s_settings->pageItem().paperColor(),
+                            priority, scene(),
+                            false, TileItem::diskCache(this), TileItem::diskCacheKey(this, rect));
+
+    return 1;
+}
+
 void PageItem::paintPage(QPainter* painter, const QRectF& exposedRect) const
 {
     if(s_settings->pageItem().decoratePages() && !presentationMode())
@@ -1163,7 +1989,11 @@ void PageItem::paintPage(QPainter* painter, const QRectF& exposedRect) const
 
     // tiles
 
-    if(!s_settings->pageItem().useTiling() || thumbnailMode())
+    if(!m_frame.isNull() && m_frameRenderParam == m_renderParam)
+    {
+        painter->drawPixmap(m_boundingRect, m_frame, QRectF(QPointF(), m_frame.size()));
+    }
+    else if(!s_settings->pageItem().useTiling() || thumbnailMode())
     {
         m_tileItems.first()->paint(painter, m_boundingRect.topLeft());
     }
@@ -1173,7 +2003,7 @@ void PageItem::paintPage(QPainter* painter, const QRectF& exposedRect) const
 
         foreach(TileItem* tile, m_tileItems)
         {
-            if(translatedExposedRect.intersects(tile->rect()))
+            if(translatedExposedRect.intersects(tile->displayedRect()))
             {
                 tile->paint(painter, m_boundingRect.topLeft());
             }
@@ -23,12 +23,18 @@ along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
 #define PAGEITEM_H
 
 #include <QCache>
+#include <QFutureWatcher>
 #include <QGraphicsObject>
+#include <QHash>
 #include <QIcon>
+#include <QImage>
+#include <QPixmap>
 
 class QGraphicsProxyWidget;
+class QThread;
 
 #include "global.h"
+#include "hittestindex.h"
 
 namespace qpdfview
 {
@@ -68,10 +74,21 @@ public:
     inline int index() const { return m_index; }
 
     inline const QSizeF& size() const { return m_size; }
+    void setSize(const QSizeF& size);
+
+    inline const QRectF& cropRect() const { return m_cropRect; }
+    void setCropRect(const QRectF& cropRect);
 
     qreal displayedWidth() const;
     qreal displayedHeight() const;
 
+    // The geometry of a page item can be computed without creating it, so that pages can be laid out before they are materialized.
+
+    static QRectF boundingRect(const QSizeF& size, const QRectF& cropRect, const RenderParam& renderParam);
+
+    static qreal displayedWidth(const QSizeF& size, const QRectF& cropRect, const RenderParam& renderParam);
+    static qreal displayedHeight(const QSizeF& size, const QRectF& cropRect, const RenderParam& renderParam);
+
     inline const QList< QRectF >& highlights() const { return m_highlights; }
     void setHighlights(const QList< QRectF >& highlights);
 
@@ -100,9 +117,32 @@ public:
     inline bool convertToGrayscale() { return m_renderParam.convertToGrayscale; }
     void setConvertToGrayscale(bool convertToGrayscale);
 
+    inline const RenderParam& renderParam() const { return m_renderParam; }
+
+    // A frame of the whole page rendered ahead of time is painted instead of the tiles while it matches the render parameters.
+
+    void setFrame(const RenderParam& renderParam, const QPixmap& frame);
+
     inline const QTransform& transform() const { return m_transform; }
     inline const QTransform& normalizedTransform() const { return m_normalizedTransform; }
 
+    inline const QByteArray& documentKey() const { return m_documentKey; }
+    void setDocumentKey(const QByteArray& documentKey, bool keepCachedPixmaps = false);
+
+    // Keeps the pixmaps cached for a page of a document while no page item is showing it.
+    static void retainCachedPixmaps(const QByteArray& documentKey, int index);
+    static void releaseCachedPixmaps(const QByteArray& documentKey, int index);
+
+    // The bytes of the pixmaps cached for a page of a document, which can be dropped without releasing them.
+    static int cachedPixmapsCost(const QByteArray& documentKey, int index);
+    static void dropCachedPixmaps(const QByteArray& documentKey, int index);
+
+    // Replaces the page after the document was reloaded and keeps the cached pixmaps if it did not change.
+    void setPage(Model::Page* page, const QByteArray& documentKey, bool changed);
+
+    // Estimates the bytes and milliseconds needed to render the tiles within the given rectangle which are not cached yet.
+    void estimateRenderCost(const QRectF& rect, qint64& bytes, qreal& duration) const;
+
 signals:
     void cropRectChanged();
 
@@ -110,6 +150,9 @@ signals:
     void linkClicked(bool newTab, const QString& fileName, int page);
     void linkClicked(const QString& url);
 
+    // Links into other files ask for their targets to be loaded ahead when they are hovered or their page was loaded.
+    void linkPreloadRequested(const QString& fileName, int page, bool hovered);
+
     void rubberBandStarted();
     void rubberBandFinished();
 
@@ -121,8 +164,9 @@ signals:
 public slots:
     void refresh(bool keepObsoletePixmaps = false, bool dropCachedPixmaps = false);
 
-    int startRender(bool prefetch = false);
-    void cancelRender();
+    int startRender(bool prefetch = false, bool nearVisible = false);
+    int startRender(const QRectF& rect, bool prefetch = false, bool nearVisible = false);
+    void cancelRender(bool force = false);
 
 protected slots:
     void showAnnotationOverlay(Model::Annotation* selectedAnnotation);
@@ -147,6 +191,12 @@ protected:
 
 private slots:
     virtual void loadInteractiveElements();
+    void on_interactiveElements_finished();
+
+    void on_pageRenderTask_finished();
+    void on_pageRenderTask_imageReady(const RenderParam& renderParam,
+                                      const QRect& rect, bool prefetch,
+                                      QImage image, QRectF cropRect);
 
 private:
     Q_DISABLE_COPY(PageItem)
@@ -163,6 +213,27 @@ private:
     int m_index;
     DrawMode m_drawMode;
 
+    // cache
+
+    QByteArray m_documentKey;
+    QByteArray m_cacheKey;
+    int m_cacheId;
+
+    struct CacheKeyReference
+    {
+        int id;
+        int count;
+
+    };
+
+    static QHash< QByteArray, CacheKeyReference > s_cacheKeyReferences;
+    static int s_lastCacheId;
+
+    static QByteArray cacheKey(const QByteArray& documentKey, int index);
+
+    void retainCacheKey();
+    void releaseCacheKey(bool dropCachedPixmaps = true);
+
     inline bool presentationMode() const { return m_drawMode == PresentationMode; }
     inline bool thumbnailMode() const { return m_drawMode == ThumbnailMode; }
 
@@ -174,6 +245,31 @@ private:
     QList< Model::Annotation* > m_annotations;
     QList< Model::FormField* > m_formFields;
 
+    HitTestIndex m_linkIndex;
+    HitTestIndex m_annotationIndex;
+    HitTestIndex m_formFieldIndex;
+
+    void prepareLinkIndex();
+    void prepareAnnotationIndex();
+    void prepareFormFieldIndex();
+
+    bool m_interactiveElementsRequested;
+
+    struct InteractiveElements
+    {
+        QList< Model::Link* > links;
+        QList< Model::Annotation* > annotations;
+        QList< Model::FormField* > formFields;
+
+    };
+
+    QFutureWatcher< InteractiveElements >* m_interactiveElementsWatcher;
+
+    void requestInteractiveElements();
+    void discardInteractiveElements();
+
+    static InteractiveElements fetchInteractiveElements(Model::Page* page, bool fetchAnnotationsAndFormFields, QThread* thread);
+
     RubberBandMode m_rubberBandMode;
     QRectF m_rubberBand;
 
@@ -207,12 +303,43 @@ private:
     QTransform m_normalizedTransform;
     QRectF m_boundingRect;
 
+    static QTransform renderTransform(const RenderParam& renderParam);
+    static QRectF uncroppedBoundingRect(const QTransform& transform, const QSizeF& size);
+    static QRectF cropBoundingRect(const QRectF& boundingRect, const QRectF& cropRect);
+
     void prepareGeometry();
 
     QVector< TileItem* > m_tileItems;
 
+    // edge length of the tiles chosen for the measured render costs of the document and its current zoom
+    int m_tileSize;
+    int chooseTileSize() const;
+
     void prepareTiling();
 
+    // The tiles of the pyramid are rendered at the power of two just above the scale factor and scaled down when they are painted.
+
+    bool usesTilePyramid() const;
+
+    RenderParam tileRenderParam() const;
+    qreal tileScale() const;
+
+    QRectF tileBoundingRect() const;
+
+    RenderParam m_frameRenderParam;
+    QPixmap m_frame;
+
+    RenderTask* m_pageRenderTask;
+
+    // milliseconds per megapixel as measured for this page or for any page if not yet rendered
+    qreal m_renderRate;
+    static qreal s_renderRate;
+
+    void updateRenderRate(int duration, const QSize& size);
+
+    bool slicesPageRender() const;
+    int startPageRender(bool prefetch, bool nearVisible);
+
     // paint
 
     void paintPage(QPainter* painter, const QRectF& exposedRect) const;
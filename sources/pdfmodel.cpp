@@ -22,9 +22,12 @@ along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "pdfmodel.h"
 
+#include <QFile>
+#include <QFileInfo>
 #include <QFormLayout>
 #include <QMessageBox>
 #include <QSettings>
+#include <QSpinBox>
 
 #if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
 
@@ -60,6 +63,84 @@ along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
 namespace
 {
 
+// number of bytes at the end of the original file which have to be written unchanged for an update to be appended
+const qint64 incrementalUpdateWindow = 4096;
+
+// Skips the copy of the original file which starts the written data and keeps only what is written beyond it.
+// Instead of comparing the whole copy, only its end is checked as the trailer of the original file is located there.
+
+class IncrementalUpdateDevice : public QIODevice
+{
+public:
+    IncrementalUpdateDevice(QFile* original) : QIODevice(),
+        m_originalSize(original->size()),
+        m_originalTail(),
+        m_position(0),
+        m_tail(),
+        m_update()
+    {
+        const qint64 tailSize = qMin(m_originalSize, incrementalUpdateWindow);
+
+        if(original->seek(m_originalSize - tailSize))
+        {
+            m_originalTail = original->read(tailSize);
+        }
+    }
+
+    inline bool isIncremental() const
+    {
+        return m_position >= m_originalSize
+                && m_originalTail.size() == qMin(m_originalSize, incrementalUpdateWindow)
+                && m_tail == m_originalTail;
+    }
+    inline const QByteArray& update() const { return m_update; }
+
+protected:
+    qint64 readData(char* data, qint64 maxSize)
+    {
+        Q_UNUSED(data);
+        Q_UNUSED(maxSize);
+
+        return -1;
+    }
+
+    qint64 writeData(const char* data, qint64 maxSize)
+    {
+        qint64 offset = 0;
+
+        if(m_position < m_originalSize)
+        {
+            const qint64 size = qMin(maxSize, m_originalSize - m_position);
+            const qint64 tailBegin = m_originalSize - m_originalTail.size();
+
+            if(m_position + size > tailBegin)
+            {
+                const qint64 skip = qMax(tailBegin - m_position, Q_INT64_C(0));
+
+                m_tail.append(data + skip, size - skip);
+            }
+
+            m_position += size;
+            offset = size;
+        }
+
+        m_update.append(data + offset, maxSize - offset);
+
+        return maxSize;
+    }
+
+private:
+    Q_DISABLE_COPY(IncrementalUpdateDevice)
+
+    const qint64 m_originalSize;
+    QByteArray m_originalTail;
+    qint64 m_position;
+
+    QByteArray m_tail;
+    QByteArray m_update;
+
+};
+
 void loadOutline(Poppler::Document* document, const QDomNode& node, QStandardItem* parent)
 {
     const QDomElement element = node.toElement();
@@ -134,6 +215,174 @@ void loadOutline(Poppler::Document* document, const QDomNode& node, QStandardIte
     }
 }
 
+
+#ifdef HAS_POPPLER_63
+
+bool shouldAbortRender(const QVariant& closure)
+{
+    const qpdfview::Model::CancellationToken* cancellation = reinterpret_cast< const qpdfview::Model::CancellationToken* >(closure.value< quintptr >());
+
+    return cancellation->wasCanceled();
+}
+
+#endif // HAS_POPPLER_63
+
+QImage renderPage(Poppler::Page* page, qreal horizontalResolution, qreal verticalResolution, qpdfview::Rotation rotation, const QRect& boundingRect, const qpdfview::Model::CancellationToken* cancellation)
+{
+    Poppler::Page::Rotation rotate;
+
+    switch(rotation)
+    {
+    default:
+    case qpdfview::RotateBy0:
+        rotate = Poppler::Page::Rotate0;
+        break;
+    case qpdfview::RotateBy90:
+        rotate = Poppler::Page::Rotate90;
+        break;
+    case qpdfview::RotateBy180:
+        rotate = Poppler::Page::Rotate180;
+        break;
+    case qpdfview::RotateBy270:
+        rotate = Poppler::Page::Rotate270;
+        break;
+    }
+
+    int x = -1;
+    int y = -1;
+    int w = -1;
+    int h = -1;
+
+    if(!boundingRect.isNull())
+    {
+        x = boundingRect.x();
+        y = boundingRect.y();
+        w = boundingRect.width();
+        h = boundingRect.height();
+    }
+
+#ifdef HAS_POPPLER_63
+
+    if(cancellation != 0)
+    {
+        return page->renderToImage(horizontalResolution, verticalResolution, x, y, w, h, rotate,
+                                   0, 0, shouldAbortRender, QVariant::fromValue(reinterpret_cast< quintptr >(cancellation)));
+    }
+
+#else
+
+    Q_UNUSED(cancellation);
+
+#endif // HAS_POPPLER_63
+
+    return page->renderToImage(horizontalResolution, verticalResolution, x, y, w, h, rotate);
+}
+
+QList< QRectF > searchPage(Poppler::Page* page, const QString& text, bool matchCase)
+{
+    QList< QRectF > results;
+
+#if defined(HAS_POPPLER_22)
+
+    results = page->search(text, matchCase ? Poppler::Page::CaseSensitive : Poppler::Page::CaseInsensitive);
+
+#elif defined(HAS_POPPLER_14)
+
+    double left = 0.0, top = 0.0, right = 0.0, bottom = 0.0;
+
+    while(page->search(text, left, top, right, bottom, Poppler::Page::NextResult, matchCase ? Poppler::Page::CaseSensitive : Poppler::Page::CaseInsensitive))
+    {
+        QRectF rect;
+        rect.setLeft(left);
+        rect.setTop(top);
+        rect.setRight(right);
+        rect.setBottom(bottom);
+
+        results.append(rect);
+    }
+
+#else
+
+    QRectF rect;
+
+    while(page->search(text, rect, Poppler::Page::NextResult, matchCase ? Poppler::Page::CaseSensitive : Poppler::Page::CaseInsensitive))
+    {
+        results.append(rect);
+    }
+
+#endif // HAS_POPPLER_22 HAS_POPPLER_14
+
+    return results;
+}
+
+void configureDocument(Poppler::Document* document, QSettings* settings)
+{
+    document->setRenderHint(Poppler::Document::Antialiasing, settings->value("antialiasing", true).toBool());
+    document->setRenderHint(Poppler::Document::TextAntialiasing, settings->value("textAntialiasing", true).toBool());
+
+#if defined(HAS_POPPLER_18)
+
+    switch(settings->value("textHinting", 0).toInt())
+    {
+    default:
+    case 0:
+        document->setRenderHint(Poppler::Document::TextHinting, false);
+        break;
+    case 1:
+        document->setRenderHint(Poppler::Document::TextHinting, true);
+        document->setRenderHint(Poppler::Document::TextSlightHinting, false);
+        break;
+    case 2:
+        document->setRenderHint(Poppler::Document::TextHinting, true);
+        document->setRenderHint(Poppler::Document::TextSlightHinting, true);
+        break;
+    }
+
+#elif defined(HAS_POPPLER_14)
+
+    document->setRenderHint(Poppler::Document::TextHinting, settings->value("textHinting", false).toBool());
+
+#endif // HAS_POPPLER_18 HAS_POPPLER_14
+
+#ifdef HAS_POPPLER_22
+
+    document->setRenderHint(Poppler::Document::OverprintPreview, settings->value("overprintPreview", false).toBool());
+
+#endif // HAS_POPPLER_22
+
+#ifdef HAS_POPPLER_24
+
+    switch(settings->value("thinLineMode", 0).toInt())
+    {
+    default:
+    case 0:
+        document->setRenderHint(Poppler::Document::ThinLineSolid, false);
+        document->setRenderHint(Poppler::Document::ThinLineShape, false);
+        break;
+    case 1:
+        document->setRenderHint(Poppler::Document::ThinLineSolid, true);
+        document->setRenderHint(Poppler::Document::ThinLineShape, false);
+        break;
+    case 2:
+        document->setRenderHint(Poppler::Document::ThinLineSolid, false);
+        document->setRenderHint(Poppler::Document::ThinLineShape, true);
+        break;
+    }
+
+#endif // HAS_POPPLER_24
+
+    switch(settings->value("backend").toInt())
+    {
+    default:
+    case 0:
+        document->setRenderBackend(Poppler::Document::SplashBackend);
+        break;
+    case 1:
+        document->setRenderBackend(Poppler::Document::ArthurBackend);
+        break;
+    }
+}
+
 } // anonymous
 
 namespace qpdfview
@@ -142,8 +391,83 @@ namespace qpdfview
 namespace Model
 {
 
-PdfAnnotation::PdfAnnotation(QMutex* mutex, Poppler::Annotation* annotation) : Annotation(),
+PdfDocumentPool::PdfDocumentPool(const QList< Poppler::Document* >& documents) :
+    m_mutex(),
+    m_allReleased(),
+    m_documents(documents),
+    m_freeDocuments(documents),
+    m_detached(false)
+{
+}
+
+PdfDocumentPool::~PdfDocumentPool()
+{
+    QMutexLocker mutexLocker(&m_mutex);
+
+    while(m_freeDocuments.count() != m_documents.count())
+    {
+        m_allReleased.wait(&m_mutex);
+    }
+
+    qDeleteAll(m_documents);
+}
+
+Poppler::Document* PdfDocumentPool::tryAcquire()
+{
+    QMutexLocker mutexLocker(&m_mutex);
+
+    if(m_detached || m_freeDocuments.isEmpty())
+    {
+        return 0;
+    }
+
+    return m_freeDocuments.takeLast();
+}
+
+void PdfDocumentPool::release(Poppler::Document* document)
+{
+    QMutexLocker mutexLocker(&m_mutex);
+
+    m_freeDocuments.append(document);
+
+    if(m_freeDocuments.count() == m_documents.count())
+    {
+        m_allReleased.wakeAll();
+    }
+}
+
+int PdfDocumentPool::count() const
+{
+    QMutexLocker mutexLocker(&m_mutex);
+
+    return m_documents.count();
+}
+
+void PdfDocumentPool::detach()
+{
+    QMutexLocker mutexLocker(&m_mutex);
+
+    m_detached = true;
+}
+
+void PdfDocumentPool::setPaperColor(const QColor& paperColor)
+{
+    QMutexLocker mutexLocker(&m_mutex);
+
+    while(m_freeDocuments.count() != m_documents.count())
+    {
+        m_allReleased.wait(&m_mutex);
+    }
+
+    foreach(Poppler::Document* document, m_documents)
+    {
+        document->setPaperColor(paperColor);
+    }
+}
+
+PdfAnnotation::PdfAnnotation(QMutex* mutex, PdfDocumentPool* pool, Poppler::Annotation* annotation) : Annotation(),
     m_mutex(mutex),
+    m_pool(pool),
     m_annotation(annotation)
 {
 }
@@ -169,6 +493,11 @@ QString PdfAnnotation::contents() const
 
 QWidget* PdfAnnotation::createWidget()
 {
+    if(m_pool != 0)
+    {
+        m_pool->detach();
+    }
+
     QWidget* widget = 0;
 
     if(m_annotation->subType() == Poppler::Annotation::AText || m_annotation->subType() == Poppler::Annotation::AHighlight)
@@ -187,8 +516,9 @@ QWidget* PdfAnnotation::createWidget()
     return widget;
 }
 
-PdfFormField::PdfFormField(QMutex* mutex, Poppler::FormField* formField) : FormField(),
+PdfFormField::PdfFormField(QMutex* mutex, PdfDocumentPool* pool, Poppler::FormField* formField) : FormField(),
     m_mutex(mutex),
+    m_pool(pool),
     m_formField(formField)
 {
 }
@@ -214,6 +544,11 @@ QString PdfFormField::name() const
 
 QWidget* PdfFormField::createWidget()
 {
+    if(m_pool != 0)
+    {
+        m_pool->detach();
+    }
+
     QWidget* widget = 0;
 
     if(m_formField->type() == Poppler::FormField::FormText)
@@ -261,8 +596,10 @@ QWidget* PdfFormField::createWidget()
     return widget;
 }
 
-PdfPage::PdfPage(QMutex* mutex, Poppler::Page* page) :
+PdfPage::PdfPage(QMutex* mutex, PdfDocumentPool* pool, int index, Poppler::Page* page) :
     m_mutex(mutex),
+    m_pool(pool),
+    m_index(index),
     m_page(page)
 {
 }
@@ -279,43 +616,53 @@ QSizeF PdfPage::size() const
     return m_page->pageSizeF();
 }
 
-QImage PdfPage::render(qreal horizontalResolution, qreal verticalResolution, Rotation rotation, const QRect& boundingRect) const
+QImage PdfPage::render(qreal horizontalResolution, qreal verticalResolution, Rotation rotation, const QRect& boundingRect, const CancellationToken* cancellation, ImageAllocator* allocator) const
 {
-    LOCK_PAGE
+    // Poppler allocates the images it renders into itself.
 
-    Poppler::Page::Rotation rotate;
+    Q_UNUSED(allocator);
 
-    switch(rotation)
+    if(m_pool != 0)
     {
-    default:
-    case RotateBy0:
-        rotate = Poppler::Page::Rotate0;
-        break;
-    case RotateBy90:
-        rotate = Poppler::Page::Rotate90;
-        break;
-    case RotateBy180:
-        rotate = Poppler::Page::Rotate180;
-        break;
-    case RotateBy270:
-        rotate = Poppler::Page::Rotate270;
-        break;
-    }
+        Poppler::Document* document = m_pool->tryAcquire();
 
-    int x = -1;
-    int y = -1;
-    int w = -1;
-    int h = -1;
+        if(document != 0)
+        {
+            QImage image;
 
-    if(!boundingRect.isNull())
+            {
+                QScopedPointer< Poppler::Page > page(document->page(m_index));
+
+                if(page != 0)
+                {
+                    image = renderPage(page.data(), horizontalResolution, verticalResolution, rotation, boundingRect, cancellation);
+                }
+            }
+
+            m_pool->release(document);
+
+            if(!image.isNull())
+            {
+                return image;
+            }
+        }
+    }
+
+    if(cancellation != 0 && cancellation->wasCanceled())
     {
-        x = boundingRect.x();
-        y = boundingRect.y();
-        w = boundingRect.width();
-        h = boundingRect.height();
+        return QImage();
     }
 
-    return m_page->renderToImage(horizontalResolution, verticalResolution, x, y, w, h, rotate);
+    LOCK_PAGE
+
+    return renderPage(m_page, horizontalResolution, verticalResolution, rotation, boundingRect, cancellation);
+}
+
+QImage PdfPage::thumbnail() const
+{
+    LOCK_PAGE
+
+    return m_page->thumbnail();
 }
 
 QString PdfPage::label() const
@@ -389,41 +736,55 @@ QString PdfPage::text(const QRectF& rect) const
 
 QList< QRectF > PdfPage::search(const QString& text, bool matchCase) const
 {
-    LOCK_PAGE
+    if(m_pool != 0)
+    {
+        Poppler::Document* document = m_pool->tryAcquire();
 
-    QList< QRectF > results;
+        if(document != 0)
+        {
+            QList< QRectF > results;
+            bool ok = false;
 
-#if defined(HAS_POPPLER_22)
+            {
+                QScopedPointer< Poppler::Page > page(document->page(m_index));
 
-    results = m_page->search(text, matchCase ? Poppler::Page::CaseSensitive : Poppler::Page::CaseInsensitive);
+                if(page != 0)
+                {
+                    results = searchPage(page.data(), text, matchCase);
+                    ok = true;
+                }
+            }
 
-#elif defined(HAS_POPPLER_14)
+            m_pool->release(document);
 
-    double left = 0.0, top = 0.0, right = 0.0, bottom = 0.0;
+            if(ok)
+            {
+                return results;
+            }
+        }
+    }
 
-    while(m_page->search(text, left, top, right, bottom, Poppler::Page::NextResult, matchCase ? Poppler::Page::CaseSensitive : Poppler::Page::CaseInsensitive))
-    {
-        QRectF rect;
-        rect.setLeft(left);
-        rect.setTop(top);
-        rect.setRight(right);
-        rect.setBottom(bottom);
+    LOCK_PAGE
 
-        results.append(rect);
-    }
+    return searchPage(m_page, text, matchCase);
+}
 
-#else
+QList< TextBox > PdfPage::textBoxes() const
+{
+    LOCK_PAGE
 
-    QRectF rect;
+    QList< TextBox > textBoxes;
+
+    const QList< Poppler::TextBox* > popplerTextBoxes = m_page->textList();
 
-    while(m_page->search(text, rect, Poppler::Page::NextResult, matchCase ? Poppler::Page::CaseSensitive : Poppler::Page::CaseInsensitive))
+    foreach(const Poppler::TextBox* textBox, popplerTextBoxes)
     {
-        results.append(rect);
+        textBoxes.append(TextBox(textBox->text(), textBox->boundingBox()));
     }
 
-#endif // HAS_POPPLER_22 HAS_POPPLER_14
+    qDeleteAll(popplerTextBoxes);
 
-    return results;
+    return textBoxes;
 }
 
 QList< Annotation* > PdfPage::annotations() const
@@ -436,7 +797,7 @@ QList< Annotation* > PdfPage::annotations() const
     {
         if(annotation->subType() == Poppler::Annotation::AText || annotation->subType() == Poppler::Annotation::AHighlight || annotation->subType() == Poppler::Annotation::AFileAttachment)
         {
-            annotations.append(new PdfAnnotation(m_mutex, annotation));
+            annotations.append(new PdfAnnotation(m_mutex, m_pool, annotation));
             continue;
         }
 
@@ -467,6 +828,11 @@ Annotation* PdfPage::addTextAnnotation(const QRectF& boundary, const QColor& col
 
 #ifdef HAS_POPPLER_20
 
+    if(m_pool != 0)
+    {
+        m_pool->detach();
+    }
+
     Poppler::Annotation::Style style;
     style.setColor(color);
 
@@ -481,7 +847,7 @@ Annotation* PdfPage::addTextAnnotation(const QRectF& boundary, const QColor& col
 
     m_page->addAnnotation(annotation);
 
-    return new PdfAnnotation(m_mutex, annotation);
+    return new PdfAnnotation(m_mutex, m_pool, annotation);
 
 #else
 
@@ -499,6 +865,11 @@ Annotation* PdfPage::addHighlightAnnotation(const QRectF& boundary, const QColor
 
 #ifdef HAS_POPPLER_20
 
+    if(m_pool != 0)
+    {
+        m_pool->detach();
+    }
+
     Poppler::Annotation::Style style;
     style.setColor(color);
 
@@ -521,7 +892,7 @@ Annotation* PdfPage::addHighlightAnnotation(const QRectF& boundary, const QColor
 
     m_page->addAnnotation(annotation);
 
-    return new PdfAnnotation(m_mutex, annotation);
+    return new PdfAnnotation(m_mutex, m_pool, annotation);
 
 #else
 
@@ -540,6 +911,11 @@ void PdfPage::removeAnnotation(Annotation* annotation)
 
 #ifdef HAS_POPPLER_20
 
+    if(m_pool != 0)
+    {
+        m_pool->detach();
+    }
+
     PdfAnnotation* pdfAnnotation = static_cast< PdfAnnotation* >(annotation);
 
     m_page->removeAnnotation(pdfAnnotation->m_annotation);
@@ -572,7 +948,7 @@ QList< FormField* > PdfPage::formFields() const
 
             if(formFieldText->textType() == Poppler::FormFieldText::Normal || formFieldText->textType() == Poppler::FormFieldText::Multiline)
             {
-                formFields.append(new PdfFormField(m_mutex, formField));
+                formFields.append(new PdfFormField(m_mutex, m_pool, formField));
                 continue;
             }
         }
@@ -582,7 +958,7 @@ QList< FormField* > PdfPage::formFields() const
 
             if(formFieldChoice->choiceType() == Poppler::FormFieldChoice::ListBox || formFieldChoice->choiceType() == Poppler::FormFieldChoice::ComboBox)
             {
-                formFields.append(new PdfFormField(m_mutex, formField));
+                formFields.append(new PdfFormField(m_mutex, m_pool, formField));
                 continue;
             }
         }
@@ -592,7 +968,7 @@ QList< FormField* > PdfPage::formFields() const
 
             if(formFieldButton->buttonType() == Poppler::FormFieldButton::CheckBox || formFieldButton->buttonType() == Poppler::FormFieldButton::Radio)
             {
-                formFields.append(new PdfFormField(m_mutex, formField));
+                formFields.append(new PdfFormField(m_mutex, m_pool, formField));
                 continue;
             }
         }
@@ -603,9 +979,11 @@ QList< FormField* > PdfPage::formFields() const
     return formFields;
 }
 
-PdfDocument::PdfDocument(Poppler::Document* document) :
+PdfDocument::PdfDocument(Poppler::Document* document, qint64 dataSize, PdfDocumentPool* pool) :
     m_mutex(),
-    m_document(document)
+    m_document(document),
+    m_dataSize(dataSize),
+    m_pool(pool)
 {
 }
 
@@ -627,7 +1005,7 @@ Page* PdfDocument::page(int index) const
 
     Poppler::Page* page = m_document->page(index);
 
-    return page != 0 ? new PdfPage(&m_mutex, page) : 0;
+    return page != 0 ? new PdfPage(&m_mutex, m_pool.data(), index, page) : 0;
 }
 
 bool PdfDocument::isLocked() const
@@ -644,6 +1022,15 @@ bool PdfDocument::unlock(const QString& password)
     return m_document->unlock(password.toLatin1(), password.toLatin1());
 }
 
+qint64 PdfDocument::memoryEstimate() const
+{
+    // Poppler does not report its memory, but the parsed objects of each instance grow with the size of the file.
+
+    const int instances = 1 + (m_pool.isNull() ? 0 : m_pool->count());
+
+    return instances * m_dataSize;
+}
+
 QStringList PdfDocument::saveFilter() const
 {
     return QStringList() << "Portable document format (*.pdf)";
@@ -670,6 +1057,62 @@ bool PdfDocument::save(const QString& filePath, bool withChanges) const
     return pdfConverter->convert();
 }
 
+bool PdfDocument::saveChanges(const QString& filePath) const
+{
+    QFile file(filePath);
+
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    // Poppler writes an incremental update as a copy of the original data followed by the changed objects,
+    // so only the latter have to be appended if the file still contains the original data.
+    // Poppler still streams the whole document while it is locked, so that takes time proportional to the size of the file.
+
+    IncrementalUpdateDevice device(&file);
+    device.open(QIODevice::WriteOnly);
+
+    {
+        LOCK_DOCUMENT
+
+        QScopedPointer< Poppler::PDFConverter > pdfConverter(m_document->pdfConverter());
+
+        pdfConverter->setOutputDevice(&device);
+        pdfConverter->setPDFOptions(pdfConverter->pdfOptions() | Poppler::PDFConverter::WithChanges);
+
+        if(!pdfConverter->convert() || !device.isIncremental())
+        {
+            return false;
+        }
+    }
+
+    file.close();
+
+    if(device.update().isEmpty())
+    {
+        return true;
+    }
+
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Append))
+    {
+        return false;
+    }
+
+    // A partially appended update would leave the file without a valid trailer, so it is cut back to its original size.
+
+    const qint64 originalSize = file.size();
+
+    if(file.write(device.update()) != device.update().size() || !file.flush())
+    {
+        file.resize(originalSize);
+
+        return false;
+    }
+
+    return true;
+}
+
 bool PdfDocument::canBePrintedUsingCUPS() const
 {
     return true;
@@ -677,6 +1120,11 @@ bool PdfDocument::canBePrintedUsingCUPS() const
 
 void PdfDocument::setPaperColor(const QColor& paperColor)
 {
+    if(m_pool != 0)
+    {
+        m_pool->setPaperColor(paperColor);
+    }
+
     LOCK_DOCUMENT
 
     m_document->setPaperColor(paperColor);
@@ -725,12 +1173,26 @@ void PdfDocument::loadProperties(QStandardItemModel* propertiesModel) const
 }
 
 void PdfDocument::loadFonts(QStandardItemModel* fontsModel) const
+{
+    loadFonts(fontsModel, 0, numberOfPages());
+}
+
+void PdfDocument::loadFonts(QStandardItemModel* fontsModel, int beginIndex, int endIndex) const
 {
     Document::loadFonts(fontsModel);
 
     LOCK_DOCUMENT
 
-    const QList< Poppler::FontInfo > fonts = m_document->fonts();
+    QList< Poppler::FontInfo > fonts;
+
+    // The iterator has to be advanced page by page as scanning all of them at once is what takes so long.
+
+    QScopedPointer< Poppler::FontIterator > fontIterator(m_document->newFontIterator(beginIndex));
+
+    while(fontIterator->hasNext() && fontIterator->currentPage() + 1 < endIndex)
+    {
+        fonts.append(fontIterator->next());
+    }
 
     fontsModel->setRowCount(fonts.count());
     fontsModel->setColumnCount(5);
@@ -874,6 +1336,15 @@ PdfSettingsWidget::PdfSettingsWidget(QSettings* settings, QWidget* parent) : Set
     m_backendComboBox->setCurrentIndex(m_settings->value("backend", 0).toInt());
 
     m_layout->addRow(tr("Backend:"), m_backendComboBox);
+
+    // document instances
+
+    m_documentInstancesSpinBox = new QSpinBox(this);
+    m_documentInstancesSpinBox->setRange(1, 16);
+    m_documentInstancesSpinBox->setValue(m_settings->value("documentInstances", 1).toInt());
+    m_documentInstancesSpinBox->setToolTip(tr("Opening additional instances of a document allows rendering and searching in parallel at the cost of memory."));
+
+    m_layout->addRow(tr("Document instances:"), m_documentInstancesSpinBox);
 }
 
 void PdfSettingsWidget::accept()
@@ -905,6 +1376,8 @@ void PdfSettingsWidget::accept()
 #endif // HAS_POPPLER_24
 
     m_settings->setValue("backend", m_backendComboBox->currentIndex());
+
+    m_settings->setValue("documentInstances", m_documentInstancesSpinBox->value());
 }
 
 void PdfSettingsWidget::reset()
@@ -935,6 +1408,8 @@ void PdfSettingsWidget::reset()
 #endif // HAS_POPPLER_24
 
     m_backendComboBox->setCurrentIndex(0);
+
+    m_documentInstancesSpinBox->setValue(1);
 }
 
 PdfPlugin::PdfPlugin(QObject* parent) : QObject(parent)
@@ -946,77 +1421,58 @@ PdfPlugin::PdfPlugin(QObject* parent) : QObject(parent)
 
 Model::Document* PdfPlugin::loadDocument(const QString& filePath) const
 {
-    Poppler::Document* document = Poppler::Document::load(filePath);
-
-    if(document != 0)
-    {
-        document->setRenderHint(Poppler::Document::Antialiasing, m_settings->value("antialiasing", true).toBool());
-        document->setRenderHint(Poppler::Document::TextAntialiasing, m_settings->value("textAntialiasing", true).toBool());
+    return loadDocument(filePath, QByteArray());
+}
 
-#if defined(HAS_POPPLER_18)
+Model::Document* PdfPlugin::loadDocumentFromData(const QByteArray& data) const
+{
+    return loadDocument(QString(), data);
+}
 
-        switch(m_settings->value("textHinting", 0).toInt())
-        {
-        default:
-        case 0:
-            document->setRenderHint(Poppler::Document::TextHinting, false);
-            break;
-        case 1:
-            document->setRenderHint(Poppler::Document::TextHinting, true);
-            document->setRenderHint(Poppler::Document::TextSlightHinting, false);
-            break;
-        case 2:
-            document->setRenderHint(Poppler::Document::TextHinting, true);
-            document->setRenderHint(Poppler::Document::TextSlightHinting, true);
-            break;
-        }
+Model::Document* PdfPlugin::loadDocument(const QString& filePath, const QByteArray& data) const
+{
+    // Documents loaded from memory keep sharing the data with all their instances.
 
-#elif defined(HAS_POPPLER_14)
+    Poppler::Document* document = data.isNull() ? Poppler::Document::load(filePath) : Poppler::Document::loadFromData(data);
 
-        document->setRenderHint(Poppler::Document::TextHinting, m_settings->value("textHinting", false).toBool());
+    if(document == 0)
+    {
+        return 0;
+    }
 
-#endif // HAS_POPPLER_18 HAS_POPPLER_14
+    configureDocument(document, m_settings);
 
-#ifdef HAS_POPPLER_22
+    // Additional instances are only opened for documents which do not require a password.
 
-        document->setRenderHint(Poppler::Document::OverprintPreview, m_settings->value("overprintPreview", false).toBool());
+    Model::PdfDocumentPool* pool = 0;
 
-#endif // HAS_POPPLER_22
+    const int documentInstances = m_settings->value("documentInstances", 1).toInt();
 
-#ifdef HAS_POPPLER_24
+    if(documentInstances > 1 && !document->isLocked())
+    {
+        QList< Poppler::Document* > documents;
 
-        switch(m_settings->value("thinLineMode", 0).toInt())
+        for(int instance = 1; instance < documentInstances; ++instance)
         {
-        default:
-        case 0:
-            document->setRenderHint(Poppler::Document::ThinLineSolid, false);
-            document->setRenderHint(Poppler::Document::ThinLineShape, false);
-            break;
-        case 1:
-            document->setRenderHint(Poppler::Document::ThinLineSolid, true);
-            document->setRenderHint(Poppler::Document::ThinLineShape, false);
-            break;
-        case 2:
-            document->setRenderHint(Poppler::Document::ThinLineSolid, false);
-            document->setRenderHint(Poppler::Document::ThinLineShape, true);
-            break;
-        }
+            Poppler::Document* additionalDocument = data.isNull() ? Poppler::Document::load(filePath) : Poppler::Document::loadFromData(data);
 
-#endif // HAS_POPPLER_24
+            if(additionalDocument == 0)
+            {
+                break;
+            }
+
+            configureDocument(additionalDocument, m_settings);
+
+            documents.append(additionalDocument);
+        }
 
-        switch(m_settings->value("backend").toInt())
+        if(!documents.isEmpty())
         {
-        default:
-        case 0:
-            document->setRenderBackend(Poppler::Document::SplashBackend);
-            break;
-        case 1:
-            document->setRenderBackend(Poppler::Document::ArthurBackend);
-            break;
+            pool = new Model::PdfDocumentPool(documents);
         }
     }
 
-    return document != 0 ? new Model::PdfDocument(document) : 0;
+    return new Model::PdfDocument(document, data.isNull() ? QFileInfo(filePath).size() : data.size(), pool);
 }
 
 SettingsWidget* PdfPlugin::createSettingsWidget(QWidget* parent) const
@@ -24,13 +24,16 @@ along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
 #define PDFMODEL_H
 
 #include <QCoreApplication>
+#include <QList>
 #include <QMutex>
 #include <QScopedPointer>
+#include <QWaitCondition>
 
 class QCheckBox;
 class QComboBox;
 class QFormLayout;
 class QSettings;
+class QSpinBox;
 
 namespace Poppler
 {
@@ -49,6 +52,37 @@ class PdfPlugin;
 
 namespace Model
 {
+    // Additional instances of the same document which render and search in parallel to the primary one.
+    // Once the primary instance is modified, the pool is detached so that the output reflects the modifications.
+
+    class PdfDocumentPool
+    {
+    public:
+        PdfDocumentPool(const QList< Poppler::Document* >& documents);
+        ~PdfDocumentPool();
+
+        Poppler::Document* tryAcquire();
+        void release(Poppler::Document* document);
+
+        void detach();
+
+        void setPaperColor(const QColor& paperColor);
+
+        int count() const;
+
+    private:
+        Q_DISABLE_COPY(PdfDocumentPool)
+
+        mutable QMutex m_mutex;
+        QWaitCondition m_allReleased;
+
+        QList< Poppler::Document* > m_documents;
+        QList< Poppler::Document* > m_freeDocuments;
+
+        bool m_detached;
+
+    };
+
     class PdfAnnotation : public Annotation
     {
         Q_OBJECT
@@ -66,9 +100,10 @@ namespace Model
     private:
         Q_DISABLE_COPY(PdfAnnotation)
 
-        PdfAnnotation(QMutex* mutex, Poppler::Annotation* annotation);
+        PdfAnnotation(QMutex* mutex, PdfDocumentPool* pool, Poppler::Annotation* annotation);
 
         mutable QMutex* m_mutex;
+        PdfDocumentPool* m_pool;
         Poppler::Annotation* m_annotation;
 
     };
@@ -90,9 +125,10 @@ namespace Model
     private:
         Q_DISABLE_COPY(PdfFormField)
 
-        PdfFormField(QMutex* mutex, Poppler::FormField* formField);
+        PdfFormField(QMutex* mutex, PdfDocumentPool* pool, Poppler::FormField* formField);
 
         mutable QMutex* m_mutex;
+        PdfDocumentPool* m_pool;
         Poppler::FormField* m_formField;
 
     };
@@ -108,7 +144,8 @@ namespace Model
 
         QSizeF size() const;
 
-        QImage render(qreal horizontalResolution, qreal verticalResolution, Rotation rotation, const QRect& boundingRect) const;
+        QImage render(qreal horizontalResolution, qreal verticalResolution, Rotation rotation, const QRect& boundingRect, const CancellationToken* cancellation, ImageAllocator* allocator) const;
+        QImage thumbnail() const;
 
         QString label() const;
 
@@ -117,6 +154,8 @@ namespace Model
         QString text(const QRectF& rect) const;
         QList< QRectF > search(const QString& text, bool matchCase) const;
 
+        QList< TextBox > textBoxes() const;
+
         QList< Annotation* > annotations() const;
 
         bool canAddAndRemoveAnnotations() const;
@@ -129,9 +168,11 @@ namespace Model
     private:
         Q_DISABLE_COPY(PdfPage)
 
-        PdfPage(QMutex* mutex, Poppler::Page* page);
+        PdfPage(QMutex* mutex, PdfDocumentPool* pool, int index, Poppler::Page* page);
 
         mutable QMutex* m_mutex;
+        PdfDocumentPool* m_pool;
+        int m_index;
         Poppler::Page* m_page;
 
     };
@@ -152,10 +193,13 @@ namespace Model
         bool isLocked() const;
         bool unlock(const QString& password);
 
+        qint64 memoryEstimate() const;
+
         QStringList saveFilter() const;
 
         bool canSave() const;
         bool save(const QString& filePath, bool withChanges) const;
+        bool saveChanges(const QString& filePath) const;
 
         bool canBePrintedUsingCUPS() const;
 
@@ -165,6 +209,7 @@ namespace Model
         void loadProperties(QStandardItemModel* propertiesModel) const;
 
         void loadFonts(QStandardItemModel* fontsModel) const;
+        void loadFonts(QStandardItemModel* fontsModel, int beginIndex, int endIndex) const;
 
         bool wantsContinuousMode() const;
         bool wantsSinglePageMode() const;
@@ -175,11 +220,15 @@ namespace Model
     private:
         Q_DISABLE_COPY(PdfDocument)
 
-        PdfDocument(Poppler::Document* document);
+        PdfDocument(Poppler::Document* document, qint64 dataSize, PdfDocumentPool* pool = 0);
 
         mutable QMutex m_mutex;
         Poppler::Document* m_document;
 
+        qint64 m_dataSize;
+
+        QScopedPointer< PdfDocumentPool > m_pool;
+
     };
 }
 
@@ -227,6 +276,8 @@ private:
 
     QComboBox* m_backendComboBox;
 
+    QSpinBox* m_documentInstancesSpinBox;
+
 };
 
 class PdfPlugin : public QObject, Plugin
@@ -236,7 +287,7 @@ class PdfPlugin : public QObject, Plugin
 
 #if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
 
-    Q_PLUGIN_METADATA(IID "local.qpdfview.Plugin")
+    Q_PLUGIN_METADATA(IID "local.qpdfview.Plugin/2")
 
 #endif // QT_VERSION
 
@@ -244,6 +295,7 @@ public:
     PdfPlugin(QObject* parent = 0);
 
     Model::Document* loadDocument(const QString& filePath) const;
+    Model::Document* loadDocumentFromData(const QByteArray& data) const;
 
     SettingsWidget* createSettingsWidget(QWidget* parent) const;
 
@@ -252,6 +304,8 @@ private:
 
     QSettings* m_settings;
 
+    Model::Document* loadDocument(const QString& filePath, const QByteArray& data) const;
+
 };
 
 } // qpdfview
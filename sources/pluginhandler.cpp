@@ -24,9 +24,12 @@ along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
 #include <QApplication>
 #include <QDebug>
 #include <QDir>
+#include <QFile>
 #include <QFileInfo>
 #include <QMessageBox>
 #include <QPluginLoader>
+#include <QThread>
+#include <QtConcurrentRun>
 
 #if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
 
@@ -34,6 +37,12 @@ along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
 
 #endif // QT_VERSION
 
+#if QT_VERSION >= QT_VERSION_CHECK(5,4,0)
+
+#include <QStorageInfo>
+
+#endif // QT_VERSION
+
 #ifdef WITH_MAGIC
 
 #include <magic.h>
@@ -47,6 +56,19 @@ namespace
 
 using namespace qpdfview;
 
+// At most this many files are inspected to determine the plug-ins to preload.
+const int maximumPreloadCount = 10;
+
+void adoptPlugin(QObject* object)
+{
+    // Plug-ins instantiated on a worker thread are handed over to the main thread.
+
+    if(object->thread() == QThread::currentThread() && object->thread() != qApp->thread())
+    {
+        object->moveToThread(qApp->thread());
+    }
+}
+
 Plugin* loadStaticPlugin(const QString& objectName)
 {
     foreach(QObject* object, QPluginLoader::staticInstances())
@@ -57,6 +79,8 @@ Plugin* loadStaticPlugin(const QString& objectName)
 
             if(plugin != 0)
             {
+                adoptPlugin(object);
+
                 return plugin;
             }
         }
@@ -90,17 +114,41 @@ Plugin* loadPlugin(const QString& fileName)
         }
     }
 
-    Plugin* plugin = qobject_cast< Plugin* >(pluginLoader.instance());
+    QObject* object = pluginLoader.instance();
+    Plugin* plugin = qobject_cast< Plugin* >(object);
 
     if(plugin == 0)
     {
         qCritical() << "Could not instantiate plug-in:" << pluginLoader.fileName();
         qCritical() << pluginLoader.errorString();
+
+        return 0;
     }
 
+    adoptPlugin(object);
+
     return plugin;
 }
 
+bool isOnNetworkFileSystem(const QString& filePath)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5,4,0)
+
+    const QByteArray fileSystemType = QStorageInfo(filePath).fileSystemType();
+
+    return fileSystemType.startsWith("nfs")
+            || fileSystemType == "cifs" || fileSystemType == "smbfs" || fileSystemType == "smb3"
+            || fileSystemType == "fuse.sshfs" || fileSystemType == "9p" || fileSystemType == "afs";
+
+#else
+
+    Q_UNUSED(filePath);
+
+    return false;
+
+#endif // QT_VERSION
+}
+
 PluginHandler::FileType matchFileType(const QString& filePath)
 {
     PluginHandler::FileType fileType = PluginHandler::Unknown;
@@ -203,10 +251,51 @@ PluginHandler* PluginHandler::instance()
 
 PluginHandler::~PluginHandler()
 {
+    m_preloadFuture.waitForFinished();
+
     s_instance = 0;
 }
 
 Model::Document* PluginHandler::loadDocument(const QString& filePath)
+{
+    Plugin* plugin = pluginForFile(filePath);
+
+    return plugin != 0 ? loadDocument(plugin, filePath) : 0;
+}
+
+Model::Document* PluginHandler::loadDocument(const Plugin* plugin, const QString& filePath)
+{
+    if(isOnNetworkFileSystem(filePath))
+    {
+        // Parsing seeks all over the file, which is slow if every read is a round trip, whereas reading it sequentially profits from read-ahead.
+
+        QFile file(filePath);
+
+        if(file.open(QIODevice::ReadOnly))
+        {
+            const QByteArray data = file.readAll();
+
+            if(!data.isEmpty())
+            {
+                Model::Document* document = plugin->loadDocumentFromData(data);
+
+                if(document != 0)
+                {
+                    return document;
+                }
+            }
+        }
+    }
+
+    return plugin->loadDocument(filePath);
+}
+
+PluginHandler::FileType PluginHandler::fileType(const QString& filePath)
+{
+    return matchFileType(filePath);
+}
+
+Plugin* PluginHandler::pluginForFile(const QString& filePath)
 {
     FileType fileType = matchFileType(filePath);
 
@@ -217,9 +306,11 @@ Model::Document* PluginHandler::loadDocument(const QString& filePath)
         return 0;
     }
 
-    if(loadPlugin(fileType))
+    Plugin* plugin = loadPlugin(fileType);
+
+    if(plugin != 0)
     {
-        return m_plugins.value(fileType)->loadDocument(filePath);
+        return plugin;
     }
 
     QMessageBox::critical(0, tr("Critical"), tr("Could not load plug-in for file type '%1'!").arg(fileTypeName(fileType)));
@@ -229,11 +320,27 @@ Model::Document* PluginHandler::loadDocument(const QString& filePath)
 
 SettingsWidget* PluginHandler::createSettingsWidget(FileType fileType, QWidget* parent)
 {
-    return loadPlugin(fileType) ? m_plugins.value(fileType)->createSettingsWidget(parent) : 0;
+    Plugin* plugin = loadPlugin(fileType);
+
+    return plugin != 0 ? plugin->createSettingsWidget(parent) : 0;
+}
+
+void PluginHandler::preloadPlugins(const QStringList& filePaths)
+{
+    if(filePaths.isEmpty() || m_preloadFuture.isRunning())
+    {
+        return;
+    }
+
+    m_preloadFuture = QtConcurrent::run(this, &PluginHandler::preload, filePaths.mid(0, maximumPreloadCount));
 }
 
 PluginHandler::PluginHandler(QObject* parent) : QObject(parent),
-    m_plugins()
+    m_mutex(),
+    m_plugins(),
+    m_objectNames(),
+    m_fileNames(),
+    m_preloadFuture()
 {
 #ifdef WITH_FITZ
 #ifdef STATIC_FITZ_PLUGIN
@@ -268,11 +375,13 @@ PluginHandler::PluginHandler(QObject* parent) : QObject(parent),
 #endif // WITH_DJVU
 }
 
-bool PluginHandler::loadPlugin(FileType fileType)
+Plugin* PluginHandler::loadPlugin(FileType fileType)
 {
+    QMutexLocker mutexLocker(&m_mutex);
+
     if(m_plugins.contains(fileType))
     {
-        return true;
+        return m_plugins.value(fileType);
     }
 
     foreach(const QString& objectName, m_objectNames.values(fileType))
@@ -283,7 +392,7 @@ bool PluginHandler::loadPlugin(FileType fileType)
         {
             m_plugins.insert(fileType, plugin);
 
-            return true;
+            return plugin;
         }
     }
 
@@ -295,11 +404,33 @@ bool PluginHandler::loadPlugin(FileType fileType)
         {
             m_plugins.insert(fileType, plugin);
 
-            return true;
+            return plugin;
         }
     }
 
-    return false;
+    return 0;
+}
+
+void PluginHandler::preload(const QStringList& filePaths)
+{
+    QList< FileType > fileTypes;
+
+    foreach(const QString& filePath, filePaths)
+    {
+        if(!QFileInfo(filePath).exists())
+        {
+            continue;
+        }
+
+        const FileType fileType = matchFileType(filePath);
+
+        if(fileType != Unknown && !fileTypes.contains(fileType))
+        {
+            fileTypes.append(fileType);
+
+            loadPlugin(fileType);
+        }
+    }
 }
 
 } // qpdfview
@@ -22,8 +22,11 @@ along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef PLUGINHANDLER_H
 #define PLUGINHANDLER_H
 
-#include <QObject>
+#include <QFuture>
 #include <QMap>
+#include <QMutex>
+#include <QObject>
+#include <QStringList>
 
 class QString;
 class QWidget;
@@ -71,22 +74,41 @@ public:
         }
     }
 
+    static FileType fileType(const QString& filePath);
+
     Model::Document* loadDocument(const QString& filePath);
 
+    // Files on network file systems are read into memory in one go before they are parsed, if the plug-in can load them from there.
+
+    static Model::Document* loadDocument(const Plugin* plugin, const QString& filePath);
+
+    // The returned plug-in may be used to load the document on a worker thread.
+
+    Plugin* pluginForFile(const QString& filePath);
+
     SettingsWidget* createSettingsWidget(FileType fileType, QWidget* parent = 0);
 
+    // The plug-ins for the given files are loaded on a worker thread so that opening them later does not stall.
+
+    void preloadPlugins(const QStringList& filePaths);
+
 private:
     Q_DISABLE_COPY(PluginHandler)
 
     static PluginHandler* s_instance;
     PluginHandler(QObject* parent = 0);
 
+    QMutex m_mutex;
     QMap< FileType, Plugin* > m_plugins;
 
     QMultiMap< FileType, QString > m_objectNames;
     QMultiMap< FileType, QString > m_fileNames;
 
-    bool loadPlugin(FileType fileType);
+    Plugin* loadPlugin(FileType fileType);
+
+    QFuture< void > m_preloadFuture;
+
+    void preload(const QStringList& filePaths);
 
 };
 
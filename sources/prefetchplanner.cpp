@@ -0,0 +1,95 @@
+/*
+
+Copyright 2014 Adam Reichold
+
+This file is part of qpdfview.
+
+qpdfview is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+qpdfview is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "prefetchplanner.h"
+
+#include <QWidget>
+
+#include "pageitem.h"
+#include "renderscheduler.h"
+#include "tileitem.h"
+
+namespace
+{
+
+// Every render thread is given this many milliseconds of estimated work.
+const qreal durationPerThread = 1000.0;
+
+} // anonymous
+
+namespace qpdfview
+{
+
+PrefetchPlanner::PrefetchPlanner(const QWidget* viewport) :
+    m_maxBytes(0),
+    m_maxDuration(0.0),
+    m_bytes(0),
+    m_duration(0.0)
+{
+    qreal devicePixelRatio = 1.0;
+
+#if QT_VERSION >= QT_VERSION_CHECK(5,1,0)
+
+    devicePixelRatio = viewport->devicePixelRatio();
+
+#endif // QT_VERSION
+
+    const qint64 visibleBytes = static_cast< qint64 >(4.0 * devicePixelRatio * devicePixelRatio * viewport->width() * viewport->height());
+
+    m_maxBytes = qMax(static_cast< qint64 >(TileItem::cacheMaxCost()) - visibleBytes, Q_INT64_C(0));
+    m_maxDuration = durationPerThread * RenderScheduler::instance()->maxThreadCount();
+}
+
+bool PrefetchPlanner::prefetch(PageItem* page, bool nearVisible, const QRectF& rect)
+{
+    qint64 bytes = 0;
+    qreal duration = 0.0;
+
+    page->estimateRenderCost(rect, bytes, duration);
+
+    if(bytes == 0)
+    {
+        return true;
+    }
+
+    // Pages next to the visible ones are always prefetched, the others only if they fit.
+
+    if(!nearVisible && (m_bytes + bytes > m_maxBytes || m_duration + duration > m_maxDuration))
+    {
+        return false;
+    }
+
+    if(rect.isNull())
+    {
+        page->startRender(true, nearVisible);
+    }
+    else
+    {
+        page->startRender(rect, true, nearVisible);
+    }
+
+    m_bytes += bytes;
+    m_duration += duration;
+
+    return m_bytes < m_maxBytes && m_duration < m_maxDuration;
+}
+
+} // qpdfview
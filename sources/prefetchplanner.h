@@ -0,0 +1,61 @@
+/*
+
+Copyright 2014 Adam Reichold
+
+This file is part of qpdfview.
+
+qpdfview is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+qpdfview is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef PREFETCHPLANNER_H
+#define PREFETCHPLANNER_H
+
+#include <QRectF>
+
+class QWidget;
+
+namespace qpdfview
+{
+
+class PageItem;
+
+// Starts prefetching pages until their estimated pixel bytes or render time exceed a budget
+// derived from the tile cache and the render threads so that tiles on screen are not evicted.
+
+class PrefetchPlanner
+{
+public:
+    explicit PrefetchPlanner(const QWidget* viewport);
+
+    inline qint64 maxBytes() const { return m_maxBytes; }
+    inline qreal maxDuration() const { return m_maxDuration; }
+
+    // Returns false once the budget is exhausted.
+    bool prefetch(PageItem* page, bool nearVisible, const QRectF& rect = QRectF());
+
+private:
+    Q_DISABLE_COPY(PrefetchPlanner)
+
+    qint64 m_maxBytes;
+    qreal m_maxDuration;
+
+    qint64 m_bytes;
+    qreal m_duration;
+
+};
+
+} // qpdfview
+
+#endif // PREFETCHPLANNER_H
@@ -25,9 +25,16 @@ along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
 #include <QShortcut>
 #include <QTimer>
 
+#ifdef WITH_OPENGL
+
+#include <QGLWidget>
+
+#endif // WITH_OPENGL
+
 #include "settings.h"
 #include "model.h"
 #include "pageitem.h"
+#include "rendertask.h"
 #include "documentview.h"
 
 namespace qpdfview
@@ -35,9 +42,9 @@ namespace qpdfview
 
 Settings* PresentationView::s_settings = 0;
 
-PresentationView::PresentationView(const QVector< Model::Page* >& pages, QWidget* parent) : QGraphicsView(parent),
-    m_prefetchTimer(0),
+PresentationView::PresentationView(const QVector< Model::Page* >& pages, const QByteArray& documentKey, QWidget* parent) : QGraphicsView(parent),
     m_pages(pages),
+    m_documentKey(documentKey),
     m_currentPage(1),
     m_past(),
     m_future(),
@@ -45,7 +52,8 @@ PresentationView::PresentationView(const QVector< Model::Page* >& pages, QWidget
     m_scaleFactor(1.0),
     m_rotation(RotateBy0),
     m_invertColors(false),
-    m_pageItems()
+    m_pageItems(),
+    m_frames()
 {
     if(s_settings == 0)
     {
@@ -63,35 +71,31 @@ PresentationView::PresentationView(const QVector< Model::Page* >& pages, QWidget
     setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
     setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
 
-    setScene(new QGraphicsScene(this));
+#ifdef WITH_OPENGL
 
-    preparePages();
-    prepareBackground();
+    if(s_settings->documentView().useOpenGL() && QGLFormat::hasOpenGL())
+    {
+        // Pixmaps are kept as textures by the paint engine, so slide changes are composited by the GPU.
 
-    // prefetch
+        QGLWidget* glWidget = new QGLWidget(QGLFormat(QGL::SampleBuffers));
 
-    m_prefetchTimer = new QTimer(this);
-    m_prefetchTimer->setInterval(250);
-    m_prefetchTimer->setSingleShot(true);
+        if(glWidget->isValid())
+        {
+            setViewport(glWidget);
+            setViewportUpdateMode(QGraphicsView::FullViewportUpdate);
+        }
+        else
+        {
+            delete glWidget;
+        }
+    }
 
-    connect(this, SIGNAL(currentPageChanged(int)), m_prefetchTimer, SLOT(start()));
-    connect(this, SIGNAL(scaleModeChanged(ScaleMode)), m_prefetchTimer, SLOT(start()));
-    connect(this, SIGNAL(scaleFactorChanged(qreal)), m_prefetchTimer, SLOT(start()));
-    connect(this, SIGNAL(rotationChanged(Rotation)), m_prefetchTimer, SLOT(start()));
-    connect(this, SIGNAL(invertColorsChanged(bool)), m_prefetchTimer, SLOT(start()));
+#endif // WITH_OPENGL
 
-    connect(m_prefetchTimer, SIGNAL(timeout()), SLOT(on_prefetch_timeout()));
+    setScene(new QGraphicsScene(this));
 
-    if(s_settings->documentView().prefetch())
-    {
-        m_prefetchTimer->blockSignals(false);
-        m_prefetchTimer->start();
-    }
-    else
-    {
-        m_prefetchTimer->blockSignals(true);
-        m_prefetchTimer->stop();
-    }
+    preparePages();
+    prepareBackground();
 
     prepareScene();
     prepareView();
@@ -99,6 +103,17 @@ PresentationView::PresentationView(const QVector< Model::Page* >& pages, QWidget
 
 PresentationView::~PresentationView()
 {
+    foreach(const Frame& frame, m_frames)
+    {
+        frame.task->cancel(true);
+        frame.task->wait();
+    }
+
+    foreach(const Frame& frame, m_frames)
+    {
+        delete frame.task;
+    }
+
     qDeleteAll(m_pageItems);
 }
 
@@ -188,6 +203,7 @@ void PresentationView::setInvertColors(bool invertColors)
         }
 
         prepareBackground();
+        prepareFrames();
 
         emit invertColorsChanged(m_invertColors);
     }
@@ -335,37 +351,56 @@ void PresentationView::rotateRight()
     }
 }
 
-void PresentationView::on_prefetch_timeout()
+void PresentationView::on_frames_finished()
 {
-    int fromPage = m_currentPage, toPage = m_currentPage;
+    const RenderTask* task = qobject_cast< RenderTask* >(sender());
 
-    fromPage -= s_settings->documentView().prefetchDistance() / 2;
-    toPage += s_settings->documentView().prefetchDistance();
+    // The task signals that it finished just before it is marked as not running, so the frames are prepared again once it is.
 
-    fromPage = qMax(fromPage, 1);
-    toPage = qMin(toPage, m_pages.count());
+    if(task != 0 && task->isRunning())
+    {
+        QTimer::singleShot(0, this, SLOT(on_frames_finished()));
 
-    const int maxCost = toPage - fromPage + 1;
-    int cost = 0;
+        return;
+    }
 
-    for(int index = m_currentPage - 1; index <= toPage - 1; ++index)
-    {
-        cost += m_pageItems.at(index)->startRender(true);
+    prepareFrames();
+}
 
-        if(cost >= maxCost)
+void PresentationView::on_frames_imageReady(const RenderParam& renderParam,
+                                            const QRect& rect, bool prefetch,
+                                            QImage image, QRectF cropRect)
+{
+    Q_UNUSED(rect);
+    Q_UNUSED(prefetch);
+    Q_UNUSED(cropRect);
+
+    for(QHash< int, Frame >::iterator frame = m_frames.begin(); frame != m_frames.end(); ++frame)
+    {
+        if(frame.value().task != sender())
         {
-            return;
+            continue;
         }
-    }
 
-    for(int index = m_currentPage - 1; index >= fromPage - 1; --index)
-    {
-        cost += m_pageItems.at(index)->startRender(true);
+        PageItem* page = m_pageItems.at(frame.key());
 
-        if(cost >= maxCost)
+        if(frame.value().renderParam == renderParam && page->renderParam() == renderParam)
         {
-            return;
+            if(image.isNull())
+            {
+                // The slide is left to its tiles instead of being rendered again whenever another frame finishes.
+
+                frame.value().failed = true;
+            }
+            else
+            {
+                frame.value().pixmap = QPixmap::fromImage(image);
+
+                page->setFrame(renderParam, frame.value().pixmap);
+            }
         }
+
+        break;
     }
 }
 
@@ -543,6 +578,7 @@ void PresentationView::preparePages()
     {
         PageItem* page = new PageItem(m_pages.at(index), index, PageItem::PresentationMode);
 
+        page->setDocumentKey(m_documentKey);
         page->setInvertColors(m_invertColors);
 
         scene()->addItem(page);
@@ -629,6 +665,85 @@ void PresentationView::prepareView()
     }
 
     viewport()->update();
+
+    prepareFrames();
+}
+
+void PresentationView::prepareFrames()
+{
+    const int distance = s_settings->documentView().prefetch() ? 1 : 0;
+
+    const int fromIndex = qMax(m_currentPage - 1 - distance, 0);
+    const int toIndex = qMin(m_currentPage - 1 + distance, m_pages.count() - 1);
+
+    for(QHash< int, Frame >::iterator frame = m_frames.begin(); frame != m_frames.end(); )
+    {
+        const int index = frame.key();
+        PageItem* page = m_pageItems.at(index);
+
+        const bool outside = index < fromIndex || index > toIndex;
+
+        if(outside || frame.value().renderParam != page->renderParam())
+        {
+            frame.value().task->cancel(true);
+
+            frame.value().renderParam = RenderParam();
+            frame.value().pixmap = QPixmap();
+            frame.value().failed = false;
+
+            page->setFrame(RenderParam(), QPixmap());
+        }
+
+        if(outside && !frame.value().task->isRunning())
+        {
+            frame.value().task->deleteLater();
+
+            frame = m_frames.erase(frame);
+        }
+        else
+        {
+            ++frame;
+        }
+    }
+
+    for(int index = fromIndex; index <= toIndex; ++index)
+    {
+        // The current slide is already on screen and rendered by its tiles unless a frame was prepared for it before.
+
+        if(index == m_currentPage - 1)
+        {
+            continue;
+        }
+
+        Frame& frame = m_frames[index];
+
+        if(!frame.pixmap.isNull() || frame.failed)
+        {
+            continue;
+        }
+
+        if(frame.task == 0)
+        {
+            frame.task = new RenderTask(m_pages.at(index), this);
+
+            // The task finishes synchronously when it is canceled while queued, so the frames are only prepared again once control returns to the event loop.
+
+            connect(frame.task, SIGNAL(finished()), SLOT(on_frames_finished()), Qt::QueuedConnection);
+            connect(frame.task, SIGNAL(imageReady(RenderParam,QRect,bool,QImage,QRectF)), SLOT(on_frames_imageReady(RenderParam,QRect,bool,QImage,QRectF)));
+        }
+
+        if(frame.task->isRunning())
+        {
+            continue;
+        }
+
+        frame.renderParam = m_pageItems.at(index)->renderParam();
+
+        frame.task->start(frame.renderParam,
+                          QRect(), false,
+                          false, s_settings->pageItem().paperColor(),
+                          RenderScheduler::NearVisiblePriority, this);
+    }
 }
 
 } // qpdfview
@@ -23,6 +23,9 @@ along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
 #define PRESENTATIONVIEW_H
 
 #include <QGraphicsView>
+#include <QHash>
+#include <QImage>
+#include <QPixmap>
 
 #include "global.h"
 
@@ -36,13 +39,14 @@ class Page;
 
 class Settings;
 class PageItem;
+class RenderTask;
 
 class PresentationView : public QGraphicsView
 {
     Q_OBJECT
 
 public:
-    PresentationView(const QVector< Model::Page* >& pages, QWidget* parent = 0);
+    PresentationView(const QVector< Model::Page* >& pages, const QByteArray& documentKey = QByteArray(), QWidget* parent = 0);
     ~PresentationView();
 
     int numberOfPages() const;
@@ -90,7 +94,10 @@ public slots:
     void rotateRight();
 
 protected slots:
-    void on_prefetch_timeout();
+    void on_frames_finished();
+    void on_frames_imageReady(const RenderParam& renderParam,
+                              const QRect& rect, bool prefetch,
+                              QImage image, QRectF cropRect);
 
     void on_pages_cropRectChanged();
 
@@ -107,9 +114,8 @@ private:
 
     static Settings* s_settings;
 
-    QTimer* m_prefetchTimer;
-
     QVector< Model::Page* > m_pages;
+    QByteArray m_documentKey;
 
     int m_currentPage;
 
@@ -124,6 +130,24 @@ private:
 
     QVector< PageItem* > m_pageItems;
 
+    // The slides next to the current one are rendered in full ahead of time and held as ready frames, so that changing slides only swaps pixmaps.
+    // The frames are owned by the view and are not part of the tile cache, so the document views cannot evict them.
+
+    struct Frame
+    {
+        RenderTask* task;
+        RenderParam renderParam;
+        QPixmap pixmap;
+        bool failed;
+
+        Frame() : task(0), renderParam(), pixmap(), failed(false) {}
+
+    };
+
+    QHash< int, Frame > m_frames;
+
+    void prepareFrames();
+
     void preparePages();
     void prepareBackground();
 
@@ -22,6 +22,8 @@ along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "psmodel.h"
 
+#include <cstring>
+
 #include <QFile>
 #include <QFormLayout>
 #include <qmath.h>
@@ -30,87 +32,57 @@ along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <libspectre/spectre-document.h>
 
-namespace qpdfview
-{
-
-namespace Model
-{
-
-PsPage::PsPage(QMutex* mutex, SpectrePage* page, SpectreRenderContext* renderContext) :
-    m_mutex(mutex),
-    m_page(page),
-    m_renderContext(renderContext)
-{
-}
-
-PsPage::~PsPage()
-{
-    spectre_page_free(m_page);
-    m_page = 0;
-}
-
-QSizeF PsPage::size() const
+namespace
 {
-    QMutexLocker mutexLocker(m_mutex);
-
-    int w;
-    int h;
-
-    spectre_page_get_size(m_page, &w, &h);
-
-    return QSizeF(w, h);
-}
 
-QImage PsPage::render(qreal horizontalResolution, qreal verticalResolution, Rotation rotation, const QRect& boundingRect) const
+QImage renderPage(SpectrePage* page, SpectreRenderContext* renderContext, qreal horizontalResolution, qreal verticalResolution, qpdfview::Rotation rotation, const QRect& boundingRect, qpdfview::Model::ImageAllocator* allocator)
 {
-    QMutexLocker mutexLocker(m_mutex);
-
     double xscale;
     double yscale;
 
     switch(rotation)
     {
     default:
-    case RotateBy0:
-    case RotateBy180:
+    case qpdfview::RotateBy0:
+    case qpdfview::RotateBy180:
         xscale = horizontalResolution / 72.0;
         yscale = verticalResolution / 72.0;
         break;
-    case RotateBy90:
-    case RotateBy270:
+    case qpdfview::RotateBy90:
+    case qpdfview::RotateBy270:
         xscale = verticalResolution / 72.0;
         yscale = horizontalResolution / 72.0;
         break;
     }
 
-    spectre_render_context_set_scale(m_renderContext, xscale, yscale);
+    spectre_render_context_set_scale(renderContext, xscale, yscale);
 
     switch(rotation)
     {
     default:
-    case RotateBy0:
-        spectre_render_context_set_rotation(m_renderContext, 0);
+    case qpdfview::RotateBy0:
+        spectre_render_context_set_rotation(renderContext, 0);
         break;
-    case RotateBy90:
-        spectre_render_context_set_rotation(m_renderContext, 90);
+    case qpdfview::RotateBy90:
+        spectre_render_context_set_rotation(renderContext, 90);
         break;
-    case RotateBy180:
-        spectre_render_context_set_rotation(m_renderContext, 180);
+    case qpdfview::RotateBy180:
+        spectre_render_context_set_rotation(renderContext, 180);
         break;
-    case RotateBy270:
-        spectre_render_context_set_rotation(m_renderContext, 270);
+    case qpdfview::RotateBy270:
+        spectre_render_context_set_rotation(renderContext, 270);
         break;
     }
 
     int w;
     int h;
 
-    spectre_page_get_size(m_page, &w, &h);
+    spectre_page_get_size(page, &w, &h);
 
     w = qRound(w * xscale);
     h = qRound(h * yscale);
 
-    if(rotation == RotateBy90 || rotation == RotateBy270)
+    if(rotation == qpdfview::RotateBy90 || rotation == qpdfview::RotateBy270)
     {
         qSwap(w, h);
     }
@@ -118,9 +90,9 @@ QImage PsPage::render(qreal horizontalResolution, qreal verticalResolution, Rota
     unsigned char* pageData = 0;
     int rowLength = 0;
 
-    spectre_page_render(m_page, m_renderContext, &pageData, &rowLength);
+    spectre_page_render(page, renderContext, &pageData, &rowLength);
 
-    if (spectre_page_status(m_page) != SPECTRE_STATUS_SUCCESS)
+    if (spectre_page_status(page) != SPECTRE_STATUS_SUCCESS)
     {
         free(pageData);
         pageData = 0;
@@ -129,7 +101,26 @@ QImage PsPage::render(qreal horizontalResolution, qreal verticalResolution, Rota
     }
 
     QImage auxiliaryImage(pageData, rowLength / 4, h, QImage::Format_RGB32);
-    QImage image(boundingRect.isNull() ? auxiliaryImage.copy(0, 0, w, h) : auxiliaryImage.copy(boundingRect));
+
+    const QRect rect = boundingRect.isNull() ? QRect(0, 0, w, h) : boundingRect;
+
+    QImage image;
+
+    // The rows are copied into the given buffer if the rectangle lies within the rendered page as copying would pad it otherwise.
+
+    if(allocator != 0 && auxiliaryImage.rect().contains(rect))
+    {
+        image = allocator->allocate(rect.width(), rect.height());
+
+        for(int y = 0; y < rect.height(); ++y)
+        {
+            memcpy(image.scanLine(y), auxiliaryImage.constScanLine(rect.y() + y) + 4 * rect.x(), 4 * rect.width());
+        }
+    }
+    else
+    {
+        image = auxiliaryImage.copy(rect);
+    }
 
     free(pageData);
     pageData = 0;
@@ -137,15 +128,108 @@ QImage PsPage::render(qreal horizontalResolution, qreal verticalResolution, Rota
     return image;
 }
 
-PsDocument::PsDocument(SpectreDocument* document, SpectreRenderContext* renderContext) :
+} // anonymous
+
+namespace qpdfview
+{
+
+namespace Model
+{
+
+PsPage::PsPage(const PsDocument* parent, int index, SpectrePage* page) :
+    m_parent(parent),
+    m_index(index),
+    m_page(page)
+{
+}
+
+PsPage::~PsPage()
+{
+    spectre_page_free(m_page);
+    m_page = 0;
+}
+
+QSizeF PsPage::size() const
+{
+    QMutexLocker mutexLocker(&m_parent->m_mutex);
+
+    int w;
+    int h;
+
+    spectre_page_get_size(m_page, &w, &h);
+
+    return QSizeF(w, h);
+}
+
+QImage PsPage::render(qreal horizontalResolution, qreal verticalResolution, Rotation rotation, const QRect& boundingRect, const CancellationToken* cancellation, ImageAllocator* allocator) const
+{
+    // Use whichever instance is free and wait for the primary one only if all of them are busy.
+
+    if(m_parent->m_mutex.tryLock())
+    {
+        const QImage image = renderPage(m_page, m_parent->m_renderContext, horizontalResolution, verticalResolution, rotation, boundingRect, allocator);
+
+        m_parent->m_mutex.unlock();
+
+        return image;
+    }
+
+    foreach(PsDocument::RenderInstance* renderInstance, m_parent->m_renderInstances)
+    {
+        if(renderInstance->mutex.tryLock())
+        {
+            QImage image;
+
+            SpectrePage* page = spectre_document_get_page(renderInstance->document, m_index);
+
+            if(page != 0)
+            {
+                image = renderPage(page, renderInstance->renderContext, horizontalResolution, verticalResolution, rotation, boundingRect, allocator);
+
+                spectre_page_free(page);
+            }
+
+            renderInstance->mutex.unlock();
+
+            if(!image.isNull())
+            {
+                return image;
+            }
+
+            break;
+        }
+    }
+
+    // Ghostscript cannot be interrupted, but a canceled render need not wait for the primary instance.
+
+    if(cancellation != 0 && cancellation->wasCanceled())
+    {
+        return QImage();
+    }
+
+    QMutexLocker mutexLocker(&m_parent->m_mutex);
+
+    return renderPage(m_page, m_parent->m_renderContext, horizontalResolution, verticalResolution, rotation, boundingRect, allocator);
+}
+
+PsDocument::PsDocument(SpectreDocument* document, SpectreRenderContext* renderContext, const QList< RenderInstance* >& renderInstances) :
     m_mutex(),
     m_document(document),
-    m_renderContext(renderContext)
+    m_renderContext(renderContext),
+    m_renderInstances(renderInstances)
 {
 }
 
 PsDocument::~PsDocument()
 {
+    foreach(RenderInstance* renderInstance, m_renderInstances)
+    {
+        spectre_render_context_free(renderInstance->renderContext);
+        spectre_document_free(renderInstance->document);
+
+        delete renderInstance;
+    }
+
     spectre_render_context_free(m_renderContext);
     m_renderContext = 0;
 
@@ -166,7 +250,12 @@ Page* PsDocument::page(int index) const
 
     SpectrePage* page = spectre_document_get_page(m_document, index);
 
-    return page != 0 ? new PsPage(&m_mutex, page, m_renderContext) : 0;
+    return page != 0 ? new PsPage(this, index, page) : 0;
+}
+
+bool PsDocument::hasPageLabels() const
+{
+    return false;
 }
 
 QStringList PsDocument::saveFilter() const
@@ -249,18 +338,30 @@ PsSettingsWidget::PsSettingsWidget(QSettings* settings, QWidget* parent) : Setti
     m_textAntialisBitsSpinBox->setValue(m_settings->value("textAntialiasBits", 2).toInt());
 
     m_layout->addRow(tr("Text antialias bits:"), m_textAntialisBitsSpinBox);
+
+    // document instances
+
+    m_documentInstancesSpinBox = new QSpinBox(this);
+    m_documentInstancesSpinBox->setRange(1, 16);
+    m_documentInstancesSpinBox->setValue(m_settings->value("documentInstances", 1).toInt());
+
+    m_layout->addRow(tr("Document instances:"), m_documentInstancesSpinBox);
 }
 
 void PsSettingsWidget::accept()
 {
     m_settings->setValue("graphicsAntialiasBits", m_graphicsAntialiasBitsSpinBox->value());
     m_settings->setValue("textAntialiasBits", m_textAntialisBitsSpinBox->value());
+
+    m_settings->setValue("documentInstances", m_documentInstancesSpinBox->value());
 }
 
 void PsSettingsWidget::reset()
 {
     m_graphicsAntialiasBitsSpinBox->setValue(4);
     m_textAntialisBitsSpinBox->setValue(2);
+
+    m_documentInstancesSpinBox->setValue(1);
 }
 
 PsPlugin::PsPlugin(QObject* parent) : QObject(parent)
@@ -289,7 +390,36 @@ Model::Document* PsPlugin::loadDocument(const QString& filePath) const
                                               m_settings->value("graphicsAntialiasBits", 4).toInt(),
                                               m_settings->value("textAntialiasBits", 2).toInt());
 
-    return new Model::PsDocument(document, renderContext);
+    QList< Model::PsDocument::RenderInstance* > renderInstances;
+
+    const int documentInstances = m_settings->value("documentInstances", 1).toInt();
+
+    for(int instance = 1; instance < documentInstances; ++instance)
+    {
+        SpectreDocument* additionalDocument = spectre_document_new();
+
+        spectre_document_load(additionalDocument, QFile::encodeName(filePath));
+
+        if(spectre_document_status(additionalDocument) != SPECTRE_STATUS_SUCCESS)
+        {
+            spectre_document_free(additionalDocument);
+
+            break;
+        }
+
+        Model::PsDocument::RenderInstance* renderInstance = new Model::PsDocument::RenderInstance;
+
+        renderInstance->document = additionalDocument;
+        renderInstance->renderContext = spectre_render_context_new();
+
+        spectre_render_context_set_antialias_bits(renderInstance->renderContext,
+                                                  m_settings->value("graphicsAntialiasBits", 4).toInt(),
+                                                  m_settings->value("textAntialiasBits", 2).toInt());
+
+        renderInstances.append(renderInstance);
+    }
+
+    return new Model::PsDocument(document, renderContext, renderInstances);
 }
 
 SettingsWidget* PsPlugin::createSettingsWidget(QWidget* parent) const
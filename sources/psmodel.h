@@ -24,6 +24,7 @@ along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
 #define PSMODEL_H
 
 #include <QCoreApplication>
+#include <QList>
 #include <QMutex>
 
 class QFormLayout;
@@ -52,16 +53,17 @@ namespace Model
 
         QSizeF size() const;
 
-        QImage render(qreal horizontalResolution, qreal verticalResolution, Rotation rotation, const QRect& boundingRect) const;
+        QImage render(qreal horizontalResolution, qreal verticalResolution, Rotation rotation, const QRect& boundingRect, const CancellationToken* cancellation, ImageAllocator* allocator) const;
 
     private:
         Q_DISABLE_COPY(PsPage)
 
-        PsPage(QMutex* mutex, SpectrePage* page, SpectreRenderContext* renderContext);
+        PsPage(const class PsDocument* parent, int index, SpectrePage* page);
 
-        mutable QMutex* m_mutex;
+        const class PsDocument* m_parent;
+
+        int m_index;
         SpectrePage* m_page;
-        SpectreRenderContext* m_renderContext;
 
     };
 
@@ -69,6 +71,7 @@ namespace Model
     {
         Q_DECLARE_TR_FUNCTIONS(Model::PsDocument)
 
+        friend class PsPage;
         friend class qpdfview::PsPlugin;
 
     public:
@@ -78,6 +81,8 @@ namespace Model
 
         Page* page(int index) const;
 
+        bool hasPageLabels() const;
+
         QStringList saveFilter() const;
 
         bool canSave() const;
@@ -90,12 +95,24 @@ namespace Model
     private:
         Q_DISABLE_COPY(PsDocument)
 
-        PsDocument(SpectreDocument* document, SpectreRenderContext* renderContext);
+        // Additional instances of the same document which render pages in parallel to the primary one.
+
+        struct RenderInstance
+        {
+            QMutex mutex;
+            SpectreDocument* document;
+            SpectreRenderContext* renderContext;
+
+        };
+
+        PsDocument(SpectreDocument* document, SpectreRenderContext* renderContext, const QList< RenderInstance* >& renderInstances = QList< RenderInstance* >());
 
         mutable QMutex m_mutex;
         SpectreDocument* m_document;
         SpectreRenderContext* m_renderContext;
 
+        QList< RenderInstance* > m_renderInstances;
+
     };
 }
 
@@ -119,6 +136,8 @@ private:
     QSpinBox* m_graphicsAntialiasBitsSpinBox;
     QSpinBox* m_textAntialisBitsSpinBox;
 
+    QSpinBox* m_documentInstancesSpinBox;
+
 };
 
 class PsPlugin : public QObject, Plugin
@@ -128,7 +147,7 @@ class PsPlugin : public QObject, Plugin
 
 #if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
 
-    Q_PLUGIN_METADATA(IID "local.qpdfview.Plugin")
+    Q_PLUGIN_METADATA(IID "local.qpdfview.Plugin/2")
 
 #endif // QT_VERSION
 
@@ -0,0 +1,297 @@
+/*
+
+Copyright 2014 Adam Reichold
+
+This file is part of qpdfview.
+
+qpdfview is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+qpdfview is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "renderscheduler.h"
+
+#include <QApplication>
+#include <QThread>
+
+#include "rendertask.h"
+
+namespace qpdfview
+{
+
+class RenderScheduler::Job : public QRunnable
+{
+public:
+    Job(RenderScheduler* scheduler, const Entry& entry) : QRunnable(),
+        m_scheduler(scheduler),
+        m_entry(entry)
+    {
+        setAutoDelete(true);
+    }
+
+    void run()
+    {
+        if(m_entry.task != 0)
+        {
+            m_entry.task->run();
+        }
+        else
+        {
+            m_entry.runnable->run();
+
+            if(m_entry.runnable->autoDelete())
+            {
+                delete m_entry.runnable;
+            }
+        }
+
+        m_scheduler->finished(m_entry.group);
+    }
+
+private:
+    Q_DISABLE_COPY(Job)
+
+    RenderScheduler* m_scheduler;
+    Entry m_entry;
+
+};
+
+RenderScheduler* RenderScheduler::s_instance = 0;
+
+RenderScheduler* RenderScheduler::instance()
+{
+    if(s_instance == 0)
+    {
+        s_instance = new RenderScheduler(qApp);
+    }
+
+    return s_instance;
+}
+
+RenderScheduler::~RenderScheduler()
+{
+    QList< RenderTask* > tasks;
+    QList< QRunnable* > runnables;
+
+    m_mutex.lock();
+
+    for(int priority = 0; priority < NumberOfPriorities; ++priority)
+    {
+        foreach(const Entry& entry, m_queue[priority])
+        {
+            if(entry.task != 0)
+            {
+                tasks.append(entry.task);
+            }
+            else
+            {
+                runnables.append(entry.runnable);
+            }
+        }
+
+        m_queue[priority].clear();
+    }
+
+    m_mutex.unlock();
+
+    foreach(RenderTask* task, tasks)
+    {
+        task->finish();
+    }
+
+    foreach(QRunnable* runnable, runnables)
+    {
+        if(runnable->autoDelete())
+        {
+            delete runnable;
+        }
+    }
+
+    m_threadPool.waitForDone();
+
+    s_instance = 0;
+}
+
+int RenderScheduler::maxThreadCount() const
+{
+    return m_threadPool.maxThreadCount();
+}
+
+void RenderScheduler::setMaxThreadCount(int maxThreadCount)
+{
+    QMutexLocker mutexLocker(&m_mutex);
+
+    m_threadPool.setMaxThreadCount(qMax(maxThreadCount, 1));
+
+    dispatch();
+}
+
+int RenderScheduler::queuedCount() const
+{
+    QMutexLocker mutexLocker(&m_mutex);
+
+    int count = 0;
+
+    for(int priority = 0; priority < NumberOfPriorities; ++priority)
+    {
+        count += m_queue[priority].count();
+    }
+
+    return count;
+}
+
+int RenderScheduler::activeCount() const
+{
+    QMutexLocker mutexLocker(&m_mutex);
+
+    return m_activeCount;
+}
+
+void RenderScheduler::start(QRunnable* runnable, Priority priority, const QObject* group)
+{
+    QMutexLocker mutexLocker(&m_mutex);
+
+    m_queue[priority].append(Entry(runnable, group));
+
+    dispatch();
+}
+
+RenderScheduler::RenderScheduler(QObject* parent) : QObject(parent),
+    m_mutex(),
+    m_activeByGroup(),
+    m_activeCount(0),
+    m_threadPool()
+{
+    m_threadPool.setMaxThreadCount(qMax(QThread::idealThreadCount(), 1));
+}
+
+void RenderScheduler::schedule(RenderTask* task, Priority priority, const QObject* group)
+{
+    QMutexLocker mutexLocker(&m_mutex);
+
+    m_queue[priority].append(Entry(task, group));
+
+    dispatch();
+}
+
+bool RenderScheduler::unschedule(RenderTask* task)
+{
+    QMutexLocker mutexLocker(&m_mutex);
+
+    for(int priority = 0; priority < NumberOfPriorities; ++priority)
+    {
+        QList< Entry >& queue = m_queue[priority];
+
+        for(int index = 0; index < queue.count(); ++index)
+        {
+            if(queue.at(index).task == task)
+            {
+                queue.removeAt(index);
+
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+bool RenderScheduler::reschedule(RenderTask* task, Priority priority)
+{
+    QMutexLocker mutexLocker(&m_mutex);
+
+    for(int oldPriority = priority + 1; oldPriority < NumberOfPriorities; ++oldPriority)
+    {
+        QList< Entry >& queue = m_queue[oldPriority];
+
+        for(int index = 0; index < queue.count(); ++index)
+        {
+            if(queue.at(index).task == task)
+            {
+                m_queue[priority].append(queue.takeAt(index));
+
+                dispatch();
+
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+void RenderScheduler::finished(const QObject* group)
+{
+    QMutexLocker mutexLocker(&m_mutex);
+
+    --m_activeCount;
+
+    QHash< const QObject*, int >::iterator iterator = m_activeByGroup.find(group);
+
+    if(iterator != m_activeByGroup.end() && --iterator.value() <= 0)
+    {
+        m_activeByGroup.erase(iterator);
+    }
+
+    dispatch();
+}
+
+void RenderScheduler::dispatch()
+{
+    Entry entry;
+
+    while(m_activeCount < m_threadPool.maxThreadCount() && takeNext(entry))
+    {
+        ++m_activeCount;
+        ++m_activeByGroup[entry.group];
+
+        m_threadPool.start(new Job(this, entry));
+    }
+}
+
+bool RenderScheduler::takeNext(Entry& entry)
+{
+    for(int priority = 0; priority < NumberOfPriorities; ++priority)
+    {
+        QList< Entry >& queue = m_queue[priority];
+
+        if(queue.isEmpty())
+        {
+            continue;
+        }
+
+        // Prefer the group with the fewest active tasks so that no single tab can starve the others.
+
+        int nextIndex = 0;
+        int nextActive = m_activeByGroup.value(queue.first().group, 0);
+
+        for(int index = 1; index < queue.count() && nextActive > 0; ++index)
+        {
+            const int active = m_activeByGroup.value(queue.at(index).group, 0);
+
+            if(active < nextActive)
+            {
+                nextIndex = index;
+                nextActive = active;
+            }
+        }
+
+        entry = queue.takeAt(nextIndex);
+
+        return true;
+    }
+
+    return false;
+}
+
+} // qpdfview
@@ -0,0 +1,108 @@
+/*
+
+Copyright 2014 Adam Reichold
+
+This file is part of qpdfview.
+
+qpdfview is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+qpdfview is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef RENDERSCHEDULER_H
+#define RENDERSCHEDULER_H
+
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QRunnable>
+#include <QThreadPool>
+
+namespace qpdfview
+{
+
+class RenderTask;
+
+class RenderScheduler : public QObject
+{
+    Q_OBJECT
+
+    friend class RenderTask;
+
+public:
+    enum Priority
+    {
+        VisiblePriority = 0,
+        NearVisiblePriority = 1,
+        PrefetchPriority = 2,
+        ThumbnailPriority = 3,
+        PrintPriority = 4,
+        BackgroundPriority = 5,
+        NumberOfPriorities = 6
+    };
+
+    static RenderScheduler* instance();
+    ~RenderScheduler();
+
+    int maxThreadCount() const;
+    void setMaxThreadCount(int maxThreadCount);
+
+    int queuedCount() const;
+    int activeCount() const;
+
+    // Runs jobs which are not render tasks, e.g. print bands, within the same thread budget.
+    void start(QRunnable* runnable, Priority priority, const QObject* group);
+
+private:
+    Q_DISABLE_COPY(RenderScheduler)
+
+    static RenderScheduler* s_instance;
+    RenderScheduler(QObject* parent = 0);
+
+    class Job;
+
+    struct Entry
+    {
+        RenderTask* task;
+        QRunnable* runnable;
+        const QObject* group;
+
+        Entry(RenderTask* task = 0, const QObject* group = 0) : task(task), runnable(0), group(group) {}
+        Entry(QRunnable* runnable, const QObject* group) : task(0), runnable(runnable), group(group) {}
+
+    };
+
+    mutable QMutex m_mutex;
+
+    QList< Entry > m_queue[NumberOfPriorities];
+
+    QHash< const QObject*, int > m_activeByGroup;
+    int m_activeCount;
+
+    QThreadPool m_threadPool;
+
+    void schedule(RenderTask* task, Priority priority, const QObject* group);
+    bool unschedule(RenderTask* task);
+    bool reschedule(RenderTask* task, Priority priority);
+
+    void finished(const QObject* group);
+
+    void dispatch();
+    bool takeNext(Entry& entry);
+
+};
+
+} // qpdfview
+
+#endif // RENDERSCHEDULER_H
@@ -0,0 +1,198 @@
+/*
+
+Copyright 2014 Adam Reichold
+
+This file is part of qpdfview.
+
+qpdfview is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+qpdfview is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "renderstatistics.h"
+
+#include <qmath.h>
+
+namespace
+{
+
+// minimum number of renders before their costs are fitted
+const int minimumFitCount = 8;
+
+// minimum relative spread of the render sizes before their costs are fitted
+const qreal minimumFitSpread = 0.1;
+
+} // anonymous
+
+namespace qpdfview
+{
+
+RenderStatistics::Counters& RenderStatistics::Counters::operator+=(const Counters& other)
+{
+    renderCount += other.renderCount;
+    cancelCount += other.cancelCount;
+    diskCacheHits += other.diskCacheHits;
+
+    queueTime += other.queueTime;
+    renderTime += other.renderTime;
+    postProcessTime += other.postProcessTime;
+
+    megapixels += other.megapixels;
+    squaredMegapixels += other.squaredMegapixels;
+    megapixelsTimesRenderTime += other.megapixelsTimesRenderTime;
+
+    searchedPages += other.searchedPages;
+    searchTime += other.searchTime;
+
+    return *this;
+}
+
+bool RenderStatistics::Counters::fitRenderCost(qreal& costPerCall, qreal& costPerMegapixel) const
+{
+    if(renderCount < minimumFitCount)
+    {
+        return false;
+    }
+
+    const qreal meanMegapixels = megapixels / renderCount;
+    const qreal variance = squaredMegapixels / renderCount - meanMegapixels * meanMegapixels;
+
+    if(variance <= 0.0 || qSqrt(variance) < minimumFitSpread * meanMegapixels)
+    {
+        return false;
+    }
+
+    const qreal meanRenderTime = qreal(renderTime) / renderCount;
+    const qreal covariance = megapixelsTimesRenderTime / renderCount - meanMegapixels * meanRenderTime;
+
+    // Negative costs are measurement noise and are clamped so that neither term is ignored completely.
+
+    costPerMegapixel = qMax(covariance / variance, 0.0);
+    costPerCall = qMax(meanRenderTime - costPerMegapixel * meanMegapixels, 0.0);
+
+    return costPerCall > 0.0 || costPerMegapixel > 0.0;
+}
+
+QMutex RenderStatistics::s_mutex;
+
+QHash< const QObject*, RenderStatistics::Counters > RenderStatistics::s_counters;
+RenderStatistics::Counters RenderStatistics::s_totalCounters;
+
+QHash< const QObject*, int > RenderStatistics::s_tileSizes;
+
+void RenderStatistics::recordRender(const QObject* group, qint64 queueTime, qint64 renderTime, qint64 postProcessTime, qint64 pixelCount)
+{
+    Counters counters;
+
+    counters.renderCount = 1;
+
+    counters.queueTime = queueTime;
+    counters.renderTime = renderTime;
+    counters.postProcessTime = postProcessTime;
+
+    const qreal megapixels = pixelCount / (1024.0 * 1024.0);
+
+    counters.megapixels = megapixels;
+    counters.squaredMegapixels = megapixels * megapixels;
+    counters.megapixelsTimesRenderTime = megapixels * renderTime;
+
+    QMutexLocker mutexLocker(&s_mutex);
+
+    s_counters[group] += counters;
+    s_totalCounters += counters;
+}
+
+void RenderStatistics::recordDiskCacheHit(const QObject* group, qint64 queueTime)
+{
+    Counters counters;
+
+    counters.diskCacheHits = 1;
+
+    counters.queueTime = queueTime;
+
+    QMutexLocker mutexLocker(&s_mutex);
+
+    s_counters[group] += counters;
+    s_totalCounters += counters;
+}
+
+void RenderStatistics::recordCancellation(const QObject* group)
+{
+    Counters counters;
+
+    counters.cancelCount = 1;
+
+    QMutexLocker mutexLocker(&s_mutex);
+
+    s_counters[group] += counters;
+    s_totalCounters += counters;
+}
+
+void RenderStatistics::recordSearch(const QObject* group, int searchedPages, qint64 searchTime)
+{
+    Counters counters;
+
+    counters.searchedPages = searchedPages;
+    counters.searchTime = searchTime;
+
+    QMutexLocker mutexLocker(&s_mutex);
+
+    s_counters[group] += counters;
+    s_totalCounters += counters;
+}
+
+RenderStatistics::Counters RenderStatistics::counters(const QObject* group)
+{
+    QMutexLocker mutexLocker(&s_mutex);
+
+    return s_counters.value(group);
+}
+
+RenderStatistics::Counters RenderStatistics::totalCounters()
+{
+    QMutexLocker mutexLocker(&s_mutex);
+
+    return s_totalCounters;
+}
+
+void RenderStatistics::recordTileSize(const QObject* group, int tileSize)
+{
+    QMutexLocker mutexLocker(&s_mutex);
+
+    s_tileSizes.insert(group, tileSize);
+}
+
+int RenderStatistics::tileSize(const QObject* group)
+{
+    QMutexLocker mutexLocker(&s_mutex);
+
+    return s_tileSizes.value(group, 0);
+}
+
+void RenderStatistics::removeGroup(const QObject* group)
+{
+    QMutexLocker mutexLocker(&s_mutex);
+
+    s_counters.remove(group);
+    s_tileSizes.remove(group);
+}
+
+void RenderStatistics::reset()
+{
+    QMutexLocker mutexLocker(&s_mutex);
+
+    s_counters.clear();
+    s_totalCounters = Counters();
+}
+
+} // qpdfview
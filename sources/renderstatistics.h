@@ -0,0 +1,105 @@
+/*
+
+Copyright 2014 Adam Reichold
+
+This file is part of qpdfview.
+
+qpdfview is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+qpdfview is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef RENDERSTATISTICS_H
+#define RENDERSTATISTICS_H
+
+#include <QHash>
+#include <QMutex>
+
+class QObject;
+
+namespace qpdfview
+{
+
+// Accumulates where the time of render and search tasks is spent, per group as well as in total.
+
+class RenderStatistics
+{
+public:
+    struct Counters
+    {
+        int renderCount;
+        int cancelCount;
+        int diskCacheHits;
+
+        // in milliseconds
+        qint64 queueTime;
+        qint64 renderTime;
+        qint64 postProcessTime;
+
+        // sums over the renders for fitting their time to a cost per call and a cost per megapixel
+        qreal megapixels;
+        qreal squaredMegapixels;
+        qreal megapixelsTimesRenderTime;
+
+        int searchedPages;
+        qint64 searchTime;
+
+        Counters() : renderCount(0), cancelCount(0), diskCacheHits(0), queueTime(0), renderTime(0), postProcessTime(0), megapixels(0.0), squaredMegapixels(0.0), megapixelsTimesRenderTime(0.0), searchedPages(0), searchTime(0) {}
+
+        inline qreal averageQueueTime() const { return renderCount + diskCacheHits > 0 ? qreal(queueTime) / (renderCount + diskCacheHits) : 0.0; }
+        inline qreal averageRenderTime() const { return renderCount > 0 ? qreal(renderTime) / renderCount : 0.0; }
+        inline qreal averagePostProcessTime() const { return renderCount > 0 ? qreal(postProcessTime) / renderCount : 0.0; }
+
+        inline qreal searchedPagesPerSecond() const { return searchTime > 0 ? 1000.0 * searchedPages / searchTime : 0.0; }
+
+        // Fails until enough renders of sufficiently different sizes were recorded to tell both costs apart.
+        bool fitRenderCost(qreal& costPerCall, qreal& costPerMegapixel) const;
+
+        Counters& operator+=(const Counters& other);
+
+    };
+
+    static void recordRender(const QObject* group, qint64 queueTime, qint64 renderTime, qint64 postProcessTime, qint64 pixelCount);
+    static void recordDiskCacheHit(const QObject* group, qint64 queueTime);
+    static void recordCancellation(const QObject* group);
+
+    static void recordSearch(const QObject* group, int searchedPages, qint64 searchTime);
+
+    static Counters counters(const QObject* group);
+    static Counters totalCounters();
+
+    // the tile size last chosen for the group or zero
+    static void recordTileSize(const QObject* group, int tileSize);
+    static int tileSize(const QObject* group);
+
+    static void removeGroup(const QObject* group);
+
+    static void reset();
+
+private:
+    Q_DISABLE_COPY(RenderStatistics)
+
+    RenderStatistics();
+
+    static QMutex s_mutex;
+
+    static QHash< const QObject*, Counters > s_counters;
+    static Counters s_totalCounters;
+
+    static QHash< const QObject*, int > s_tileSizes;
+
+};
+
+} // qpdfview
+
+#endif // RENDERSTATISTICS_H
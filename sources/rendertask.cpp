@@ -22,9 +22,21 @@ along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
 #include "rendertask.h"
 
 #include <qmath.h>
-#include <QThreadPool>
+#include <QTransform>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+
+#define POSTPROCESSING_SSE2
+
+#include <emmintrin.h>
+
+#endif // __SSE2__
 
 #include "model.h"
+#include "diskcache.h"
+#include "imagebufferpool.h"
+#include "renderstatistics.h"
+#include "tracing.h"
 
 namespace
 {
@@ -81,6 +93,28 @@ bool testCancellation(QAtomicInt& wasCanceled, bool prefetch)
 #endif // QT_VERSION
 }
 
+class Cancellation : public Model::CancellationToken
+{
+public:
+    Cancellation(QAtomicInt& wasCanceled, bool prefetch) :
+        m_wasCanceled(wasCanceled),
+        m_prefetch(prefetch)
+    {
+    }
+
+    bool wasCanceled() const
+    {
+        return testCancellation(m_wasCanceled, m_prefetch);
+    }
+
+private:
+    Q_DISABLE_COPY(Cancellation)
+
+    QAtomicInt& m_wasCanceled;
+    bool m_prefetch;
+
+};
+
 int loadWasCanceled(const QAtomicInt& wasCanceled)
 {
 #if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
@@ -106,110 +140,426 @@ qreal scaledResolutionY(const RenderParam& renderParam)
             renderParam.resolution.resolutionY * renderParam.scaleFactor;
 }
 
-bool columnHasPaperColor(int x, QRgb paperColor, const QImage& image)
+inline bool isPaperColor(QRgb pixel, QRgb paperColor)
+{
+    return paperColor == (pixel | 0xff000000u);
+}
+
+inline QRgb processPixel(QRgb pixel, bool convertToGrayscale, bool invertColors)
+{
+    if(convertToGrayscale)
+    {
+        const int gray = qGray(pixel);
+
+        pixel = qRgba(gray, gray, gray, qAlpha(pixel));
+    }
+
+    if(invertColors)
+    {
+        pixel ^= 0x00ffffffu;
+    }
+
+    return pixel;
+}
+
+#ifdef POSTPROCESSING_SSE2
+
+inline __m128i processPixels(__m128i pixels, bool convertToGrayscale, bool invertColors)
 {
+    const __m128i alphaMask = _mm_set1_epi32(static_cast< int >(0xff000000u));
+
+    if(convertToGrayscale)
+    {
+        // Computes qGray, i.e. (11 * r + 16 * g + 5 * b) / 32, for four pixels at once.
+
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i weights = _mm_set_epi16(0, 11, 16, 5, 0, 11, 16, 5);
+
+        __m128i low = _mm_madd_epi16(_mm_unpacklo_epi8(pixels, zero), weights);
+        __m128i high = _mm_madd_epi16(_mm_unpackhi_epi8(pixels, zero), weights);
+
+        low = _mm_add_epi32(low, _mm_srli_epi64(low, 32));
+        high = _mm_add_epi32(high, _mm_srli_epi64(high, 32));
+
+        low = _mm_shuffle_epi32(low, _MM_SHUFFLE(3, 1, 2, 0));
+        high = _mm_shuffle_epi32(high, _MM_SHUFFLE(3, 1, 2, 0));
+
+        __m128i gray = _mm_srli_epi32(_mm_unpacklo_epi64(low, high), 5);
+        gray = _mm_or_si128(gray, _mm_or_si128(_mm_slli_epi32(gray, 8), _mm_slli_epi32(gray, 16)));
+
+        pixels = _mm_or_si128(gray, _mm_and_si128(pixels, alphaMask));
+    }
+
+    if(invertColors)
+    {
+        pixels = _mm_xor_si128(pixels, _mm_set1_epi32(0x00ffffffu));
+    }
+
+    return pixels;
+}
+
+#endif // POSTPROCESSING_SSE2
+
+QRectF cropRectFromBounds(int left, int right, int top, int bottom, int width, int height)
+{
+    left = qMin(left, width / 3);
+    right = qMax(right, 2 * width / 3);
+
+    top = qMin(top, height / 3);
+    bottom = qMax(bottom, 2 * height / 3);
+
+    left = qMax(left - width / 100, 0);
+    top = qMax(top - height / 100, 0);
+
+    right = qMin(right + width / 100, width);
+    bottom = qMin(bottom + height / 100, height);
+
+    return QRectF(static_cast< qreal >(left) / width,
+                  static_cast< qreal >(top) / height,
+                  static_cast< qreal >(right - left) / width,
+                  static_cast< qreal >(bottom - top) / height);
+}
+
+// Trims margins, converts to grayscale and inverts colors in a single row-major pass over the scan lines.
+
+QRectF postProcess(QImage& image, bool trimMargins, QRgb paperColor, bool convertToGrayscale, bool invertColors)
+{
+    if(image.isNull())
+    {
+        return trimMargins ? QRectF(0.0, 0.0, 1.0, 1.0) : QRectF();
+    }
+
+    if(!trimMargins && !convertToGrayscale && !invertColors)
+    {
+        return QRectF();
+    }
+
+    if(image.depth() != 32)
+    {
+        image = image.convertToFormat(QImage::Format_ARGB32);
+    }
+
+    const bool modifyPixels = convertToGrayscale || invertColors;
+
+    const int width = image.width();
     const int height = image.height();
 
+    int left = width;
+    int right = -1;
+    int top = height;
+    int bottom = -1;
+
+#ifdef POSTPROCESSING_SSE2
+
+    const __m128i paperColors = _mm_set1_epi32(static_cast< int >(paperColor));
+    const __m128i alphaMask = _mm_set1_epi32(static_cast< int >(0xff000000u));
+
+#endif // POSTPROCESSING_SSE2
+
     for(int y = 0; y < height; ++y)
     {
-        if(paperColor != (image.pixel(x, y) | 0xff000000u))
+        QRgb* const line = reinterpret_cast< QRgb* >(image.scanLine(y));
+
+        int x = 0;
+
+#ifdef POSTPROCESSING_SSE2
+
+        for(; x + 4 <= width; x += 4)
         {
-            return false;
+            __m128i pixels = _mm_loadu_si128(reinterpret_cast< const __m128i* >(line + x));
+
+            if(trimMargins)
+            {
+                const int mask = _mm_movemask_epi8(_mm_cmpeq_epi32(_mm_or_si128(pixels, alphaMask), paperColors));
+
+                if(mask != 0xffff)
+                {
+                    for(int lane = 0; lane < 4; ++lane)
+                    {
+                        if(((mask >> (4 * lane)) & 0xf) != 0xf)
+                        {
+                            left = qMin(left, x + lane);
+                            right = qMax(right, x + lane);
+                        }
+                    }
+
+                    top = qMin(top, y);
+                    bottom = y;
+                }
+            }
+
+            if(modifyPixels)
+            {
+                _mm_storeu_si128(reinterpret_cast< __m128i* >(line + x), processPixels(pixels, convertToGrayscale, invertColors));
+            }
+        }
+
+#endif // POSTPROCESSING_SSE2
+
+        for(; x < width; ++x)
+        {
+            const QRgb pixel = line[x];
+
+            if(trimMargins && !isPaperColor(pixel, paperColor))
+            {
+                left = qMin(left, x);
+                right = qMax(right, x);
+
+                top = qMin(top, y);
+                bottom = y;
+            }
+
+            if(modifyPixels)
+            {
+                line[x] = processPixel(pixel, convertToGrayscale, invertColors);
+            }
         }
     }
 
-    return true;
+    if(!trimMargins)
+    {
+        return QRectF();
+    }
+
+    return cropRectFromBounds(left, right, top, bottom, width, height);
 }
 
-bool rowHasPaperColor(int y, QRgb paperColor, const QImage& image)
+// Margins are detected on a rendering of the whole page whose longer side has this many pixels, so that it does not depend on the tile or the scale factor.
+
+const int cropRectExtent = 256;
+
+QSizeF pageExtent(const Model::Page* page, const RenderParam& renderParam)
 {
-    const int width = image.width();
+    const QSizeF size = page->size();
+
+    const qreal width = size.width() * renderParam.resolution.resolutionX * renderParam.scaleFactor / 72.0;
+    const qreal height = size.height() * renderParam.resolution.resolutionY * renderParam.scaleFactor / 72.0;
+
+    return renderParam.rotation == RotateBy90 || renderParam.rotation == RotateBy270 ? QSizeF(height, width) : QSizeF(width, height);
+}
+
+QRectF measureCropRect(const Model::Page* page, Rotation rotation, QRgb paperColor, const Model::CancellationToken* cancellation)
+{
+    const QSizeF size = page->size();
+    const qreal resolution = 72.0 * cropRectExtent / qMax(qMax(size.width(), size.height()), 1.0);
+
+    QImage image = page->render(resolution, resolution, rotation, QRect(), cancellation, ImageBufferPool::instance());
+
+    const QRectF cropRect = postProcess(image, true, paperColor, false, false);
+
+    ImageBufferPool::instance()->recycle(image);
+
+    return cropRect;
+}
+
+// Embedded thumbnails are only looked up for renderings whose longer side has at most this many pixels.
+const qreal maximumThumbnailExtent = 1024.0;
+
+// Embedded thumbnails replace renderings which are at most this much larger, so that they do not look blurry.
+const qreal maximumThumbnailUpscale = 1.5;
+
+// Previews are shown only until the rendering is ready, so embedded thumbnails may be enlarged further for them.
+const qreal maximumPreviewThumbnailUpscale = 4.0;
 
-    for(int x = 0; x < width; ++x)
+// Embedded thumbnails must match the aspect ratio of the page up to this relative deviation.
+const qreal maximumThumbnailDistortion = 0.05;
+
+QImage renderThumbnail(const Model::Page* page, const QSizeF& extent, Rotation rotation, const QRect& rect, qreal maximumUpscale)
+{
+    if(qMax(extent.width(), extent.height()) > maximumThumbnailExtent)
     {
-        if(paperColor != (image.pixel(x, y) | 0xff000000u))
-        {
-            return false;
-        }
+        return QImage();
     }
 
-    return true;
+    QImage thumbnail = page->thumbnail();
+
+    if(thumbnail.isNull())
+    {
+        return QImage();
+    }
+
+    if(rotation != RotateBy0)
+    {
+        thumbnail = thumbnail.transformed(QTransform().rotate(90.0 * rotation));
+    }
+
+    if(maximumUpscale * thumbnail.width() < extent.width() || maximumUpscale * thumbnail.height() < extent.height())
+    {
+        return QImage();
+    }
+
+    // A thumbnail which does not match the shape of the page, e.g. because it ignores the rotation of the page, is not used.
+
+    const qreal aspectRatio = (thumbnail.width() * extent.height()) / (thumbnail.height() * extent.width());
+
+    if(qAbs(aspectRatio - 1.0) > maximumThumbnailDistortion)
+    {
+        return QImage();
+    }
+
+    thumbnail = thumbnail.scaled(qCeil(extent.width()), qCeil(extent.height()), Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+
+    return (rect.isNull() ? thumbnail : thumbnail.copy(rect)).convertToFormat(QImage::Format_RGB32);
 }
 
-QRectF trimMargins(QRgb paperColor, const QImage& image)
+// The crop rectangle of the page is expressed relative to the tile so that the union over all tiles yields it again.
+
+QRectF relativeCropRect(const QRectF& cropRect, const QSizeF& pageExtent, const QRect& tileRect)
 {
-    if(image.isNull())
+    if(tileRect.isEmpty())
+    {
+        return cropRect;
+    }
+
+    return QRectF((cropRect.left() * pageExtent.width() - tileRect.left()) / tileRect.width(),
+                  (cropRect.top() * pageExtent.height() - tileRect.top()) / tileRect.height(),
+                  cropRect.width() * pageExtent.width() / tileRect.width(),
+                  cropRect.height() * pageExtent.height() / tileRect.height());
+}
+
+// Prefetched tiles without colour are stored with one bit or one byte per pixel so that the tile cache holds several times as many of them.
+
+QImage compactImage(const QImage& image)
+{
+    if(image.format() != QImage::Format_RGB32 && image.format() != QImage::Format_ARGB32 && image.format() != QImage::Format_ARGB32_Premultiplied)
     {
-        return QRectF(0.0, 0.0, 1.0, 1.0);
+        return image;
     }
 
     const int width = image.width();
     const int height = image.height();
 
-    int left;
-    for(left = 0; left < width; ++left)
+    bool levels[256] = {};
+    int levelCount = 0;
+
+    for(int y = 0; y < height; ++y)
     {
-        if(!columnHasPaperColor(left, paperColor, image))
+        const QRgb* const line = reinterpret_cast< const QRgb* >(image.constScanLine(y));
+
+        for(int x = 0; x < width; ++x)
         {
-            break;
+            const QRgb pixel = line[x];
+
+            if(qAlpha(pixel) != 255 || qRed(pixel) != qGreen(pixel) || qGreen(pixel) != qBlue(pixel))
+            {
+                return image;
+            }
+
+            if(!levels[qRed(pixel)])
+            {
+                levels[qRed(pixel)] = true;
+                ++levelCount;
+            }
         }
     }
-    left = qMin(left, width / 3);
 
-    int right;
-    for(right = width - 1; right >= left; --right)
+    QImage compact;
+
+    if(levelCount <= 2)
     {
-        if(!columnHasPaperColor(right, paperColor, image))
+        QVector< QRgb > colorTable;
+
+        for(int level = 0; level < 256; ++level)
         {
-            break;
+            if(levels[level])
+            {
+                colorTable.append(qRgb(level, level, level));
+            }
         }
-    }
-    right = qMax(right, 2 * width / 3);
 
-    int top;
-    for(top = 0; top < height; ++top)
-    {
-        if(!rowHasPaperColor(top, paperColor, image))
+        if(colorTable.count() < 2)
         {
-            break;
+            colorTable.append(colorTable.first());
         }
-    }
-    top = qMin(top, height / 3);
 
-    int bottom;
-    for(bottom = height - 1; bottom >= top; --bottom)
+        compact = QImage(width, height, QImage::Format_Mono);
+        compact.setColorTable(colorTable);
+        compact.fill(0);
+
+        const int upperLevel = qRed(colorTable.last());
+
+        for(int y = 0; y < height; ++y)
+        {
+            const QRgb* const line = reinterpret_cast< const QRgb* >(image.constScanLine(y));
+            uchar* const compactLine = compact.scanLine(y);
+
+            for(int x = 0; x < width; ++x)
+            {
+                if(qRed(line[x]) == upperLevel)
+                {
+                    compactLine[x >> 3] |= 0x80 >> (x & 7);
+                }
+            }
+        }
+    }
+    else
     {
-        if(!rowHasPaperColor(bottom, paperColor, image))
+        QVector< QRgb > colorTable;
+        colorTable.reserve(256);
+
+        for(int level = 0; level < 256; ++level)
         {
-            break;
+            colorTable.append(qRgb(level, level, level));
+        }
+
+        compact = QImage(width, height, QImage::Format_Indexed8);
+        compact.setColorTable(colorTable);
+
+        for(int y = 0; y < height; ++y)
+        {
+            const QRgb* const line = reinterpret_cast< const QRgb* >(image.constScanLine(y));
+            uchar* const compactLine = compact.scanLine(y);
+
+            for(int x = 0; x < width; ++x)
+            {
+                compactLine[x] = qRed(line[x]);
+            }
         }
     }
-    bottom = qMax(bottom, 2 * height / 3);
 
-    left = qMax(left - width / 100, 0);
-    top = qMax(top - height / 100, 0);
+#if QT_VERSION >= QT_VERSION_CHECK(5,1,0)
 
-    right = qMin(right + width / 100, width);
-    bottom = qMin(bottom + height / 100, height);
+    compact.setDevicePixelRatio(image.devicePixelRatio());
 
-    return QRectF(static_cast< qreal >(left) / width,
-                  static_cast< qreal >(top) / height,
-                  static_cast< qreal >(right - left) / width,
-                  static_cast< qreal >(bottom - top) / height);
+#endif // QT_VERSION
+
+    return compact;
 }
 
-void convertToGrayscale(QImage& image)
+// Images are converted into the format of the raster pixmaps by the workers, so that the pixmap shares their pixels
+// instead of converting them on the GUI thread. Opaque images are detected here for the same reason.
+
+QImage displayImage(const QImage& image)
 {
-    QRgb* const begin = reinterpret_cast< QRgb* >(image.bits());
-    QRgb* const end = reinterpret_cast< QRgb* >(image.bits() + image.byteCount());
+    if(image.isNull() || image.format() == QImage::Format_Mono || image.format() == QImage::Format_MonoLSB || image.format() == QImage::Format_Indexed8)
+    {
+        return image;
+    }
+
+    bool opaque = !image.hasAlphaChannel();
 
-    for(QRgb* pointer = begin; pointer != end; ++pointer)
+    if(!opaque && (image.format() == QImage::Format_ARGB32 || image.format() == QImage::Format_ARGB32_Premultiplied))
     {
-        const int gray = qGray(*pointer);
-        const int alpha = qAlpha(*pointer);
+        opaque = true;
 
-        *pointer = qRgba(gray, gray, gray, alpha);
+        for(int y = 0; opaque && y < image.height(); ++y)
+        {
+            const QRgb* const line = reinterpret_cast< const QRgb* >(image.constScanLine(y));
+
+            for(int x = 0; x < image.width(); ++x)
+            {
+                if(qAlpha(line[x]) != 255)
+                {
+                    opaque = false;
+                    break;
+                }
+            }
+        }
     }
+
+    const QImage::Format format = opaque ? QImage::Format_RGB32 : QImage::Format_ARGB32_Premultiplied;
+
+    return image.format() != format ? image.convertToFormat(format) : image;
 }
 
 } // anonymous
@@ -217,17 +567,24 @@ void convertToGrayscale(QImage& image)
 namespace qpdfview
 {
 
-RenderTask::RenderTask(Model::Page* page, QObject* parent) : QObject(parent), QRunnable(),
+RenderTask::RenderTask(Model::Page* page, QObject* parent) : QObject(parent),
     m_isRunning(false),
     m_wasCanceled(NotCanceled),
+    m_renderDuration(0),
     m_page(page),
     m_renderParam(),
     m_rect(),
     m_prefetch(false),
+    m_previewFirst(false),
+    m_embeddedThumbnails(false),
+    m_diskCache(0),
+    m_diskCacheKey(),
     m_trimMargins(false),
-    m_paperColor()
+    m_paperColor(),
+    m_group(0),
+    m_queueTimer(),
+    m_queueTimestamp(0)
 {
-    setAutoDelete(false);
 }
 
 void RenderTask::wait()
@@ -247,6 +604,15 @@ bool RenderTask::isRunning() const
     return m_isRunning;
 }
 
+void RenderTask::setPage(Model::Page* page)
+{
+    QMutexLocker mutexLocker(&m_mutex);
+
+    Q_ASSERT(!m_isRunning);
+
+    m_page = page;
+}
+
 bool RenderTask::wasCanceled() const
 {
     return loadWasCanceled(m_wasCanceled) != NotCanceled;
@@ -262,50 +628,219 @@ bool RenderTask::wasCanceledForcibly() const
     return loadWasCanceled(m_wasCanceled) == CanceledForcibly;
 }
 
+int RenderTask::renderDuration() const
+{
+    QMutexLocker mutexLocker(&m_mutex);
+
+    return m_renderDuration;
+}
+
+bool RenderTask::convertColors(QImage& image,
+                               bool convertedToGrayscale, bool invertedColors,
+                               bool convertToGrayscale, bool invertColors)
+{
+    if(convertedToGrayscale && !convertToGrayscale)
+    {
+        return false;
+    }
+
+    if(convertedToGrayscale == convertToGrayscale)
+    {
+        // Inverting is its own inverse, so the colours only have to be inverted once more if the settings differ.
+
+        postProcess(image, false, 0, false, invertedColors != invertColors);
+
+        return true;
+    }
+
+    if(invertedColors)
+    {
+        postProcess(image, false, 0, false, true);
+    }
+
+    postProcess(image, false, 0, convertToGrayscale, invertColors);
+
+    return true;
+}
+
 void RenderTask::run()
 {
-#define CANCELLATION_POINT if(testCancellation(m_wasCanceled, m_prefetch)) { finish(); return; }
+#define CANCELLATION_POINT if(testCancellation(m_wasCanceled, m_prefetch)) { RenderStatistics::recordCancellation(m_group); finish(); return; }
+
+    const qint64 queueTime = m_queueTimer.elapsed();
+
+    Tracing::recordSpan("render", "queue", m_queueTimestamp);
+
+    const TraceSpan span("render", "run");
 
     CANCELLATION_POINT
 
-    QImage image;
-    QRectF cropRect;
+    m_mutex.lock();
+    m_renderDuration = -1;
+    m_mutex.unlock();
+
+    const Cancellation cancellation(m_wasCanceled, m_prefetch);
+
+    if(m_diskCache != 0 && !m_diskCacheKey.isEmpty())
+    {
+        QImage image;
+        QRectF cropRect;
+
+        const qint64 loadBegin = Tracing::timestamp();
+
+        const bool loaded = m_diskCache->load(m_diskCacheKey, image, cropRect);
 
-    image = m_page->render(scaledResolutionX(m_renderParam), scaledResolutionY(m_renderParam),
-                           m_renderParam.rotation, m_rect);
+        Tracing::recordSpan("render", "loadFromDiskCache", loadBegin);
 
+        // Tiles stored while the crop rectangle of their page was already known do not carry one.
+
+        if(loaded && (!m_trimMargins || !cropRect.isNull()))
+        {
 #if QT_VERSION >= QT_VERSION_CHECK(5,1,0)
 
-    image.setDevicePixelRatio(m_renderParam.resolution.devicePixelRatio);
+            image.setDevicePixelRatio(m_renderParam.resolution.devicePixelRatio);
 
 #endif // QT_VERSION
 
-    if(m_trimMargins)
+            image = m_prefetch ? compactImage(image) : displayImage(image);
+
+            CANCELLATION_POINT
+
+            emit imageReady(m_renderParam,
+                            m_rect, m_prefetch,
+                            image, cropRect);
+
+            RenderStatistics::recordDiskCacheHit(m_group, queueTime);
+
+            finish();
+
+            return;
+        }
+    }
+
+    const QSizeF extent = pageExtent(m_page, m_renderParam);
+
+    // Tiles are placed in device pixels whereas the extent of the page is measured in logical ones.
+
+    const QSizeF renderExtent = extent * m_renderParam.resolution.devicePixelRatio;
+
+    if(m_previewFirst)
     {
+        const qreal scaleFactor = previewScaleFactor();
+        const QRect previewRect(qFloor(scaleFactor * m_rect.x()), qFloor(scaleFactor * m_rect.y()),
+                                qCeil(scaleFactor * m_rect.width()), qCeil(scaleFactor * m_rect.height()));
+
+        const qint64 previewBegin = Tracing::timestamp();
+
+        QImage previewImage = renderThumbnail(m_page, scaleFactor * renderExtent, m_renderParam.rotation, previewRect, maximumPreviewThumbnailUpscale);
+
+        if(previewImage.isNull())
+        {
+            previewImage = m_page->render(scaleFactor * scaledResolutionX(m_renderParam), scaleFactor * scaledResolutionY(m_renderParam),
+                                          m_renderParam.rotation, previewRect, &cancellation, ImageBufferPool::instance());
+        }
+
+        postProcess(previewImage, false, m_paperColor.rgb(),
+                    m_renderParam.convertToGrayscale, m_renderParam.invertColors);
+
+        previewImage = displayImage(previewImage);
+
+        Tracing::recordSpan("render", "renderPreview", previewBegin);
+
         CANCELLATION_POINT
 
-        cropRect = trimMargins(m_paperColor.rgb(), image);
+        emit previewReady(m_renderParam,
+                          m_rect,
+                          previewImage);
+
+        CANCELLATION_POINT
     }
 
-    if(m_renderParam.convertToGrayscale)
+    // Renderings which are not larger than the one used to measure the margins, e.g. thumbnails, are scanned directly.
+
+    const bool measureMargins = m_trimMargins && qMax(extent.width(), extent.height()) > cropRectExtent;
+    const bool trimMargins = m_trimMargins && !measureMargins;
+
+    QImage image;
+    QRectF cropRect;
+
+    if(measureMargins)
     {
+        const qint64 measureBegin = Tracing::timestamp();
+
+        cropRect = relativeCropRect(measureCropRect(m_page, m_renderParam.rotation, m_paperColor.rgb(), &cancellation), extent, m_rect);
+
+        Tracing::recordSpan("render", "measureCropRect", measureBegin);
+
         CANCELLATION_POINT
+    }
+
+    QElapsedTimer renderTimer;
+    renderTimer.start();
+
+    const qint64 renderBegin = Tracing::timestamp();
+
+    if(m_embeddedThumbnails)
+    {
+        image = renderThumbnail(m_page, renderExtent, m_renderParam.rotation, m_rect, maximumThumbnailUpscale);
+    }
 
-        convertToGrayscale(image);
+    if(image.isNull())
+    {
+        image = m_page->render(scaledResolutionX(m_renderParam), scaledResolutionY(m_renderParam),
+                               m_renderParam.rotation, m_rect, &cancellation, ImageBufferPool::instance());
     }
 
-    if(m_renderParam.invertColors)
+    const qint64 renderTime = renderTimer.elapsed();
+
+    Tracing::recordSpan("render", "render", renderBegin, "pixels", qint64(m_rect.width()) * m_rect.height());
+
+    m_mutex.lock();
+    m_renderDuration = renderTime;
+    m_mutex.unlock();
+
+#if QT_VERSION >= QT_VERSION_CHECK(5,1,0)
+
+    image.setDevicePixelRatio(m_renderParam.resolution.devicePixelRatio);
+
+#endif // QT_VERSION
+
+    QElapsedTimer postProcessTimer;
+    postProcessTimer.start();
+
+    const qint64 postProcessBegin = Tracing::timestamp();
+
+    if(trimMargins || m_renderParam.convertToGrayscale || m_renderParam.invertColors)
     {
         CANCELLATION_POINT
 
-        image.invertPixels();
+        const QRectF imageCropRect = postProcess(image, trimMargins, m_paperColor.rgb(),
+                                                 m_renderParam.convertToGrayscale, m_renderParam.invertColors);
+
+        if(trimMargins)
+        {
+            cropRect = imageCropRect;
+        }
     }
 
     CANCELLATION_POINT
 
+    image = displayImage(image);
+
+    const QImage readyImage = m_prefetch ? compactImage(image) : image;
+
+    Tracing::recordSpan("render", "postProcess", postProcessBegin);
+
+    RenderStatistics::recordRender(m_group, queueTime, renderTime, postProcessTimer.elapsed(), qint64(m_rect.width()) * m_rect.height());
+
     emit imageReady(m_renderParam,
                     m_rect, m_prefetch,
-                    image, cropRect);
+                    readyImage, cropRect);
+
+    if(m_diskCache != 0 && !m_diskCacheKey.isEmpty())
+    {
+        m_diskCache->store(m_diskCacheKey, image, cropRect);
+    }
 
     finish();
 
@@ -314,28 +849,52 @@ void RenderTask::run()
 
 void RenderTask::start(const RenderParam& renderParam,
                        const QRect& rect, bool prefetch,
-                       bool trimMargins, const QColor& paperColor)
+                       bool trimMargins, const QColor& paperColor,
+                       RenderScheduler::Priority priority, const QObject* group,
+                       bool previewFirst, DiskCache* diskCache, const QByteArray& diskCacheKey)
 {
     m_renderParam = renderParam;
 
     m_rect = rect;
     m_prefetch = prefetch;
+    m_previewFirst = previewFirst;
+
+    m_diskCache = diskCache;
+    m_diskCacheKey = diskCacheKey;
 
     m_trimMargins = trimMargins;
     m_paperColor = paperColor;
 
+    m_group = group;
+    m_queueTimer.start();
+    m_queueTimestamp = Tracing::timestamp();
+
     m_mutex.lock();
     m_isRunning = true;
     m_mutex.unlock();
 
     resetCancellation(m_wasCanceled);
 
-    QThreadPool::globalInstance()->start(this, prefetch ? 0 : 1);
+    RenderScheduler::instance()->schedule(this, priority, group);
+}
+
+void RenderTask::reprioritize(RenderScheduler::Priority priority)
+{
+    RenderScheduler::instance()->reschedule(this, priority);
 }
 
 void RenderTask::cancel(bool force)
 {
     setCancellation(m_wasCanceled, force);
+
+    // Tasks which are still queued are dropped instead of being picked up by a worker only to bail out.
+
+    if(testCancellation(m_wasCanceled, m_prefetch) && RenderScheduler::instance()->unschedule(this))
+    {
+        RenderStatistics::recordCancellation(m_group);
+
+        finish();
+    }
 }
 
 void RenderTask::finish()
@@ -23,12 +23,13 @@ along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
 #define RENDERTASK_H
 
 #include <QColor>
+#include <QElapsedTimer>
 #include <QImage>
 #include <QMutex>
-#include <QRunnable>
 #include <QWaitCondition>
 
 #include "global.h"
+#include "renderscheduler.h"
 
 namespace qpdfview
 {
@@ -38,10 +39,14 @@ namespace Model
 class Page;
 }
 
-class RenderTask : public QObject, QRunnable
+class DiskCache;
+
+class RenderTask : public QObject
 {
     Q_OBJECT
 
+    friend class RenderScheduler;
+
 public:
     explicit RenderTask(Model::Page* page, QObject* parent = 0);
 
@@ -49,15 +54,37 @@ public:
 
     bool isRunning() const;
 
+    // The task must not be running when its page is replaced.
+    void setPage(Model::Page* page);
+
+    // Embedded thumbnails ignore the changes made since the document was loaded as well as the render settings of the plug-ins,
+    // so they always stand in for previews but only replace final renderings if this is enabled, e.g. for the thumbnails.
+    inline void setEmbeddedThumbnails(bool embeddedThumbnails) { m_embeddedThumbnails = embeddedThumbnails; }
+
     bool wasCanceled() const;
     bool wasCanceledNormally() const;
     bool wasCanceledForcibly() const;
 
+    // duration of the last render in milliseconds or negative if it was loaded from the disk cache
+    int renderDuration() const;
+
     void run();
 
+    static inline qreal previewScaleFactor() { return 0.25; }
+
+    // Converts an image rendered using the former colour settings into one using the latter, which fails only if the colours were already converted to grayscale.
+
+    static bool convertColors(QImage& image,
+                              bool convertedToGrayscale, bool invertedColors,
+                              bool convertToGrayscale, bool invertColors);
+
 signals:
     void finished();
 
+    void previewReady(const RenderParam& renderParam,
+                      const QRect& rect,
+                      QImage image);
+
     void imageReady(const RenderParam& renderParam,
                     const QRect& rect, bool prefetch,
                     QImage image, QRectF cropRect);
@@ -65,7 +92,11 @@ signals:
 public slots:
     void start(const RenderParam& renderParam,
                const QRect& rect, bool prefetch,
-               bool trimMargins, const QColor& paperColor);
+               bool trimMargins, const QColor& paperColor,
+               RenderScheduler::Priority priority, const QObject* group,
+               bool previewFirst = false, DiskCache* diskCache = 0, const QByteArray& diskCacheKey = QByteArray());
+
+    void reprioritize(RenderScheduler::Priority priority);
 
     void cancel(bool force = false);
 
@@ -78,6 +109,8 @@ private:
     bool m_isRunning;
     QAtomicInt m_wasCanceled;
 
+    int m_renderDuration;
+
     void finish();
 
 
@@ -87,10 +120,19 @@ private:
 
     QRect m_rect;
     bool m_prefetch;
+    bool m_previewFirst;
+    bool m_embeddedThumbnails;
+
+    DiskCache* m_diskCache;
+    QByteArray m_diskCacheKey;
 
     bool m_trimMargins;
     QColor m_paperColor;
 
+    const QObject* m_group;
+    QElapsedTimer m_queueTimer;
+    qint64 m_queueTimestamp;
+
 };
 
 } // qpdfview
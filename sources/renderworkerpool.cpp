@@ -0,0 +1,841 @@
+/*
+
+Copyright 2014 Adam Reichold
+
+This file is part of qpdfview.
+
+qpdfview is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+qpdfview is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "renderworkerpool.h"
+
+#include <climits>
+#include <cstring>
+
+#include <QCache>
+#include <QColor>
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <qmath.h>
+#include <QProcess>
+#include <QSharedMemory>
+#include <QtEndian>
+
+#if defined(Q_OS_UNIX)
+
+#include <unistd.h>
+
+#elif defined(Q_OS_WIN)
+
+#include <fcntl.h>
+#include <io.h>
+
+#endif // Q_OS_UNIX
+
+#include "model.h"
+#include "pluginhandler.h"
+
+namespace
+{
+
+using namespace qpdfview;
+
+// size in bytes of the control block in front of the pixels in the shared memory
+const int sharedHeaderSize = 64;
+
+// granularity in bytes in which the shared memory grows
+const int sharedMemoryGranularity = 1024 * 1024;
+
+// milliseconds waited for a worker process to start
+const int startTimeout = 5000;
+
+// milliseconds between checks for cancellation while waiting for a worker
+const int pollInterval = 50;
+
+// milliseconds after which a worker which did not reply is considered hung
+const int renderTimeout = 60 * 1000;
+
+// milliseconds waited for a worker process to exit
+const int stopTimeout = 1000;
+
+// maximum number of documents kept open by a worker process
+const int maxWorkerDocuments = 4;
+
+// maximum number of pages kept per document by a worker process
+const int maxWorkerPages = 16;
+
+enum Status
+{
+    RenderOk = 0,
+    RenderNull = 1,
+    RenderTooSmall = 2,
+    RenderUnsupported = 3,
+    // never sent by a worker, but set if it exited while rendering
+    RenderCrashed = 4,
+    // never sent by a worker, but set if it did not reply in time
+    RenderTimedOut = 5
+};
+
+struct Request
+{
+    QString filePath;
+    QDateTime lastModified;
+    QColor paperColor;
+    int index;
+
+    qreal horizontalResolution;
+    qreal verticalResolution;
+    int rotation;
+    QRect boundingRect;
+
+    QString sharedMemoryKey;
+
+    Request() : filePath(), lastModified(), paperColor(), index(-1), horizontalResolution(72.0), verticalResolution(72.0), rotation(RotateBy0), boundingRect(), sharedMemoryKey() {}
+
+};
+
+QDataStream& operator<<(QDataStream& stream, const Request& request)
+{
+    return stream << request.filePath << request.lastModified << request.paperColor << request.index
+                  << request.horizontalResolution << request.verticalResolution << request.rotation << request.boundingRect
+                  << request.sharedMemoryKey;
+}
+
+QDataStream& operator>>(QDataStream& stream, Request& request)
+{
+    return stream >> request.filePath >> request.lastModified >> request.paperColor >> request.index
+                  >> request.horizontalResolution >> request.verticalResolution >> request.rotation >> request.boundingRect
+                  >> request.sharedMemoryKey;
+}
+
+struct Reply
+{
+    int status;
+
+    int format;
+    int width;
+    int height;
+    int bytesPerLine;
+
+    int requiredSize;
+
+    Reply() : status(RenderUnsupported), format(QImage::Format_Invalid), width(0), height(0), bytesPerLine(0), requiredSize(0) {}
+
+};
+
+QDataStream& operator<<(QDataStream& stream, const Reply& reply)
+{
+    return stream << reply.status << reply.format << reply.width << reply.height << reply.bytesPerLine << reply.requiredSize;
+}
+
+QDataStream& operator>>(QDataStream& stream, Reply& reply)
+{
+    return stream >> reply.status >> reply.format >> reply.width >> reply.height >> reply.bytesPerLine >> reply.requiredSize;
+}
+
+QAtomicInt sharedMemoryId;
+
+// The client asks its worker to cancel by setting this flag in front of the pixels.
+
+inline QAtomicInt* canceledFlag(void* data)
+{
+    return static_cast< QAtomicInt* >(data);
+}
+
+// Messages are prefixed by their length so that a partial message is never parsed.
+
+template< typename T > QByteArray frame(const T& value)
+{
+    QByteArray payload;
+    QDataStream(&payload, QIODevice::WriteOnly) << value;
+
+    QByteArray message;
+    message.resize(sizeof(quint32));
+
+    qToBigEndian< quint32 >(payload.size(), reinterpret_cast< uchar* >(message.data()));
+
+    return message + payload;
+}
+
+bool readFully(QFile& file, char* data, qint64 size)
+{
+    while(size > 0)
+    {
+        const qint64 read = file.read(data, size);
+
+        if(read <= 0)
+        {
+            return false;
+        }
+
+        data += read;
+        size -= read;
+    }
+
+    return true;
+}
+
+bool readMessage(QFile& file, QByteArray& payload)
+{
+    uchar length[sizeof(quint32)];
+
+    if(!readFully(file, reinterpret_cast< char* >(length), sizeof(quint32)))
+    {
+        return false;
+    }
+
+    payload.resize(qFromBigEndian< quint32 >(length));
+
+    return readFully(file, payload.data(), payload.size());
+}
+
+class SharedCancellation : public Model::CancellationToken
+{
+public:
+    explicit SharedCancellation(void* data) :
+        m_canceled(canceledFlag(data))
+    {
+    }
+
+    bool wasCanceled() const
+    {
+        return m_canceled->fetchAndAddOrdered(0) != 0;
+    }
+
+private:
+    Q_DISABLE_COPY(SharedCancellation)
+
+    QAtomicInt* m_canceled;
+
+};
+
+// Back-ends which take an allocator render straight into the shared memory, so their pixels are not copied within the worker.
+
+class SharedAllocator : public Model::ImageAllocator
+{
+public:
+    SharedAllocator(uchar* data, int size) :
+        m_data(data),
+        m_size(size)
+    {
+    }
+
+    QImage allocate(int width, int height)
+    {
+        if(width > 0 && height > 0 && 4 * static_cast< qint64 >(width) * height <= m_size)
+        {
+            return QImage(m_data, width, height, 4 * width, QImage::Format_RGB32);
+        }
+
+        return QImage(width, height, QImage::Format_RGB32);
+    }
+
+private:
+    Q_DISABLE_COPY(SharedAllocator)
+
+    uchar* m_data;
+    int m_size;
+
+};
+
+struct WorkerDocument
+{
+    QString filePath;
+    QDateTime lastModified;
+    QColor paperColor;
+
+    Model::Document* document;
+    QCache< int, Model::Page >* pages;
+
+};
+
+void closeDocument(QList< WorkerDocument >& documents, int position)
+{
+    const WorkerDocument document = documents.takeAt(position);
+
+    delete document.pages;
+    delete document.document;
+}
+
+Model::Page* workerPage(QList< WorkerDocument >& documents, const Request& request)
+{
+    int position = -1;
+
+    for(int index = 0; index < documents.count(); ++index)
+    {
+        if(documents.at(index).filePath == request.filePath)
+        {
+            position = index;
+            break;
+        }
+    }
+
+    if(position != -1 && documents.at(position).lastModified != request.lastModified)
+    {
+        closeDocument(documents, position);
+
+        position = -1;
+    }
+
+    if(position != -1)
+    {
+        documents.move(position, documents.count() - 1);
+    }
+    else
+    {
+        // The view renders the file as it was when it was loaded, which the worker cannot do once it was changed.
+
+        if(QFileInfo(request.filePath).lastModified() != request.lastModified)
+        {
+            return 0;
+        }
+
+        Model::Document* document = PluginHandler::instance()->loadDocument(request.filePath);
+
+        if(document == 0)
+        {
+            return 0;
+        }
+
+        // Locked documents stay with the view which knows the password.
+
+        if(document->isLocked())
+        {
+            delete document;
+
+            return 0;
+        }
+
+        if(documents.count() >= maxWorkerDocuments)
+        {
+            closeDocument(documents, 0);
+        }
+
+        WorkerDocument entry;
+        entry.filePath = request.filePath;
+        entry.lastModified = request.lastModified;
+        entry.document = document;
+        entry.pages = new QCache< int, Model::Page >(maxWorkerPages);
+
+        documents.append(entry);
+    }
+
+    WorkerDocument& entry = documents.last();
+
+    if(request.paperColor.isValid() && entry.paperColor != request.paperColor)
+    {
+        entry.document->setPaperColor(request.paperColor);
+        entry.paperColor = request.paperColor;
+    }
+
+    if(request.index < 0 || request.index >= entry.document->numberOfPages())
+    {
+        return 0;
+    }
+
+    Model::Page* page = entry.pages->object(request.index);
+
+    if(page == 0)
+    {
+        page = entry.document->page(request.index);
+
+        if(page == 0)
+        {
+            return 0;
+        }
+
+        entry.pages->insert(request.index, page);
+    }
+
+    return page;
+}
+
+Reply serveRequest(QList< WorkerDocument >& documents, QSharedMemory& sharedMemory, const Request& request)
+{
+    Reply reply;
+
+    if(sharedMemory.key() != request.sharedMemoryKey)
+    {
+        sharedMemory.detach();
+        sharedMemory.setKey(request.sharedMemoryKey);
+
+        if(!sharedMemory.attach())
+        {
+            return reply;
+        }
+    }
+
+    Model::Page* page = workerPage(documents, request);
+
+    if(page == 0)
+    {
+        return reply;
+    }
+
+    uchar* data = static_cast< uchar* >(sharedMemory.data());
+    uchar* pixels = data + sharedHeaderSize;
+    const int capacity = sharedMemory.size() - sharedHeaderSize;
+
+    SharedCancellation cancellation(data);
+    SharedAllocator allocator(pixels, capacity);
+
+    QImage image = page->render(request.horizontalResolution, request.verticalResolution, static_cast< Rotation >(request.rotation), request.boundingRect, &cancellation, &allocator);
+
+    if(image.isNull())
+    {
+        reply.status = RenderNull;
+
+        return reply;
+    }
+
+    // Indexed images would need their color table, so only the formats of the render tasks are transferred.
+
+    if(image.format() != QImage::Format_RGB32 && image.format() != QImage::Format_ARGB32 && image.format() != QImage::Format_ARGB32_Premultiplied)
+    {
+        image = image.convertToFormat(QImage::Format_RGB32);
+    }
+
+    reply.format = image.format();
+    reply.width = image.width();
+    reply.height = image.height();
+    reply.bytesPerLine = image.bytesPerLine();
+
+    const qint64 imageSize = static_cast< qint64 >(image.bytesPerLine()) * image.height();
+
+    if(imageSize > capacity)
+    {
+        reply.status = RenderTooSmall;
+        reply.requiredSize = static_cast< int >(qMin(sharedHeaderSize + imageSize, static_cast< qint64 >(INT_MAX)));
+
+        return reply;
+    }
+
+    if(image.constBits() != pixels)
+    {
+        memcpy(pixels, image.constBits(), imageSize);
+    }
+
+    reply.status = RenderOk;
+
+    return reply;
+}
+
+} // anonymous
+
+namespace qpdfview
+{
+
+class RenderWorkerPool::Worker
+{
+public:
+    Worker() :
+        m_process(),
+        m_sharedMemory()
+    {
+    }
+
+    ~Worker()
+    {
+        stop();
+    }
+
+    int render(Request& request, int expectedSize, const Model::CancellationToken* cancellation, Model::ImageAllocator* allocator, QImage& image);
+
+private:
+    Q_DISABLE_COPY(Worker)
+
+    QProcess m_process;
+    QSharedMemory m_sharedMemory;
+
+    bool start();
+    void stop();
+    void kill();
+
+    bool reserve(int size);
+
+    bool receive(const Model::CancellationToken* cancellation, Reply& reply);
+
+};
+
+int RenderWorkerPool::Worker::render(Request& request, int expectedSize, const Model::CancellationToken* cancellation, Model::ImageAllocator* allocator, QImage& image)
+{
+    if(!start() || !reserve(expectedSize))
+    {
+        return RenderUnsupported;
+    }
+
+    // The expected size is only an estimate, so the request is repeated once with the size the worker asked for.
+
+    for(int attempt = 0; attempt < 2; ++attempt)
+    {
+        request.sharedMemoryKey = m_sharedMemory.key();
+
+        canceledFlag(m_sharedMemory.data())->fetchAndStoreOrdered(0);
+
+        const QByteArray message = frame(request);
+
+        Reply reply;
+
+        if(m_process.write(message) != message.size() || !receive(cancellation, reply))
+        {
+            // A slow page is not necessarily a broken one, so only a worker which exited by itself counts as crashed.
+
+            const bool exited = m_process.state() != QProcess::Running;
+
+            kill();
+
+            return exited ? RenderCrashed : RenderTimedOut;
+        }
+
+        if(reply.status == RenderTooSmall)
+        {
+            if(!reserve(reply.requiredSize))
+            {
+                return RenderUnsupported;
+            }
+
+            continue;
+        }
+
+        if(reply.status == RenderOk)
+        {
+            const QImage::Format format = static_cast< QImage::Format >(reply.format);
+            const uchar* pixels = static_cast< const uchar* >(m_sharedMemory.constData()) + sharedHeaderSize;
+
+            image = allocator != 0 && format == QImage::Format_RGB32 ? allocator->allocate(reply.width, reply.height) : QImage(reply.width, reply.height, format);
+
+            const int bytesPerLine = qMin(reply.bytesPerLine, image.bytesPerLine());
+
+            for(int y = 0; y < reply.height; ++y)
+            {
+                memcpy(image.scanLine(y), pixels + y * reply.bytesPerLine, bytesPerLine);
+            }
+        }
+
+        return reply.status;
+    }
+
+    return RenderUnsupported;
+}
+
+bool RenderWorkerPool::Worker::start()
+{
+    if(m_process.state() == QProcess::Running)
+    {
+        return true;
+    }
+
+#if QT_VERSION >= QT_VERSION_CHECK(5,2,0)
+
+    m_process.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+
+#endif // QT_VERSION
+
+    m_process.start(QCoreApplication::applicationFilePath(), QStringList() << QLatin1String("--render-worker"));
+
+    return m_process.waitForStarted(startTimeout);
+}
+
+void RenderWorkerPool::Worker::stop()
+{
+    if(m_process.state() == QProcess::NotRunning)
+    {
+        return;
+    }
+
+    // Closing its input makes the worker leave its main loop.
+
+    m_process.closeWriteChannel();
+
+    if(!m_process.waitForFinished(stopTimeout))
+    {
+        kill();
+    }
+}
+
+void RenderWorkerPool::Worker::kill()
+{
+    m_process.kill();
+    m_process.waitForFinished(stopTimeout);
+}
+
+bool RenderWorkerPool::Worker::reserve(int size)
+{
+    if(m_sharedMemory.isAttached() && m_sharedMemory.size() >= size)
+    {
+        return true;
+    }
+
+    // A segment cannot grow, so a larger one is created under a new key which the worker attaches to with the next request.
+
+    m_sharedMemory.detach();
+    m_sharedMemory.setKey(QString("qpdfview-render-%1-%2").arg(QCoreApplication::applicationPid()).arg(sharedMemoryId.fetchAndAddOrdered(1)));
+
+    const int roundedSize = (qMax(size, sharedHeaderSize) + sharedMemoryGranularity - 1) / sharedMemoryGranularity * sharedMemoryGranularity;
+
+    return m_sharedMemory.create(roundedSize);
+}
+
+bool RenderWorkerPool::Worker::receive(const Model::CancellationToken* cancellation, Reply& reply)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    bool wasCanceled = false;
+
+    qint64 length = -1;
+
+    while(true)
+    {
+        if(length < 0 && m_process.bytesAvailable() >= static_cast< qint64 >(sizeof(quint32)))
+        {
+            uchar buffer[sizeof(quint32)];
+            m_process.read(reinterpret_cast< char* >(buffer), sizeof(quint32));
+
+            length = qFromBigEndian< quint32 >(buffer);
+        }
+
+        if(length >= 0 && m_process.bytesAvailable() >= length)
+        {
+            const QByteArray payload = m_process.read(length);
+
+            QDataStream stream(payload);
+            stream >> reply;
+
+            return stream.status() == QDataStream::Ok;
+        }
+
+        if(m_process.state() != QProcess::Running || timer.elapsed() > renderTimeout)
+        {
+            return false;
+        }
+
+        if(!wasCanceled && cancellation != 0 && cancellation->wasCanceled())
+        {
+            canceledFlag(m_sharedMemory.data())->fetchAndStoreOrdered(1);
+
+            wasCanceled = true;
+        }
+
+        m_process.waitForReadyRead(pollInterval);
+    }
+}
+
+RenderWorkerPool* RenderWorkerPool::s_instance = 0;
+
+RenderWorkerPool* RenderWorkerPool::instance()
+{
+    if(s_instance == 0)
+    {
+        s_instance = new RenderWorkerPool();
+    }
+
+    return s_instance;
+}
+
+RenderWorkerPool::~RenderWorkerPool()
+{
+    s_instance = 0;
+}
+
+bool RenderWorkerPool::isEnabled() const
+{
+    return m_enabled.fetchAndAddOrdered(0) != 0;
+}
+
+void RenderWorkerPool::setEnabled(bool enabled)
+{
+    m_enabled.fetchAndStoreOrdered(enabled ? 1 : 0);
+}
+
+bool RenderWorkerPool::render(const QString& filePath, const QDateTime& lastModified, const QColor& paperColor, int index, const QSizeF& size,
+                              qreal horizontalResolution, qreal verticalResolution, Rotation rotation, const QRect& boundingRect,
+                              const Model::CancellationToken* cancellation, Model::ImageAllocator* allocator, QImage& image)
+{
+    if(!isEnabled())
+    {
+        return false;
+    }
+
+    const QString fileKey = filePath + QLatin1Char('\n') + QString::number(lastModified.toMSecsSinceEpoch());
+
+    {
+        QMutexLocker mutexLocker(&m_mutex);
+
+        if(m_unsupportedFiles.contains(fileKey))
+        {
+            return false;
+        }
+
+        // Rendering the same page again would only crash the next worker as well.
+
+        if(m_failedPages.contains(qMakePair(fileKey, index)))
+        {
+            image = QImage();
+
+            return true;
+        }
+    }
+
+    const bool swapped = rotation == RotateBy90 || rotation == RotateBy270;
+
+    const qreal width = swapped ? size.height() : size.width();
+    const qreal height = swapped ? size.width() : size.height();
+
+    const qint64 expectedSize = boundingRect.isValid()
+            ? 4 * static_cast< qint64 >(boundingRect.width()) * boundingRect.height()
+            : 4 * static_cast< qint64 >(qCeil(width * horizontalResolution / 72.0) + 1) * (qCeil(height * verticalResolution / 72.0) + 1);
+
+    if(sharedHeaderSize + expectedSize > INT_MAX)
+    {
+        return false;
+    }
+
+    if(!m_workers.hasLocalData())
+    {
+        m_workers.setLocalData(new Worker());
+    }
+
+    Request request;
+    request.filePath = filePath;
+    request.lastModified = lastModified;
+    request.paperColor = paperColor;
+    request.index = index;
+    request.horizontalResolution = horizontalResolution;
+    request.verticalResolution = verticalResolution;
+    request.rotation = rotation;
+    request.boundingRect = boundingRect;
+
+    const int status = m_workers.localData()->render(request, sharedHeaderSize + static_cast< int >(expectedSize), cancellation, allocator, image);
+
+    if(status == RenderOk)
+    {
+        return true;
+    }
+    else if(status == RenderNull)
+    {
+        image = QImage();
+
+        return true;
+    }
+    else if(status == RenderCrashed)
+    {
+        qWarning() << "Rendering page" << index + 1 << "of" << filePath << "crashed its worker process.";
+
+        QMutexLocker mutexLocker(&m_mutex);
+
+        m_failedPages.insert(qMakePair(fileKey, index));
+
+        image = QImage();
+
+        return true;
+    }
+    else if(status == RenderTimedOut)
+    {
+        qWarning() << "Rendering page" << index + 1 << "of" << filePath << "timed out in its worker process and is rendered in-process instead.";
+
+        return false;
+    }
+
+    QMutexLocker mutexLocker(&m_mutex);
+
+    m_unsupportedFiles.insert(fileKey);
+
+    return false;
+}
+
+int RenderWorkerPool::serve()
+{
+#if defined(Q_OS_UNIX)
+
+    // Back-ends printing diagnostics must not corrupt the replies, so these use a duplicate of the standard output which itself is redirected to the standard error.
+
+    const int outputDescriptor = dup(STDOUT_FILENO);
+    dup2(STDERR_FILENO, STDOUT_FILENO);
+
+    const int inputDescriptor = STDIN_FILENO;
+
+#elif defined(Q_OS_WIN)
+
+    _setmode(_fileno(stdin), _O_BINARY);
+    _setmode(_fileno(stdout), _O_BINARY);
+
+    const int outputDescriptor = _fileno(stdout);
+    const int inputDescriptor = _fileno(stdin);
+
+#else
+
+    const int outputDescriptor = fileno(stdout);
+    const int inputDescriptor = fileno(stdin);
+
+#endif // Q_OS_UNIX
+
+    QFile input;
+    QFile output;
+
+    if(!input.open(inputDescriptor, QIODevice::ReadOnly | QIODevice::Unbuffered) || !output.open(outputDescriptor, QIODevice::WriteOnly | QIODevice::Unbuffered))
+    {
+        return 1;
+    }
+
+    QList< WorkerDocument > documents;
+    QSharedMemory sharedMemory;
+
+    QByteArray payload;
+
+    while(readMessage(input, payload))
+    {
+        Request request;
+
+        QDataStream stream(payload);
+        stream >> request;
+
+        if(stream.status() != QDataStream::Ok)
+        {
+            break;
+        }
+
+        const QByteArray message = frame(serveRequest(documents, sharedMemory, request));
+
+        if(output.write(message) != message.size())
+        {
+            break;
+        }
+    }
+
+    while(!documents.isEmpty())
+    {
+        closeDocument(documents, 0);
+    }
+
+    return 0;
+}
+
+RenderWorkerPool::RenderWorkerPool() :
+    m_enabled(0),
+    m_workers(),
+    m_mutex(),
+    m_unsupportedFiles(),
+    m_failedPages()
+{
+}
+
+} // qpdfview
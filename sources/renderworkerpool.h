@@ -0,0 +1,90 @@
+/*
+
+Copyright 2014 Adam Reichold
+
+This file is part of qpdfview.
+
+qpdfview is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+qpdfview is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef RENDERWORKERPOOL_H
+#define RENDERWORKERPOOL_H
+
+#include <QAtomicInt>
+#include <QMutex>
+#include <QPair>
+#include <QSet>
+#include <QThreadStorage>
+
+#include "global.h"
+
+class QColor;
+class QDateTime;
+class QImage;
+class QRect;
+class QSizeF;
+
+namespace qpdfview
+{
+
+namespace Model
+{
+class CancellationToken;
+class ImageAllocator;
+}
+
+// Renders pages in helper processes with their own back-end instances, one per render thread, so that a broken file cannot crash the application and no document-wide lock is shared between the threads.
+
+class RenderWorkerPool
+{
+public:
+    static RenderWorkerPool* instance();
+    ~RenderWorkerPool();
+
+    bool isEnabled() const;
+    void setEnabled(bool enabled);
+
+    // Yields false if the page has to be rendered in this process, e.g. because the document is locked or the file changed, or because it timed out in its worker, whereas pages which crashed their worker yield a null image.
+
+    bool render(const QString& filePath, const QDateTime& lastModified, const QColor& paperColor, int index, const QSizeF& size,
+                qreal horizontalResolution, qreal verticalResolution, Rotation rotation, const QRect& boundingRect,
+                const Model::CancellationToken* cancellation, Model::ImageAllocator* allocator, QImage& image);
+
+    // The main loop of a worker process, which serves the requests read from the standard input until it is closed.
+
+    static int serve();
+
+private:
+    Q_DISABLE_COPY(RenderWorkerPool)
+
+    static RenderWorkerPool* s_instance;
+    RenderWorkerPool();
+
+    class Worker;
+
+    mutable QAtomicInt m_enabled;
+
+    QThreadStorage< Worker* > m_workers;
+
+    QMutex m_mutex;
+
+    QSet< QString > m_unsupportedFiles;
+    QSet< QPair< QString, int > > m_failedPages;
+
+};
+
+} // qpdfview
+
+#endif // RENDERWORKERPOOL_H
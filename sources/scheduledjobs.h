@@ -0,0 +1,159 @@
+/*
+
+Copyright 2014 Adam Reichold
+
+This file is part of qpdfview.
+
+qpdfview is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+qpdfview is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef SCHEDULEDJOBS_H
+#define SCHEDULEDJOBS_H
+
+#include <QAtomicInt>
+#include <QFuture>
+#include <QFutureInterface>
+#include <QRunnable>
+#include <QSharedPointer>
+
+#include "renderscheduler.h"
+
+namespace qpdfview
+{
+
+// These replace QtConcurrent::run and QtConcurrent::mapped for work which should share the thread budget of the render scheduler.
+
+template< typename Result, typename Function, typename Argument >
+class ScheduledRun : public QFutureInterface< Result >, public QRunnable
+{
+public:
+    ScheduledRun(Function function, const Argument& argument) : QFutureInterface< Result >(), QRunnable(),
+        m_function(function),
+        m_argument(argument)
+    {
+        setAutoDelete(true);
+    }
+
+    QFuture< Result > start(RenderScheduler::Priority priority, const QObject* group)
+    {
+        this->reportStarted();
+
+        const QFuture< Result > future = this->future();
+
+        RenderScheduler::instance()->start(this, priority, group);
+
+        return future;
+    }
+
+    void run()
+    {
+        if(!this->isCanceled())
+        {
+            const Result result = m_function(m_argument);
+
+            this->reportResult(result);
+        }
+
+        this->reportFinished();
+    }
+
+private:
+    Q_DISABLE_COPY(ScheduledRun)
+
+    Function m_function;
+    Argument m_argument;
+
+};
+
+template< typename Result, typename Function, typename Argument >
+class ScheduledMapItem : public QRunnable
+{
+public:
+    ScheduledMapItem(const QFutureInterface< Result >& futureInterface, QSharedPointer< QAtomicInt > remaining,
+                     Function function, const Argument& argument, int index) : QRunnable(),
+        m_futureInterface(futureInterface),
+        m_remaining(remaining),
+        m_function(function),
+        m_argument(argument),
+        m_index(index)
+    {
+        setAutoDelete(true);
+    }
+
+    void run()
+    {
+        if(!m_futureInterface.isCanceled())
+        {
+            const Result result = m_function(m_argument);
+
+            m_futureInterface.reportResult(result, m_index);
+        }
+
+        if(!m_remaining->deref())
+        {
+            m_futureInterface.reportFinished();
+        }
+    }
+
+private:
+    Q_DISABLE_COPY(ScheduledMapItem)
+
+    QFutureInterface< Result > m_futureInterface;
+    QSharedPointer< QAtomicInt > m_remaining;
+
+    Function m_function;
+    Argument m_argument;
+    int m_index;
+
+};
+
+template< typename Result, typename Function, typename Argument >
+inline QFuture< Result > scheduleRun(Function function, const Argument& argument, RenderScheduler::Priority priority, const QObject* group)
+{
+    return (new ScheduledRun< Result, Function, Argument >(function, argument))->start(priority, group);
+}
+
+// Every item is scheduled separately and its result is reported at its index, like QtConcurrent::mapped does.
+
+template< typename Result, typename Sequence, typename Function >
+QFuture< Result > scheduleMapped(const Sequence& sequence, Function function, RenderScheduler::Priority priority, const QObject* group)
+{
+    typedef typename Sequence::value_type Argument;
+
+    QFutureInterface< Result > futureInterface;
+    futureInterface.reportStarted();
+
+    const QFuture< Result > future = futureInterface.future();
+
+    if(sequence.isEmpty())
+    {
+        futureInterface.reportFinished();
+
+        return future;
+    }
+
+    QSharedPointer< QAtomicInt > remaining(new QAtomicInt(sequence.count()));
+
+    for(int index = 0; index < sequence.count(); ++index)
+    {
+        RenderScheduler::instance()->start(new ScheduledMapItem< Result, Function, Argument >(futureInterface, remaining, function, sequence.at(index), index), priority, group);
+    }
+
+    return future;
+}
+
+} // qpdfview
+
+#endif // SCHEDULEDJOBS_H
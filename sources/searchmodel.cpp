@@ -23,19 +23,21 @@ along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
 #include "searchmodel.h"
 
 #include <QApplication>
-#include <QtConcurrentRun>
+#include <QRegExp>
 
 #include "documentview.h"
+#include "scheduledjobs.h"
 
 namespace
 {
 
-using namespace qpdfview;
+// rows whose surrounding text is prefetched after the requested one
+const int prefetchRows = 50;
 
-inline bool operator<(int page, const QPair< int, QRectF >& result) { return page < result.first; }
-inline bool operator<(const QPair< int, QRectF >& result, int page) { return result.first < page; }
+// pages whose surrounding text is fetched at the same time
+const int maximumTextJobs = 20;
 
-}
+} // anonymous
 
 namespace qpdfview
 {
@@ -165,7 +167,7 @@ QVariant SearchModel::data(const QModelIndex& index, int role) const
             return QVariant();
         }
 
-        const Result& result = results->at(index.row());
+        const Result result = results->at(index.row());
 
         switch(role)
         {
@@ -179,8 +181,10 @@ QVariant SearchModel::data(const QModelIndex& index, int role) const
             return view->searchText();
         case MatchCaseRole:
             return view->searchMatchCase();
+        case PatternRole:
+            return view->searchPattern();
         case SurroundingTextRole:
-            return fetchSurroundingText(view, result);
+            return fetchSurroundingText(view, index.row());
         case Qt::ToolTipRole:
             return tr("<b>%1</b> occurrences on page <b>%2</b>").arg(numberOfResultsOnPage(view, result.first)).arg(result.first);
         }
@@ -208,26 +212,58 @@ bool SearchModel::hasResults(DocumentView* view) const
     return results != 0 && !results->isEmpty();
 }
 
-bool SearchModel::hasResultsOnPage(DocumentView* view, int page) const
+int SearchModel::numberOfResults(DocumentView* view) const
 {
     const Results* results = m_results.value(view, 0);
 
-    return results != 0 && qBinaryFind(results->begin(), results->end(), page) != results->end();
+    return results != 0 ? results->count() : 0;
 }
 
-int SearchModel::numberOfResultsOnPage(DocumentView* view, int page) const
+qint64 SearchModel::resultsCost(DocumentView* view) const
 {
     const Results* results = m_results.value(view, 0);
 
-    if(results == 0)
+    return results != 0 ? results->cost() : 0;
+}
+
+qint64 SearchModel::surroundingTextCost(DocumentView* view) const
+{
+    qint64 cost = 0;
+
+    foreach(const TextCacheKey& key, m_textCache.keys())
     {
-        return 0;
+        if(key.view == view)
+        {
+            cost += m_textCache.object(key)->length() * sizeof(QChar);
+        }
     }
 
-    const Results::const_iterator pageBegin = qLowerBound(results->constBegin(), results->constEnd(), page);
-    const Results::const_iterator pageEnd = qUpperBound(pageBegin, results->constEnd(), page);
+    return cost;
+}
 
-    return pageEnd - pageBegin;
+void SearchModel::releaseSurroundingText(DocumentView* view)
+{
+    foreach(const TextCacheKey& key, m_textCache.keys())
+    {
+        if(key.view == view)
+        {
+            m_textCache.remove(key);
+        }
+    }
+}
+
+bool SearchModel::hasResultsOnPage(DocumentView* view, int page) const
+{
+    const Results* results = m_results.value(view, 0);
+
+    return results != 0 && results->countOnPage(page) > 0;
+}
+
+int SearchModel::numberOfResultsOnPage(DocumentView* view, int page) const
+{
+    const Results* results = m_results.value(view, 0);
+
+    return results != 0 ? results->countOnPage(page) : 0;
 }
 
 QList< QRectF > SearchModel::resultsOnPage(DocumentView* view, int page) const
@@ -238,12 +274,11 @@ QList< QRectF > SearchModel::resultsOnPage(DocumentView* view, int page) const
 
     if(results != 0)
     {
-        const Results::const_iterator pageBegin = qLowerBound(results->constBegin(), results->constEnd(), page);
-        const Results::const_iterator pageEnd = qUpperBound(pageBegin, results->constEnd(), page);
+        const int end = results->endOfPage(page);
 
-        for(Results::const_iterator iterator = pageBegin; iterator != pageEnd; ++iterator)
+        for(int row = results->beginOfPage(page); row < end; ++row)
         {
-            resultsOnPage.append(iterator->second);
+            resultsOnPage.append(results->rect(row));
         }
     }
 
@@ -281,25 +316,24 @@ QPersistentModelIndex SearchModel::findResult(DocumentView* view, const QPersist
         {
         default:
         case FindNext:
-        {
-            Results::const_iterator lowerBound = qLowerBound(results->constBegin(), results->constEnd(), currentPage);
-
-            row = (lowerBound - results->constBegin()) % rows;
+            row = results->beginOfPage(currentPage) % rows;
             break;
-        }
         case FindPrevious:
-        {
-            Results::const_iterator upperBound = qUpperBound(results->constBegin(), results->constEnd(), currentPage);
-
-            row = ((upperBound - results->constBegin()) + rows - 1) % rows;
+            row = (results->endOfPage(currentPage) + rows - 1) % rows;
             break;
         }
-        }
     }
 
     return createIndex(row, 0, view);
 }
 
+QList< int > SearchModel::pagesWithResults(DocumentView* view) const
+{
+    const Results* results = m_results.value(view, 0);
+
+    return results != 0 ? results->pages() : QList< int >();
+}
+
 void SearchModel::insertResults(DocumentView* view, int page, const QList< QRectF >& resultsOnPage)
 {
     if(resultsOnPage.isEmpty())
@@ -311,14 +345,52 @@ void SearchModel::insertResults(DocumentView* view, int page, const QList< QRect
 
     Results* results = m_results.value(view);
 
-    Results::iterator at = qLowerBound(results->begin(), results->end(), page);
-    const int row = at - results->begin();
+    const int row = results->endOfPage(page);
 
     beginInsertRows(parent, row, row + resultsOnPage.size() - 1);
 
-    for(int index = resultsOnPage.size() - 1; index >= 0; --index)
+    results->insert(page, resultsOnPage);
+
+    endInsertRows();
+}
+
+void SearchModel::insertResults(DocumentView* view, const QMap< int, QList< QRectF > >& resultsByPage)
+{
+    int count = 0;
+
+    for(QMap< int, QList< QRectF > >::const_iterator iterator = resultsByPage.constBegin(); iterator != resultsByPage.constEnd(); ++iterator)
+    {
+        count += iterator.value().size();
+    }
+
+    if(count == 0)
+    {
+        return;
+    }
+
+    const QModelIndex parent = findOrInsertView(view);
+
+    Results* results = m_results.value(view);
+
+    const int row = results->beginOfPage(resultsByPage.constBegin().key());
+
+    // Unless the results of other pages lie in between, the whole batch is inserted as a single range of rows.
+
+    if(row != results->endOfPage((resultsByPage.constEnd() - 1).key()))
+    {
+        for(QMap< int, QList< QRectF > >::const_iterator iterator = resultsByPage.constBegin(); iterator != resultsByPage.constEnd(); ++iterator)
+        {
+            insertResults(view, iterator.key(), iterator.value());
+        }
+
+        return;
+    }
+
+    beginInsertRows(parent, row, row + count - 1);
+
+    for(QMap< int, QList< QRectF > >::const_iterator iterator = resultsByPage.constBegin(); iterator != resultsByPage.constEnd(); ++iterator)
     {
-        at = results->insert(at, qMakePair(page, resultsOnPage.at(index)));
+        results->insert(iterator.key(), iterator.value());
     }
 
     endInsertRows();
@@ -326,14 +398,21 @@ void SearchModel::insertResults(DocumentView* view, int page, const QList< QRect
 
 void SearchModel::clearResults(DocumentView* view)
 {
-    foreach(const TextCacheKey& key, m_textCache.keys())
+    // The jobs of the view have to finish before it can go away.
+
+    foreach(const TextCacheKey& key, m_textWatchers.keys())
     {
-        if(key.first == view)
+        if(key.view == view)
         {
-            m_textCache.remove(key);
+            TextWatcher* watcher = m_textWatchers.take(key);
+
+            watcher->waitForFinished();
+            delete watcher;
         }
     }
 
+    releaseSurroundingText(view);
+
     const QList< DocumentView* >::iterator at = qBinaryFind(m_views.begin(), m_views.end(), view);
     const int row = at - m_views.begin();
 
@@ -371,20 +450,115 @@ void SearchModel::on_fetchSurroundingText_finished()
 
     const TextJob job = watcher->result();
 
-    m_textWatchers.remove(job.key);
+    m_textWatchers.remove(TextCacheKey(job.view, job.page));
     delete watcher;
 
-    DocumentView* view = job.key.first;
-    const Results* results = m_results.value(view, 0);
+    const Results* results = m_results.value(job.view, 0);
 
     if(results == 0)
     {
         return;
     }
 
-    m_textCache.insert(job.key, job.object, job.object->length());
+    for(int index = 0; index < job.rects.count(); ++index)
+    {
+        const QString& text = job.texts.at(index);
+
+        m_textCache.insert(TextCacheKey(job.view, job.page, job.rects.at(index)), new QString(text), qMax(text.length(), 1));
+    }
+
+    const int begin = results->beginOfPage(job.page);
+    const int end = results->endOfPage(job.page);
+
+    if(begin < end)
+    {
+        emit dataChanged(createIndex(begin, 0, job.view), createIndex(end - 1, 0, job.view));
+    }
+}
+
+SearchModel::Results::Results() :
+    m_pages(),
+    m_rects(),
+    m_offsets()
+{
+}
+
+QRectF SearchModel::Results::rect(int row) const
+{
+    const float* rect = m_rects.constData() + 4 * row;
+
+    return QRectF(rect[0], rect[1], rect[2], rect[3]);
+}
+
+int SearchModel::Results::beginOfPage(int page) const
+{
+    if(m_offsets.isEmpty())
+    {
+        return 0;
+    }
+
+    return m_offsets.at(qBound(0, page, m_offsets.count() - 1));
+}
+
+int SearchModel::Results::endOfPage(int page) const
+{
+    return beginOfPage(page + 1);
+}
+
+QList< int > SearchModel::Results::pages() const
+{
+    QList< int > pages;
+
+    for(int page = 0; page < m_offsets.count() - 1; ++page)
+    {
+        if(m_offsets.at(page) < m_offsets.at(page + 1))
+        {
+            pages.append(page);
+        }
+    }
+
+    return pages;
+}
+
+void SearchModel::Results::insert(int page, const QList< QRectF >& rects)
+{
+    if(rects.isEmpty() || page < 0)
+    {
+        return;
+    }
+
+    if(m_offsets.count() < page + 2)
+    {
+        const int oldCount = m_offsets.count();
+
+        m_offsets.resize(page + 2);
+
+        for(int index = oldCount; index < m_offsets.count(); ++index)
+        {
+            m_offsets[index] = m_pages.count();
+        }
+    }
 
-    emit dataChanged(createIndex(0, 0, view), createIndex(results->count() - 1, 0, view));
+    const int row = m_offsets.at(page + 1);
+    const int count = rects.count();
+
+    m_pages.insert(row, count, page);
+    m_rects.insert(4 * row, 4 * count, 0.0f);
+
+    float* rect = m_rects.data() + 4 * row;
+
+    foreach(const QRectF& result, rects)
+    {
+        *rect++ = result.x();
+        *rect++ = result.y();
+        *rect++ = result.width();
+        *rect++ = result.height();
+    }
+
+    for(int index = page + 1; index < m_offsets.count(); ++index)
+    {
+        m_offsets[index] += count;
+    }
 }
 
 SearchModel::SearchModel(QObject* parent) : QAbstractItemModel(parent),
@@ -429,50 +603,88 @@ QModelIndex SearchModel::findOrInsertView(DocumentView* view)
     return createIndex(row, 0);
 }
 
-QString SearchModel::fetchSurroundingText(DocumentView* view, const Result& result) const
+QString SearchModel::fetchSurroundingText(DocumentView* view, int row) const
 {
-    if(view == 0)
+    const Results* results = m_results.value(view, 0);
+
+    if(results == 0 || row < 0 || row >= results->count())
     {
         return QString();
     }
 
-    const TextCacheKey key = textCacheKey(view, result);
-    const TextCacheObject* object = m_textCache.object(key);
+    const TextCacheObject* object = m_textCache.object(textCacheKey(view, results->at(row)));
 
     if(object != 0)
     {
         return *object;
     }
 
-    if(m_textWatchers.size() < 20 && !m_textWatchers.contains(key))
-    {
-        TextWatcher* watcher = new TextWatcher();
-        m_textWatchers.insert(key, watcher);
+    // The rows which follow are likely to be shown next.
+
+    const int lastRow = qMin(row + prefetchRows, results->count() - 1);
 
-        connect(watcher, SIGNAL(finished()), SLOT(on_fetchSurroundingText_finished()));
+    for(int page = results->page(row); page <= results->page(lastRow); page = results->page(results->endOfPage(page)))
+    {
+        startTextJob(view, results, page);
 
-        watcher->setFuture(QtConcurrent::run(textJob, key, result));
+        if(results->endOfPage(page) > lastRow)
+        {
+            break;
+        }
     }
 
     return QLatin1String("...");
 }
 
-inline SearchModel::TextCacheKey SearchModel::textCacheKey(DocumentView* view, const Result& result)
+void SearchModel::startTextJob(DocumentView* view, const Results* results, int page) const
 {
-    QByteArray key;
+    const TextCacheKey key(view, page);
+
+    if(m_textWatchers.size() >= maximumTextJobs || m_textWatchers.contains(key))
+    {
+        return;
+    }
+
+    QList< QRectF > rects;
+
+    const int end = results->endOfPage(page);
+
+    for(int row = results->beginOfPage(page); row < end; ++row)
+    {
+        const QRectF rect = results->rect(row);
+
+        if(!m_textCache.contains(TextCacheKey(view, page, rect)))
+        {
+            rects.append(rect);
+        }
+    }
+
+    if(rects.isEmpty())
+    {
+        return;
+    }
+
+    TextWatcher* watcher = new TextWatcher();
+    m_textWatchers.insert(key, watcher);
+
+    connect(watcher, SIGNAL(finished()), SLOT(on_fetchSurroundingText_finished()));
 
-    QDataStream(&key, QIODevice::WriteOnly)
-            << result.first
-            << result.second;
+    watcher->setFuture(scheduleRun< TextJob >(textJob, TextJob(view, page, rects), RenderScheduler::BackgroundPriority, view));
+}
 
-    return qMakePair(view, key);
+inline SearchModel::TextCacheKey SearchModel::textCacheKey(DocumentView* view, const Result& result)
+{
+    return TextCacheKey(view, result.first, result.second);
 }
 
-SearchModel::TextJob SearchModel::textJob(const TextCacheKey& key, const Result& result)
+SearchModel::TextJob SearchModel::textJob(TextJob job)
 {
-    const QString surroundingText = key.first->surroundingText(result.first, result.second);
+    foreach(const QRectF& rect, job.rects)
+    {
+        job.texts.append(job.view->surroundingText(job.page, rect));
+    }
 
-    return TextJob(key, new QString(surroundingText));
+    return job;
 }
 
 } // qpdfview
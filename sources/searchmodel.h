@@ -26,7 +26,10 @@ along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
 #include <QAbstractItemModel>
 #include <QCache>
 #include <QFutureWatcher>
+#include <QMap>
 #include <QRectF>
+#include <QStringList>
+#include <QVector>
 
 namespace qpdfview
 {
@@ -57,6 +60,7 @@ public:
         RectRole,
         TextRole,
         MatchCaseRole,
+        PatternRole,
         SurroundingTextRole
     };
 
@@ -71,6 +75,16 @@ public:
     int numberOfResultsOnPage(DocumentView* view, int page) const;
     QList< QRectF > resultsOnPage(DocumentView* view, int page) const;
 
+    QList< int > pagesWithResults(DocumentView* view) const;
+
+    // The bytes held for the results of a view and for their surrounding texts, the latter of which can be released to stay within the memory limit of a tab.
+
+    int numberOfResults(DocumentView* view) const;
+    qint64 resultsCost(DocumentView* view) const;
+
+    qint64 surroundingTextCost(DocumentView* view) const;
+    void releaseSurroundingText(DocumentView* view);
+
     enum FindDirection
     {
         FindNext,
@@ -80,6 +94,7 @@ public:
     QPersistentModelIndex findResult(DocumentView* view, const QPersistentModelIndex& currentResult, int currentPage, FindDirection direction) const;
 
     void insertResults(DocumentView* view, int page, const QList< QRectF >& resultsOnPage);
+    void insertResults(DocumentView* view, const QMap< int, QList< QRectF > >& resultsByPage);
     void clearResults(DocumentView* view);
 
     void updateProgress(DocumentView* view);
@@ -100,36 +115,105 @@ private:
 
 
     typedef QPair< int, QRectF > Result;
-    typedef QList< Result > Results;
+
+    // The results of a view are kept sorted by page in contiguous arrays
+    // together with the first row of each page so that per-page lookups need no search.
+
+    class Results
+    {
+    public:
+        Results();
+
+        inline int count() const { return m_pages.count(); }
+        inline bool isEmpty() const { return m_pages.isEmpty(); }
+
+        inline int page(int row) const { return m_pages.at(row); }
+        QRectF rect(int row) const;
+
+        inline Result at(int row) const { return qMakePair(page(row), rect(row)); }
+
+        // first row on or after the page
+        int beginOfPage(int page) const;
+        // first row after the page
+        int endOfPage(int page) const;
+
+        inline int countOnPage(int page) const { return endOfPage(page) - beginOfPage(page); }
+
+        QList< int > pages() const;
+
+        void insert(int page, const QList< QRectF >& rects);
+
+        inline qint64 cost() const { return m_pages.capacity() * sizeof(int) + m_rects.capacity() * sizeof(float) + m_offsets.capacity() * sizeof(int); }
+
+    private:
+        QVector< int > m_pages;
+        QVector< float > m_rects;
+
+        // first row of each page followed by the number of rows
+        QVector< int > m_offsets;
+
+    };
 
     QHash< DocumentView*, Results* > m_results;
 
 
-    typedef QPair< DocumentView*, QByteArray > TextCacheKey;
+    struct TextCacheKey
+    {
+        DocumentView* view;
+        int page;
+        QRectF rect;
+
+        TextCacheKey(DocumentView* view = 0, int page = 0, const QRectF& rect = QRectF()) : view(view), page(page), rect(rect) {}
+
+        bool operator==(const TextCacheKey& other) const
+        {
+            return view == other.view && page == other.page && rect == other.rect;
+        }
+
+    };
+
+    friend uint qHash(const TextCacheKey& key);
+
     typedef QString TextCacheObject;
 
+    // The surrounding text of all results on a page is fetched by a single job and the pages of the following rows are prefetched.
+
     struct TextJob
     {
-        TextCacheKey key;
-        TextCacheObject* object;
+        DocumentView* view;
+        int page;
+
+        QList< QRectF > rects;
+        QStringList texts;
 
-        TextJob() : key(), object(0) {}
-        TextJob(const TextCacheKey& key, TextCacheObject* object) : key(key), object(object) {}
+        TextJob(DocumentView* view = 0, int page = 0, const QList< QRectF >& rects = QList< QRectF >()) : view(view), page(page), rects(rects), texts() {}
 
     };
 
     typedef QFutureWatcher< TextJob > TextWatcher;
 
     mutable QCache< TextCacheKey, TextCacheObject > m_textCache;
-    mutable QHash< TextCacheKey, TextWatcher* > m_textWatchers;
+    mutable QHash< TextCacheKey, TextWatcher* > m_textWatchers; // by view and page
 
-    QString fetchSurroundingText(DocumentView* view, const Result& result) const;
+    QString fetchSurroundingText(DocumentView* view, int row) const;
+    void startTextJob(DocumentView* view, const Results* results, int page) const;
 
     static TextCacheKey textCacheKey(DocumentView* view, const Result& result);
-    static TextJob textJob(const TextCacheKey& key, const Result& result);
+    static TextJob textJob(TextJob job);
 
 };
 
+inline uint qHash(const SearchModel::TextCacheKey& key)
+{
+    uint hash = qHash(key.view);
+
+    hash = 31 * hash + static_cast< uint >(key.page);
+    hash = 31 * hash + static_cast< uint >(qRound(key.rect.x() * 1000.0));
+    hash = 31 * hash + static_cast< uint >(qRound(key.rect.y() * 1000.0));
+
+    return hash;
+}
+
 } // qpdfview
 
 #endif // SEARCHMODEL_H
@@ -21,7 +21,16 @@ along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "searchtask.h"
 
+#include <QElapsedTimer>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QtAlgorithms>
+
+#include "lazypage.h"
 #include "model.h"
+#include "renderstatistics.h"
+#include "textlayout.h"
+#include "tracing.h"
 
 namespace
 {
@@ -129,14 +138,184 @@ int loadProgress(const QAtomicInt& progress)
 namespace qpdfview
 {
 
+class SearchTask::Scheduler
+{
+public:
+    static Scheduler* instance()
+    {
+        static Scheduler scheduler;
+
+        return &scheduler;
+    }
+
+    ~Scheduler()
+    {
+        m_threadPool.waitForDone();
+    }
+
+    void schedule(SearchTask* task)
+    {
+        QMutexLocker mutexLocker(&m_mutex);
+
+        task->m_nextOffset = 0;
+        task->m_activeCount = 0;
+
+        m_tasks.append(task);
+
+        while(m_activeWorkers < m_threadPool.maxThreadCount())
+        {
+            ++m_activeWorkers;
+
+            m_threadPool.start(new Worker(this));
+        }
+    }
+
+    void unschedule(SearchTask* task)
+    {
+        QMutexLocker mutexLocker(&m_mutex);
+
+        m_tasks.removeAll(task);
+
+        while(task->m_activeCount > 0)
+        {
+            m_pageFinished.wait(&m_mutex);
+        }
+    }
+
+    bool isForeground(const SearchTask* task)
+    {
+        QMutexLocker mutexLocker(&m_mutex);
+
+        return task->m_foreground;
+    }
+
+    void setForeground(SearchTask* task, bool foreground)
+    {
+        QMutexLocker mutexLocker(&m_mutex);
+
+        task->m_foreground = foreground;
+    }
+
+    bool takeNext(SearchTask*& task, int& offset)
+    {
+        QMutexLocker mutexLocker(&m_mutex);
+
+        // Prefer tasks in the foreground and then the task with the fewest active pages so that all documents make progress.
+
+        task = 0;
+
+        foreach(SearchTask* candidate, m_tasks)
+        {
+            if(task == 0
+                    || (candidate->m_foreground && !task->m_foreground)
+                    || (candidate->m_foreground == task->m_foreground && candidate->m_activeCount < task->m_activeCount))
+            {
+                task = candidate;
+            }
+        }
+
+        if(task == 0)
+        {
+            --m_activeWorkers;
+
+            return false;
+        }
+
+        offset = task->m_nextOffset++;
+        ++task->m_activeCount;
+
+        if(task->m_nextOffset >= task->m_indices.count())
+        {
+            m_tasks.removeAll(task);
+        }
+
+        return true;
+    }
+
+    void finished(SearchTask* task)
+    {
+        QMutexLocker mutexLocker(&m_mutex);
+
+        --task->m_activeCount;
+
+        m_pageFinished.wakeAll();
+    }
+
+private:
+    Q_DISABLE_COPY(Scheduler)
+
+    Scheduler() :
+        m_mutex(),
+        m_pageFinished(),
+        m_tasks(),
+        m_activeWorkers(0),
+        m_threadPool()
+    {
+        m_threadPool.setMaxThreadCount(qMax(QThread::idealThreadCount(), 1));
+    }
+
+    QMutex m_mutex;
+    QWaitCondition m_pageFinished;
+
+    QList< SearchTask* > m_tasks;
+    int m_activeWorkers;
+
+    QThreadPool m_threadPool;
+
+};
+
+class SearchTask::Worker : public QRunnable
+{
+public:
+    Worker(Scheduler* scheduler) : QRunnable(),
+        m_scheduler(scheduler)
+    {
+        setAutoDelete(true);
+    }
+
+    void run()
+    {
+        SearchTask* task = 0;
+        int offset = 0;
+
+        while(m_scheduler->takeNext(task, offset))
+        {
+            task->searchPage(offset);
+
+            m_scheduler->finished(task);
+        }
+    }
+
+private:
+    Q_DISABLE_COPY(Worker)
+
+    Scheduler* m_scheduler;
+
+};
+
 SearchTask::SearchTask(QObject* parent) : QThread(parent),
     m_wasCanceled(NotCanceled),
     m_progress(0),
     m_pages(),
     m_text(),
     m_matchCase(false),
-    m_beginAtPage(1)
+    m_wholeWords(false),
+    m_regularExpression(false),
+    m_pattern(),
+    m_beginAtPage(1),
+    m_indices(),
+    m_textIndex(),
+    m_terms(),
+    m_foreground(false),
+    m_nextOffset(0),
+    m_activeCount(0),
+    m_mutex(),
+    m_resultsReady(),
+    m_results()
 {
+    // The shared scheduler is created on the main thread before any task runs.
+
+    Scheduler::instance();
 }
 
 bool SearchTask::wasCanceled() const
@@ -149,36 +328,116 @@ int SearchTask::progress() const
     return acquireProgress(m_progress);
 }
 
+bool SearchTask::isForeground() const
+{
+    return Scheduler::instance()->isForeground(this);
+}
+
+void SearchTask::setForeground(bool foreground)
+{
+    Scheduler::instance()->setForeground(this, foreground);
+}
+
 void SearchTask::run()
 {
-    for(int index = m_beginAtPage - 1; index < m_pages.count() + m_beginAtPage - 1; ++index)
+    const int count = m_indices.count();
+
+    QElapsedTimer searchTimer;
+    searchTimer.start();
+
+    int searchedPages = 0;
+
+    if(count > 0)
+    {
+        Scheduler::instance()->schedule(this);
+    }
+
+    for(int offset = 0; offset < count; ++offset, ++searchedPages)
     {
-        if(testCancellation(m_wasCanceled))
+        QList< QRectF > results;
+
         {
-            break;
-        }
+            QMutexLocker mutexLocker(&m_mutex);
 
-        const QList< QRectF > results = m_pages.at(index % m_pages.count())->search(m_text, m_matchCase);
+            while(!m_results.contains(offset) && !testCancellation(m_wasCanceled))
+            {
+                m_resultsReady.wait(&m_mutex);
+            }
 
-        emit resultsReady(index % m_pages.count(), results);
+            if(testCancellation(m_wasCanceled))
+            {
+                break;
+            }
+
+            results = m_results.take(offset);
+        }
 
-        releaseProgress(m_progress, 100 * (index + 1 - m_beginAtPage + 1) / m_pages.count());
+        emit resultsReady(m_indices.at(offset), results);
+
+        releaseProgress(m_progress, 100 * (offset + 1) / count);
 
         emit progressChanged(loadProgress(m_progress));
     }
 
+    Scheduler::instance()->unschedule(this);
+
+    RenderStatistics::recordSearch(parent(), searchedPages, searchTimer.elapsed());
+
+    m_mutex.lock();
+    m_results.clear();
+    m_mutex.unlock();
+
     releaseProgress(m_progress, 0);
 }
 
 void SearchTask::start(const QVector< Model::Page* >& pages,
-                       const QString& text, bool matchCase, int beginAtPage)
+                       const QString& text, bool matchCase, bool wholeWords, bool regularExpression, int beginAtPage,
+                       const TextIndex& textIndex,
+                       const QVector< int >& indices)
 {
     m_pages = pages;
 
     m_text = text;
     m_matchCase = matchCase;
+    m_wholeWords = wholeWords;
+    m_regularExpression = regularExpression;
     m_beginAtPage = beginAtPage;
 
+    // Literal text is searched directly since the backends can answer it even without a text layout.
+
+    m_pattern = wholeWords || regularExpression ? TextLayout::pattern(text, matchCase, wholeWords, regularExpression) : QRegExp();
+
+    // All pages are searched unless a subset is given, either way beginning at the given page and wrapping around.
+
+    QVector< int > sortedIndices = indices;
+
+    if(sortedIndices.isEmpty())
+    {
+        sortedIndices.reserve(pages.count());
+
+        for(int index = 0; index < pages.count(); ++index)
+        {
+            sortedIndices.append(index);
+        }
+    }
+    else
+    {
+        qSort(sortedIndices);
+    }
+
+    const int begin = qLowerBound(sortedIndices.constBegin(), sortedIndices.constEnd(), beginAtPage - 1) - sortedIndices.constBegin();
+
+    m_indices.clear();
+    m_indices.reserve(sortedIndices.count());
+
+    for(int offset = 0; offset < sortedIndices.count(); ++offset)
+    {
+        m_indices.append(sortedIndices.at((begin + offset) % sortedIndices.count()));
+    }
+
+    m_textIndex = textIndex;
+    m_terms = regularExpression ? QStringList() : TextIndex::terms(text);
+
     resetCancellation(m_wasCanceled);
     releaseProgress(m_progress, 0);
 
@@ -188,6 +447,42 @@ void SearchTask::start(const QVector< Model::Page* >& pages,
 void SearchTask::cancel()
 {
     setCancellation(m_wasCanceled);
+
+    QMutexLocker mutexLocker(&m_mutex);
+
+    m_resultsReady.wakeAll();
+}
+
+void SearchTask::searchPage(int offset)
+{
+    if(testCancellation(m_wasCanceled))
+    {
+        return;
+    }
+
+    const int index = m_indices.at(offset);
+
+    const TraceSpan span("search", "searchPage", "page", index + 1);
+
+    QList< QRectF > results;
+
+    if(m_textIndex.mayContain(index, m_terms, m_matchCase))
+    {
+        if(m_wholeWords || m_regularExpression)
+        {
+            results = static_cast< const LazyPage* >(m_pages.at(index))->search(m_pattern);
+        }
+        else
+        {
+            results = m_pages.at(index)->search(m_text, m_matchCase);
+        }
+    }
+
+    QMutexLocker mutexLocker(&m_mutex);
+
+    m_results.insert(offset, results);
+
+    m_resultsReady.wakeAll();
 }
 
 } // qpdfview
@@ -22,9 +22,15 @@ along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef SEARCHTASK_H
 #define SEARCHTASK_H
 
+#include <QHash>
+#include <QMutex>
 #include <QRectF>
+#include <QRegExp>
 #include <QThread>
 #include <QVector>
+#include <QWaitCondition>
+
+#include "textindex.h"
 
 namespace qpdfview
 {
@@ -46,6 +52,13 @@ public:
 
     inline QString text() const { return m_text; }
     inline bool matchCase() const { return m_matchCase; }
+    inline bool wholeWords() const { return m_wholeWords; }
+    inline bool regularExpression() const { return m_regularExpression; }
+
+    // The pages of the tasks in the foreground are searched before those of the others.
+
+    bool isForeground() const;
+    void setForeground(bool foreground);
 
     void run();
 
@@ -56,13 +69,18 @@ signals:
 
 public slots:
     void start(const QVector< Model::Page* >& pages,
-               const QString& text, bool matchCase, int beginAtPage = 1);
+               const QString& text, bool matchCase, bool wholeWords = false, bool regularExpression = false, int beginAtPage = 1,
+               const TextIndex& textIndex = TextIndex(),
+               const QVector< int >& indices = QVector< int >());
 
     void cancel();
 
 private:
     Q_DISABLE_COPY(SearchTask)
 
+    class Scheduler;
+    class Worker;
+
     QAtomicInt m_wasCanceled;
     mutable QAtomicInt m_progress;
 
@@ -70,8 +88,30 @@ private:
 
     QString m_text;
     bool m_matchCase;
+    bool m_wholeWords;
+    bool m_regularExpression;
+    QRegExp m_pattern;
     int m_beginAtPage;
 
+    // indices of the pages which are searched in reading order
+    QVector< int > m_indices;
+
+    TextIndex m_textIndex;
+    QStringList m_terms;
+
+    // The pages of all tasks are interleaved on the workers of a shared scheduler in reading order
+    // and results which arrive early are held back until all previous pages are done.
+
+    bool m_foreground;
+    int m_nextOffset;
+    int m_activeCount;
+
+    QMutex m_mutex;
+    QWaitCondition m_resultsReady;
+    QHash< int, QList< QRectF > > m_results;
+
+    void searchPage(int offset);
+
 };
 
 } // qpdfview
@@ -79,14 +79,19 @@ Settings::~Settings()
 void Settings::PageItem::sync()
 {
     m_cacheSize = m_settings->value("pageItem/cacheSize", Defaults::PageItem::cacheSize()).toInt();
+    m_diskCacheSize = m_settings->value("pageItem/diskCacheSize", Defaults::PageItem::diskCacheSize()).toInt();
+    m_thumbnailCacheSize = m_settings->value("pageItem/thumbnailCacheSize", Defaults::PageItem::thumbnailCacheSize()).toInt();
 
     m_useTiling = m_settings->value("pageItem/useTiling", Defaults::PageItem::useTiling()).toBool();
     m_tileSize = m_settings->value("pageItem/tileSize", Defaults::PageItem::tileSize()).toInt();
+    m_useTilePyramid = m_settings->value("pageItem/useTilePyramid", Defaults::PageItem::useTilePyramid()).toBool();
 
     m_progressIcon = QIcon::fromTheme("image-loading", QIcon(":/icons/image-loading.svg"));
     m_errorIcon = QIcon::fromTheme("image-missing", QIcon(":icons/image-missing.svg"));
 
     m_keepObsoletePixmaps = m_settings->value("pageItem/keepObsoletePixmaps", Defaults::PageItem::keepObsoletePixmaps()).toBool();
+    m_progressiveRendering = m_settings->value("pageItem/progressiveRendering", Defaults::PageItem::progressiveRendering()).toBool();
+    m_renderOutOfProcess = m_settings->value("pageItem/renderOutOfProcess", Defaults::PageItem::renderOutOfProcess()).toBool();
     m_useDevicePixelRatio = m_settings->value("pageItem/useDevicePixelRatio", Defaults::PageItem::useDevicePixelRatio()).toBool();
 
     m_trimMargins = m_settings->value("pageItem/trimMargins", Defaults::PageItem::trimMargins()).toBool();
@@ -103,25 +108,61 @@ void Settings::PageItem::sync()
 
 void Settings::PageItem::setCacheSize(int cacheSize)
 {
-    if(cacheSize >= 0)
+    if(cacheSize >= -1)
     {
         m_cacheSize = cacheSize;
         m_settings->setValue("pageItem/cacheSize", cacheSize);
     }
 }
 
+void Settings::PageItem::setDiskCacheSize(int diskCacheSize)
+{
+    if(diskCacheSize >= 0)
+    {
+        m_diskCacheSize = diskCacheSize;
+        m_settings->setValue("pageItem/diskCacheSize", diskCacheSize);
+    }
+}
+
+void Settings::PageItem::setThumbnailCacheSize(int thumbnailCacheSize)
+{
+    if(thumbnailCacheSize >= 0)
+    {
+        m_thumbnailCacheSize = thumbnailCacheSize;
+        m_settings->setValue("pageItem/thumbnailCacheSize", thumbnailCacheSize);
+    }
+}
+
 void Settings::PageItem::setUseTiling(bool useTiling)
 {
     m_useTiling = useTiling;
     m_settings->setValue("pageItem/useTiling", useTiling);
 }
 
+void Settings::PageItem::setUseTilePyramid(bool useTilePyramid)
+{
+    m_useTilePyramid = useTilePyramid;
+    m_settings->setValue("pageItem/useTilePyramid", useTilePyramid);
+}
+
 void Settings::PageItem::setKeepObsoletePixmaps(bool keepObsoletePixmaps)
 {
     m_keepObsoletePixmaps = keepObsoletePixmaps;
     m_settings->setValue("pageItem/keepObsoletePixmaps", keepObsoletePixmaps);
 }
 
+void Settings::PageItem::setProgressiveRendering(bool progressiveRendering)
+{
+    m_progressiveRendering = progressiveRendering;
+    m_settings->setValue("pageItem/progressiveRendering", progressiveRendering);
+}
+
+void Settings::PageItem::setRenderOutOfProcess(bool renderOutOfProcess)
+{
+    m_renderOutOfProcess = renderOutOfProcess;
+    m_settings->setValue("pageItem/renderOutOfProcess", renderOutOfProcess);
+}
+
 void Settings::PageItem::setUseDevicePixelRatio(bool useDevicePixelRatio)
 {
     m_useDevicePixelRatio = useDevicePixelRatio;
@@ -233,9 +274,13 @@ void Settings::PageItem::setFormFieldOverlay(bool overlay)
 Settings::PageItem::PageItem(QSettings* settings) :
     m_settings(settings),
     m_cacheSize(Defaults::PageItem::cacheSize()),
+    m_diskCacheSize(Defaults::PageItem::diskCacheSize()),
+    m_thumbnailCacheSize(Defaults::PageItem::thumbnailCacheSize()),
     m_progressIcon(),
     m_errorIcon(),
     m_keepObsoletePixmaps(Defaults::PageItem::keepObsoletePixmaps()),
+    m_progressiveRendering(Defaults::PageItem::progressiveRendering()),
+    m_renderOutOfProcess(Defaults::PageItem::renderOutOfProcess()),
     m_useDevicePixelRatio(false),
     m_trimMargins(false),
     m_decoratePages(Defaults::PageItem::decoratePages()),
@@ -334,6 +379,39 @@ int Settings::DocumentView::autoRefreshTimeout() const
     return m_settings->value("documentView/autoRefreshTimeout", Defaults::DocumentView::autoRefreshTimeout()).toInt();
 }
 
+int Settings::DocumentView::memoryLimit() const
+{
+    return m_settings->value("documentView/memoryLimit", Defaults::DocumentView::memoryLimit()).toInt();
+}
+
+void Settings::DocumentView::setMemoryLimit(int memoryLimit)
+{
+    if(memoryLimit >= 0)
+    {
+        m_settings->setValue("documentView/memoryLimit", memoryLimit);
+    }
+}
+
+bool Settings::DocumentView::indexText() const
+{
+    return m_settings->value("documentView/indexText", Defaults::DocumentView::indexText()).toBool();
+}
+
+void Settings::DocumentView::setIndexText(bool indexText)
+{
+    m_settings->setValue("documentView/indexText", indexText);
+}
+
+bool Settings::DocumentView::useOpenGL() const
+{
+    return m_settings->value("documentView/useOpenGL", Defaults::DocumentView::useOpenGL()).toBool();
+}
+
+void Settings::DocumentView::setUseOpenGL(bool useOpenGL)
+{
+    m_settings->setValue("documentView/useOpenGL", useOpenGL);
+}
+
 void Settings::DocumentView::setPrefetch(bool prefetch)
 {
     m_prefetch = prefetch;
@@ -395,6 +473,19 @@ void Settings::DocumentView::setZoomFactor(qreal zoomFactor)
     m_settings->setValue("documentView/zoomFactor", zoomFactor);
 }
 
+int Settings::DocumentView::zoomGestureTimeout() const
+{
+    return m_settings->value("documentView/zoomGestureTimeout", Defaults::DocumentView::zoomGestureTimeout()).toInt();
+}
+
+void Settings::DocumentView::setZoomGestureTimeout(int zoomGestureTimeout)
+{
+    if(zoomGestureTimeout >= 0)
+    {
+        m_settings->setValue("documentView/zoomGestureTimeout", zoomGestureTimeout);
+    }
+}
+
 void Settings::DocumentView::setPageSpacing(qreal pageSpacing)
 {
     if(pageSpacing >= 0.0)
@@ -432,6 +523,26 @@ void Settings::DocumentView::setMatchCase(bool matchCase)
     m_settings->setValue("documentView/matchCase", matchCase);
 }
 
+bool Settings::DocumentView::wholeWords() const
+{
+    return m_settings->value("documentView/wholeWords", Defaults::DocumentView::wholeWords()).toBool();
+}
+
+void Settings::DocumentView::setWholeWords(bool wholeWords)
+{
+    m_settings->setValue("documentView/wholeWords", wholeWords);
+}
+
+bool Settings::DocumentView::regularExpression() const
+{
+    return m_settings->value("documentView/regularExpression", Defaults::DocumentView::regularExpression()).toBool();
+}
+
+void Settings::DocumentView::setRegularExpression(bool regularExpression)
+{
+    m_settings->setValue("documentView/regularExpression", regularExpression);
+}
+
 int Settings::DocumentView::highlightDuration() const
 {
     return m_settings->value("documentView/highlightDuration", Defaults::DocumentView::highlightDuration()).toInt();
@@ -682,6 +793,16 @@ void Settings::MainWindow::setSaveDatabaseInterval(int saveDatabaseInterval)
     m_settings->setValue("mainWindow/saveDatabaseInterval", saveDatabaseInterval);
 }
 
+int Settings::MainWindow::hibernateTabsTimeout() const
+{
+    return m_settings->value("mainWindow/hibernateTabsTimeout", Defaults::MainWindow::hibernateTabsTimeout()).toInt();
+}
+
+void Settings::MainWindow::setHibernateTabsTimeout(int hibernateTabsTimeout)
+{
+    m_settings->setValue("mainWindow/hibernateTabsTimeout", hibernateTabsTimeout);
+}
+
 int Settings::MainWindow::tabPosition() const
 {
     return m_settings->value("mainWindow/tabPosition", Defaults::MainWindow::tabPosition()).toInt();
@@ -928,6 +1049,16 @@ void Settings::MainWindow::setFontsDialogSize(const QSize& fontsDialogSize)
     m_settings->setValue("mainWindow/fontsDialogSize", fontsDialogSize);
 }
 
+QSize Settings::MainWindow::statisticsDialogSize(const QSize& sizeHint) const
+{
+    return m_settings->value("mainWindow/statisticsDialogSize", sizeHint).toSize();
+}
+
+void Settings::MainWindow::setStatisticsDialogSize(const QSize& statisticsDialogSize)
+{
+    m_settings->setValue("mainWindow/statisticsDialogSize", statisticsDialogSize);
+}
+
 QSize Settings::MainWindow::contentsDialogSize(const QSize& sizeHint) const
 {
     return m_settings->value("mainWindow/contentsDialogSize", sizeHint).toSize();
@@ -55,17 +55,32 @@ public:
         inline int cacheSize() const { return m_cacheSize; }
         void setCacheSize(int cacheSize);
 
+        inline int diskCacheSize() const { return m_diskCacheSize; }
+        void setDiskCacheSize(int diskCacheSize);
+
+        inline int thumbnailCacheSize() const { return m_thumbnailCacheSize; }
+        void setThumbnailCacheSize(int thumbnailCacheSize);
+
         inline bool useTiling() const { return m_useTiling; }
         void setUseTiling(bool useTiling);
 
         inline int tileSize() const { return m_tileSize; }
 
+        inline bool useTilePyramid() const { return m_useTilePyramid; }
+        void setUseTilePyramid(bool useTilePyramid);
+
         inline const QIcon& progressIcon() const { return m_progressIcon; }
         inline const QIcon& errorIcon() const { return m_errorIcon; }
 
         inline bool keepObsoletePixmaps() const { return m_keepObsoletePixmaps; }
         void setKeepObsoletePixmaps(bool keepObsoletePixmaps);
 
+        inline bool progressiveRendering() const { return m_progressiveRendering; }
+        void setProgressiveRendering(bool progressiveRendering);
+
+        inline bool renderOutOfProcess() const { return m_renderOutOfProcess; }
+        void setRenderOutOfProcess(bool renderOutOfProcess);
+
         inline bool useDevicePixelRatio() const { return m_useDevicePixelRatio; }
         void setUseDevicePixelRatio(bool useDevicePixelRatio);
 
@@ -115,14 +130,19 @@ public:
         QSettings* m_settings;
 
         int m_cacheSize;
+        int m_diskCacheSize;
+        int m_thumbnailCacheSize;
 
         bool m_useTiling;
         int m_tileSize;
+        bool m_useTilePyramid;
 
         QIcon m_progressIcon;
         QIcon m_errorIcon;
 
         bool m_keepObsoletePixmaps;
+        bool m_progressiveRendering;
+        bool m_renderOutOfProcess;
         bool m_useDevicePixelRatio;
 
         bool m_trimMargins;
@@ -175,6 +195,16 @@ public:
 
         int autoRefreshTimeout() const;
 
+        // soft limit in megabytes on the memory used by each tab, where zero disables it
+        int memoryLimit() const;
+        void setMemoryLimit(int memoryLimit);
+
+        bool indexText() const;
+        void setIndexText(bool indexText);
+
+        bool useOpenGL() const;
+        void setUseOpenGL(bool useOpenGL);
+
         inline bool prefetch() const { return m_prefetch; }
         void setPrefetch(bool prefetch);
 
@@ -198,6 +228,11 @@ public:
         qreal zoomFactor() const;
         void setZoomFactor(qreal zoomFactor);
 
+        // Repeated zooming only scales the existing pixmaps until no further step follows within this timeout.
+
+        int zoomGestureTimeout() const;
+        void setZoomGestureTimeout(int zoomGestureTimeout);
+
         inline qreal pageSpacing() const { return m_pageSpacing; }
         void setPageSpacing(qreal pageSpacing);
 
@@ -210,6 +245,12 @@ public:
         bool matchCase() const;
         void setMatchCase(bool matchCase);
 
+        bool wholeWords() const;
+        void setWholeWords(bool wholeWords);
+
+        bool regularExpression() const;
+        void setRegularExpression(bool regularExpression);
+
         int highlightDuration() const;
         void setHighlightDuration(int highlightDuration);
 
@@ -307,6 +348,9 @@ public:
         int saveDatabaseInterval() const;
         void setSaveDatabaseInterval(int saveDatabaseInterval);
 
+        int hibernateTabsTimeout() const;
+        void setHibernateTabsTimeout(int hibernateTabsTimeout);
+
         int tabPosition() const;
         void setTabPosition(int tabPosition);
 
@@ -379,6 +423,9 @@ public:
         QSize fontsDialogSize(const QSize& sizeHint) const;
         void setFontsDialogSize(const QSize& fontsDialogSize);
 
+        QSize statisticsDialogSize(const QSize& sizeHint) const;
+        void setStatisticsDialogSize(const QSize& statisticsDialogSize);
+
         QSize contentsDialogSize(const QSize& sizeHint) const;
         void setContentsDialogSize(const QSize& contentsDialogSize);
 
@@ -466,12 +513,18 @@ public:
     class PageItem
     {
     public:
-        static inline int cacheSize() { return 32 * 1024 * 1024; }
+        // a negative cache size sizes the tile cache automatically
+        static inline int cacheSize() { return -1; }
+        static inline int diskCacheSize() { return 0; }
+        static inline int thumbnailCacheSize() { return 64; }
 
         static inline bool useTiling() { return false; }
         static inline int tileSize() { return 1024; }
+        static inline bool useTilePyramid() { return false; }
 
         static inline bool keepObsoletePixmaps() { return false; }
+        static inline bool progressiveRendering() { return false; }
+        static inline bool renderOutOfProcess() { return false; }
         static inline bool useDevicePixelRatio() { return false; }
 
         static inline bool trimMargins() { return false; }
@@ -520,6 +573,12 @@ public:
 
         static inline int autoRefreshTimeout() { return 750; }
 
+        static inline int memoryLimit() { return 0; }
+
+        static inline bool indexText() { return false; }
+
+        static inline bool useOpenGL() { return false; }
+
         static inline bool prefetch() { return false; }
         static inline int prefetchDistance() { return 1; }
 
@@ -534,6 +593,7 @@ public:
         static inline qreal maximumScaleFactor() { return 50.0; }
 
         static inline qreal zoomFactor() { return 1.1; }
+        static inline int zoomGestureTimeout() { return 200; }
 
         static inline qreal pageSpacing() { return 5.0; }
         static inline qreal thumbnailSpacing() { return 3.0; }
@@ -541,6 +601,8 @@ public:
         static inline qreal thumbnailSize() { return 150.0; }
 
         static inline bool matchCase() { return false; }
+        static inline bool wholeWords() { return false; }
+        static inline bool regularExpression() { return false; }
 
         static inline int highlightDuration() { return 5 * 1000; }
         static inline QString sourceEditor() { return QString(); }
@@ -588,6 +650,8 @@ public:
 
         static inline int saveDatabaseInterval() { return 5 * 60 * 1000; }
 
+        static inline int hibernateTabsTimeout() { return 0; }
+
         static inline int tabPosition() { return 0; }
         static inline int tabVisibility() { return 0; }
 
@@ -33,6 +33,7 @@ along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
 #include <QTableView>
 
 #include "settings.h"
+#include "cachebudget.h"
 #include "model.h"
 #include "pluginhandler.h"
 #include "shortcuthandler.h"
@@ -230,6 +231,14 @@ void SettingsDialog::createBehaviorTab()
 
     m_behaviorLayout->addRow(tr("Auto-refresh:"), m_autoRefreshCheckBox);
 
+    // index text
+
+    m_indexTextCheckBox = new QCheckBox(this);
+    m_indexTextCheckBox->setChecked(s_settings->documentView().indexText());
+    m_indexTextCheckBox->setToolTip(tr("The text of each document is extracted in the background to speed up searching."));
+
+    m_behaviorLayout->addRow(tr("Index text:"), m_indexTextCheckBox);
+
     // track recently used
 
     m_trackRecentlyUsedCheckBox = new QCheckBox(this);
@@ -286,6 +295,16 @@ void SettingsDialog::createBehaviorTab()
 
 #endif // WITH_SQL
 
+    // hibernate tabs timeout
+
+    m_hibernateTabsTimeoutSpinBox = new QSpinBox(this);
+    m_hibernateTabsTimeoutSpinBox->setSuffix(tr(" min"));
+    m_hibernateTabsTimeoutSpinBox->setRange(0, 24 * 60);
+    m_hibernateTabsTimeoutSpinBox->setSpecialValueText(tr("Never"));
+    m_hibernateTabsTimeoutSpinBox->setValue(s_settings->mainWindow().hibernateTabsTimeout() / 1000 / 60);
+
+    m_behaviorLayout->addRow(tr("Hibernate background tabs after:"), m_hibernateTabsTimeoutSpinBox);
+
     // synchronize presentation
 
     m_synchronizePresentationCheckBox = new QCheckBox(this);
@@ -318,6 +337,17 @@ void SettingsDialog::createBehaviorTab()
 
     m_behaviorLayout->addRow(tr("Zoom factor:"), m_zoomFactorSpinBox);
 
+    // zoom gesture timeout
+
+    m_zoomGestureTimeoutSpinBox = new QSpinBox(this);
+    m_zoomGestureTimeoutSpinBox->setSuffix(tr(" ms"));
+    m_zoomGestureTimeoutSpinBox->setRange(0, 2000);
+    m_zoomGestureTimeoutSpinBox->setSingleStep(50);
+    m_zoomGestureTimeoutSpinBox->setSpecialValueText(tr("None"));
+    m_zoomGestureTimeoutSpinBox->setValue(s_settings->documentView().zoomGestureTimeout());
+
+    m_behaviorLayout->addRow(tr("Zoom gesture timeout:"), m_zoomGestureTimeoutSpinBox);
+
     // highlight duration
 
     m_highlightDurationSpinBox = new QSpinBox(this);
@@ -356,6 +386,8 @@ void SettingsDialog::acceptBehaivorTab()
 
     s_settings->documentView().setAutoRefresh(m_autoRefreshCheckBox->isChecked());
 
+    s_settings->documentView().setIndexText(m_indexTextCheckBox->isChecked());
+
     s_settings->mainWindow().setTrackRecentlyUsed(m_trackRecentlyUsedCheckBox->isChecked());
     s_settings->mainWindow().setKeepRecentlyClosed(m_keepRecentlyClosedCheckBox->isChecked());
 
@@ -364,12 +396,15 @@ void SettingsDialog::acceptBehaivorTab()
     s_settings->mainWindow().setRestorePerFileSettings(m_restorePerFileSettingsCheckBox->isChecked());
     s_settings->mainWindow().setSaveDatabaseInterval(m_saveDatabaseInterval->value() * 60 * 1000);
 
+    s_settings->mainWindow().setHibernateTabsTimeout(m_hibernateTabsTimeoutSpinBox->value() * 60 * 1000);
+
     s_settings->presentationView().setSynchronize(m_synchronizePresentationCheckBox->isChecked());
     s_settings->presentationView().setScreen(m_presentationScreenSpinBox->value());
 
     s_settings->mainWindow().setSynchronizeOutlineView(m_synchronizeOutlineViewCheckBox->isChecked());
 
     s_settings->documentView().setZoomFactor(m_zoomFactorSpinBox->value());
+    s_settings->documentView().setZoomGestureTimeout(m_zoomGestureTimeoutSpinBox->value());
 
     s_settings->documentView().setHighlightDuration(m_highlightDurationSpinBox->value());
     s_settings->pageItem().setHighlightColor(getValidColorFromCurrentText(m_highlightColorComboBox, Defaults::PageItem::highlightColor()));
@@ -384,6 +419,8 @@ void SettingsDialog::resetBehaviorTab()
 
     m_autoRefreshCheckBox->setChecked(Defaults::DocumentView::autoRefresh());
 
+    m_indexTextCheckBox->setChecked(Defaults::DocumentView::indexText());
+
     m_trackRecentlyUsedCheckBox->setChecked(Defaults::MainWindow::trackRecentlyUsed());
     m_keepRecentlyClosedCheckBox->setChecked(Defaults::MainWindow::keepRecentlyClosed());
 
@@ -392,12 +429,15 @@ void SettingsDialog::resetBehaviorTab()
     m_restorePerFileSettingsCheckBox->setChecked(Defaults::MainWindow::restorePerFileSettings());
     m_saveDatabaseInterval->setValue(Defaults::MainWindow::saveDatabaseInterval());
 
+    m_hibernateTabsTimeoutSpinBox->setValue(Defaults::MainWindow::hibernateTabsTimeout() / 1000 / 60);
+
     m_synchronizePresentationCheckBox->setChecked(Defaults::PresentationView::synchronize());
     m_presentationScreenSpinBox->setValue(Defaults::PresentationView::screen());
 
     m_synchronizeOutlineViewCheckBox->setChecked(Defaults::MainWindow::synchronizeOutlineView());
 
     m_zoomFactorSpinBox->setValue(Defaults::DocumentView::zoomFactor());
+    m_zoomGestureTimeoutSpinBox->setValue(Defaults::DocumentView::zoomGestureTimeout());
 
     m_highlightDurationSpinBox->setValue(Defaults::DocumentView::highlightDuration());
     setCurrentTextToColorName(m_highlightColorComboBox, Defaults::PageItem::highlightColor());
@@ -415,6 +455,14 @@ void SettingsDialog::createGraphicsTab()
 
     m_graphicsLayout->addRow(tr("Use tiling:"), m_useTilingCheckBox);
 
+    // use tile pyramid
+
+    m_useTilePyramidCheckBox = new QCheckBox(this);
+    m_useTilePyramidCheckBox->setChecked(s_settings->pageItem().useTilePyramid());
+    m_useTilePyramidCheckBox->setToolTip(tr("Tiles are rendered at the next power of two of the scale factor and reused while zooming."));
+
+    m_graphicsLayout->addRow(tr("Use tile pyramid:"), m_useTilePyramidCheckBox);
+
     // keep obsolete pixmaps
 
     m_keepObsoletePixmapsCheckBox = new QCheckBox(this);
@@ -422,6 +470,33 @@ void SettingsDialog::createGraphicsTab()
 
     m_graphicsLayout->addRow(tr("Keep obsolete pixmaps:"), m_keepObsoletePixmapsCheckBox);
 
+    // progressive rendering
+
+    m_progressiveRenderingCheckBox = new QCheckBox(this);
+    m_progressiveRenderingCheckBox->setChecked(s_settings->pageItem().progressiveRendering());
+
+    m_graphicsLayout->addRow(tr("Progressive rendering:"), m_progressiveRenderingCheckBox);
+
+    // render out of process
+
+    m_renderOutOfProcessCheckBox = new QCheckBox(this);
+    m_renderOutOfProcessCheckBox->setChecked(s_settings->pageItem().renderOutOfProcess());
+    m_renderOutOfProcessCheckBox->setToolTip(tr("Pages are rendered by helper processes so that a broken file cannot hang or crash the application."));
+
+    m_graphicsLayout->addRow(tr("Render out of process:"), m_renderOutOfProcessCheckBox);
+
+#ifdef WITH_OPENGL
+
+    // use OpenGL
+
+    m_useOpenGLCheckBox = new QCheckBox(this);
+    m_useOpenGLCheckBox->setChecked(s_settings->documentView().useOpenGL());
+    m_useOpenGLCheckBox->setToolTip(tr("Effective after restart."));
+
+    m_graphicsLayout->addRow(tr("Use OpenGL:"), m_useOpenGLCheckBox);
+
+#endif // WITH_OPENGL
+
 #if QT_VERSION >= QT_VERSION_CHECK(5,1,0)
 
     // use device pixel ratio
@@ -520,6 +595,7 @@ void SettingsDialog::createGraphicsTab()
     // cache size
 
     m_cacheSizeComboBox = new QComboBox(this);
+    m_cacheSizeComboBox->addItem(tr("Automatic"), -1);
     m_cacheSizeComboBox->addItem(tr("%1 MB").arg(0), 0);
     m_cacheSizeComboBox->addItem(tr("%1 MB").arg(8), 8 * 1024 * 1024);
     m_cacheSizeComboBox->addItem(tr("%1 MB").arg(16), 16 * 1024 * 1024);
@@ -542,9 +618,71 @@ void SettingsDialog::createGraphicsTab()
     }
 
     m_cacheSizeComboBox->setCurrentIndex(cacheSizeIndex);
+    m_cacheSizeComboBox->setToolTip(CacheBudget::instance()->statistics());
 
     m_graphicsLayout->addRow(tr("Cache size:"), m_cacheSizeComboBox);
 
+    // disk cache size
+
+    m_diskCacheSizeComboBox = new QComboBox(this);
+    m_diskCacheSizeComboBox->addItem(tr("%1 MB").arg(0), 0);
+    m_diskCacheSizeComboBox->addItem(tr("%1 MB").arg(128), 128);
+    m_diskCacheSizeComboBox->addItem(tr("%1 MB").arg(256), 256);
+    m_diskCacheSizeComboBox->addItem(tr("%1 MB").arg(512), 512);
+    m_diskCacheSizeComboBox->addItem(tr("%1 MB").arg(1024), 1024);
+    m_diskCacheSizeComboBox->addItem(tr("%1 MB").arg(2048), 2048);
+    m_diskCacheSizeComboBox->addItem(tr("%1 MB").arg(4096), 4096);
+
+    const int diskCacheSize = s_settings->pageItem().diskCacheSize();
+    int diskCacheSizeIndex = m_diskCacheSizeComboBox->findData(diskCacheSize);
+
+    if(diskCacheSizeIndex == -1)
+    {
+        m_diskCacheSizeComboBox->addItem(tr("%1 MB").arg(diskCacheSize), diskCacheSize);
+
+        diskCacheSizeIndex = m_diskCacheSizeComboBox->count() - 1;
+    }
+
+    m_diskCacheSizeComboBox->setCurrentIndex(diskCacheSizeIndex);
+
+    m_graphicsLayout->addRow(tr("Disk cache size:"), m_diskCacheSizeComboBox);
+
+    // thumbnail cache size
+
+    m_thumbnailCacheSizeComboBox = new QComboBox(this);
+    m_thumbnailCacheSizeComboBox->addItem(tr("%1 MB").arg(0), 0);
+    m_thumbnailCacheSizeComboBox->addItem(tr("%1 MB").arg(16), 16);
+    m_thumbnailCacheSizeComboBox->addItem(tr("%1 MB").arg(32), 32);
+    m_thumbnailCacheSizeComboBox->addItem(tr("%1 MB").arg(64), 64);
+    m_thumbnailCacheSizeComboBox->addItem(tr("%1 MB").arg(128), 128);
+    m_thumbnailCacheSizeComboBox->addItem(tr("%1 MB").arg(256), 256);
+
+    const int thumbnailCacheSize = s_settings->pageItem().thumbnailCacheSize();
+    int thumbnailCacheSizeIndex = m_thumbnailCacheSizeComboBox->findData(thumbnailCacheSize);
+
+    if(thumbnailCacheSizeIndex == -1)
+    {
+        m_thumbnailCacheSizeComboBox->addItem(tr("%1 MB").arg(thumbnailCacheSize), thumbnailCacheSize);
+
+        thumbnailCacheSizeIndex = m_thumbnailCacheSizeComboBox->count() - 1;
+    }
+
+    m_thumbnailCacheSizeComboBox->setCurrentIndex(thumbnailCacheSizeIndex);
+
+    m_graphicsLayout->addRow(tr("Thumbnail cache size:"), m_thumbnailCacheSizeComboBox);
+
+    // memory limit
+
+    m_memoryLimitSpinBox = new QSpinBox(this);
+    m_memoryLimitSpinBox->setSuffix(tr(" MB"));
+    m_memoryLimitSpinBox->setRange(0, 64 * 1024);
+    m_memoryLimitSpinBox->setSingleStep(64);
+    m_memoryLimitSpinBox->setSpecialValueText(tr("None"));
+    m_memoryLimitSpinBox->setValue(s_settings->documentView().memoryLimit());
+    m_memoryLimitSpinBox->setToolTip(tr("A tab which uses more memory releases its cached tiles and texts first."));
+
+    m_graphicsLayout->addRow(tr("Memory limit per tab:"), m_memoryLimitSpinBox);
+
     // prefetch
 
     m_prefetchCheckBox = new QCheckBox(this);
@@ -564,7 +702,16 @@ void SettingsDialog::createGraphicsTab()
 void SettingsDialog::acceptGraphicsTab()
 {
     s_settings->pageItem().setUseTiling(m_useTilingCheckBox->isChecked());
+    s_settings->pageItem().setUseTilePyramid(m_useTilePyramidCheckBox->isChecked());
     s_settings->pageItem().setKeepObsoletePixmaps(m_keepObsoletePixmapsCheckBox->isChecked());
+    s_settings->pageItem().setProgressiveRendering(m_progressiveRenderingCheckBox->isChecked());
+    s_settings->pageItem().setRenderOutOfProcess(m_renderOutOfProcessCheckBox->isChecked());
+
+#ifdef WITH_OPENGL
+
+    s_settings->documentView().setUseOpenGL(m_useOpenGLCheckBox->isChecked());
+
+#endif // WITH_OPENGL
 
 #if QT_VERSION >= QT_VERSION_CHECK(5,1,0)
 
@@ -590,6 +737,9 @@ void SettingsDialog::acceptGraphicsTab()
     s_settings->documentView().setThumbnailSize(m_thumbnailSizeSpinBox->value());
 
     s_settings->pageItem().setCacheSize(m_cacheSizeComboBox->itemData(m_cacheSizeComboBox->currentIndex()).toInt());
+    s_settings->pageItem().setDiskCacheSize(m_diskCacheSizeComboBox->itemData(m_diskCacheSizeComboBox->currentIndex()).toInt());
+    s_settings->pageItem().setThumbnailCacheSize(m_thumbnailCacheSizeComboBox->itemData(m_thumbnailCacheSizeComboBox->currentIndex()).toInt());
+    s_settings->documentView().setMemoryLimit(m_memoryLimitSpinBox->value());
     s_settings->documentView().setPrefetch(m_prefetchCheckBox->isChecked());
     s_settings->documentView().setPrefetchDistance(m_prefetchDistanceSpinBox->value());
 
@@ -612,7 +762,16 @@ void SettingsDialog::acceptGraphicsTab()
 void SettingsDialog::resetGraphicsTab()
 {
     m_useTilingCheckBox->setChecked(Defaults::PageItem::useTiling());
+    m_useTilePyramidCheckBox->setChecked(Defaults::PageItem::useTilePyramid());
     m_keepObsoletePixmapsCheckBox->setChecked(Defaults::PageItem::keepObsoletePixmaps());
+    m_progressiveRenderingCheckBox->setChecked(Defaults::PageItem::progressiveRendering());
+    m_renderOutOfProcessCheckBox->setChecked(Defaults::PageItem::renderOutOfProcess());
+
+#ifdef WITH_OPENGL
+
+    m_useOpenGLCheckBox->setChecked(Defaults::DocumentView::useOpenGL());
+
+#endif // WITH_OPENGL
 
 #if QT_VERSION >= QT_VERSION_CHECK(5,1,0)
 
@@ -638,6 +797,9 @@ void SettingsDialog::resetGraphicsTab()
     m_thumbnailSizeSpinBox->setValue(Defaults::DocumentView::thumbnailSize());
 
     m_cacheSizeComboBox->setCurrentIndex(m_cacheSizeComboBox->findData(Defaults::PageItem::cacheSize()));
+    m_diskCacheSizeComboBox->setCurrentIndex(m_diskCacheSizeComboBox->findData(Defaults::PageItem::diskCacheSize()));
+    m_thumbnailCacheSizeComboBox->setCurrentIndex(m_thumbnailCacheSizeComboBox->findData(Defaults::PageItem::thumbnailCacheSize()));
+    m_memoryLimitSpinBox->setValue(Defaults::DocumentView::memoryLimit());
     m_prefetchCheckBox->setChecked(Defaults::DocumentView::prefetch());
     m_prefetchDistanceSpinBox->setValue(Defaults::DocumentView::prefetchDistance());
 
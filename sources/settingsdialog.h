@@ -83,6 +83,8 @@ private:
 
     QCheckBox* m_autoRefreshCheckBox;
 
+    QCheckBox* m_indexTextCheckBox;
+
     QCheckBox* m_trackRecentlyUsedCheckBox;
     QCheckBox* m_keepRecentlyClosedCheckBox;
 
@@ -91,12 +93,15 @@ private:
     QCheckBox* m_restorePerFileSettingsCheckBox;
     QSpinBox* m_saveDatabaseInterval;
 
+    QSpinBox* m_hibernateTabsTimeoutSpinBox;
+
     QCheckBox* m_synchronizePresentationCheckBox;
     QSpinBox* m_presentationScreenSpinBox;
 
     QCheckBox* m_synchronizeOutlineViewCheckBox;
 
     QDoubleSpinBox* m_zoomFactorSpinBox;
+    QSpinBox* m_zoomGestureTimeoutSpinBox;
 
     QSpinBox* m_highlightDurationSpinBox;
     QComboBox* m_highlightColorComboBox;
@@ -111,7 +116,16 @@ private:
     // graphics
 
     QCheckBox* m_useTilingCheckBox;
+    QCheckBox* m_useTilePyramidCheckBox;
     QCheckBox* m_keepObsoletePixmapsCheckBox;
+    QCheckBox* m_progressiveRenderingCheckBox;
+    QCheckBox* m_renderOutOfProcessCheckBox;
+
+#ifdef WITH_OPENGL
+
+    QCheckBox* m_useOpenGLCheckBox;
+
+#endif // WITH_OPENGL
 
 #if QT_VERSION >= QT_VERSION_CHECK(5,1,0)
 
@@ -137,6 +151,9 @@ private:
     QDoubleSpinBox* m_thumbnailSizeSpinBox;
 
     QComboBox* m_cacheSizeComboBox;
+    QComboBox* m_diskCacheSizeComboBox;
+    QComboBox* m_thumbnailCacheSizeComboBox;
+    QSpinBox* m_memoryLimitSpinBox;
     QCheckBox* m_prefetchCheckBox;
     QSpinBox* m_prefetchDistanceSpinBox;
 
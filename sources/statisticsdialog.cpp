@@ -0,0 +1,189 @@
+/*
+
+Copyright 2014 Adam Reichold
+
+This file is part of qpdfview.
+
+qpdfview is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+qpdfview is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "statisticsdialog.h"
+
+#include <QDialogButtonBox>
+#include <QHeaderView>
+#include <QLabel>
+#include <QMap>
+#include <QPushButton>
+#include <QStandardItemModel>
+#include <QTableView>
+#include <QVBoxLayout>
+
+#include "settings.h"
+#include "cachebudget.h"
+#include "pluginhandler.h"
+#include "renderscheduler.h"
+#include "renderstatistics.h"
+#include "tileitem.h"
+#include "documentview.h"
+
+namespace
+{
+
+using namespace qpdfview;
+
+QList< QStandardItem* > createRow(const QString& name, const QString& type, const RenderStatistics::Counters& counters, int tileSize = 0)
+{
+    QList< QStandardItem* > row;
+
+    row.append(new QStandardItem(name));
+    row.append(new QStandardItem(type));
+
+    row.append(new QStandardItem(QString::number(counters.renderCount)));
+    row.append(new QStandardItem(QString::number(counters.cancelCount)));
+    row.append(new QStandardItem(QString::number(counters.diskCacheHits)));
+
+    row.append(new QStandardItem(QString::number(counters.averageQueueTime(), 'f', 1)));
+    row.append(new QStandardItem(QString::number(counters.averageRenderTime(), 'f', 1)));
+    row.append(new QStandardItem(QString::number(counters.averagePostProcessTime(), 'f', 1)));
+
+    qreal costPerCall = 0.0;
+    qreal costPerMegapixel = 0.0;
+
+    if(counters.fitRenderCost(costPerCall, costPerMegapixel))
+    {
+        row.append(new QStandardItem(QString::number(costPerCall, 'f', 1)));
+        row.append(new QStandardItem(QString::number(costPerMegapixel, 'f', 1)));
+    }
+    else
+    {
+        row.append(new QStandardItem());
+        row.append(new QStandardItem());
+    }
+
+    row.append(new QStandardItem(tileSize > 0 ? QString::number(tileSize) : QString()));
+
+    row.append(new QStandardItem(QString::number(counters.searchedPages)));
+    row.append(new QStandardItem(QString::number(counters.searchedPagesPerSecond(), 'f', 1)));
+
+    return row;
+}
+
+} // anonymous
+
+namespace qpdfview
+{
+
+StatisticsDialog::StatisticsDialog(const QList< DocumentView* >& tabs, QWidget* parent) : QDialog(parent),
+    m_tabs(tabs)
+{
+    setWindowTitle(tr("Statistics") + QLatin1String(" - qpdfview"));
+
+    m_model = new QStandardItemModel(this);
+
+    m_tableView = new QTableView(this);
+    m_tableView->setModel(m_model);
+
+    m_tableView->setAlternatingRowColors(true);
+    m_tableView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_tableView->setHorizontalScrollMode(QAbstractItemView::ScrollPerPixel);
+
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+
+    m_tableView->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    m_tableView->verticalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+
+#else
+
+    m_tableView->horizontalHeader()->setResizeMode(QHeaderView::ResizeToContents);
+    m_tableView->verticalHeader()->setResizeMode(QHeaderView::ResizeToContents);
+
+#endif // QT_VERSION
+
+    m_tableView->verticalHeader()->setVisible(false);
+
+    m_summaryLabel = new QLabel(this);
+    m_summaryLabel->setWordWrap(true);
+
+    m_dialogButtonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Reset, Qt::Horizontal, this);
+    connect(m_dialogButtonBox, SIGNAL(accepted()), SLOT(accept()));
+    connect(m_dialogButtonBox, SIGNAL(rejected()), SLOT(reject()));
+
+    connect(m_dialogButtonBox->button(QDialogButtonBox::Reset), SIGNAL(clicked()), SLOT(on_reset_clicked()));
+
+    setLayout(new QVBoxLayout(this));
+    layout()->addWidget(m_tableView);
+    layout()->addWidget(m_summaryLabel);
+    layout()->addWidget(m_dialogButtonBox);
+
+    updateStatistics();
+
+    resize(Settings::instance()->mainWindow().statisticsDialogSize(sizeHint()));
+}
+
+StatisticsDialog::~StatisticsDialog()
+{
+    Settings::instance()->mainWindow().setStatisticsDialogSize(size());
+}
+
+void StatisticsDialog::on_reset_clicked()
+{
+    RenderStatistics::reset();
+    TileItem::resetCacheStatistics();
+
+    updateStatistics();
+}
+
+void StatisticsDialog::updateStatistics()
+{
+    m_model->clear();
+
+    m_model->setHorizontalHeaderLabels(QStringList()
+                                       << tr("Document") << tr("Type")
+                                       << tr("Renders") << tr("Canceled") << tr("From disk cache")
+                                       << tr("Queue wait (ms)") << tr("Render (ms)") << tr("Post-processing (ms)")
+                                       << tr("Per call (ms)") << tr("Per megapixel (ms)") << tr("Tile size")
+                                       << tr("Searched pages") << tr("Pages per second"));
+
+    // The open documents are summed up per backend so that the backends can be compared.
+
+    QMap< QString, RenderStatistics::Counters > countersByType;
+
+    foreach(const DocumentView* tab, m_tabs)
+    {
+        const QString type = PluginHandler::fileTypeName(PluginHandler::fileType(tab->fileInfo().filePath()));
+
+        RenderStatistics::Counters counters = RenderStatistics::counters(tab->scene());
+        counters += RenderStatistics::counters(tab);
+
+        m_model->appendRow(createRow(tab->fileInfo().fileName(), type, counters, RenderStatistics::tileSize(tab->scene())));
+
+        countersByType[type] += counters;
+    }
+
+    for(QMap< QString, RenderStatistics::Counters >::const_iterator iterator = countersByType.constBegin(); iterator != countersByType.constEnd(); ++iterator)
+    {
+        m_model->appendRow(createRow(tr("All open documents"), iterator.key(), iterator.value()));
+    }
+
+    m_model->appendRow(createRow(tr("Total"), QString(), RenderStatistics::totalCounters()));
+
+    const RenderScheduler* renderScheduler = RenderScheduler::instance();
+
+    m_summaryLabel->setText(tr("Tile cache: %1").arg(CacheBudget::instance()->statistics()) + QLatin1Char('\n')
+                            + tr("Scheduler: %1 queued, %2 of %3 threads active")
+                            .arg(renderScheduler->queuedCount()).arg(renderScheduler->activeCount()).arg(renderScheduler->maxThreadCount()));
+}
+
+} // qpdfview
@@ -0,0 +1,66 @@
+/*
+
+Copyright 2014 Adam Reichold
+
+This file is part of qpdfview.
+
+qpdfview is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+qpdfview is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef STATISTICSDIALOG_H
+#define STATISTICSDIALOG_H
+
+#include <QDialog>
+
+class QDialogButtonBox;
+class QLabel;
+class QStandardItemModel;
+class QTableView;
+
+namespace qpdfview
+{
+
+class DocumentView;
+
+class StatisticsDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    StatisticsDialog(const QList< DocumentView* >& tabs, QWidget* parent = 0);
+    ~StatisticsDialog();
+
+protected slots:
+    void on_reset_clicked();
+
+private:
+    Q_DISABLE_COPY(StatisticsDialog)
+
+    QList< DocumentView* > m_tabs;
+
+    QStandardItemModel* m_model;
+    QTableView* m_tableView;
+
+    QLabel* m_summaryLabel;
+
+    QDialogButtonBox* m_dialogButtonBox;
+
+    void updateStatistics();
+
+};
+
+} // qpdfview
+
+#endif // STATISTICSDIALOG_H
@@ -0,0 +1,115 @@
+/*
+
+Copyright 2014 Adam Reichold
+
+This file is part of qpdfview.
+
+qpdfview is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+qpdfview is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "synctexscanner.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QRectF>
+
+#include <synctex_parser.h>
+
+namespace qpdfview
+{
+
+SyncTeXScanner* SyncTeXScanner::load(const QString& filePath)
+{
+    synctex_scanner_t scanner = synctex_scanner_new_with_output_file(filePath.toLocal8Bit(), 0, 1);
+
+    return scanner != 0 ? new SyncTeXScanner(scanner) : 0;
+}
+
+SyncTeXScanner::~SyncTeXScanner()
+{
+    synctex_scanner_free(m_scanner);
+}
+
+bool SyncTeXScanner::hasData(const QString& filePath)
+{
+    const QFileInfo fileInfo(filePath);
+    const QDir dir = fileInfo.dir();
+
+    return dir.exists(fileInfo.completeBaseName() + QLatin1String(".synctex.gz"))
+            || dir.exists(fileInfo.completeBaseName() + QLatin1String(".synctex"));
+}
+
+bool SyncTeXScanner::isOutdated() const
+{
+    const QFileInfo fileInfo(m_syncTeXFilePath);
+
+    return !fileInfo.exists() || fileInfo.lastModified() != m_lastModified;
+}
+
+bool SyncTeXScanner::findSource(int page, const QPointF& pos, QString& sourceName, int& sourceLine, int& sourceColumn) const
+{
+    if(synctex_edit_query(m_scanner, page, pos.x(), pos.y()) > 0)
+    {
+        synctex_node_t node = synctex_next_result(m_scanner);
+
+        if(node != 0)
+        {
+            sourceName = QString::fromLocal8Bit(synctex_scanner_get_name(m_scanner, synctex_node_tag(node)));
+            sourceLine = qMax(synctex_node_line(node), 0);
+            sourceColumn = qMax(synctex_node_column(node), 0);
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool SyncTeXScanner::findPosition(const QString& sourceName, int sourceLine, int sourceColumn, int& page, QRectF& enclosingBox) const
+{
+    page = -1;
+    enclosingBox = QRectF();
+
+    if(synctex_display_query(m_scanner, sourceName.toLocal8Bit(), sourceLine, sourceColumn) > 0)
+    {
+        for(synctex_node_t node = synctex_next_result(m_scanner); node != 0; node = synctex_next_result(m_scanner))
+        {
+            const int nodePage = synctex_node_page(node);
+            const QRectF nodeBox(synctex_node_box_visible_h(node), synctex_node_box_visible_v(node), synctex_node_box_visible_width(node), synctex_node_box_visible_height(node));
+
+            if(page != nodePage)
+            {
+                page = nodePage;
+                enclosingBox = nodeBox;
+            }
+            else
+            {
+                enclosingBox = enclosingBox.united(nodeBox);
+            }
+        }
+    }
+
+    return page != -1;
+}
+
+SyncTeXScanner::SyncTeXScanner(__synctex_scanner_t* scanner) :
+    m_scanner(scanner),
+    m_syncTeXFilePath(QString::fromLocal8Bit(synctex_scanner_get_synctex(scanner))),
+    m_lastModified(QFileInfo(m_syncTeXFilePath).lastModified())
+{
+}
+
+} // qpdfview
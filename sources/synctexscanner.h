@@ -0,0 +1,76 @@
+/*
+
+Copyright 2014 Adam Reichold
+
+This file is part of qpdfview.
+
+qpdfview is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+qpdfview is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef SYNCTEXSCANNER_H
+#define SYNCTEXSCANNER_H
+
+#include <QDateTime>
+#include <QString>
+
+class QPointF;
+class QRectF;
+
+struct __synctex_scanner_t;
+
+namespace qpdfview
+{
+
+// Keeps the SyncTeX data of an output file parsed, since parsing it again for every query takes seconds for large documents.
+// Queries iterate the internal state of the scanner and hence must not be made concurrently.
+
+class SyncTeXScanner
+{
+public:
+    // Parses the SyncTeX data of the given output file and yields null if there is none.
+
+    static SyncTeXScanner* load(const QString& filePath);
+    ~SyncTeXScanner();
+
+    // Whether SyncTeX data which seems to belong to the given output file exists so that it is worth parsing it in advance.
+
+    static bool hasData(const QString& filePath);
+
+    // Whether the SyncTeX data was modified or removed since it was parsed.
+
+    bool isOutdated() const;
+
+    bool findSource(int page, const QPointF& pos, QString& sourceName, int& sourceLine, int& sourceColumn) const;
+
+    // The boxes of the results on the page of the last result are united.
+
+    bool findPosition(const QString& sourceName, int sourceLine, int sourceColumn, int& page, QRectF& enclosingBox) const;
+
+private:
+    Q_DISABLE_COPY(SyncTeXScanner)
+
+    SyncTeXScanner(__synctex_scanner_t* scanner);
+
+    __synctex_scanner_t* m_scanner;
+
+    QString m_syncTeXFilePath;
+    QDateTime m_lastModified;
+
+};
+
+} // qpdfview
+
+#endif // SYNCTEXSCANNER_H
@@ -0,0 +1,126 @@
+/*
+
+Copyright 2014 Adam Reichold
+
+This file is part of qpdfview.
+
+qpdfview is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+qpdfview is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "textindex.h"
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QRectF>
+#include <QRegExp>
+
+#include "model.h"
+
+namespace
+{
+
+const quint32 textIndexMagic = 0x71706478; // "qpdx"
+const quint32 textIndexVersion = 1;
+
+} // anonymous
+
+namespace qpdfview
+{
+
+TextIndex::TextIndex() :
+    m_pageTexts()
+{
+}
+
+TextIndex::TextIndex(const QVector< QString >& pageTexts) :
+    m_pageTexts(pageTexts)
+{
+}
+
+bool TextIndex::mayContain(int index, const QStringList& terms, bool matchCase) const
+{
+    if(index < 0 || index >= m_pageTexts.count())
+    {
+        return true;
+    }
+
+    const QString& pageText = m_pageTexts.at(index);
+
+    foreach(const QString& term, terms)
+    {
+        if(!pageText.contains(term, matchCase ? Qt::CaseSensitive : Qt::CaseInsensitive))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+QStringList TextIndex::terms(const QString& text)
+{
+    // Terms are matched separately since the order of the extracted text need not agree with that used by the backend search.
+
+    return text.split(QRegExp("\\s+"), QString::SkipEmptyParts);
+}
+
+QString TextIndex::pageText(Model::Page* page)
+{
+    return page->text(QRectF(QPointF(), page->size())).simplified();
+}
+
+QByteArray TextIndex::save() const
+{
+    QByteArray data;
+
+    QDataStream(&data, QIODevice::WriteOnly)
+            << textIndexMagic
+            << textIndexVersion
+            << m_pageTexts;
+
+    return qCompress(data);
+}
+
+TextIndex TextIndex::restore(const QByteArray& data, int numberOfPages)
+{
+    if(data.isEmpty())
+    {
+        return TextIndex();
+    }
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    QVector< QString > pageTexts;
+
+    QDataStream stream(qUncompress(data));
+
+    stream >> magic >> version;
+
+    if(magic != textIndexMagic || version != textIndexVersion)
+    {
+        return TextIndex();
+    }
+
+    stream >> pageTexts;
+
+    if(stream.status() != QDataStream::Ok || pageTexts.count() != numberOfPages)
+    {
+        return TextIndex();
+    }
+
+    return TextIndex(pageTexts);
+}
+
+} // qpdfview
@@ -0,0 +1,66 @@
+/*
+
+Copyright 2014 Adam Reichold
+
+This file is part of qpdfview.
+
+qpdfview is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+qpdfview is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef TEXTINDEX_H
+#define TEXTINDEX_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class QByteArray;
+
+namespace qpdfview
+{
+
+namespace Model
+{
+class Page;
+}
+
+// The text of all pages is kept so that a search only has to ask the backend for the boxes on pages which contain every term of the query.
+
+class TextIndex
+{
+public:
+    TextIndex();
+    explicit TextIndex(const QVector< QString >& pageTexts);
+
+    inline bool isEmpty() const { return m_pageTexts.isEmpty(); }
+    inline int count() const { return m_pageTexts.count(); }
+
+    bool mayContain(int index, const QStringList& terms, bool matchCase) const;
+
+    static QStringList terms(const QString& text);
+
+    static QString pageText(Model::Page* page);
+
+    QByteArray save() const;
+    static TextIndex restore(const QByteArray& data, int numberOfPages);
+
+private:
+    QVector< QString > m_pageTexts;
+
+};
+
+} // qpdfview
+
+#endif // TEXTINDEX_H
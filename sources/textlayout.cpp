@@ -0,0 +1,217 @@
+/*
+
+Copyright 2014 Adam Reichold
+
+This file is part of qpdfview.
+
+qpdfview is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+qpdfview is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "textlayout.h"
+
+#include <QStringList>
+#include <QtAlgorithms>
+
+namespace qpdfview
+{
+
+TextLayout::TextLayout(const QList< Model::TextBox >& textBoxes) :
+    m_string(),
+    m_offsets(),
+    m_lengths(),
+    m_boxes()
+{
+    m_offsets.reserve(textBoxes.count());
+    m_lengths.reserve(textBoxes.count());
+    m_boxes.reserve(textBoxes.count());
+
+    foreach(const Model::TextBox& textBox, textBoxes)
+    {
+        const QString text = textBox.text.simplified();
+
+        if(text.isEmpty())
+        {
+            continue;
+        }
+
+        if(!m_string.isEmpty())
+        {
+            m_string.append(QLatin1Char(' '));
+        }
+
+        m_offsets.append(m_string.length());
+        m_lengths.append(text.length());
+        m_boxes.append(textBox.boundingBox.normalized());
+
+        m_string.append(text);
+    }
+
+    m_string.squeeze();
+}
+
+int TextLayout::cost() const
+{
+    return m_string.length() * sizeof(QChar) + m_boxes.count() * (2 * sizeof(int) + sizeof(QRectF));
+}
+
+QString TextLayout::text(const QRectF& rect) const
+{
+    // Characters are selected if the center of their share of the bounding box lies within the rectangle.
+
+    QStringList words;
+
+    for(int box = 0; box < m_boxes.count(); ++box)
+    {
+        if(!rect.intersects(m_boxes.at(box)))
+        {
+            continue;
+        }
+
+        const int length = m_lengths.at(box);
+
+        int begin = 0;
+        int end = length;
+
+        while(begin < length && !rect.contains(characterBox(box, begin, begin + 1).center()))
+        {
+            ++begin;
+        }
+
+        while(end > begin && !rect.contains(characterBox(box, end - 1, end).center()))
+        {
+            --end;
+        }
+
+        if(begin < end)
+        {
+            words.append(m_string.mid(m_offsets.at(box) + begin, end - begin));
+        }
+    }
+
+    return words.join(" ");
+}
+
+QList< QRectF > TextLayout::search(const QString& text, bool matchCase) const
+{
+    QList< QRectF > results;
+
+    const QString needle = text.simplified();
+
+    if(needle.isEmpty())
+    {
+        return results;
+    }
+
+    const Qt::CaseSensitivity caseSensitivity = matchCase ? Qt::CaseSensitive : Qt::CaseInsensitive;
+
+    for(int position = m_string.indexOf(needle, 0, caseSensitivity); position != -1; position = m_string.indexOf(needle, position + needle.length(), caseSensitivity))
+    {
+        const QRectF result = hitBox(position, needle.length());
+
+        if(!result.isNull())
+        {
+            results.append(result);
+        }
+    }
+
+    return results;
+}
+
+QList< QRectF > TextLayout::search(const QRegExp& pattern) const
+{
+    QList< QRectF > results;
+
+    if(pattern.isEmpty() || !pattern.isValid())
+    {
+        return results;
+    }
+
+    // The pattern keeps its match state, so every caller works on its own copy.
+
+    QRegExp regExp(pattern);
+
+    for(int position = regExp.indexIn(m_string); position != -1; position = regExp.indexIn(m_string, position + qMax(regExp.matchedLength(), 1)))
+    {
+        if(regExp.matchedLength() <= 0)
+        {
+            continue;
+        }
+
+        const QRectF result = hitBox(position, regExp.matchedLength());
+
+        if(!result.isNull())
+        {
+            results.append(result);
+        }
+    }
+
+    return results;
+}
+
+QRegExp TextLayout::pattern(const QString& text, bool matchCase, bool wholeWords, bool regularExpression)
+{
+    QString pattern = regularExpression ? text : QRegExp::escape(text.simplified());
+
+    if(pattern.isEmpty())
+    {
+        return QRegExp();
+    }
+
+    if(wholeWords)
+    {
+        pattern = QString("\\b(?:%1)\\b").arg(pattern);
+    }
+
+    return QRegExp(pattern, matchCase ? Qt::CaseSensitive : Qt::CaseInsensitive, QRegExp::RegExp2);
+}
+
+int TextLayout::boxAt(int position) const
+{
+    // index of the last box which begins at or before the position
+
+    const int box = qUpperBound(m_offsets.constBegin(), m_offsets.constEnd(), position) - m_offsets.constBegin() - 1;
+
+    return qMax(box, 0);
+}
+
+QRectF TextLayout::hitBox(int position, int length) const
+{
+    const int end = position + length;
+
+    QRectF result;
+
+    for(int box = boxAt(position); box < m_boxes.count() && m_offsets.at(box) < end; ++box)
+    {
+        const int begin = qMax(position - m_offsets.at(box), 0);
+        const int boxEnd = qMin(end - m_offsets.at(box), m_lengths.at(box));
+
+        if(begin < boxEnd)
+        {
+            result = result.united(characterBox(box, begin, boxEnd));
+        }
+    }
+
+    return result;
+}
+
+QRectF TextLayout::characterBox(int box, int begin, int end) const
+{
+    const QRectF& boundingBox = m_boxes.at(box);
+    const qreal width = boundingBox.width() / m_lengths.at(box);
+
+    return QRectF(boundingBox.left() + begin * width, boundingBox.top(), (end - begin) * width, boundingBox.height());
+}
+
+} // qpdfview
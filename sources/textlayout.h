@@ -0,0 +1,73 @@
+/*
+
+Copyright 2014 Adam Reichold
+
+This file is part of qpdfview.
+
+qpdfview is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+qpdfview is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef TEXTLAYOUT_H
+#define TEXTLAYOUT_H
+
+#include <QList>
+#include <QRectF>
+#include <QRegExp>
+#include <QString>
+#include <QVector>
+
+#include "model.h"
+
+namespace qpdfview
+{
+
+// The words of a page are joined into a single string and each character is mapped back to a share of the bounding box of its word,
+// so that text extraction and search can be answered without going back to the backend.
+
+class TextLayout
+{
+public:
+    explicit TextLayout(const QList< Model::TextBox >& textBoxes = QList< Model::TextBox >());
+
+    inline bool isEmpty() const { return m_boxes.isEmpty(); }
+
+    inline const QString& string() const { return m_string; }
+
+    int cost() const;
+
+    QString text(const QRectF& rect) const;
+    QList< QRectF > search(const QString& text, bool matchCase) const;
+    QList< QRectF > search(const QRegExp& pattern) const;
+
+    // Whole words are matched by anchoring the pattern at word boundaries and literal text is escaped unless it is a regular expression.
+
+    static QRegExp pattern(const QString& text, bool matchCase, bool wholeWords, bool regularExpression);
+
+private:
+    QString m_string;
+
+    QVector< int > m_offsets;
+    QVector< int > m_lengths;
+    QVector< QRectF > m_boxes;
+
+    int boxAt(int position) const;
+    QRectF hitBox(int position, int length) const;
+    QRectF characterBox(int box, int begin, int end) const;
+
+};
+
+} // qpdfview
+
+#endif // TEXTLAYOUT_H
@@ -0,0 +1,360 @@
+/*
+
+Copyright 2014 Adam Reichold
+
+This file is part of qpdfview.
+
+qpdfview is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+qpdfview is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "tilecache.h"
+
+#include "imagebufferpool.h"
+
+namespace qpdfview
+{
+
+TileCache::TileCache(int maxCost) :
+    m_maxCost(maxCost),
+    m_totalCost(0),
+    m_backgroundMaxCost(maxCost),
+    m_foregroundCost(0),
+    m_foregroundPages(),
+    m_pageCosts(),
+    m_statistics(),
+    m_nodes(),
+    m_pages(),
+    m_first(0),
+    m_last(0)
+{
+}
+
+TileCache::~TileCache()
+{
+    clear();
+}
+
+void TileCache::setMaxCost(int maxCost)
+{
+    m_maxCost = maxCost;
+
+    evict(m_maxCost);
+}
+
+void TileCache::setBackgroundMaxCost(int backgroundMaxCost)
+{
+    m_backgroundMaxCost = backgroundMaxCost;
+
+    evictBackground(m_backgroundMaxCost);
+}
+
+void TileCache::setForegroundPages(const QSet< int >& pages)
+{
+    m_foregroundPages = pages;
+    m_foregroundCost = 0;
+
+    foreach(int page, m_foregroundPages)
+    {
+        m_foregroundCost += m_pageCosts.value(page, 0);
+    }
+
+    evictBackground(m_backgroundMaxCost);
+}
+
+const TileObject* TileCache::object(const TileKey& key)
+{
+    Node* node = m_nodes.value(key, 0);
+
+    if(node == 0)
+    {
+        ++m_statistics.misses;
+
+        return 0;
+    }
+
+    ++m_statistics.hits;
+
+    if(node != m_last)
+    {
+        // least recently used order
+
+        if(node->previous != 0)
+        {
+            node->previous->next = node->next;
+        }
+        else
+        {
+            m_first = node->next;
+        }
+
+        node->next->previous = node->previous;
+
+        node->previous = m_last;
+        node->next = 0;
+
+        m_last->next = node;
+        m_last = node;
+    }
+
+    return &node->object;
+}
+
+void TileCache::insert(const TileKey& key, const TileObject& object, int cost)
+{
+    remove(key);
+
+    if(cost > m_maxCost)
+    {
+        return;
+    }
+
+    evict(m_maxCost - cost);
+
+    Node* node = new Node;
+
+    node->key = key;
+    node->object = object;
+    node->cost = cost;
+
+    link(node);
+
+    if(!m_foregroundPages.contains(key.page))
+    {
+        evictBackground(m_backgroundMaxCost);
+    }
+}
+
+QList< TileCache::Entry > TileCache::entriesOnPage(int page) const
+{
+    QList< Entry > entries;
+
+    for(const Node* node = m_pages.value(page, 0); node != 0; node = node->nextOnPage)
+    {
+        entries.append(qMakePair(node->key, node->object));
+    }
+
+    return entries;
+}
+
+void TileCache::remove(const TileKey& key)
+{
+    Node* node = m_nodes.value(key, 0);
+
+    if(node != 0)
+    {
+        unlink(node);
+        destroy(node);
+    }
+}
+
+void TileCache::removePage(int page)
+{
+    Node* node = m_pages.value(page, 0);
+
+    while(node != 0)
+    {
+        Node* nextOnPage = node->nextOnPage;
+
+        unlink(node);
+        destroy(node);
+
+        node = nextOnPage;
+    }
+}
+
+void TileCache::clear()
+{
+    Node* node = m_first;
+
+    while(node != 0)
+    {
+        Node* next = node->next;
+
+        destroy(node);
+
+        node = next;
+    }
+
+    m_nodes.clear();
+    m_pages.clear();
+    m_pageCosts.clear();
+
+    m_first = m_last = 0;
+
+    m_totalCost = 0;
+    m_foregroundCost = 0;
+}
+
+void TileCache::link(Node* node)
+{
+    // least recently used order
+
+    node->previous = m_last;
+    node->next = 0;
+
+    if(m_last != 0)
+    {
+        m_last->next = node;
+    }
+    else
+    {
+        m_first = node;
+    }
+
+    m_last = node;
+
+    // per-page bucket
+
+    Node*& firstOnPage = m_pages[node->key.page];
+
+    node->previousOnPage = 0;
+    node->nextOnPage = firstOnPage;
+
+    if(firstOnPage != 0)
+    {
+        firstOnPage->previousOnPage = node;
+    }
+
+    firstOnPage = node;
+
+    m_nodes.insert(node->key, node);
+    m_totalCost += node->cost;
+
+    m_pageCosts[node->key.page] += node->cost;
+
+    if(m_foregroundPages.contains(node->key.page))
+    {
+        m_foregroundCost += node->cost;
+    }
+}
+
+void TileCache::unlink(Node* node)
+{
+    // least recently used order
+
+    if(node->previous != 0)
+    {
+        node->previous->next = node->next;
+    }
+    else
+    {
+        m_first = node->next;
+    }
+
+    if(node->next != 0)
+    {
+        node->next->previous = node->previous;
+    }
+    else
+    {
+        m_last = node->previous;
+    }
+
+    // per-page bucket
+
+    if(node->previousOnPage != 0)
+    {
+        node->previousOnPage->nextOnPage = node->nextOnPage;
+    }
+    else if(node->nextOnPage != 0)
+    {
+        m_pages.insert(node->key.page, node->nextOnPage);
+    }
+    else
+    {
+        m_pages.remove(node->key.page);
+    }
+
+    if(node->nextOnPage != 0)
+    {
+        node->nextOnPage->previousOnPage = node->previousOnPage;
+    }
+
+    m_nodes.remove(node->key);
+    m_totalCost -= node->cost;
+
+    QHash< int, int >::iterator pageCost = m_pageCosts.find(node->key.page);
+
+    if(pageCost != m_pageCosts.end() && (pageCost.value() -= node->cost) <= 0)
+    {
+        m_pageCosts.erase(pageCost);
+    }
+
+    if(m_foregroundPages.contains(node->key.page))
+    {
+        m_foregroundCost -= node->cost;
+    }
+}
+
+void TileCache::destroy(Node* node)
+{
+    QImage image;
+
+    if(node->object.isCompact())
+    {
+        image = node->object.image;
+    }
+
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+
+    else
+    {
+        // Raster pixmaps share their buffer with the image returned here.
+
+        image = node->object.pixmap.toImage();
+    }
+
+#endif // QT_VERSION
+
+    delete node;
+
+    ImageBufferPool::instance()->recycle(image);
+}
+
+void TileCache::evict(int maxCost)
+{
+    while(m_totalCost > maxCost && m_first != 0)
+    {
+        Node* node = m_first;
+
+        unlink(node);
+        destroy(node);
+
+        ++m_statistics.evictions;
+    }
+}
+
+void TileCache::evictBackground(int backgroundMaxCost)
+{
+    Node* node = m_first;
+
+    while(backgroundCost() > backgroundMaxCost && node != 0)
+    {
+        Node* next = node->next;
+
+        if(!m_foregroundPages.contains(node->key.page))
+        {
+            unlink(node);
+            destroy(node);
+
+            ++m_statistics.evictions;
+            ++m_statistics.backgroundEvictions;
+        }
+
+        node = next;
+    }
+}
+
+} // qpdfview
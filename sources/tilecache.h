@@ -0,0 +1,202 @@
+/*
+
+Copyright 2014 Adam Reichold
+
+This file is part of qpdfview.
+
+qpdfview is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+qpdfview is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef TILECACHE_H
+#define TILECACHE_H
+
+#include <QHash>
+#include <QImage>
+#include <QList>
+#include <QPair>
+#include <QPixmap>
+#include <QRect>
+#include <QSet>
+
+#include "global.h"
+
+namespace qpdfview
+{
+
+struct TileKey
+{
+    int page;
+
+    int resolutionX;
+    int resolutionY;
+    qreal scaleFactor;
+    Rotation rotation;
+    bool invertColors;
+    bool convertToGrayscale;
+
+    bool preview;
+
+    QRect rect;
+
+    bool operator==(const TileKey& other) const
+    {
+        return page == other.page
+                && resolutionX == other.resolutionX
+                && resolutionY == other.resolutionY
+                && scaleFactor == other.scaleFactor
+                && rotation == other.rotation
+                && invertColors == other.invertColors
+                && convertToGrayscale == other.convertToGrayscale
+                && preview == other.preview
+                && rect == other.rect;
+    }
+
+};
+
+inline uint qHash(const TileKey& key)
+{
+    uint hash = static_cast< uint >(key.page);
+
+    hash = 31 * hash + static_cast< uint >(key.resolutionX);
+    hash = 31 * hash + static_cast< uint >(key.resolutionY);
+    hash = 31 * hash + static_cast< uint >(qRound(key.scaleFactor * 1000.0));
+    hash = 31 * hash + static_cast< uint >(key.rotation);
+    hash = 31 * hash + (key.invertColors ? 1u : 0u) + (key.convertToGrayscale ? 2u : 0u) + (key.preview ? 4u : 0u);
+    hash = 31 * hash + static_cast< uint >(key.rect.x());
+    hash = 31 * hash + static_cast< uint >(key.rect.y());
+    hash = 31 * hash + static_cast< uint >(key.rect.width());
+    hash = 31 * hash + static_cast< uint >(key.rect.height());
+
+    return hash;
+}
+
+// Prefetched tiles in a compact format are kept as images and only converted into pixmaps when they are painted.
+
+struct TileObject
+{
+    QPixmap pixmap;
+    QImage image;
+    QRectF cropRect;
+
+    TileObject(const QPixmap& pixmap = QPixmap(), const QRectF& cropRect = QRectF()) : pixmap(pixmap), image(), cropRect(cropRect) {}
+    TileObject(const QImage& image, const QRectF& cropRect) : pixmap(), image(image), cropRect(cropRect) {}
+
+    inline bool isCompact() const { return pixmap.isNull() && !image.isNull(); }
+    inline QPixmap toPixmap() const { return isCompact() ? QPixmap::fromImage(image) : pixmap; }
+
+};
+
+class TileCache
+{
+public:
+    explicit TileCache(int maxCost = 0);
+    ~TileCache();
+
+    inline int maxCost() const { return m_maxCost; }
+    void setMaxCost(int maxCost);
+
+    inline int totalCost() const { return m_totalCost; }
+
+    // Entries of pages which are not in the foreground are evicted first once they exceed their share.
+
+    inline int backgroundMaxCost() const { return m_backgroundMaxCost; }
+    void setBackgroundMaxCost(int backgroundMaxCost);
+
+    inline int backgroundCost() const { return m_totalCost - m_foregroundCost; }
+
+    void setForegroundPages(const QSet< int >& pages);
+
+    struct Statistics
+    {
+        int hits;
+        int misses;
+        int evictions;
+        int backgroundEvictions;
+
+        Statistics() : hits(0), misses(0), evictions(0), backgroundEvictions(0) {}
+
+    };
+
+    inline const Statistics& statistics() const { return m_statistics; }
+    inline void resetStatistics() { m_statistics = Statistics(); }
+
+    inline int count() const { return m_nodes.count(); }
+
+    inline int pageCost(int page) const { return m_pageCosts.value(page, 0); }
+
+    inline bool contains(const TileKey& key) const { return m_nodes.contains(key); }
+
+    const TileObject* object(const TileKey& key);
+    void insert(const TileKey& key, const TileObject& object, int cost);
+
+    typedef QPair< TileKey, TileObject > Entry;
+
+    QList< Entry > entriesOnPage(int page) const;
+
+    void remove(const TileKey& key);
+    void removePage(int page);
+
+    void clear();
+
+private:
+    Q_DISABLE_COPY(TileCache)
+
+    struct Node
+    {
+        TileKey key;
+        TileObject object;
+        int cost;
+
+        // least recently used order
+        Node* previous;
+        Node* next;
+
+        // per-page bucket
+        Node* previousOnPage;
+        Node* nextOnPage;
+
+    };
+
+    int m_maxCost;
+    int m_totalCost;
+
+    int m_backgroundMaxCost;
+    int m_foregroundCost;
+
+    QSet< int > m_foregroundPages;
+    QHash< int, int > m_pageCosts;
+
+    Statistics m_statistics;
+
+    QHash< TileKey, Node* > m_nodes;
+    QHash< int, Node* > m_pages;
+
+    // least recently used first
+    Node* m_first;
+    Node* m_last;
+
+    void link(Node* node);
+    void unlink(Node* node);
+
+    void destroy(Node* node);
+
+    void evict(int maxCost);
+    void evictBackground(int backgroundMaxCost);
+
+};
+
+} // qpdfview
+
+#endif // TILECACHE_H
@@ -21,19 +21,63 @@ along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "tileitem.h"
 
+#include <QGraphicsScene>
+#include <qmath.h>
 #include <QPainter>
+#include <QRegion>
 #include <QTimer>
 
 #include "settings.h"
+#include "cachebudget.h"
+#include "diskcache.h"
 #include "rendertask.h"
+#include "renderworkerpool.h"
 #include "pageitem.h"
+#include "tracing.h"
+
+namespace
+{
+
+// The render tasks deliver images in the format of the raster pixmaps, so these share the pixels of the images instead of converting them.
+
+QPixmap convertToPixmap(const QImage& image)
+{
+    const qpdfview::TraceSpan span("tile", "convertToPixmap", "pixels", qint64(image.width()) * image.height());
+
+    return QPixmap::fromImage(image);
+}
+
+// Maps a rectangle on a page of the given size onto the page rotated clockwise by the given number of quarter turns.
+
+QRect rotateRect(const QRect& rect, const QSize& size, int turns)
+{
+    switch(turns)
+    {
+    default:
+    case 0:
+        return rect;
+    case 1:
+        return QRect(size.height() - rect.y() - rect.height(), rect.x(), rect.height(), rect.width());
+    case 2:
+        return QRect(size.width() - rect.x() - rect.width(), size.height() - rect.y() - rect.height(), rect.width(), rect.height());
+    case 3:
+        return QRect(rect.y(), size.width() - rect.x() - rect.width(), rect.height(), rect.width());
+    }
+}
+
+QRectF scaleRect(const QRectF& rect, qreal scale)
+{
+    return QRectF(scale * rect.x(), scale * rect.y(), scale * rect.width(), scale * rect.height());
+}
+
+} // anonymous
 
 namespace qpdfview
 {
 
 Settings* TileItem::s_settings = 0;
 
-QCache< TileItem::CacheKey, TileItem::CacheObject > TileItem::s_cache;
+TileCache TileItem::s_cache(32 * 1024 * 1024);
 
 TileItem::TileItem(QObject* parent) : QObject(parent),
     m_rect(),
@@ -48,11 +92,18 @@ TileItem::TileItem(QObject* parent) : QObject(parent),
         s_settings = Settings::instance();
     }
 
-    s_cache.setMaxCost(s_settings->pageItem().cacheSize());
+    CacheBudget::instance();
+
+    DiskCache::instance()->setMaxSize(static_cast< qint64 >(s_settings->pageItem().diskCacheSize()) * 1024 * 1024);
+    DiskCache::thumbnailInstance()->setMaxSize(static_cast< qint64 >(s_settings->pageItem().thumbnailCacheSize()) * 1024 * 1024);
+
+    RenderWorkerPool::instance()->setEnabled(s_settings->pageItem().renderOutOfProcess());
 
     m_renderTask = new RenderTask(parentPage()->m_page, this);
+    m_renderTask->setEmbeddedThumbnails(parentPage()->thumbnailMode());
 
     connect(m_renderTask, SIGNAL(finished()), SLOT(on_renderTask_finished()));
+    connect(m_renderTask, SIGNAL(previewReady(RenderParam,QRect,QImage)), SLOT(on_renderTask_previewReady(RenderParam,QRect,QImage)));
     connect(m_renderTask, SIGNAL(imageReady(RenderParam,QRect,bool,QImage,QRectF)), SLOT(on_renderTask_imageReady(RenderParam,QRect,bool,QImage,QRectF)));
 }
 
@@ -62,6 +113,11 @@ TileItem::~TileItem()
     m_renderTask->wait();
 }
 
+QRectF TileItem::displayedRect() const
+{
+    return scaleRect(m_rect, parentPage()->tileScale());
+}
+
 void TileItem::setCropRect(const QRectF& cropRect)
 {
     if(!s_settings->pageItem().trimMargins())
@@ -79,36 +135,268 @@ void TileItem::setCropRect(const QRectF& cropRect)
 
 void TileItem::dropCachedPixmaps(PageItem* page)
 {
-    foreach(CacheKey key, s_cache.keys())
+    s_cache.removePage(page->m_cacheId);
+}
+
+void TileItem::dropCachedPixmaps(int cacheId)
+{
+    s_cache.removePage(cacheId);
+}
+
+int TileItem::cacheCost(const PageItem* page)
+{
+    return s_cache.pageCost(page->m_cacheId);
+}
+
+int TileItem::cacheCost(int cacheId)
+{
+    return s_cache.pageCost(cacheId);
+}
+
+void TileItem::rotateCachedPixmaps(PageItem* page, Rotation oldRotation, const QSize& oldSize)
+{
+    const CacheKey key = page->m_tileItems.first()->cacheKey();
+    const int turns = (key.rotation - oldRotation + NumberOfRotations) % NumberOfRotations;
+
+    if(turns == 0)
+    {
+        return;
+    }
+
+    QList< QPair< QRect, QImage > > pieces;
+
+    foreach(const TileCache::Entry& entry, s_cache.entriesOnPage(key.page))
     {
-        if(key.first == page)
+        const CacheKey& other = entry.first;
+
+        if(other.preview || other.rotation != oldRotation || other.scaleFactor != key.scaleFactor
+                || other.resolutionX != key.resolutionX || other.resolutionY != key.resolutionY
+                || other.invertColors != key.invertColors || other.convertToGrayscale != key.convertToGrayscale)
+        {
+            continue;
+        }
+
+        const QImage image = entry.second.isCompact() ? entry.second.image : entry.second.pixmap.toImage();
+
+        if(!image.isNull() && !other.rect.isEmpty())
         {
-            s_cache.remove(key);
+            pieces.append(qMakePair(rotateRect(other.rect, oldSize, turns), image));
         }
     }
+
+    if(pieces.isEmpty())
+    {
+        return;
+    }
+
+    const TraceSpan span("tile", "rotateCachedPixmaps", "pieces", pieces.count());
+
+    // Rotating by quarter turns only moves pixels, so the result is the same as rendering the page again.
+
+    QTransform transform;
+    transform.rotate(90.0 * turns);
+
+    // Each piece is rotated once even if it contributes to several tiles.
+
+    for(int index = 0; index < pieces.count(); ++index)
+    {
+        pieces[index].second = pieces.at(index).second.transformed(transform);
+    }
+
+    const QRect& firstRect = pieces.first().first;
+    const QImage& firstImage = pieces.first().second;
+
+    const qreal ratioX = static_cast< qreal >(firstImage.width()) / firstRect.width();
+    const qreal ratioY = static_cast< qreal >(firstImage.height()) / firstRect.height();
+
+    foreach(TileItem* tile, page->m_tileItems)
+    {
+        const CacheKey tileKey = tile->cacheKey();
+
+        if(tile->m_rect.isEmpty() || s_cache.contains(tileKey))
+        {
+            continue;
+        }
+
+        // Overlapping pieces can add up to the area of the tile while still leaving holes.
+
+        QRegion uncoveredRegion(tile->m_rect);
+        bool hasAlphaChannel = false;
+
+        for(int index = 0; index < pieces.count(); ++index)
+        {
+            const QRect intersection = pieces.at(index).first.intersected(tile->m_rect);
+
+            if(!intersection.isEmpty())
+            {
+                uncoveredRegion -= intersection;
+                hasAlphaChannel = hasAlphaChannel || pieces.at(index).second.hasAlphaChannel();
+            }
+        }
+
+        if(!uncoveredRegion.isEmpty())
+        {
+            continue;
+        }
+
+        QImage image(qRound(ratioX * tile->m_rect.width()), qRound(ratioY * tile->m_rect.height()),
+                     hasAlphaChannel ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32);
+
+        // Pixels on the edges of the pieces might not be hit exactly once they are scaled.
+
+        image.fill(0);
+
+        {
+            QPainter painter(&image);
+
+            for(int index = 0; index < pieces.count(); ++index)
+            {
+                const QRect& rect = pieces.at(index).first;
+
+                if(rect.intersects(tile->m_rect))
+                {
+                    const QRectF target(ratioX * (rect.x() - tile->m_rect.x()), ratioY * (rect.y() - tile->m_rect.y()),
+                                        ratioX * rect.width(), ratioY * rect.height());
+
+                    painter.drawImage(target, pieces.at(index).second);
+                }
+            }
+        }
+
+#if QT_VERSION >= QT_VERSION_CHECK(5,1,0)
+
+        image.setDevicePixelRatio(firstImage.devicePixelRatio());
+
+#endif // QT_VERSION
+
+        const QPixmap pixmap = convertToPixmap(image);
+
+        const int cost = pixmap.width() * pixmap.height() * pixmap.depth() / 8;
+        s_cache.insert(tileKey, CacheObject(pixmap, QRectF()), cost);
+    }
+}
+
+void TileItem::recolorCachedPixmaps(PageItem* page)
+{
+    const CacheKey key = page->m_tileItems.first()->cacheKey();
+
+    foreach(const TileItem* tile, page->m_tileItems)
+    {
+        CacheKey tileKey = key;
+        tileKey.rect = tile->m_rect;
+
+        if(tile->m_rect.isEmpty() || s_cache.contains(tileKey))
+        {
+            continue;
+        }
+
+        // Sources using the same grayscale setting are preferred as they only have to be inverted.
+
+        QList< QPair< bool, bool > > variants;
+        variants.append(qMakePair(key.convertToGrayscale, !key.invertColors));
+
+        if(key.convertToGrayscale)
+        {
+            variants.append(qMakePair(false, key.invertColors));
+            variants.append(qMakePair(false, !key.invertColors));
+        }
+
+        CacheKey sourceKey = tileKey;
+        const CacheObject* source = 0;
+
+        for(int index = 0; index < variants.count() && source == 0; ++index)
+        {
+            sourceKey.convertToGrayscale = variants.at(index).first;
+            sourceKey.invertColors = variants.at(index).second;
+
+            if(s_cache.contains(sourceKey))
+            {
+                source = s_cache.object(sourceKey);
+            }
+        }
+
+        if(source == 0)
+        {
+            continue;
+        }
+
+        const TraceSpan span("tile", "recolorCachedPixmap");
+
+        QImage image = source->isCompact() ? source->image : source->pixmap.toImage();
+
+        if(!RenderTask::convertColors(image,
+                                      sourceKey.convertToGrayscale, sourceKey.invertColors,
+                                      key.convertToGrayscale, key.invertColors))
+        {
+            continue;
+        }
+
+        const QRectF cropRect = source->cropRect;
+        const QPixmap pixmap = convertToPixmap(image);
+
+        const int cost = pixmap.width() * pixmap.height() * pixmap.depth() / 8;
+        s_cache.insert(tileKey, CacheObject(pixmap, cropRect), cost);
+    }
+}
+
+void TileItem::setCacheBudget(int maxCost, int backgroundMaxCost)
+{
+    s_cache.setMaxCost(maxCost);
+    s_cache.setBackgroundMaxCost(backgroundMaxCost);
+}
+
+void TileItem::setForegroundPages(const QVector< PageItem* >& pages)
+{
+    QSet< int > foregroundPages;
+
+    foreach(const PageItem* page, pages)
+    {
+        foregroundPages.insert(page->m_cacheId);
+    }
+
+    s_cache.setForegroundPages(foregroundPages);
 }
 
 void TileItem::paint(QPainter* painter, const QPointF& topLeft)
 {
     const QPixmap& pixmap = takePixmap();
 
+    const qreal tileScale = parentPage()->tileScale();
+    const QRectF displayedRect = scaleRect(m_rect, tileScale);
+
     if(!pixmap.isNull())
     {
         // pixmap
 
-        painter->drawPixmap(m_rect.topLeft() + topLeft, pixmap);
+        if(tileScale == 1.0)
+        {
+            painter->drawPixmap(m_rect.topLeft() + topLeft, pixmap);
+        }
+        else
+        {
+            painter->save();
+
+            painter->setRenderHint(QPainter::SmoothPixmapTransform);
+            painter->drawPixmap(displayedRect.translated(topLeft), pixmap, QRectF());
+
+            painter->restore();
+        }
     }
     else if(!m_obsoletePixmap.isNull())
     {
         // obsolete pixmap
 
-        painter->drawPixmap(QRectF(m_rect).translated(topLeft), m_obsoletePixmap, QRectF());
+        painter->drawPixmap(displayedRect.translated(topLeft), m_obsoletePixmap, QRectF());
+    }
+    else if(paintNearestScale(painter, topLeft))
+    {
+        // cached pixmaps of the nearest scale factor
     }
     else
     {
-        const qreal iconExtent = qMin(0.1 * m_rect.width(), 0.1 * m_rect.height());
-        const QRect iconRect(topLeft.x() + m_rect.left() + 0.01 * m_rect.width(),
-                             topLeft.y() + m_rect.top() + 0.01 * m_rect.height(),
+        const qreal iconExtent = qMin(0.1 * displayedRect.width(), 0.1 * displayedRect.height());
+        const QRect iconRect(topLeft.x() + displayedRect.left() + 0.01 * displayedRect.width(),
+                             topLeft.y() + displayedRect.top() + 0.01 * displayedRect.height(),
                              iconExtent, iconExtent);
 
         if(!m_pixmapError)
@@ -130,11 +418,11 @@ void TileItem::refresh(bool keepObsoletePixmaps)
 {
     if(keepObsoletePixmaps && s_settings->pageItem().keepObsoletePixmaps())
     {
-        CacheObject* object = s_cache.object(cacheKey());
+        const CacheObject* object = s_cache.object(cacheKey());
 
         if(object != 0)
         {
-            m_obsoletePixmap = object->first;
+            m_obsoletePixmap = object->toPixmap();
         }
     }
     else
@@ -153,23 +441,72 @@ void TileItem::refresh(bool keepObsoletePixmaps)
     m_pixmap = QPixmap();
 }
 
-int TileItem::startRender(bool prefetch)
+int TileItem::startRender(bool prefetch, bool nearVisible)
 {
-    if(m_pixmapError || m_renderTask->isRunning() || (prefetch && s_cache.contains(cacheKey())))
+    if(m_pixmapError || (prefetch && isCached()))
     {
         return 0;
     }
 
-    m_renderTask->start(parentPage()->m_renderParam,
+    PageItem* page = parentPage();
+
+    if(page->slicesPageRender())
+    {
+        return page->startPageRender(prefetch, nearVisible);
+    }
+
+    RenderScheduler::Priority priority;
+
+    if(page->thumbnailMode())
+    {
+        priority = RenderScheduler::ThumbnailPriority;
+    }
+    else if(!prefetch)
+    {
+        priority = RenderScheduler::VisiblePriority;
+    }
+    else
+    {
+        priority = nearVisible ? RenderScheduler::NearVisiblePriority : RenderScheduler::PrefetchPriority;
+    }
+
+    if(m_renderTask->isRunning())
+    {
+        m_renderTask->reprioritize(priority);
+
+        return 0;
+    }
+
+    bool previewFirst = false;
+
+    if(!prefetch && !page->thumbnailMode() && s_settings->pageItem().progressiveRendering() && m_obsoletePixmap.isNull())
+    {
+        const CacheObject* object = s_cache.object(cacheKey(true));
+
+        if(object != 0)
+        {
+            m_obsoletePixmap = object->toPixmap();
+        }
+        else
+        {
+            previewFirst = true;
+        }
+    }
+
+    // Margins are only detected until the crop rectangle of the page is known as it does not depend on the scale factor.
+
+    m_renderTask->start(page->tileRenderParam(),
                         m_rect, prefetch,
-                        s_settings->pageItem().trimMargins(), s_settings->pageItem().paperColor());
+                        s_settings->pageItem().trimMargins() && page->cropRect().isNull(), s_settings->pageItem().paperColor(),
+                        priority, page->scene(),
+                        previewFirst, diskCache(page), diskCacheKey(page, m_rect));
 
     return 1;
 }
 
-void TileItem::cancelRender()
+void TileItem::cancelRender(bool force)
 {
-    m_renderTask->cancel();
+    m_renderTask->cancel(force);
 
     m_pixmap = QPixmap();
     m_obsoletePixmap = QPixmap();
@@ -194,37 +531,50 @@ void TileItem::on_renderTask_finished()
     parentPage()->update();
 }
 
-void TileItem::on_renderTask_imageReady(const RenderParam& renderParam,
-                                        const QRect& rect, bool prefetch,
-                                        QImage image, QRectF cropRect)
+void TileItem::on_renderTask_previewReady(const RenderParam& renderParam,
+                                          const QRect& rect,
+                                          QImage image)
 {
-    if(parentPage()->m_renderParam != renderParam || m_rect != rect)
+    if(parentPage()->tileRenderParam() != renderParam || m_rect != rect)
     {
         return;
     }
 
-    m_obsoletePixmap = QPixmap();
-
-    if(image.isNull())
+    if(image.isNull() || m_renderTask->wasCanceled())
     {
-        m_pixmapError = true;
-
         return;
     }
 
-    if(prefetch && !m_renderTask->wasCanceledForcibly())
+    const QPixmap pixmap = convertToPixmap(image);
+
+    const int cost = image.width() * image.height() * image.depth() / 8;
+    s_cache.insert(cacheKey(true), CacheObject(pixmap, QRectF()), cost);
+
+    if(m_pixmap.isNull() && m_obsoletePixmap.isNull())
     {
-        const int cost = image.width() * image.height() * image.depth() / 8;
-        s_cache.insert(cacheKey(), new CacheObject(QPixmap::fromImage(image), cropRect), cost);
+        m_obsoletePixmap = pixmap;
 
-        setCropRect(cropRect);
+        parentPage()->update();
     }
-    else if(!m_renderTask->wasCanceled())
+}
+
+void TileItem::on_renderTask_imageReady(const RenderParam& renderParam,
+                                        const QRect& rect, bool prefetch,
+                                        QImage image, QRectF cropRect)
+{
+    const TraceSpan span("tile", "imageReady");
+
+    if(parentPage()->tileRenderParam() != renderParam || m_rect != rect)
     {
-        m_pixmap = QPixmap::fromImage(image);
+        return;
+    }
 
-        setCropRect(cropRect);
+    if(!image.isNull())
+    {
+        parentPage()->updateRenderRate(m_renderTask->renderDuration(), image.size());
     }
+
+    setImage(m_renderTask, prefetch, image, cropRect);
 }
 
 inline PageItem* TileItem::parentPage() const
@@ -232,21 +582,146 @@ inline PageItem* TileItem::parentPage() const
     return qobject_cast< PageItem* >(parent());
 }
 
-inline TileItem::CacheKey TileItem::cacheKey() const
+inline TileItem::CacheKey TileItem::cacheKey(bool preview) const
 {
     PageItem* page = parentPage();
+    const RenderParam renderParam = page->tileRenderParam();
+    CacheKey key;
+
+    key.page = page->m_cacheId;
+
+    key.resolutionX = renderParam.resolution.resolutionX;
+    key.resolutionY = renderParam.resolution.resolutionY;
+    key.scaleFactor = renderParam.scaleFactor;
+    key.rotation = renderParam.rotation;
+    key.invertColors = renderParam.invertColors;
+    key.convertToGrayscale = renderParam.convertToGrayscale;
+
+    key.preview = preview;
+
+    key.rect = m_rect;
+
+    return key;
+}
+
+bool TileItem::isCached() const
+{
+    return s_cache.contains(cacheKey());
+}
+
+DiskCache* TileItem::diskCache(const PageItem* page)
+{
+    // Thumbnails are kept in a separate store so that they survive even when tiles are not cached on disk.
+
+    return page->thumbnailMode() ? DiskCache::thumbnailInstance() : DiskCache::instance();
+}
+
+QByteArray TileItem::diskCacheKey(const PageItem* page, const QRect& rect)
+{
+    if(page->m_documentKey.isEmpty() || !diskCache(page)->isEnabled())
+    {
+        return QByteArray();
+    }
+
+    const RenderParam renderParam = page->tileRenderParam();
+
     QByteArray key;
 
     QDataStream(&key, QIODevice::WriteOnly)
-            << page->m_renderParam.resolution.resolutionX
-            << page->m_renderParam.resolution.resolutionY
-            << page->m_renderParam.scaleFactor
-            << page->m_renderParam.rotation
-            << page->m_renderParam.invertColors
-            << page->m_renderParam.convertToGrayscale
-            << m_rect;
-
-    return qMakePair(page, key);
+            << page->m_index
+            << s_settings->pageItem().trimMargins()
+            << s_settings->pageItem().paperColor().rgb()
+            << renderParam.resolution.resolutionX
+            << renderParam.resolution.resolutionY
+            << renderParam.scaleFactor
+            << renderParam.rotation
+            << renderParam.invertColors
+            << renderParam.convertToGrayscale
+            << rect;
+
+    return page->m_documentKey + key;
+}
+
+bool TileItem::paintNearestScale(QPainter* painter, const QPointF& topLeft) const
+{
+    const CacheKey key = cacheKey();
+    const QList< TileCache::Entry > entries = s_cache.entriesOnPage(key.page);
+
+    if(entries.isEmpty())
+    {
+        return false;
+    }
+
+    // Pick the scale factor which is closest in ratio among those whose tiles overlap this one.
+
+    qreal nearestScaleFactor = 0.0;
+    qreal nearestDistance = 0.0;
+
+    foreach(const TileCache::Entry& entry, entries)
+    {
+        const CacheKey& other = entry.first;
+
+        if(other.resolutionX != key.resolutionX || other.resolutionY != key.resolutionY
+                || other.rotation != key.rotation
+                || other.invertColors != key.invertColors || other.convertToGrayscale != key.convertToGrayscale
+                || other.scaleFactor == key.scaleFactor || other.scaleFactor <= 0.0)
+        {
+            continue;
+        }
+
+        const qreal ratio = key.scaleFactor / other.scaleFactor;
+        const QRectF rect(ratio * other.rect.x(), ratio * other.rect.y(), ratio * other.rect.width(), ratio * other.rect.height());
+
+        if(!rect.intersects(m_rect))
+        {
+            continue;
+        }
+
+        const qreal distance = qAbs(qLn(ratio));
+
+        if(nearestScaleFactor == 0.0 || distance < nearestDistance)
+        {
+            nearestScaleFactor = other.scaleFactor;
+            nearestDistance = distance;
+        }
+    }
+
+    if(nearestScaleFactor == 0.0)
+    {
+        return false;
+    }
+
+    const qreal ratio = key.scaleFactor / nearestScaleFactor;
+    const qreal tileScale = parentPage()->tileScale();
+
+    painter->save();
+
+    painter->setClipRect(scaleRect(m_rect, tileScale).translated(topLeft), Qt::IntersectClip);
+    painter->setRenderHint(QPainter::SmoothPixmapTransform);
+
+    foreach(const TileCache::Entry& entry, entries)
+    {
+        const CacheKey& other = entry.first;
+
+        if(other.scaleFactor != nearestScaleFactor
+                || other.resolutionX != key.resolutionX || other.resolutionY != key.resolutionY
+                || other.rotation != key.rotation
+                || other.invertColors != key.invertColors || other.convertToGrayscale != key.convertToGrayscale)
+        {
+            continue;
+        }
+
+        const QRectF rect(ratio * other.rect.x(), ratio * other.rect.y(), ratio * other.rect.width(), ratio * other.rect.height());
+
+        if(rect.intersects(m_rect))
+        {
+            painter->drawPixmap(scaleRect(rect, tileScale).translated(topLeft), entry.second.toPixmap(), QRectF());
+        }
+    }
+
+    painter->restore();
+
+    return true;
 }
 
 QPixmap TileItem::takePixmap()
@@ -258,8 +733,22 @@ QPixmap TileItem::takePixmap()
     {
         m_obsoletePixmap = QPixmap();
 
-        setCropRect(object->second);
-        return object->first;
+        setCropRect(object->cropRect);
+
+        if(object->isCompact())
+        {
+            // Tiles which are actually painted are promoted to pixmaps to avoid converting them again.
+
+            const QPixmap pixmap = convertToPixmap(object->image);
+            const QRectF cropRect = object->cropRect;
+
+            const int cost = pixmap.width() * pixmap.height() * pixmap.depth() / 8;
+            s_cache.insert(key, CacheObject(pixmap, cropRect), cost);
+
+            return pixmap;
+        }
+
+        return object->pixmap;
     }
 
     QPixmap pixmap;
@@ -267,7 +756,7 @@ QPixmap TileItem::takePixmap()
     if(!m_pixmap.isNull())
     {
         int cost = m_pixmap.width() * m_pixmap.height() * m_pixmap.depth() / 8;
-        s_cache.insert(key, new CacheObject(m_pixmap, m_cropRect), cost);
+        s_cache.insert(key, CacheObject(m_pixmap, m_cropRect), cost);
 
         pixmap = m_pixmap;
         m_pixmap = QPixmap();
@@ -280,4 +769,38 @@ QPixmap TileItem::takePixmap()
     return pixmap;
 }
 
+void TileItem::setImage(const RenderTask* renderTask, bool prefetch, const QImage& image, const QRectF& cropRect)
+{
+    m_obsoletePixmap = QPixmap();
+
+    if(image.isNull())
+    {
+        m_pixmapError = true;
+
+        return;
+    }
+
+    if(prefetch && !renderTask->wasCanceledForcibly())
+    {
+        const int cost = image.width() * image.height() * image.depth() / 8;
+
+        if(image.depth() < 32)
+        {
+            s_cache.insert(cacheKey(), CacheObject(image, cropRect), cost);
+        }
+        else
+        {
+            s_cache.insert(cacheKey(), CacheObject(convertToPixmap(image), cropRect), cost);
+        }
+
+        setCropRect(cropRect);
+    }
+    else if(!renderTask->wasCanceled())
+    {
+        m_pixmap = convertToPixmap(image);
+
+        setCropRect(cropRect);
+    }
+}
+
 } // qpdfview
@@ -22,16 +22,18 @@ along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef TILEITEM_H
 #define TILEITEM_H
 
-#include <QCache>
 #include <QObject>
 #include <QPixmap>
+#include <QVector>
 
 #include "global.h"
+#include "tilecache.h"
 
 namespace qpdfview
 {
 
 class Settings;
+class DiskCache;
 class RenderTask;
 class PageItem;
 
@@ -39,6 +41,8 @@ class TileItem : public QObject
 {
     Q_OBJECT
 
+    friend class PageItem;
+
 public:
     TileItem(QObject* parent = 0);
     ~TileItem();
@@ -46,6 +50,10 @@ public:
     inline const QRect& rect() const { return m_rect; }
     inline void setRect(const QRect& rect) { m_rect = rect; }
 
+    // Tiles of the pyramid are laid out at the scale factor of their level and cover this rectangle at the current one.
+
+    QRectF displayedRect() const;
+
     inline const QRectF& cropRect() const { return m_cropRect; }
     void setCropRect(const QRectF& cropRect);
 
@@ -53,19 +61,41 @@ public:
     inline void dropObsoletePixmap() { m_obsoletePixmap = QPixmap(); }
 
     static void dropCachedPixmaps(PageItem* page);
+    static void dropCachedPixmaps(int cacheId);
+
+    // Derives the tiles of a page which was just rotated from those cached for its previous rotation where they cover them completely.
+
+    static void rotateCachedPixmaps(PageItem* page, Rotation oldRotation, const QSize& oldSize);
+
+    // Derives the tiles of a page whose colour settings just changed from those cached using other colour settings.
+
+    static void recolorCachedPixmaps(PageItem* page);
+
+    static void setCacheBudget(int maxCost, int backgroundMaxCost);
+    static void setForegroundPages(const QVector< PageItem* >& pages);
+
+    static inline int cacheMaxCost() { return s_cache.maxCost(); }
+    static inline int cacheTotalCost() { return s_cache.totalCost(); }
+    static int cacheCost(const PageItem* page);
+    static int cacheCost(int cacheId);
+    static inline const TileCache::Statistics& cacheStatistics() { return s_cache.statistics(); }
+    static inline void resetCacheStatistics() { s_cache.resetStatistics(); }
 
     void paint(QPainter* painter, const QPointF& topLeft);
 
 public slots:
     void refresh(bool keepObsoletePixmaps = false);
 
-    int startRender(bool prefetch = false);
-    void cancelRender();
+    int startRender(bool prefetch = false, bool nearVisible = false);
+    void cancelRender(bool force = false);
 
     void deleteAfterRender();
 
 protected slots:
     void on_renderTask_finished();
+    void on_renderTask_previewReady(const RenderParam& renderParam,
+                                    const QRect& rect,
+                                    QImage image);
     void on_renderTask_imageReady(const RenderParam& renderParam,
                                   const QRect& rect, bool prefetch,
                                   QImage image, QRectF cropRect);
@@ -75,13 +105,17 @@ private:
 
     static Settings* s_settings;
 
-    typedef QPair< PageItem*, QByteArray > CacheKey;
-    typedef QPair< QPixmap, QRectF > CacheObject;
+    typedef TileKey CacheKey;
+    typedef TileObject CacheObject;
 
-    static QCache< CacheKey, CacheObject > s_cache;
+    static TileCache s_cache;
 
     PageItem* parentPage() const;
-    CacheKey cacheKey() const;
+    CacheKey cacheKey(bool preview = false) const;
+    static DiskCache* diskCache(const PageItem* page);
+    static QByteArray diskCacheKey(const PageItem* page, const QRect& rect);
+
+    bool isCached() const;
 
     QRect m_rect;
     QRectF m_cropRect;
@@ -92,6 +126,10 @@ private:
 
     QPixmap takePixmap();
 
+    void setImage(const RenderTask* renderTask, bool prefetch, const QImage& image, const QRectF& cropRect);
+
+    bool paintNearestScale(QPainter* painter, const QPointF& topLeft) const;
+
     RenderTask* m_renderTask;
 
 };
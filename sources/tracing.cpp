@@ -0,0 +1,207 @@
+/*
+
+Copyright 2014 Adam Reichold
+
+This file is part of qpdfview.
+
+qpdfview is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+qpdfview is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "tracing.h"
+
+#include <QFile>
+#include <QThread>
+
+namespace
+{
+
+// bounds the memory used by a long running trace to roughly 20 MB
+const int maxEvents = 500000;
+
+} // anonymous
+
+namespace qpdfview
+{
+
+bool Tracing::s_enabled = false;
+QString Tracing::s_filePath;
+
+QElapsedTimer Tracing::s_timer;
+
+QMutex Tracing::s_mutex;
+
+QVector< Tracing::Event > Tracing::s_events;
+int Tracing::s_droppedEvents = 0;
+
+QHash< Qt::HANDLE, int > Tracing::s_threads;
+
+void Tracing::start(const QString& filePath)
+{
+    QMutexLocker mutexLocker(&s_mutex);
+
+    s_filePath = filePath;
+
+    s_events.clear();
+    s_droppedEvents = 0;
+
+    // The thread starting the trace is the main thread and hence always the first one.
+
+    s_threads.clear();
+    s_threads.insert(QThread::currentThreadId(), 1);
+
+    s_timer.start();
+
+    s_enabled = true;
+}
+
+bool Tracing::stop()
+{
+    QMutexLocker mutexLocker(&s_mutex);
+
+    if(!s_enabled)
+    {
+        return true;
+    }
+
+    s_enabled = false;
+
+    QFile file(s_filePath);
+
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        return false;
+    }
+
+    QByteArray data;
+    data.reserve(128 * s_events.count() + 1024);
+
+    data.append("{\"traceEvents\":[\n");
+
+    data.append("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"main\"}}");
+
+    for(int thread = 2; thread <= s_threads.count(); ++thread)
+    {
+        data.append(",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":");
+        data.append(QByteArray::number(thread));
+        data.append(",\"args\":{\"name\":\"worker ");
+        data.append(QByteArray::number(thread - 1));
+        data.append("\"}}");
+    }
+
+    foreach(const Event& event, s_events)
+    {
+        data.append(",\n{\"name\":\"");
+        data.append(event.name);
+        data.append("\",\"cat\":\"");
+        data.append(event.category);
+        data.append("\",\"ph\":\"X\",\"pid\":1,\"tid\":");
+        data.append(QByteArray::number(event.thread));
+        data.append(",\"ts\":");
+        data.append(QByteArray::number(event.begin));
+        data.append(",\"dur\":");
+        data.append(QByteArray::number(event.duration));
+
+        if(event.key != 0)
+        {
+            data.append(",\"args\":{\"");
+            data.append(event.key);
+            data.append("\":");
+            data.append(QByteArray::number(event.value));
+            data.append("}");
+        }
+
+        data.append("}");
+    }
+
+    data.append("\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"droppedEvents\":");
+    data.append(QByteArray::number(s_droppedEvents));
+    data.append("}}\n");
+
+    s_events.clear();
+    s_threads.clear();
+
+    return file.write(data) == data.size();
+}
+
+qint64 Tracing::timestamp()
+{
+    if(!s_enabled)
+    {
+        return 0;
+    }
+
+#if QT_VERSION >= QT_VERSION_CHECK(4,8,0)
+
+    return s_timer.nsecsElapsed() / 1000;
+
+#else
+
+    return s_timer.elapsed() * 1000;
+
+#endif // QT_VERSION
+}
+
+void Tracing::recordSpan(const char* category, const char* name, qint64 begin, const char* key, qint64 value)
+{
+    if(!s_enabled)
+    {
+        return;
+    }
+
+    const qint64 end = timestamp();
+
+    QMutexLocker mutexLocker(&s_mutex);
+
+    // Workers might still finish their spans after the trace was written.
+
+    if(!s_enabled)
+    {
+        return;
+    }
+
+    if(s_events.count() >= maxEvents)
+    {
+        ++s_droppedEvents;
+
+        return;
+    }
+
+    const Qt::HANDLE threadId = QThread::currentThreadId();
+
+    QHash< Qt::HANDLE, int >::const_iterator thread = s_threads.constFind(threadId);
+
+    if(thread == s_threads.constEnd())
+    {
+        thread = s_threads.insert(threadId, s_threads.count() + 1);
+    }
+
+    Event event;
+
+    event.category = category;
+    event.name = name;
+
+    event.begin = begin;
+    event.duration = end - begin;
+
+    event.thread = thread.value();
+
+    event.key = key;
+    event.value = value;
+
+    s_events.append(event);
+}
+
+} // qpdfview
@@ -0,0 +1,125 @@
+/*
+
+Copyright 2014 Adam Reichold
+
+This file is part of qpdfview.
+
+qpdfview is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+qpdfview is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with qpdfview.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef TRACING_H
+#define TRACING_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+namespace qpdfview
+{
+
+// Records spans of render and search activity as Chrome trace events, so that a timeline can be loaded into Perfetto or "about:tracing".
+
+class Tracing
+{
+public:
+    // Tracing has to be started before any other thread is, since whether it is enabled is not synchronized.
+
+    static inline bool isEnabled() { return s_enabled; }
+
+    static void start(const QString& filePath);
+    static bool stop();
+
+    // in microseconds since tracing was started
+    static qint64 timestamp();
+
+    // The category, name and key have to be string literals since they are only written out when tracing is stopped.
+
+    static void recordSpan(const char* category, const char* name, qint64 begin, const char* key = 0, qint64 value = 0);
+
+private:
+    Q_DISABLE_COPY(Tracing)
+
+    Tracing();
+
+    struct Event
+    {
+        const char* category;
+        const char* name;
+
+        qint64 begin;
+        qint64 duration;
+
+        int thread;
+
+        const char* key;
+        qint64 value;
+
+    };
+
+    static bool s_enabled;
+    static QString s_filePath;
+
+    static QElapsedTimer s_timer;
+
+    static QMutex s_mutex;
+
+    static QVector< Event > s_events;
+    static int s_droppedEvents;
+
+    static QHash< Qt::HANDLE, int > s_threads;
+
+};
+
+// Records a span from its construction until its destruction if tracing is enabled.
+
+class TraceSpan
+{
+public:
+    TraceSpan(const char* category, const char* name, const char* key = 0, qint64 value = 0) :
+        m_category(category),
+        m_name(name),
+        m_key(key),
+        m_value(value),
+        m_begin(Tracing::isEnabled() ? Tracing::timestamp() : -1)
+    {
+    }
+
+    ~TraceSpan()
+    {
+        if(m_begin >= 0)
+        {
+            Tracing::recordSpan(m_category, m_name, m_begin, m_key, m_value);
+        }
+    }
+
+private:
+    Q_DISABLE_COPY(TraceSpan)
+
+    const char* m_category;
+    const char* m_name;
+
+    const char* m_key;
+    qint64 m_value;
+
+    qint64 m_begin;
+
+};
+
+} // qpdfview
+
+#endif // TRACING_H